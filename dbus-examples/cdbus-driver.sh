@@ -25,6 +25,13 @@ type_enum='uint16'
 # List all window ID compton manages (except destroyed ones)
 dbus-send --print-reply --dest="$service" "$object" "${interface}.list_win"
 
+# Get name, class, opacity and focus state of all windows in one call. Pass
+# window IDs in the second array to limit it to those windows.
+dbus-send --print-reply --dest="$service" "$object" "${interface}.win_snapshot" array:string:name,class_general,opacity,focused_real,mode "array:${type_win}:"
+
+# Get win_diff signals carrying changes to window names and opacity
+dbus-send --print-reply --dest="$service" "$object" "${interface}.win_watch" array:string:name,opacity
+
 # Ensure we are tracking focus
 dbus-send --print-reply --dest="$service" "$object" "${interface}.opts_set" string:track_focus boolean:true
 
@@ -41,6 +48,26 @@ else
   echo "Cannot find focused window."
 fi
 
+# Apply several changes at once, with a single repaint. dbus-send uses a new
+# connection for each call, so a transaction needs a client that keeps its
+# connection, like this one in Python:
+#   iface.begin()
+#   iface.opts_set('clear_shadow', True)
+#   iface.opts_set('no_fading_openclose', True)
+#   iface.win_set(wid, 'shadow_force', dbus.UInt16(0))
+#   iface.commit()
+
+# Capture painted frames into a shared memory ring of 3 slots. The reply is a
+# file descriptor to mmap(); the ring starts with a header giving the frame
+# size, stride, slot layout and latest_seq, the sequence number of the latest
+# complete frame. Frame seq is in slot (seq - 1) % nslots, whose header has seq
+# (0 while being written, so re-check it after copying) and the rectangles that
+# changed since frame seq - 1 (none means the whole frame). Pixels are 32-bit
+# B8G8R8X8. capture_stop, or a change of screen size, sets the closed field.
+#   fd = iface.capture_start(dbus.UInt32(3)).take()
+#   ...
+#   iface.capture_stop()
+
 # Set the clear_shadow setting to true
 dbus-send --print-reply --dest="$service" "$object" "${interface}.opts_set" string:clear_shadow boolean:true
 
@@ -59,5 +86,9 @@ dbus-send --print-reply --dest="$service" "$object" "${interface}.opts_set" stri
 sleep 3
 dbus-send --print-reply --dest="$service" "$object" "${interface}.opts_set" string:redirected_force uint16:2
 
+# Get the time the last redirection and its first frame took
+dbus-send --print-reply --dest="$service" "$object" "${interface}.opts_get" string:redir_start_us
+dbus-send --print-reply --dest="$service" "$object" "${interface}.opts_get" string:redir_frame_us
+
 # Force repaint
 dbus-send --print-reply --dest="$service" "$object" "${interface}.repaint"
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# Check compton's D-Bus interface against a running instance.
+#
+# Requires dbus-python. Run it on the display compton manages, with at
+# least one window mapped:
+#   DISPLAY=:0 ./cdbus-test.py
+# It changes clear_shadow for a moment and puts it back.
+
+import os
+import re
+import sys
+import time
+
+import dbus
+
+dpy = re.sub('[^0-9A-Za-z]', '_', os.environ.get('DISPLAY', ''))
+if not dpy:
+    print('Cannot find display.')
+    sys.exit(1)
+
+service = 'com.github.chjj.compton.' + dpy
+interface = 'com.github.chjj.compton'
+obj = '/com/github/chjj/compton'
+err_custom = interface + '.error.custom'
+
+failures = 0
+
+
+def check(cond, desc):
+    global failures
+    print('%s: %s' % ('PASS' if cond else 'FAIL', desc))
+    if not cond:
+        failures += 1
+
+
+def client():
+    """Connect to compton on a connection of our own, so each client has
+    its own unique bus name."""
+    bus = dbus.SessionBus(private=True)
+    return bus, dbus.Interface(bus.get_object(service, obj), interface)
+
+
+def error_name(call, *args):
+    """Return the D-Bus error name a call fails with, None on success."""
+    try:
+        call(*args)
+    except dbus.DBusException as e:
+        return e.get_dbus_name()
+    return None
+
+
+bus1, c1 = client()
+bus2, c2 = client()
+
+# === win_get / win_snapshot ===
+
+wids = [int(wid) for wid in c1.list_win()]
+check(len(wids) > 0, 'list_win returns windows')
+
+attrs = ['id', 'map_state', 'name']
+snapshot = c1.win_snapshot(attrs, dbus.Array([], signature='u'))
+check(sorted(int(e[0]) for e in snapshot) == sorted(wids),
+      'win_snapshot covers the windows of list_win')
+check(all(list(e[1]) == attrs for e in snapshot),
+      'win_snapshot names the requested attributes in order')
+check(all(int(e[2][0]) == int(e[0]) for e in snapshot),
+      'win_snapshot id matches the window')
+
+mapped = 0
+for e in snapshot:
+    wid, state = int(e[0]), e[2][1]
+    got = c1.win_get(dbus.UInt32(wid), 'map_state')
+    check(isinstance(got, dbus.Boolean) and isinstance(state, dbus.Boolean),
+          'map_state of %#010x is a boolean' % wid)
+    check(bool(got) == bool(state),
+          'win_get and win_snapshot agree on map_state of %#010x' % wid)
+    mapped += bool(got)
+check(mapped > 0, 'at least one window is mapped')
+
+if wids:
+    one = c1.win_snapshot(attrs, dbus.Array([dbus.UInt32(wids[0])],
+                                            signature='u'))
+    check(len(one) == 1 and int(one[0][0]) == wids[0],
+          'win_snapshot limited to one window returns just that window')
+
+# === Transactions from two clients ===
+
+old = bool(c2.opts_get('clear_shadow'))
+
+check(c1.begin(), 'first client begins a transaction')
+check(error_name(c2.begin) == err_custom,
+      'second client cannot begin while the first one\'s is open')
+check(error_name(c2.commit) == err_custom,
+      'second client cannot commit the first one\'s transaction')
+check(error_name(c2.rollback) == err_custom,
+      'second client cannot roll back the first one\'s transaction')
+
+c1.opts_set('clear_shadow', not old)
+check(bool(c2.opts_get('clear_shadow')) == old,
+      'changes are queued until commit')
+check(c1.commit(), 'first client commits')
+check(bool(c2.opts_get('clear_shadow')) == (not old),
+      'committed changes are applied')
+
+check(c2.begin(), 'second client begins once the first one committed')
+c2.opts_set('clear_shadow', old)
+check(c2.commit(), 'second client commits')
+check(bool(c1.opts_get('clear_shadow')) == old,
+      'second client\'s changes are applied')
+
+# A client leaving the bus drops its transaction
+check(c1.begin(), 'first client begins again')
+bus1.close()
+began = False
+for i in range(20):
+    if error_name(c2.begin) is None:
+        began = True
+        break
+    time.sleep(0.05)
+check(began, 'second client begins once the first one left the bus')
+if began:
+    check(c2.rollback(), 'second client rolls back')
+
+bus2.close()
+
+if failures:
+    print('%d check(s) failed.' % failures)
+    sys.exit(1)
+print('All checks passed.')
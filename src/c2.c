@@ -43,6 +43,16 @@ c2_parsed(session_t *ps, c2_lptr_t **pcondlst, const char *pattern,
     memcpy(plptr, &lptr_def, sizeof(c2_lptr_t));
     plptr->ptr = result;
     plptr->data = data;
+    plptr->src = mstrcpy(pattern);
+    // Conditions are prepended, so the head of a list summarizes the
+    // dependencies of the whole list
+    c2_dep_collect(result, plptr);
+    if (pcondlst && *pcondlst) {
+      const c2_lptr_t *pnext = *pcondlst;
+      plptr->dep_predef |= pnext->dep_predef;
+      for (int i = 0; i < pnext->dep_atoms_cnt; ++i)
+        c2_dep_add_atom(plptr, pnext->dep_atoms[i]);
+    }
     if (pcondlst) {
       plptr->next = *pcondlst;
       *pcondlst = plptr;
@@ -862,11 +872,109 @@ c2_free_lptr(c2_lptr_t *lp) {
 
   c2_lptr_t *pnext = lp->next;
   c2_free(lp->ptr);
+  free(lp->src);
+  free(lp->dep_atoms);
   free(lp);
 
   return pnext;
 }
 
+/**
+ * Add an atom to the dependencies of a condition list element.
+ */
+static void
+c2_dep_add_atom(c2_lptr_t *plptr, Atom atom) {
+  for (int i = 0; i < plptr->dep_atoms_cnt; ++i)
+    if (atom == plptr->dep_atoms[i])
+      return;
+
+  plptr->dep_atoms = realloc(plptr->dep_atoms,
+      (plptr->dep_atoms_cnt + 1) * sizeof(Atom));
+  if (!plptr->dep_atoms)
+    printf_errfq(1, "(): Failed to allocate memory for dependency atoms.");
+  plptr->dep_atoms[plptr->dep_atoms_cnt++] = atom;
+}
+
+/**
+ * Collect the targets a condition tree depends on.
+ */
+static void
+c2_dep_collect(const c2_ptr_t p, c2_lptr_t *plptr) {
+  if (p.isbranch) {
+    const c2_b_t * const pbranch = p.b;
+    if (pbranch) {
+      c2_dep_collect(pbranch->opr1, plptr);
+      c2_dep_collect(pbranch->opr2, plptr);
+    }
+    return;
+  }
+
+  const c2_l_t * const pleaf = p.l;
+  if (!pleaf)
+    return;
+
+  if (pleaf->predef)
+    plptr->dep_predef |= C2_DEP_PREDEF(pleaf->predef);
+  else if (pleaf->tgtatom)
+    c2_dep_add_atom(plptr, pleaf->tgtatom);
+}
+
+/**
+ * Check if any condition in a list depends on window position.
+ */
+bool
+c2_list_dep_pos(const c2_lptr_t *condlst) {
+  return condlst && (condlst->dep_predef & (C2_DEP_PREDEF(C2_L_PX)
+        | C2_DEP_PREDEF(C2_L_PY) | C2_DEP_PREDEF(C2_L_PX2)
+        | C2_DEP_PREDEF(C2_L_PY2) | C2_DEP_PREDEF(C2_L_PFULLSCREEN)));
+}
+
+/**
+ * Check if any condition in a list depends on a window property.
+ */
+bool
+c2_list_dep_atom(session_t *ps, const c2_lptr_t *condlst, Atom atom) {
+  if (!condlst)
+    return false;
+
+  // Properties backing predefined targets
+  uint_fast32_t predef = 0;
+  if (ps->atom_name == atom || ps->atom_name_ewmh == atom)
+    predef |= C2_DEP_PREDEF(C2_L_PNAME);
+  if (ps->atom_class == atom)
+    predef |= C2_DEP_PREDEF(C2_L_PCLASSG) | C2_DEP_PREDEF(C2_L_PCLASSI);
+  if (ps->atom_role == atom)
+    predef |= C2_DEP_PREDEF(C2_L_PROLE);
+  if (ps->atom_win_type == atom)
+    predef |= C2_DEP_PREDEF(C2_L_PWINDOWTYPE);
+  if (ps->atom_transient == atom || ps->atom_client_leader == atom)
+    predef |= C2_DEP_PREDEF(C2_L_PLEADER);
+  if (condlst->dep_predef & predef)
+    return true;
+
+  for (int i = 0; i < condlst->dep_atoms_cnt; ++i)
+    if (atom == condlst->dep_atoms[i])
+      return true;
+
+  return false;
+}
+
+/**
+ * Check if two condition lists were parsed from the same patterns, with
+ * the same attached data, in the same order.
+ */
+bool
+c2_list_equal(const c2_lptr_t *a, const c2_lptr_t *b) {
+  for (; a && b; a = a->next, b = b->next) {
+    if (a->data != b->data)
+      return false;
+    if (!a->src || !b->src || strcmp(a->src, b->src))
+      return false;
+  }
+
+  return !a && !b;
+}
+
 /**
  * Get a string representation of a rule target.
  */
@@ -1067,13 +1175,12 @@ c2_match_once_leaf(session_t *ps, win *w, const c2_l_t *pleaf,
         }
         // A raw window property
         else {
-          winprop_t prop = wid_get_prop_adv(ps, wid, pleaf->tgtatom,
+          winprop_t prop = win_get_prop(ps, w, wid, pleaf->tgtatom,
               idx, 1L, c2_get_atom_type(pleaf), pleaf->format);
           if (prop.nitems) {
             *perr = false;
             tgt = winprop_get_int(prop);
           }
-          free_winprop(&prop);
         }
 
         if (*perr)
@@ -1113,7 +1220,7 @@ c2_match_once_leaf(session_t *ps, win *w, const c2_l_t *pleaf,
         }
         // If it's an atom type property, convert atom to string
         else if (C2_L_TATOM == pleaf->type) {
-          winprop_t prop = wid_get_prop_adv(ps, wid, pleaf->tgtatom,
+          winprop_t prop = win_get_prop(ps, w, wid, pleaf->tgtatom,
               idx, 1L, c2_get_atom_type(pleaf), pleaf->format);
           Atom atom = winprop_get_int(prop);
           if (atom) {
@@ -1122,7 +1229,6 @@ c2_match_once_leaf(session_t *ps, win *w, const c2_l_t *pleaf,
           if (tgt_free) {
             tgt = tgt_free;
           }
-          free_winprop(&prop);
         }
         // Otherwise, just fetch the string list
         else {
@@ -169,13 +169,31 @@ const static c2_l_t leaf_def = C2_L_INIT;
 struct _c2_lptr {
   c2_ptr_t ptr;
   void *data;
+  /// Pattern string the condition was parsed from.
+  char *src;
+  /// Bitmask of predefined targets this condition, or any after it in the
+  /// list, depends on. Bit <code>n</code> stands for predefined target
+  /// <code>n</code>.
+  uint_fast32_t dep_predef;
+  /// Atoms of custom targets this condition, or any after it in the list,
+  /// depends on.
+  Atom *dep_atoms;
+  /// Number of elements in <code>dep_atoms</code>.
+  int dep_atoms_cnt;
   struct _c2_lptr *next;
 };
 
+/// Dependency bit of a predefined target.
+#define C2_DEP_PREDEF(predef) (((uint_fast32_t) 1) << (predef))
+
 /// Initializer for c2_lptr_t.
 #define C2_LPTR_INIT { \
   .ptr = C2_PTR_INIT, \
   .data = NULL, \
+  .src = NULL, \
+  .dep_predef = 0, \
+  .dep_atoms = NULL, \
+  .dep_atoms_cnt = 0, \
   .next = NULL, \
 }
 
@@ -313,6 +331,12 @@ c2_parse_legacy(session_t *ps, const char *pattern, int offset, c2_ptr_t *presul
 static bool
 c2_l_postprocess(session_t *ps, c2_l_t *pleaf);
 
+static void
+c2_dep_add_atom(c2_lptr_t *plptr, Atom atom);
+
+static void
+c2_dep_collect(const c2_ptr_t p, c2_lptr_t *plptr);
+
 static void
 c2_free(c2_ptr_t p);
 
@@ -52,14 +52,20 @@
 // #define CONFIG_VSYNC_OPENGL_GLSL 1
 // Whether to enable GLX FBO support
 // #define CONFIG_VSYNC_OPENGL_FBO 1
+// Whether to enable the glx_core backend on an OpenGL 3.3 core profile.
+// #define CONFIG_GLX_CORE 1
 // Whether to enable DBus support with libdbus.
 // #define CONFIG_DBUS 1
 // Whether to enable condition support.
 // #define CONFIG_C2 1
 // Whether to enable X Sync support.
 // #define CONFIG_XSYNC 1
+// Whether to enable parallel shadow rasterization with POSIX threads.
+// #define CONFIG_SHADOW_THREADS 1
 // Whether to enable GLX Sync support.
 // #define CONFIG_GLX_XSYNC 1
+// Whether to enable event trace recording and replay.
+// #define CONFIG_TRACE 1
 
 #if !defined(CONFIG_C2) && defined(DEBUG_C2)
 #error Cannot enable c2 debugging without c2 support.
@@ -69,6 +75,10 @@
 #error Cannot enable GL sync without X Sync / OpenGL support.
 #endif
 
+#if (!defined(CONFIG_VSYNC_OPENGL_GLSL) || !defined(CONFIG_VSYNC_OPENGL_FBO)) && defined(CONFIG_GLX_CORE)
+#error Cannot enable the glx_core backend without GLSL / FBO support.
+#endif
+
 #ifndef COMPTON_VERSION
 #define COMPTON_VERSION "unknown"
 #endif
@@ -110,6 +120,10 @@
 #include <X11/extensions/Xinerama.h>
 #endif
 
+#ifdef CONFIG_SHADOW_THREADS
+#include <pthread.h>
+#endif
+
 // Workarounds for missing definitions in very old versions of X headers,
 // thanks to consolers for reporting
 #ifndef PictOpDifference
@@ -125,6 +139,7 @@
 // libdbus
 #ifdef CONFIG_DBUS
 #include <dbus/dbus.h>
+#include <X11/extensions/XShm.h>
 #endif
 
 #ifdef CONFIG_VSYNC_OPENGL
@@ -146,6 +161,22 @@
 #define GLX_BACK_BUFFER_AGE_EXT 0x20F4
 #endif
 
+#ifndef GLX_CONTEXT_MAJOR_VERSION_ARB
+#define GLX_CONTEXT_MAJOR_VERSION_ARB 0x2091
+#endif
+
+#ifndef GLX_CONTEXT_MINOR_VERSION_ARB
+#define GLX_CONTEXT_MINOR_VERSION_ARB 0x2092
+#endif
+
+#ifndef GLX_CONTEXT_PROFILE_MASK_ARB
+#define GLX_CONTEXT_PROFILE_MASK_ARB 0x9126
+#endif
+
+#ifndef GLX_CONTEXT_CORE_PROFILE_BIT_ARB
+#define GLX_CONTEXT_CORE_PROFILE_BIT_ARB 0x00000001
+#endif
+
 #endif
 
 // === Macros ===
@@ -207,10 +238,13 @@
 #define REGISTER_PROP "_NET_WM_CM_S"
 
 #define TIME_MS_MAX LONG_MAX
-#define FADE_DELTA_TOLERANCE 0.2
 #define SWOPTI_TOLERANCE 3000
 #define TIMEOUT_RUN_TOLERANCE 0.05
 #define WIN_GET_LEADER_MAX_RECURSION 20
+/// Highest accepted <code>--unredir-if-possible-video-fps</code>.
+#define UNREDIR_VIDEO_FPS_MAX 1000
+/// Most frames the damage rate of a full-screen window is sampled from.
+#define UNREDIR_HIST_MAX 16384
 
 #define SEC_WRAP (15L * 24L * 60L * 60L)
 
@@ -221,6 +255,7 @@
 #define XRFILTER_CONVOLUTION  "convolution"
 #define XRFILTER_GAUSSIAN     "gaussian"
 #define XRFILTER_BINOMIAL     "binomial"
+#define XRFILTER_BILINEAR     "bilinear"
 
 /// @brief Maximum OpenGL FBConfig depth.
 #define OPENGL_MAX_DEPTH 32
@@ -231,6 +266,25 @@
 /// @brief Maximum passes for blur.
 #define MAX_BLUR_PASS 6
 
+/// @brief Number of window records the window arena allocates at once.
+#define WIN_ARENA_CHUNK 64
+
+/// @brief Initial number of buckets of the window hash. Must be a power of 2.
+#define WIN_HASH_INIT_SIZE 64
+
+/// @brief Maximum number of shadow worker threads.
+#define SHADOW_THREADS_MAX 16
+
+/// @brief Number of distinct alpha values of an A8 alpha mask.
+#define ALPHA_PICT_NUM 256
+
+/// @brief Maximum number of alpha Pictures kept alive at once.
+#define ALPHA_PICT_CACHE_MAX 64
+
+/// @brief Length in 32-bit multiples fetched at least when caching a window
+/// property.
+#define WINPROP_CACHE_LEN 64L
+
 // Window flags
 
 // Window size is changed
@@ -319,6 +373,21 @@ typedef struct {
   int format;
 } winprop_t;
 
+/// Cached value of a window property.
+typedef struct _winprop_cache {
+  /// Window the property is on, either the frame or the client window.
+  Window wid;
+  /// Atom of the property.
+  Atom atom;
+  /// Value of the property, fetched from offset 0 with any type.
+  winprop_t prop;
+  /// Length fetched, in 32-bit multiples.
+  long length;
+  /// Whether the property has more data than fetched.
+  bool partial;
+  struct _winprop_cache *next;
+} winprop_cache_t;
+
 typedef struct _ignore {
   struct _ignore *next;
   unsigned long sequence;
@@ -359,11 +428,21 @@ enum blur_method {
     NUM_BLRMTHD,
 };
 
+/// Possible easing curves of a fade.
+enum fade_easing {
+  FADE_EASING_LINEAR,
+  FADE_EASING_IN,
+  FADE_EASING_OUT,
+  FADE_EASING_IN_OUT,
+  NUM_FADE_EASING,
+};
+
 /// @brief Possible backends of compton.
 enum backend {
   BKEND_XRENDER,
   BKEND_GLX,
   BKEND_XR_GLX_HYBRID,
+  BKEND_GLX_CORE,
   NUM_BKEND,
 };
 
@@ -378,10 +457,12 @@ enum {
 typedef struct _glx_texture glx_texture_t;
 
 #ifdef CONFIG_VSYNC_OPENGL
-#ifdef DEBUG_GLX_DEBUG_CONTEXT
+#if defined(DEBUG_GLX_DEBUG_CONTEXT) || defined(CONFIG_GLX_CORE)
 typedef GLXContext (*f_glXCreateContextAttribsARB) (Display *dpy,
     GLXFBConfig config, GLXContext share_context, Bool direct,
     const int *attrib_list);
+#endif
+#ifdef DEBUG_GLX_DEBUG_CONTEXT
 typedef void (*GLDEBUGPROC) (GLenum source, GLenum type,
     GLuint id, GLenum severity, GLsizei length, const GLchar* message,
     GLvoid* userParam);
@@ -448,6 +529,23 @@ typedef void (*f_StringMarkerGREMEDY) (GLsizei len, const void *string);
 typedef void (*f_FrameTerminatorGREMEDY) (void);
 #endif
 
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+typedef void (*f_GetProgramBinary) (GLuint program, GLsizei bufSize,
+    GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (*f_ProgramBinary) (GLuint program, GLenum binaryFormat,
+    const void *binary, GLsizei length);
+typedef void (*f_ProgramParameteri) (GLuint program, GLenum pname,
+    GLint value);
+#endif
+
 /// @brief Wrapper of a GLX FBConfig.
 typedef struct {
   GLXFBConfig cfg;
@@ -488,6 +586,24 @@ typedef struct {
   GLint unifm_fulltex;
 } glx_blur_pass_t;
 
+/// Magic number of a GLSL program binary cache file.
+#define GLX_PROG_CACHE_MAGIC 0x43504743
+
+/// Upper bound of the size of a cached GLSL program binary.
+#define GLX_PROG_CACHE_MAX_LEN (16 * 1024 * 1024)
+
+/// Header of a GLSL program binary cache file.
+typedef struct {
+  /// Always <code>GLX_PROG_CACHE_MAGIC</code>.
+  uint32_t magic;
+  /// Binary format reported by the driver.
+  uint32_t format;
+  /// Cache key the binary was stored under.
+  uint64_t key;
+  /// Length of the binary following the header.
+  uint32_t length;
+} glx_prog_cache_hdr_t;
+
 typedef struct {
   /// Framebuffer used for blurring.
   GLuint fbo;
@@ -517,6 +633,135 @@ typedef struct {
   .unifm_tex = -1, \
 }
 
+typedef struct {
+  /// GLSL program.
+  GLuint prog;
+  /// Location of uniform "box" in shadow GLSL program.
+  GLint unifm_box;
+  /// Location of uniform "color" in shadow GLSL program.
+  GLint unifm_color;
+  /// Location of uniform "sigma_inv" in shadow GLSL program.
+  GLint unifm_sigma_inv;
+  /// Location of uniform "norm" in shadow GLSL program.
+  GLint unifm_norm;
+  /// Location of uniform "support" in shadow GLSL program.
+  GLint unifm_support;
+} glx_prog_shadow_t;
+
+#define GLX_PROG_SHADOW_INIT { \
+  .prog = 0, \
+  .unifm_box = -1, \
+  .unifm_color = -1, \
+  .unifm_sigma_inv = -1, \
+  .unifm_norm = -1, \
+  .unifm_support = -1, \
+}
+
+/// Bits of the key selecting a specialized window shader variant.
+enum {
+  /// Texture has a meaningful, premultiplied alpha channel.
+  GLX_WVAR_ARGB     = 1 << 0,
+  /// Window is painted with an opacity below 1.
+  GLX_WVAR_OPACITY  = 1 << 1,
+  /// Window color is inverted.
+  GLX_WVAR_INVERT   = 1 << 2,
+  /// Window is dimmed. Only used by variants painting without blending.
+  GLX_WVAR_DIM      = 1 << 3,
+  /// Window frame has its own opacity.
+  GLX_WVAR_FRAME    = 1 << 4,
+  /// Texture target is GL_TEXTURE_RECTANGLE.
+  GLX_WVAR_RECT     = 1 << 5,
+  /// Number of window shader variants.
+  GLX_WVAR_NUM      = 1 << 6,
+};
+
+/// A specialized window shader variant.
+typedef struct {
+  /// GLSL program, built on first use.
+  GLuint prog;
+  /// Whether building the program failed.
+  bool failed;
+  /// Location of uniform "tex".
+  GLint unifm_tex;
+  /// Location of uniform "opacity".
+  GLint unifm_opacity;
+  /// Location of uniform "dim".
+  GLint unifm_dim;
+  /// Location of uniform "frame_opacity".
+  GLint unifm_frame_opacity;
+  /// Location of uniform "body".
+  GLint unifm_body;
+} glx_prog_variant_t;
+
+/// Parameters of painting a window with a shader variant.
+typedef struct {
+  /// Opacity of the window, or its body if the frame has its own.
+  double opacity;
+  /// Whether the window has an alpha channel.
+  bool argb;
+  /// Whether to invert window color.
+  bool neg;
+  /// Dim factor, 0 for none. Only honored when painting without blending.
+  double dim;
+  /// Opacity of the window frame, 0 if the frame has no opacity of its own.
+  double frame_opacity;
+  /// Window body without the frame, in root window coordinates.
+  XRectangle body;
+} glx_win_params_t;
+
+#ifdef CONFIG_GLX_CORE
+/// Per-draw parameters of the glx_core window program, laid out as its
+/// std140 uniform block "Win".
+typedef struct {
+  /// Window body without the frame, in GL window coordinates, as
+  /// (x, y, x_end, y_end).
+  GLfloat body[4];
+  /// Scale (x, y) and translation (x, y) applied to vertices.
+  GLfloat xform[4];
+  GLfloat opacity;
+  /// Opacity outside of <code>body</code>.
+  GLfloat frame_opacity;
+  /// Dim factor, 0 for none.
+  GLfloat dim;
+  GLint argb;
+  GLint invert;
+  GLint pad[3];
+} glx_core_block_t;
+
+/// A GLSL program of the glx_core backend.
+typedef struct {
+  GLuint prog;
+  /// Location of uniform "root_size".
+  GLint unifm_root_size;
+  /// Location of uniform "color", fill program only.
+  GLint unifm_color;
+} glx_core_prog_t;
+
+/// State of the glx_core backend.
+typedef struct {
+  /// Vertex array object, bound for the lifetime of the context.
+  GLuint vao;
+  /// Vertex buffer quads are streamed through.
+  GLuint vbo;
+  /// Uniform buffer backing block "Win".
+  GLuint ubo;
+  /// Sampler objects for unscaled and scaled textures.
+  GLuint samplers[2];
+  /// Window programs for GL_TEXTURE_2D and GL_TEXTURE_RECTANGLE textures.
+  glx_core_prog_t win_progs[2];
+  /// Program filling rectangles with a color.
+  glx_core_prog_t fill_prog;
+  /// Vertices being built, as (x, y, s, t) tuples.
+  GLfloat *verts;
+  /// Allocated number of vertices in <code>verts</code>.
+  int verts_max;
+  /// Last contents uploaded to <code>ubo</code>.
+  glx_core_block_t block;
+  /// Whether <code>block</code> is valid.
+  bool block_valid;
+} glx_core_t;
+#endif
+
 #endif
 #endif
 
@@ -533,6 +778,146 @@ typedef struct {
   double *data;
 } conv;
 
+#ifdef CONFIG_DBUS
+/// Window states to recompute at the end of a batch of D-Bus changes.
+typedef enum {
+  WIN_REDET_SHADOW        = 1 << 0,
+  WIN_REDET_FADE          = 1 << 1,
+  WIN_REDET_FOCUSED       = 1 << 2,
+  WIN_REDET_INVERT_COLOR  = 1 << 3,
+} win_redet_t;
+
+/// Magic number at the start of a frame capture ring, "CPTR" in memory.
+#define CAPTURE_MAGIC 0x52545043u
+/// Layout version of the frame capture ring.
+#define CAPTURE_VERSION 1u
+/// Minimum number of slots in a frame capture ring.
+#define CAPTURE_SLOTS_MIN 2
+/// Default number of slots in a frame capture ring.
+#define CAPTURE_SLOTS_DEF 3
+/// Maximum number of slots in a frame capture ring.
+#define CAPTURE_SLOTS_MAX 8
+/// Maximum number of damaged rectangles a capture slot records.
+#define CAPTURE_RECTS_MAX 64
+/// Alignment of slots and pixel data in a frame capture ring.
+#define CAPTURE_ALIGN 64
+
+/// A damaged rectangle of a captured frame.
+typedef struct {
+  int32_t x;
+  int32_t y;
+  uint32_t width;
+  uint32_t height;
+} capture_rect_t;
+
+/// Header at the start of a frame capture ring.
+///
+/// Everything but <code>latest_seq</code> and <code>closed</code> is
+/// fixed once the ring is created.
+typedef struct {
+  /// <code>CAPTURE_MAGIC</code>.
+  uint32_t magic;
+  /// <code>CAPTURE_VERSION</code>.
+  uint32_t version;
+  /// Width of a frame in pixels.
+  uint32_t width;
+  /// Height of a frame in pixels.
+  uint32_t height;
+  /// Bytes per row of pixel data. Pixels are 32-bit, B8G8R8X8 in memory.
+  uint32_t stride;
+  /// Number of slots.
+  uint32_t nslots;
+  /// Offset of the first slot from the start of the ring.
+  uint32_t slot_offset;
+  /// Size of a slot in bytes, its header included.
+  uint32_t slot_size;
+  /// Offset of pixel data from the start of a slot.
+  uint32_t data_offset;
+  /// Non-zero once compton has stopped writing to the ring.
+  uint32_t closed;
+  /// Sequence number of the latest complete frame, 0 if there's none.
+  /// Frame <code>seq</code> lives in slot <code>(seq - 1) % nslots</code>.
+  uint64_t latest_seq;
+} capture_ring_t;
+
+/// Header of a slot in a frame capture ring.
+typedef struct {
+  /// Sequence number of the frame in the slot, 0 while it's being
+  /// written.
+  uint64_t seq;
+  /// Number of rectangles in <code>rects</code>, 0 if the whole frame
+  /// changed.
+  uint32_t nrects;
+  uint32_t pad;
+  /// Rectangles that changed since frame <code>seq - 1</code>.
+  capture_rect_t rects[CAPTURE_RECTS_MAX];
+} capture_slot_t;
+
+/// A captured frame whose pixels are still being read back.
+typedef struct {
+  /// Sequence number of the frame, 0 if nothing is pending.
+  uint64_t seq;
+  /// Rectangles to copy into the slot of the frame.
+  XRectangle *rects;
+  /// Number of rectangles in <code>rects</code>.
+  int nrects;
+#ifdef CONFIG_VSYNC_OPENGL
+  /// Pixel-buffer object the frame is read into, 0 for synchronous
+  /// readback.
+  GLuint pbo;
+#endif
+} capture_pending_t;
+
+/// State of the frame capture.
+typedef struct {
+  /// File descriptor of the shared memory handed to D-Bus clients.
+  int fd;
+  /// Mapping of the shared memory.
+  capture_ring_t *ring;
+  /// Size of the mapping.
+  size_t size;
+  /// Regions that changed since each slot was last written.
+  XserverRegion dirty[CAPTURE_SLOTS_MAX];
+  /// Sequence number of the last captured frame.
+  uint64_t seq;
+  /// SysV shared memory XShmGetImage() reads into, on XRender backend.
+  XShmSegmentInfo shminfo;
+  /// Readbacks in flight, on GLX backends.
+  capture_pending_t pending[2];
+  /// Index of the next element of <code>pending</code> to use.
+  int pending_cur;
+} capture_t;
+#endif
+
+/// An alpha mask Picture, cached for one alpha value.
+typedef struct _alpha_pict {
+  /// The 1x1 A8 Picture, None if it's not created.
+  Picture pict;
+  /// More recently used cached entry.
+  struct _alpha_pict *prev;
+  /// Less recently used cached entry.
+  struct _alpha_pict *next;
+} alpha_pict_t;
+
+/// Cost of screen redirection transitions.
+typedef struct {
+  /// Number of times the screen got unredirected.
+  unsigned long nstop;
+  /// Number of times the screen got redirected.
+  unsigned long nstart;
+  /// Time the last unredirection took, in microseconds.
+  long stop_us;
+  /// Time the last redirection took, in microseconds.
+  long start_us;
+  /// Time the first frame after the last redirection took to paint, in
+  /// microseconds.
+  long frame_us;
+  /// Total time spent on transitions and first frames, in microseconds.
+  unsigned long total_us;
+  /// Whether the next frame is the first one after redirection.
+  bool frame_pending;
+} redir_stats_t;
+
 /// Linked list type of atoms.
 typedef struct _latom {
   Atom atom;
@@ -551,6 +936,37 @@ struct _timeout_t;
 
 struct _win;
 
+struct _win_arena_chunk;
+
+/// Per-frame state of a window to paint.
+///
+/// Built by <code>paint_preprocess()</code>, which still walks the window
+/// list, into a contiguous array in stacking order. <code>paint_all()</code>
+/// walks this array to compute its paint regions instead of chasing
+/// <code>prev_trans</code>. It still goes through <code>w</code> for
+/// opacity, mode and everything the draw calls need.
+typedef struct {
+  /// The window. Everything not copied here lives there.
+  struct _win *w;
+  /// Copy of <code>w->reg_ignore</code>.
+  XserverRegion reg_ignore;
+  /// Copy of <code>w->border_size</code>.
+  XserverRegion border_size;
+  /// Copy of <code>w->extents</code>.
+  XserverRegion extents;
+  /// Rectangle covered by the shadow, in root window coordinates.
+  XRectangle shadow_rect;
+  /// Whether the window has shadow.
+  bool shadow;
+  /// Whether the background of the window is to be blurred.
+  bool blur_background;
+  /// Key of the shader variant the window is painted with.
+  int variant;
+  /// Whether the window is already painted ahead of stacking order in
+  /// this frame.
+  bool prepainted;
+} win_hot_t;
+
 typedef struct {
   int iterations;
   float offset;
@@ -590,6 +1006,10 @@ typedef struct _options_t {
   int glx_swap_method;
   /// Whether to use GL_EXT_gpu_shader4 to (hopefully) accelerates blurring.
   bool glx_use_gpushader4;
+  /// Whether to cache linked GLSL program binaries on disk.
+  bool glx_program_cache;
+  /// Whether to paint windows with specialized GLSL shader variants.
+  bool glx_shader_variants;
   /// Custom fragment shader for painting windows, as a string.
   char *glx_fshader_win_str;
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
@@ -615,6 +1035,12 @@ typedef struct _options_t {
   c2_lptr_t *unredir_if_possible_blacklist;
   /// Delay before unredirecting screen.
   time_ms_t unredir_if_possible_delay;
+  /// Damage rate, in frames per second, above which a full-screen
+  /// window unredirects after a quarter of the delay. 0 for disabled.
+  int unredir_if_possible_video_fps;
+  /// Largest fraction of the screen a window above a full-screen one may
+  /// cover without keeping the screen redirected. 0 for disabled.
+  double unredir_if_possible_overlay_ratio;
   /// Forced redirection setting through D-Bus.
   switch_t redirected_force;
   /// Whether to stop painting. Controlled through D-Bus.
@@ -631,6 +1057,19 @@ typedef struct _options_t {
   int benchmark;
   /// Window to constantly repaint in benchmark mode. 0 for full-screen.
   Window benchmark_wid;
+  /// Width of the target painted to in offscreen mode. 0 for disabled.
+  int offscreen_width;
+  /// Height of the target painted to in offscreen mode.
+  int offscreen_height;
+  /// Directory to dump frames painted in offscreen mode and their timings
+  /// into. NULL to only print timings.
+  char *offscreen_dump;
+  /// Path to record handled events to. NULL for disabled.
+  char *trace_record;
+  /// Path to an event trace to replay. NULL for disabled.
+  char *trace_replay;
+  /// Speed factor of trace replay. 0 to replay as fast as possible.
+  double trace_replay_speed;
   /// A list of conditions of windows not to paint.
   c2_lptr_t *paint_blacklist;
   /// Whether to avoid using XCompositeNameWindowPixmap(), for debugging.
@@ -676,6 +1115,9 @@ typedef struct _options_t {
   bool respect_prop_shadow;
   /// Whether to crop shadow to the very Xinerama screen.
   bool xinerama_shadow_crop;
+  /// Number of worker threads rasterizing shadows, 0 to build shadows
+  /// synchronously while painting.
+  int shadow_threads;
 
   // === Fading ===
   /// Enable/disable fading for specific window types.
@@ -684,8 +1126,11 @@ typedef struct _options_t {
   opacity_t fade_in_step;
   /// How much to fade out in a single fading step.
   opacity_t fade_out_step;
-  /// Fading time delta. In milliseconds.
+  /// Fading time delta. In milliseconds. A fade takes this long for
+  /// every fade_in_step/fade_out_step of opacity it covers.
   time_ms_t fade_delta;
+  /// Easing curve applied to fade progress.
+  enum fade_easing fade_easing;
   /// Whether to disable fading on window open/close.
   bool no_fading_openclose;
   /// Whether to disable fading on ARGB managed destroyed windows.
@@ -693,6 +1138,14 @@ typedef struct _options_t {
   /// Fading blacklist. A linked list of conditions.
   c2_lptr_t *fade_blacklist;
 
+  // === Animations ===
+  /// Whether to animate window geometry on map, unmap and move.
+  bool animations;
+  /// Duration of a geometry animation. In milliseconds.
+  time_ms_t animation_duration;
+  /// Scale a window is mapped from and unmapped to.
+  double animation_scale;
+
   // === Opacity ===
   /// Default opacity for specific window types
   double wintype_opacity[NUM_WINTYPES];
@@ -711,7 +1164,8 @@ typedef struct _options_t {
   /// Whether to detect _NET_WM_OPACITY on client windows. Used on window
   /// managers that don't pass _NET_WM_OPACITY to frame windows.
   bool detect_client_opacity;
-  /// Step for pregenerating alpha pictures. 0.01 - 1.0.
+  /// Step to quantize opacity of alpha pictures to. 0.01 - 1.0, or 0
+  /// for exact opacity.
   double alpha_step;
 
   // === Other window processing ===
@@ -816,8 +1270,35 @@ typedef struct {
   int z;
   /// FBConfig-s for GLX pixmap of different depths.
   glx_fbconfig_t *fbconfigs[OPENGL_MAX_DEPTH + 1];
+  /// Framebuffer object painted to in offscreen mode, 0 otherwise.
+  GLuint tgt_fbo;
+  /// Color and depth-stencil renderbuffers of <code>tgt_fbo</code>.
+  GLuint tgt_rbs[2];
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
   glx_blur_pass_t blur_passes[MAX_BLUR_PASS];
+  /// Whether building blur programs failed. They are built on first use.
+  bool blur_init_failed;
+  /// GLSL program rendering shadows. Built on first use.
+  glx_prog_shadow_t shadow_prog;
+  /// Whether building the shadow program failed.
+  bool shadow_init_failed;
+  /// Specialized window shader variants, indexed by key.
+  glx_prog_variant_t win_variants[GLX_WVAR_NUM];
+  /// GLSL program last bound with <code>glx_use_program()</code>.
+  GLuint prog_cur;
+  /// Directory of the GLSL program binary cache. NULL if the cache is
+  /// disabled or unavailable.
+  char *prog_cache_dir;
+  /// Pointer to the glGetProgramBinary() function.
+  f_GetProgramBinary glGetProgramBinaryProc;
+  /// Pointer to the glProgramBinary() function.
+  f_ProgramBinary glProgramBinaryProc;
+  /// Pointer to the glProgramParameteri() function.
+  f_ProgramParameteri glProgramParameteriProc;
+#endif
+#ifdef CONFIG_GLX_CORE
+  /// State of the glx_core backend.
+  glx_core_t core;
 #endif
 } glx_session_t;
 
@@ -850,6 +1331,14 @@ typedef struct _session_t {
   bool root_tile_fill;
   /// Picture of the root window background.
   paint_t root_tile_paint;
+  /// Damage of the root tile pixmap, if it's not filled by compton.
+  Damage root_tile_damage;
+  /// Whether the root tile pixmap is damaged since the texture is bound.
+  bool root_tile_pixmap_damaged;
+  /// Width of the root tile pixmap.
+  unsigned root_tile_width;
+  /// Height of the root tile pixmap.
+  unsigned root_tile_height;
   /// A region of the size of the screen.
   XserverRegion screen_reg;
   /// Picture of root window. Destination of painting in no-DBE painting
@@ -888,6 +1377,24 @@ typedef struct _session_t {
   struct _timeout_t *tmout_unredir;
   /// Whether we have hit unredirection timeout.
   bool tmout_unredir_hit;
+  /// Full-screen window the screen could be unredirected for in the
+  /// last frame, None if there's none.
+  Window unredir_win;
+  /// Whether <code>unredir_win</code> is damaged since the last frame.
+  bool unredir_win_damaged;
+  /// Times of recent frames <code>unredir_win</code> was damaged in, a
+  /// ring buffer large enough to hold the frames the video rate check
+  /// needs.
+  time_ms_t *unredir_damage_hist;
+  /// Number of slots in <code>unredir_damage_hist</code>.
+  int unredir_damage_hist_len;
+  /// Next slot in <code>unredir_damage_hist</code>.
+  int unredir_damage_idx;
+  /// Cost of screen redirection transitions.
+  redir_stats_t redir_stats;
+  /// Full-screen window unredirected alone while other windows stay
+  /// redirected, None if there's none.
+  Window unredir_only;
   /// Whether we have received an event in this cycle.
   bool ev_received;
   /// Whether the program is idling. I.e. no fading, no potential window
@@ -901,11 +1408,18 @@ typedef struct _session_t {
   XserverRegion all_damage_last[CGLX_MAX_BUFFER_AGE];
   /// Whether all windows are currently redirected.
   bool redirected;
-  /// Pre-generated alpha pictures.
-  Picture *alpha_picts;
+  /// Alpha pictures indexed by alpha, created on demand.
+  alpha_pict_t alpha_picts[ALPHA_PICT_NUM];
+  /// Most recently used alpha picture.
+  alpha_pict_t *alpha_picts_head;
+  /// Least recently used alpha picture, the first to be freed.
+  alpha_pict_t *alpha_picts_tail;
+  /// Number of created alpha pictures.
+  int alpha_picts_cnt;
   /// Whether all reg_ignore of windows should expire in this paint.
   bool reg_ignore_expire;
-  /// Time of last fading. In milliseconds.
+  /// Timestamp of the frame being painted, sampled once per frame and
+  /// used by all fades. 0 when idling. In milliseconds.
   time_ms_t fade_time;
   /// Head pointer of the error ignore linked list.
   ignore_t *ignore_head;
@@ -926,8 +1440,18 @@ typedef struct _session_t {
   int n_expose;
 
   // === Window related ===
-  /// Linked list of all windows.
+  /// Linked list of all windows, from the top of the stack to the bottom.
   struct _win *list;
+  /// Bottommost window in the stack, the last element of <code>list</code>.
+  struct _win *list_bottom;
+  /// Hash table of windows that are not destroyed, keyed by window ID.
+  struct _win **win_hash;
+  /// Number of buckets in <code>win_hash</code>, a power of 2.
+  unsigned win_hash_size;
+  /// Base 2 logarithm of <code>win_hash_size</code>.
+  unsigned win_hash_bits;
+  /// Number of windows in <code>win_hash</code>.
+  unsigned win_hash_cnt;
   /// Pointer to <code>win</code> of current active window. Used by
   /// EWMH <code>_NET_ACTIVE_WINDOW</code> focus detection. In theory,
   /// it's more reliable to store the window ID directly here, just in
@@ -937,6 +1461,20 @@ typedef struct _session_t {
   /// Window ID of leader window of currently active window. Used for
   /// subsidiary window detection.
   Window active_leader;
+  /// Hot state of the windows to paint in this frame, highest first.
+  win_hot_t *paint_hot;
+  /// Number of elements in <code>paint_hot</code>.
+  int paint_hot_cnt;
+  /// Allocated size of <code>paint_hot</code>.
+  int paint_hot_max;
+  /// Indices into <code>paint_hot</code> of solid windows painted ahead of
+  /// stacking order, sorted by shader variant. Allocated with the same
+  /// size as <code>paint_hot</code>.
+  int *paint_solid;
+  /// Linked list of chunks of the window record arena.
+  struct _win_arena_chunk *win_chunks;
+  /// Free window records in the arena, linked through <code>next</code>.
+  struct _win *win_free;
 
   // === Shadow/dimming related ===
   /// 1x1 black Picture.
@@ -956,6 +1494,11 @@ typedef struct _session_t {
   unsigned char *shadow_top;
   /// A region in which shadow is not painted on.
   XserverRegion shadow_exclude_reg;
+#ifdef CONFIG_SHADOW_THREADS
+  /// Worker pool rasterizing shadows, NULL if shadows are built
+  /// synchronously.
+  struct _shadow_pool *shadow_pool;
+#endif
 
   // === Software-optimization-related ===
   /// Currently used refresh rate.
@@ -965,6 +1508,16 @@ typedef struct _session_t {
   /// Nanosecond offset of the first painting.
   long paint_tm_offset;
 
+  // === Offscreen-mode-related ===
+  /// Number of frames painted in offscreen mode.
+  unsigned offscreen_frame;
+  /// File frame timings are written to in offscreen mode.
+  FILE *offscreen_timings;
+#ifdef CONFIG_TRACE
+  /// Event trace being recorded or replayed, NULL if there's none.
+  struct _trace *trace;
+#endif
+
 #ifdef CONFIG_VSYNC_DRM
   // === DRM VSync related ===
   /// File descriptor of DRI device file. Used for DRM VSync.
@@ -1066,6 +1619,12 @@ typedef struct _session_t {
   Atom atoms_wintypes[NUM_WINTYPES];
   /// Linked list of additional atoms to track.
   latom_t *track_atom_lst;
+  /// Number of window property lookups served from the cache.
+  unsigned long prop_cache_hits;
+  /// Number of window property lookups that needed a round-trip.
+  unsigned long prop_cache_misses;
+  /// Value of the last property fetched for a window that can't be cached.
+  winprop_t prop_uncached;
 
 #ifdef CONFIG_DBUS
   // === DBus related ===
@@ -1073,6 +1632,23 @@ typedef struct _session_t {
   DBusConnection *dbus_conn;
   // DBus service name.
   char *dbus_service;
+  /// Bitmask of window attributes to send <code>win_diff</code> signals
+  /// for. 0 if no client is watching.
+  uint64_t dbus_diff_attrs;
+  /// Unique bus name of the client watching window attributes, NULL if
+  /// there's none.
+  char *dbus_diff_owner;
+  /// Changes collected in the current D-Bus transaction, NULL if there's
+  /// none.
+  void *dbus_txn;
+  /// Whether a D-Bus transaction is being applied, so window states are
+  /// recomputed once at its end.
+  bool dbus_batch;
+  /// <code>win_redet_t</code> states to recompute on all windows at the
+  /// end of the current D-Bus batch.
+  unsigned dbus_redet_all;
+  /// Frame capture state, NULL if no frame is being captured.
+  capture_t *capture;
 #endif
 } session_t;
 
@@ -1080,6 +1656,10 @@ typedef struct _session_t {
 typedef struct _win {
   /// Pointer to the next structure in the linked list.
   struct _win *next;
+  /// Pointer to the previous structure in the linked list.
+  struct _win *prev;
+  /// Pointer to the next window in the same <code>win_hash</code> bucket.
+  struct _win *hash_next;
   /// Pointer to the next higher window to paint.
   struct _win *prev_trans;
 
@@ -1114,16 +1694,14 @@ typedef struct _win {
   XserverRegion extents;
   /// Window flags. Definitions above.
   int_fast16_t flags;
-  /// Whether there's a pending <code>ConfigureNotify</code> happening
-  /// when the window is unmapped.
-  bool need_configure;
-  /// Queued <code>ConfigureNotify</code> when the window is unmapped.
-  XConfigureEvent queue_configure;
   /// Region to be ignored when painting. Basically the region where
   /// higher opaque windows will paint upon. Depends on window frame
   /// opacity state, window geometry, window mapped/unmapped state,
   /// window mode, of this and all higher windows.
   XserverRegion reg_ignore;
+  /// Whether <code>reg_ignore</code> of this window and all lower windows
+  /// should expire on next paint.
+  bool reg_ignore_expire;
   /// Cached width/height of the window including border.
   int widthb, heightb;
   /// Whether the window has been destroyed.
@@ -1170,6 +1748,13 @@ typedef struct _win {
   char *class_general;
   /// <code>WM_WINDOW_ROLE</code> value of the window.
   char *role;
+  /// Cached properties of the window and its client window.
+  winprop_cache_t *prop_cache;
+  /// Whether there's a pending <code>ConfigureNotify</code> happening
+  /// when the window is unmapped.
+  bool need_configure;
+  /// Queued <code>ConfigureNotify</code> when the window is unmapped.
+  XConfigureEvent queue_configure;
   const c2_lptr_t *cache_sblst;
   const c2_lptr_t *cache_fblst;
   const c2_lptr_t *cache_fcblst;
@@ -1203,6 +1788,38 @@ typedef struct _win {
   switch_t fade_force;
   /// Callback to be called after fading completed.
   void (*fade_callback) (session_t *ps, struct _win *w);
+  /// Opacity the current fade started from.
+  opacity_t fade_start;
+  /// Opacity the current fade is heading to. Differs from
+  /// <code>opacity_tgt</code> when the target changed mid-fade.
+  opacity_t fade_end;
+  /// Frame timestamp the current fade started at. 0 if no fade is running.
+  time_ms_t fade_start_time;
+  /// Duration of the current fade. In milliseconds.
+  time_ms_t fade_duration;
+
+  // Geometry-animation-related members
+  /// Offset from the real position and scale the animation started with.
+  double anim_start_dx, anim_start_dy, anim_start_scale;
+  /// Offset from the real position and scale the animation ends with.
+  double anim_end_dx, anim_end_dy, anim_end_scale;
+  /// Current offset from the real position. Scaling is around the window
+  /// center.
+  double anim_dx, anim_dy;
+  /// Current scale.
+  double anim_scale;
+  /// Whether an animation is running.
+  bool anim_running;
+  /// Frame timestamp the running animation started at. 0 until its first
+  /// frame is painted.
+  time_ms_t anim_start_time;
+  /// Duration of the running animation. In milliseconds.
+  time_ms_t anim_duration;
+  /// Rectangle the window is displayed in this frame, if animated.
+  XRectangle anim_rect;
+  /// Region of <code>anim_rect</code>. Replaces the bounding region and
+  /// extents of the window while animated.
+  XserverRegion anim_reg;
 
   // Frame-opacity-related members
   /// Current window frame opacity. Affected by window opacity.
@@ -1229,6 +1846,13 @@ typedef struct _win {
   int shadow_height;
   /// Picture to render shadow. Affected by window size.
   paint_t shadow_paint;
+  /// Whether <code>shadow_paint</code> is kept only as a placeholder
+  /// until a shadow of the current size is ready.
+  bool shadow_outdated;
+#ifdef CONFIG_SHADOW_THREADS
+  /// Pending shadow rasterization job of the window.
+  struct _shadow_job *shadow_job;
+#endif
   /// The value of _COMPTON_SHADOW attribute of the window. Below 0 for
   /// none.
   long prop_shadow;
@@ -1254,8 +1878,24 @@ typedef struct _win {
   /// Textures and FBO background blur use.
   glx_blur_cache_t glx_blur_cache;
 #endif
+
+#ifdef CONFIG_DBUS
+  /// Attribute values last sent in a <code>win_diff</code> D-Bus signal.
+  void *dbus_state;
+  /// <code>win_redet_t</code> states to recompute at the end of the
+  /// current D-Bus batch.
+  unsigned dbus_redet;
+#endif
 } win;
 
+/// A chunk of window records allocated at once by the window arena.
+typedef struct _win_arena_chunk {
+  /// Next chunk in the arena.
+  struct _win_arena_chunk *next;
+  /// The window records.
+  win wins[WIN_ARENA_CHUNK];
+} win_arena_chunk_t;
+
 /// Temporary structure used for communication between
 /// <code>get_cfg()</code> and <code>parse_config()</code>.
 struct options_tmp {
@@ -1275,6 +1915,62 @@ typedef struct _timeout_t {
   struct _timeout_t *next;
 } timeout_t;
 
+/// A change of the stacking position of a window.
+typedef struct {
+  /// The window to restack.
+  struct _win *w;
+  /// ID of the window to put <code>w</code> directly above, None for the
+  /// bottom of the stack.
+  Window new_above;
+} restack_t;
+
+#ifdef CONFIG_SHADOW_THREADS
+/// A shadow rasterization job for the shadow worker pool.
+typedef struct _shadow_job {
+  /// Window the shadow is for, NULL if the job is cancelled. Only
+  /// touched by the main thread.
+  struct _win *w;
+  /// Size of the window.
+  int width;
+  int height;
+  /// Size of the shadow image.
+  int swidth;
+  int sheight;
+  /// Bounding shape of the window relative to it, NULL if it's not
+  /// shaped.
+  XRectangle *rects;
+  int nrects;
+  /// Rasterized 8-bit alpha image, NULL if rasterization is skipped or
+  /// failed.
+  unsigned char *data;
+  struct _shadow_job *next;
+} shadow_job_t;
+
+/// Pool of threads rasterizing shadows off the main thread.
+typedef struct _shadow_pool {
+  pthread_t *threads;
+  int nthreads;
+  /// Lock guarding everything below.
+  pthread_mutex_t lock;
+  /// Signalled when a job is queued or the pool is shutting down.
+  pthread_cond_t cond_job;
+  /// Signalled when a worker finishes a job.
+  pthread_cond_t cond_done;
+  /// Queue of jobs waiting for a worker.
+  shadow_job_t *pending;
+  shadow_job_t **pending_tail;
+  /// Finished jobs waiting to be collected by the main thread.
+  shadow_job_t *done;
+  /// Number of jobs being rasterized.
+  int running;
+  /// Whether workers should exit.
+  bool quit;
+  /// Pipe a worker writes to after finishing a job, to wake up the main
+  /// loop.
+  int wake_fds[2];
+} shadow_pool_t;
+#endif
+
 /// Enumeration for window event hints.
 typedef enum {
   WIN_EVMODE_UNKNOWN,
@@ -1286,6 +1982,7 @@ extern const char * const WINTYPES[NUM_WINTYPES];
 extern const char * const VSYNC_STRS[NUM_VSYNC + 1];
 extern const char * const BACKEND_STRS[NUM_BKEND + 1];
 extern const char * const BLUR_METHOD_STRS[NUM_BLRMTHD + 1];
+extern const char * const FADE_EASING_STRS[NUM_FADE_EASING + 1];
 extern session_t *ps_g;
 
 // == Debugging code ==
@@ -1523,6 +2220,16 @@ get_time_timespec(void) {
   return tm;
 }
 
+/**
+ * Get microseconds passed since a time from get_time_timespec().
+ */
+static inline long
+get_time_us_since(struct timespec start) {
+  struct timespec now = get_time_timespec(), diff = { 0 };
+  timespec_subtract(&diff, &now, &start);
+  return diff.tv_sec * US_PER_SEC + diff.tv_nsec / 1000L;
+}
+
 
 /**
  * Print time passed since program starts execution.
@@ -1706,6 +2413,39 @@ parse_blur_method(session_t *ps, const char *str) {
   return false;
 }
 
+/**
+ * Parse a fade_easing option argument.
+ */
+static inline bool
+parse_fade_easing(session_t *ps, const char *str) {
+  for (enum fade_easing i = 0; FADE_EASING_STRS[i]; ++i)
+    if (!strcasecmp(str, FADE_EASING_STRS[i])) {
+      ps->o.fade_easing = i;
+      return true;
+    }
+
+  printf_errf("(\"%s\"): Invalid fade_easing argument.", str);
+  return false;
+}
+
+/**
+ * Parse an offscreen option argument, like "1280x720".
+ */
+static inline bool
+parse_offscreen(session_t *ps, const char *str) {
+  int width = 0, height = 0;
+  char c = '\0';
+  if (2 != sscanf(str, "%dx%d%c", &width, &height, &c)
+      || width <= 0 || height <= 0) {
+    printf_errf("(\"%s\"): Invalid offscreen argument.", str);
+    return false;
+  }
+
+  ps->o.offscreen_width = width;
+  ps->o.offscreen_height = height;
+  return true;
+}
+
 /**
  * Parse a blur_strength option argument.
  */
@@ -1763,6 +2503,10 @@ parse_backend(session_t *ps, const char *str) {
     ps->o.backend = BKEND_XR_GLX_HYBRID;
     return true;
   }
+  if (!strcasecmp(str, "glx-core")) {
+    ps->o.backend = BKEND_GLX_CORE;
+    return true;
+  }
   printf_errf("(\"%s\"): Invalid backend argument.", str);
   return false;
 }
@@ -1949,21 +2693,29 @@ get_tgt_window(session_t *ps) {
 }
 
 /**
- * Find a window from window id in window linked list of the session.
+ * Get the bucket of a window ID in the window hash.
+ */
+static inline unsigned
+win_hash_idx(const session_t *ps, Window id) {
+  // Fibonacci hashing: the high bits of the product depend on all bits
+  // of the ID, so consecutive IDs land in distinct buckets
+  return (uint32_t) (id * 2654435761UL) >> (32 - ps->win_hash_bits);
+}
+
+/**
+ * Find a window that is not destroyed from window id.
  */
 static inline win *
 find_win(session_t *ps, Window id) {
-  if (!id)
+  if (!id || !ps->win_hash)
     return NULL;
 
-  win *w;
-
-  for (w = ps->list; w; w = w->next) {
-    if (w->id == id && !w->destroyed)
+  for (win *w = ps->win_hash[win_hash_idx(ps, id)]; w; w = w->hash_next) {
+    if (w->id == id)
       return w;
   }
 
-  return 0;
+  return NULL;
 }
 
 /**
@@ -2001,7 +2753,76 @@ bkend_use_xrender(session_t *ps) {
 static inline bool
 bkend_use_glx(session_t *ps) {
   return BKEND_GLX == ps->o.backend
-    || BKEND_XR_GLX_HYBRID == ps->o.backend;
+    || BKEND_XR_GLX_HYBRID == ps->o.backend
+    || BKEND_GLX_CORE == ps->o.backend;
+}
+
+/**
+ * Check if current backend paints windows with OpenGL.
+ */
+static inline bool
+bkend_paint_glx(session_t *ps) {
+  return BKEND_GLX == ps->o.backend
+    || BKEND_GLX_CORE == ps->o.backend;
+}
+
+/**
+ * Check if we are painting on an OpenGL core profile context.
+ */
+static inline bool
+glx_is_core(session_t *ps) {
+#ifdef CONFIG_GLX_CORE
+  return BKEND_GLX_CORE == ps->o.backend;
+#else
+  return false;
+#endif
+}
+
+/**
+ * Check if windows are painted with specialized GLSL shader variants.
+ *
+ * A custom window shader always takes precedence.
+ */
+static inline bool
+glx_use_win_variants(session_t *ps) {
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  return BKEND_GLX == ps->o.backend && ps->o.glx_shader_variants
+    && ps->psglx && !ps->o.glx_prog_win.prog;
+#else
+  return false;
+#endif
+}
+
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+/**
+ * Bind a GLSL program, skipping the call if it's already bound.
+ *
+ * Window shader variants stay bound across draws, so every other user of
+ * GLSL programs or the fixed-function pipeline must go through this.
+ */
+static inline void
+glx_use_program(session_t *ps, GLuint prog) {
+  if (prog != ps->psglx->prog_cur) {
+    glUseProgram(prog);
+    ps->psglx->prog_cur = prog;
+  }
+}
+#endif
+
+/**
+ * Check if the shadow of a window is rendered by a GLSL program instead
+ * of from a shadow pixmap.
+ *
+ * The program only knows boxes, shaped windows need a rasterized shadow.
+ */
+static inline bool
+glx_use_gpu_shadow(session_t *ps, const win *w) {
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  return BKEND_GLX == ps->o.backend && ps->psglx
+    && !ps->psglx->shadow_init_failed && !w->bounding_shaped;
+#else
+  return false;
+#endif
 }
 
 /**
@@ -2121,6 +2942,18 @@ win_is_fullscreen(session_t *ps, const win *w) {
       && (!w->bounding_shaped || w->rounded_corners);
 }
 
+/**
+ * Check if a window is small enough to stay above a full-screen window
+ * without keeping the screen redirected.
+ */
+static inline bool
+win_is_unredir_overlay(session_t *ps, const win *w) {
+  return ps->o.unredir_if_possible_overlay_ratio > 0.0
+    && !win_is_fullscreen(ps, w)
+    && (double) w->widthb * w->heightb <= ps->o.unredir_if_possible_overlay_ratio
+      * ps->root_width * ps->root_height;
+}
+
 /**
  * Check if a window will be painted solid.
  */
@@ -2129,6 +2962,14 @@ win_is_solid(session_t *ps, const win *w) {
   return WMODE_SOLID == w->mode && !ps->o.force_win_blend;
 }
 
+/**
+ * Check if a window is displayed away from its real geometry.
+ */
+static inline bool
+win_is_animated(const win *w) {
+  return w->anim_dx || w->anim_dy || 1.0 != w->anim_scale;
+}
+
 /**
  * Determine if a window has a specific property.
  *
@@ -2157,6 +2998,10 @@ winprop_t
 wid_get_prop_adv(const session_t *ps, Window w, Atom atom, long offset,
     long length, Atom rtype, int rformat);
 
+winprop_t
+win_get_prop(session_t *ps, win *w, Window wid, Atom atom, long offset,
+    long length, Atom rtype, int rformat);
+
 /**
  * Wrapper of wid_get_prop_adv().
  */
@@ -2245,6 +3090,18 @@ bool
 glx_load_prog_main(session_t *ps,
     const char *vshader_str, const char *fshader_str,
     glx_prog_main_t *pprogram);
+
+void
+glx_free_prog_main(session_t *ps, glx_prog_main_t *pprogram);
+
+void
+glx_free_blur(session_t *ps);
+
+void
+glx_free_shadow(session_t *ps);
+
+void
+glx_free_win_variants(session_t *ps);
 #endif
 
 bool
@@ -2281,6 +3138,13 @@ bool
 glx_dim_dst(session_t *ps, int dx, int dy, int width, int height, float z,
     GLfloat factor, XserverRegion reg_tgt, const reg_data_t *pcache_reg);
 
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+bool
+glx_shadow_dst(session_t *ps, int dx, int dy, int width, int height,
+    int bx, int by, int bwidth, int bheight, float z, GLfloat opacity,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg);
+#endif
+
 bool
 glx_render_(session_t *ps, const glx_texture_t *ptex,
     int x, int y, int dx, int dy, int width, int height, int z,
@@ -2301,11 +3165,49 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
   glx_render_(ps, ptex, x, y, dx, dy, width, height, z, opacity, argb, neg, reg_tgt, pcache_reg)
 #endif
 
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+int
+glx_win_variant_key(session_t *ps, const glx_texture_t *ptex,
+    const glx_win_params_t *pparams);
+
+bool
+glx_render_win(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height, int z,
+    const glx_win_params_t *pparams,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg, bool *pdimmed);
+#endif
+
+#ifdef CONFIG_GLX_CORE
+bool
+glx_core_render(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height,
+    const glx_win_params_t *pparams, const GLfloat *xform,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg, bool *pdimmed);
+
+void
+glx_core_present(session_t *ps, XserverRegion reg);
+#endif
+
 void
 glx_swap_copysubbuffermesa(session_t *ps, XserverRegion reg);
 
-unsigned char *
-glx_take_screenshot(session_t *ps, int *out_length);
+bool
+glx_read_frame(session_t *ps, unsigned char *rgb);
+
+#ifdef CONFIG_DBUS
+bool
+glx_capture_init(session_t *ps, capture_t *cap);
+
+void
+glx_capture_deinit(session_t *ps, capture_t *cap);
+
+void
+glx_capture_read(session_t *ps, capture_pending_t *pend);
+
+bool
+glx_capture_finish(session_t *ps, capture_pending_t *pend,
+    unsigned char *data, int stride);
+#endif
 
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
 GLuint
@@ -2317,6 +3219,10 @@ glx_create_program(const GLuint * const shaders, int nshaders);
 GLuint
 glx_create_program_from_str(const char *vert_shader_str,
     const char *frag_shader_str);
+
+GLuint
+glx_create_program_cached(session_t *ps, const char *vert_shader_str,
+    const char *frag_shader_str);
 #endif
 
 /**
@@ -2499,6 +3405,9 @@ xr_sync_(session_t *ps, Drawable d
 #endif
 }
 
+void
+opts_init_track_focus(session_t *ps);
+
 /** @name DBus handling
  */
 ///@{
@@ -2532,6 +3441,12 @@ cdbus_ev_win_focusout(session_t *ps, win *w);
 
 void
 cdbus_ev_win_focusin(session_t *ps, win *w);
+
+void
+cdbus_ev_win_diff(session_t *ps);
+
+void
+cdbus_free_win_state(win *w);
 //!@}
 
 /** @name DBus hooks
@@ -2550,10 +3465,52 @@ void
 win_set_invert_color_force(session_t *ps, win *w, switch_t val);
 
 void
-opts_init_track_focus(session_t *ps);
+opts_set_no_fading_openclose(session_t *ps, bool newval);
 
 void
-opts_set_no_fading_openclose(session_t *ps, bool newval);
+win_batch_redetermine(session_t *ps);
+
+bool
+capture_start(session_t *ps, unsigned nslots);
+
+void
+capture_stop(session_t *ps);
+//!@}
+#endif
+
+#ifdef CONFIG_TRACE
+/** @name Event tracing
+ */
+///@{
+bool
+trace_record_start(session_t *ps);
+
+bool
+trace_replay_start(session_t *ps);
+
+void
+trace_destroy(session_t *ps);
+
+void
+trace_flush(session_t *ps);
+
+bool
+trace_finished(session_t *ps);
+
+void
+trace_ev_begin(session_t *ps, XEvent *ev);
+
+void
+trace_ev_end(session_t *ps, XEvent *ev);
+
+void
+trace_paint_begin(session_t *ps);
+
+void
+trace_paint_end(session_t *ps);
+
+void
+trace_report(session_t *ps);
 //!@}
 #endif
 
@@ -2571,6 +3528,15 @@ c2_parsed(session_t *ps, c2_lptr_t **pcondlst, const char *pattern,
 c2_lptr_t *
 c2_free_lptr(c2_lptr_t *lp);
 
+bool
+c2_list_equal(const c2_lptr_t *a, const c2_lptr_t *b);
+
+bool
+c2_list_dep_pos(const c2_lptr_t *condlst);
+
+bool
+c2_list_dep_atom(session_t *ps, const c2_lptr_t *condlst, Atom atom);
+
 bool
 c2_matchd(session_t *ps, win *w, const c2_lptr_t *condlst,
     const c2_lptr_t **cache, void **pdata);
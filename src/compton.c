@@ -50,11 +50,21 @@ const char * const BLUR_METHOD_STRS[NUM_BLRMTHD + 1] = {
     NULL
 };
 
+/// Names of fade easing curves.
+const char * const FADE_EASING_STRS[NUM_FADE_EASING + 1] = {
+  "linear",       // FADE_EASING_LINEAR
+  "ease-in",      // FADE_EASING_IN
+  "ease-out",     // FADE_EASING_OUT
+  "ease-in-out",  // FADE_EASING_IN_OUT
+  NULL
+};
+
 /// Names of backends.
 const char * const BACKEND_STRS[NUM_BKEND + 1] = {
   "xrender",      // BKEND_XRENDER
   "glx",          // BKEND_GLX
   "xr_glx_hybrid",// BKEND_XR_GLX_HYBRID
+  "glx_core",     // BKEND_GLX_CORE
   NULL
 };
 
@@ -104,45 +114,101 @@ session_t *ps_g = NULL;
 // === Fading ===
 
 /**
- * Get the time left before next fading point.
+ * Get the time left before the next frame that advances fading.
+ *
+ * Fades are evaluated against the frame timestamp, so waking up more
+ * often than once a frame gains nothing. The refresh interval is used
+ * when known, <code>fade_delta</code> otherwise.
  *
  * In milliseconds.
  */
 static int
 fade_timeout(session_t *ps) {
-  int diff = ps->o.fade_delta - get_time_ms() + ps->fade_time;
+  time_ms_t intv = ps->o.fade_delta;
+  if (ps->refresh_intv)
+    intv = max_i(ps->refresh_intv / 1000, 1);
 
-  diff = normalize_i_range(diff, 0, ps->o.fade_delta * 2);
+  int diff = intv - get_time_ms() + ps->fade_time;
+
+  diff = normalize_i_range(diff, 0, intv * 2);
 
   return diff;
 }
 
+/**
+ * Apply an easing curve to linear fade progress.
+ *
+ * @param t linear progress, in range [0.0, 1.0]
+ */
+static double __attribute__((const))
+fade_ease(enum fade_easing easing, double t) {
+  switch (easing) {
+    case FADE_EASING_IN:
+      return t * t;
+    case FADE_EASING_OUT:
+      return t * (2.0 - t);
+    case FADE_EASING_IN_OUT:
+      return (t < 0.5 ? 2.0 * t * t: -1.0 + (4.0 - 2.0 * t) * t);
+    default:
+      break;
+  }
+
+  return t;
+}
+
 /**
  * Run fading on a window.
  *
- * @param steps steps of fading
+ * Opacity is a function of the frame timestamp <code>ps->fade_time</code>,
+ * so late frames catch up instead of slowing the fade down. A fade
+ * (re)starts from the current opacity whenever the target changes, and
+ * lasts <code>fade_delta</code> for every fade step of opacity it covers.
  */
 static void
-run_fade(session_t *ps, win *w, unsigned steps) {
+run_fade(session_t *ps, win *w) {
+  const time_ms_t now = ps->fade_time;
+
   // If we have reached target opacity, return
   if (w->opacity == w->opacity_tgt) {
+    w->fade_start_time = 0L;
     return;
   }
 
-  if (!w->fade)
+  if (!w->fade) {
     w->opacity = w->opacity_tgt;
-  else if (steps) {
+    w->fade_start_time = 0L;
+    return;
+  }
+
+  // Start a new fade if none is running, the target moved, or the clock
+  // went backwards
+  if (!w->fade_start_time || w->fade_end != w->opacity_tgt
+      || now < w->fade_start_time) {
+    const opacity_t step = (w->opacity < w->opacity_tgt ?
+        ps->o.fade_in_step: ps->o.fade_out_step);
     // Use double below because opacity_t will probably overflow during
     // calculations
-    if (w->opacity < w->opacity_tgt)
-      w->opacity = normalize_d_range(
-          (double) w->opacity + (double) ps->o.fade_in_step * steps,
-          0.0, w->opacity_tgt);
-    else
-      w->opacity = normalize_d_range(
-          (double) w->opacity - (double) ps->o.fade_out_step * steps,
-          w->opacity_tgt, OPAQUE);
+    const double dist = fabs((double) w->opacity_tgt - (double) w->opacity);
+
+    w->fade_start = w->opacity;
+    w->fade_end = w->opacity_tgt;
+    w->fade_start_time = now;
+    w->fade_duration = (step ? ceil(dist / step) * ps->o.fade_delta: 0L);
+  }
+
+  double progress = 1.0;
+  if (w->fade_duration > 0L)
+    progress = normalize_d((double) (now - w->fade_start_time)
+        / w->fade_duration);
+
+  if (progress >= 1.0) {
+    w->opacity = w->fade_end;
+    w->fade_start_time = 0L;
   }
+  else
+    w->opacity = (double) w->fade_start
+      + ((double) w->fade_end - (double) w->fade_start)
+      * fade_ease(ps->o.fade_easing, progress);
 
   if (w->opacity != w->opacity_tgt) {
     ps->idling = false;
@@ -170,6 +236,118 @@ set_fade_callback(session_t *ps, win *w,
   }
 }
 
+// === Animations ===
+
+/**
+ * Start a geometry animation on a window.
+ *
+ * Offsets are relative to the real window position, and scaling is
+ * around the window center. The animation is advanced once per frame by
+ * <code>run_anim()</code>.
+ */
+static void
+win_anim_start(session_t *ps, win *w, double dx, double dy, double scale,
+    double end_dx, double end_dy, double end_scale) {
+  // The window leaves its real rectangle, so whatever is below has to be
+  // repainted, and the window stops occluding anything
+  if (!win_is_animated(w)) {
+    add_damage_win(ps, w);
+    ps->reg_ignore_expire = true;
+  }
+
+  w->anim_start_dx = w->anim_dx = dx;
+  w->anim_start_dy = w->anim_dy = dy;
+  w->anim_start_scale = w->anim_scale = scale;
+  w->anim_end_dx = end_dx;
+  w->anim_end_dy = end_dy;
+  w->anim_end_scale = end_scale;
+  w->anim_running = true;
+  w->anim_start_time = 0L;
+  w->anim_duration = ps->o.animation_duration;
+}
+
+/**
+ * Drop the geometry animation of a window, if any.
+ */
+static void
+win_anim_stop(session_t *ps, win *w) {
+  if (w->anim_reg)
+    add_damage(ps, w->anim_reg);
+  w->anim_reg = None;
+
+  w->anim_dx = w->anim_dy = 0.0;
+  w->anim_scale = 1.0;
+  w->anim_running = false;
+  w->anim_start_time = 0L;
+}
+
+/**
+ * Advance the geometry animation of a window to the current frame.
+ *
+ * Damage covers the rectangles of the previous and the current frame, so
+ * any number of animating windows still amounts to one paint per frame.
+ */
+static void
+run_anim(session_t *ps, win *w) {
+  if (!win_is_animated(w) && !w->anim_running)
+    return;
+
+  // Holding at the end state, nothing moves
+  if (!w->anim_running && w->anim_reg)
+    return;
+
+  // Repaint where the window was displayed last frame
+  if (w->anim_reg)
+    add_damage(ps, w->anim_reg);
+  w->anim_reg = None;
+
+  if (w->anim_running) {
+    // Like fades, an animation starts at the first frame it's painted in
+    const time_ms_t now = ps->fade_time;
+    if (!w->anim_start_time)
+      w->anim_start_time = now;
+
+    double progress = 1.0;
+    if (w->anim_duration > 0L && now >= w->anim_start_time)
+      progress = normalize_d((double) (now - w->anim_start_time)
+          / w->anim_duration);
+
+    if (progress >= 1.0) {
+      w->anim_dx = w->anim_end_dx;
+      w->anim_dy = w->anim_end_dy;
+      w->anim_scale = w->anim_end_scale;
+      w->anim_running = false;
+      w->anim_start_time = 0L;
+    }
+    else {
+      const double p = fade_ease(ps->o.fade_easing, progress);
+      w->anim_dx = w->anim_start_dx + (w->anim_end_dx - w->anim_start_dx) * p;
+      w->anim_dy = w->anim_start_dy + (w->anim_end_dy - w->anim_start_dy) * p;
+      w->anim_scale = w->anim_start_scale
+        + (w->anim_end_scale - w->anim_start_scale) * p;
+      ps->idling = false;
+    }
+  }
+
+  if (!win_is_animated(w)) {
+    // Back at the real geometry
+    add_damage(ps, win_extents(ps, w));
+    ps->reg_ignore_expire = true;
+    return;
+  }
+
+  const int wid = round(w->widthb * w->anim_scale);
+  const int hei = round(w->heightb * w->anim_scale);
+  w->anim_rect = (XRectangle) {
+    .x = round(w->a.x + w->anim_dx + (w->widthb - wid) / 2.0),
+    .y = round(w->a.y + w->anim_dy + (w->heightb - hei) / 2.0),
+    .width = max_i(wid, 1),
+    .height = max_i(hei, 1),
+  };
+  w->anim_reg = XFixesCreateRegion(ps->dpy, &w->anim_rect, 1);
+  add_damage(ps, copy_region(ps, w->anim_reg));
+}
+
 // === Shadows ===
 
 static double __attribute__((const))
@@ -321,10 +499,18 @@ presum_gaussian(session_t *ps, conv *map) {
   }
 }
 
-static XImage *
-make_shadow(session_t *ps, double opacity,
+/**
+ * Rasterize the 8-bit alpha image of a shadow.
+ *
+ * Only reads the precomputed shadow tables of the session, so it's safe
+ * to call from shadow worker threads.
+ *
+ * @return image data of size <code>(width + cgsize) * (height +
+ *    cgsize)</code>, to be freed by caller, NULL on failure
+ */
+static unsigned char *
+make_shadow_data(const session_t *ps, double opacity,
             int width, int height) {
-  XImage *ximage;
   unsigned char *data;
   int ylimit, xlimit;
   int swidth = width + ps->cgsize;
@@ -336,15 +522,7 @@ make_shadow(session_t *ps, double opacity,
   int opacity_int = (int)(opacity * 25);
 
   data = malloc(swidth * sheight * sizeof(unsigned char));
-  if (!data) return 0;
-
-  ximage = XCreateImage(ps->dpy, ps->vis, 8,
-    ZPixmap, 0, (char *) data, swidth, sheight, 8, swidth * sizeof(char));
-
-  if (!ximage) {
-    free(data);
-    return 0;
-  }
+  if (!data) return NULL;
 
   /*
    * Build the gaussian in sections
@@ -448,7 +626,114 @@ make_shadow(session_t *ps, double opacity,
   }
   */
 
-  return ximage;
+  return data;
+}
+
+/**
+ * Rasterize the 8-bit alpha image of the shadow of a shaped window.
+ *
+ * The bounding shape is rasterized into a mask and blurred with the
+ * gaussian kernel in two separable passes. Like
+ * <code>make_shadow_data()</code>, only the precomputed shadow tables of
+ * the session are read.
+ *
+ * @param rects rectangles of the bounding shape, relative to the window
+ * @param nrects number of rectangles
+ * @return image data of size <code>(width + cgsize) * (height +
+ *    cgsize)</code>, to be freed by caller, NULL on failure
+ */
+static unsigned char *
+make_shadow_data_shaped(const session_t *ps, double opacity,
+    int width, int height, const XRectangle *rects, int nrects) {
+  const int g_size = ps->gaussian_map->size;
+  const int center = ps->cgsize / 2;
+  const int swidth = width + ps->cgsize;
+  const int sheight = height + ps->cgsize;
+
+  unsigned char *data = calloc(swidth * sheight, sizeof(unsigned char));
+  float *tmp = calloc(swidth * sheight, sizeof(float));
+  float *kern = malloc(g_size * sizeof(float));
+  if (!data || !tmp || !kern) {
+    free(data);
+    free(tmp);
+    free(kern);
+    return NULL;
+  }
+
+  // The gaussian map is separable, its column sums form the 1D kernel
+  for (int fx = 0; fx < g_size; ++fx) {
+    double v = 0;
+    for (int fy = 0; fy < g_size; ++fy)
+      v += ps->gaussian_map->data[fy * g_size + fx];
+    kern[fx] = v;
+  }
+
+  // Rasterize the shape into data, offset by the kernel center
+  for (int i = 0; i < nrects; ++i) {
+    const int x1 = max_i(rects[i].x, 0);
+    const int y1 = max_i(rects[i].y, 0);
+    const int x2 = min_i(rects[i].x + rects[i].width, width);
+    const int y2 = min_i(rects[i].y + rects[i].height, height);
+    for (int y = y1; y < y2; ++y)
+      if (x2 > x1)
+        memset(&data[(y + center) * swidth + x1 + center], 1, x2 - x1);
+  }
+
+  // Horizontal pass, only rows the shape covers have coverage
+  for (int y = center; y < center + height; ++y) {
+    const unsigned char *src = &data[y * swidth];
+    float *dst = &tmp[y * swidth];
+    for (int x = 0; x < swidth; ++x) {
+      const int fx_start = max_i(center - x, 0);
+      const int fx_end = min_i(swidth + center - x, g_size);
+      float v = 0;
+      for (int fx = fx_start; fx < fx_end; ++fx)
+        if (src[x + fx - center])
+          v += kern[fx];
+      dst[x] = v;
+    }
+  }
+
+  // Vertical pass
+  const float scale = opacity * 255.0;
+  for (int y = 0; y < sheight; ++y) {
+    const int fy_start = max_i(center - y, 0);
+    const int fy_end = min_i(sheight + center - y, g_size);
+    unsigned char *dst = &data[y * swidth];
+    for (int x = 0; x < swidth; ++x) {
+      float v = 0;
+      for (int fy = fy_start; fy < fy_end; ++fy)
+        v += kern[fy] * tmp[(y + fy - center) * swidth + x];
+      dst[x] = min_i(v * scale, 255);
+    }
+  }
+
+  free(tmp);
+  free(kern);
+
+  return data;
+}
+
+/**
+ * Get the bounding shape of a window for building its shadow.
+ *
+ * @param nrects number of rectangles returned
+ * @return rectangles relative to the window, to be freed with
+ *    <code>cxfree()</code>, or NULL if the window isn't shaped
+ */
+static XRectangle *
+win_shadow_rects(session_t *ps, win *w, int *nrects) {
+  *nrects = 0;
+  if (!w->bounding_shaped || !w->border_size)
+    return NULL;
+
+  XRectangle *rects = XFixesFetchRegion(ps->dpy, w->border_size, nrects);
+  for (int i = 0; i < *nrects; ++i) {
+    rects[i].x -= w->a.x;
+    rects[i].y -= w->a.y;
+  }
+
+  return rects;
 }
 
 /**
@@ -456,17 +741,48 @@ make_shadow(session_t *ps, double opacity,
  */
 static bool
 win_build_shadow(session_t *ps, win *w, double opacity) {
-  const int width = w->widthb;
-  const int height = w->heightb;
+  unsigned char *data = NULL;
+  int nrects = 0;
+  XRectangle *rects = win_shadow_rects(ps, w, &nrects);
+  if (rects) {
+    data = make_shadow_data_shaped(ps, opacity, w->widthb, w->heightb,
+        rects, nrects);
+    cxfree(rects);
+  }
+  else {
+    data = make_shadow_data(ps, opacity, w->widthb, w->heightb);
+  }
+  if (!data)
+    return false;
 
+  return win_bind_shadow(ps, w, data, w->widthb + ps->cgsize,
+      w->heightb + ps->cgsize);
+}
+
+/**
+ * Upload a rasterized shadow image of a window and build its shadow
+ * <code>Picture</code>.
+ *
+ * @param ps current session
+ * @param w struct _win of the window
+ * @param data 8-bit alpha image, freed by this function
+ * @param swidth width of the image
+ * @param sheight height of the image
+ */
+static bool
+win_bind_shadow(session_t *ps, win *w, unsigned char *data,
+    int swidth, int sheight) {
   XImage *shadow_image = NULL;
   Pixmap shadow_pixmap = None, shadow_pixmap_argb = None;
   Picture shadow_picture = None, shadow_picture_argb = None;
   GC gc = None;
 
-  shadow_image = make_shadow(ps, opacity, width, height);
-  if (!shadow_image)
-    return None;
+  shadow_image = XCreateImage(ps->dpy, ps->vis, 8, ZPixmap, 0,
+      (char *) data, swidth, sheight, 8, swidth * sizeof(char));
+  if (!shadow_image) {
+    free(data);
+    return false;
+  }
 
   shadow_pixmap = XCreatePixmap(ps->dpy, ps->root,
     shadow_image->width, shadow_image->height, 8);
@@ -525,6 +841,289 @@ shadow_picture_err:
   return false;
 }
 
+/**
+ * Request the shadow of a window to be built.
+ *
+ * With a shadow worker pool, the shadow is rasterized asynchronously and
+ * attached by <code>shadow_pool_collect()</code>, the outdated shadow, if
+ * any, is kept until then. Otherwise the shadow is built right away.
+ */
+static void
+win_request_shadow(session_t *ps, win *w) {
+#ifdef CONFIG_SHADOW_THREADS
+  if (ps->shadow_pool) {
+    if (w->shadow_job || shadow_pool_submit(ps, w))
+      return;
+  }
+#endif
+
+  free_paint(ps, &w->shadow_paint);
+  w->shadow_outdated = false;
+  win_build_shadow(ps, w, 1);
+}
+
+/**
+ * Mark the shadow of a window as outdated after a size change.
+ */
+static void
+win_expire_shadow(session_t *ps, win *w) {
+  win_cancel_shadow(ps, w);
+
+#ifdef CONFIG_SHADOW_THREADS
+  // Keep the outdated shadow as a placeholder until the new one is ready
+  if (ps->shadow_pool && w->shadow_paint.pixmap) {
+    w->shadow_outdated = true;
+    return;
+  }
+#endif
+
+  free_paint(ps, &w->shadow_paint);
+}
+
+/**
+ * Free the shadow of a window, together with its pending job.
+ */
+static void
+win_free_shadow(session_t *ps, win *w) {
+  win_cancel_shadow(ps, w);
+  free_paint(ps, &w->shadow_paint);
+  w->shadow_outdated = false;
+}
+
+#ifdef CONFIG_SHADOW_THREADS
+/**
+ * Main function of a shadow worker thread.
+ */
+static void *
+shadow_worker(void *arg) {
+  session_t * const ps = arg;
+  shadow_pool_t * const pool = ps->shadow_pool;
+
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (!pool->quit && !pool->pending)
+      pthread_cond_wait(&pool->cond_job, &pool->lock);
+    if (pool->quit)
+      break;
+
+    shadow_job_t *job = pool->pending;
+    pool->pending = job->next;
+    if (!pool->pending)
+      pool->pending_tail = &pool->pending;
+    ++pool->running;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (job->rects)
+      job->data = make_shadow_data_shaped(ps, 1, job->width, job->height,
+          job->rects, job->nrects);
+    else
+      job->data = make_shadow_data(ps, 1, job->width, job->height);
+
+    pthread_mutex_lock(&pool->lock);
+    --pool->running;
+    job->next = pool->done;
+    pool->done = job;
+    pthread_cond_broadcast(&pool->cond_done);
+
+    // Failure means the pipe is full, which already wakes the main loop
+    const char c = 0;
+    if (write(pool->wake_fds[1], &c, 1) < 0)
+      assert(EAGAIN == errno);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+/**
+ * Start the shadow worker pool.
+ */
+static bool
+shadow_pool_init(session_t *ps) {
+  shadow_pool_t *pool = cmalloc(1, shadow_pool_t);
+  pool->threads = cmalloc(ps->o.shadow_threads, pthread_t);
+  pool->nthreads = 0;
+  pool->pending = NULL;
+  pool->pending_tail = &pool->pending;
+  pool->done = NULL;
+  pool->running = 0;
+  pool->quit = false;
+
+  if (pipe2(pool->wake_fds, O_NONBLOCK | O_CLOEXEC)) {
+    printf_errf("(): Failed to create wakeup pipe.");
+    free(pool->threads);
+    free(pool);
+    return false;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->cond_job, NULL);
+  pthread_cond_init(&pool->cond_done, NULL);
+  ps->shadow_pool = pool;
+
+  for (int i = 0; i < ps->o.shadow_threads; ++i) {
+    if (pthread_create(&pool->threads[i], NULL, shadow_worker, ps))
+      break;
+    ++pool->nthreads;
+  }
+
+  if (!pool->nthreads) {
+    printf_errf("(): Failed to start any shadow worker thread.");
+    shadow_pool_destroy(ps);
+    return false;
+  }
+
+  fds_insert(ps, pool->wake_fds[0], POLLIN);
+
+  return true;
+}
+
+/**
+ * Stop the shadow worker pool and free all its jobs.
+ */
+static void
+shadow_pool_destroy(session_t *ps) {
+  shadow_pool_t * const pool = ps->shadow_pool;
+  if (!pool)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = true;
+  pthread_cond_broadcast(&pool->cond_job);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->nthreads; ++i)
+    pthread_join(pool->threads[i], NULL);
+
+  // Every job is in one of the lists now that workers are stopped
+  shadow_job_t *lists[] = { pool->pending, pool->done };
+  for (int i = 0; i < sizeof(lists) / sizeof(lists[0]); ++i) {
+    for (shadow_job_t *job = lists[i], *next = NULL; job; job = next) {
+      next = job->next;
+      if (job->w)
+        job->w->shadow_job = NULL;
+      cxfree(job->rects);
+      free(job->data);
+      free(job);
+    }
+  }
+
+  fds_drop(ps, pool->wake_fds[0], POLLIN);
+  close(pool->wake_fds[0]);
+  close(pool->wake_fds[1]);
+  pthread_cond_destroy(&pool->cond_done);
+  pthread_cond_destroy(&pool->cond_job);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->threads);
+  free(pool);
+  ps->shadow_pool = NULL;
+}
+
+/**
+ * Queue a shadow rasterization job for a window.
+ */
+static bool
+shadow_pool_submit(session_t *ps, win *w) {
+  shadow_pool_t * const pool = ps->shadow_pool;
+  shadow_job_t *job = malloc(sizeof(shadow_job_t));
+  if (!job)
+    return false;
+
+  job->w = w;
+  job->width = w->widthb;
+  job->height = w->heightb;
+  job->swidth = w->widthb + ps->cgsize;
+  job->sheight = w->heightb + ps->cgsize;
+  job->rects = win_shadow_rects(ps, w, &job->nrects);
+  job->data = NULL;
+  job->next = NULL;
+  w->shadow_job = job;
+
+  pthread_mutex_lock(&pool->lock);
+  *pool->pending_tail = job;
+  pool->pending_tail = &job->next;
+  pthread_cond_signal(&pool->cond_job);
+  pthread_mutex_unlock(&pool->lock);
+
+  return true;
+}
+
+/**
+ * Cancel all shadow jobs and wait for the workers to become idle.
+ *
+ * Must be called before the shadow tables the workers read are rebuilt.
+ */
+static void
+shadow_pool_cancel_all(session_t *ps) {
+  shadow_pool_t * const pool = ps->shadow_pool;
+  if (!pool)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  // Pending jobs go to the done list unrasterized
+  if (pool->pending) {
+    *pool->pending_tail = pool->done;
+    pool->done = pool->pending;
+    pool->pending = NULL;
+    pool->pending_tail = &pool->pending;
+  }
+  while (pool->running)
+    pthread_cond_wait(&pool->cond_done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (win *w = ps->list; w; w = w->next)
+    win_cancel_shadow(ps, w);
+}
+
+/**
+ * Attach shadows finished by the workers to their windows.
+ *
+ * @return true if any shadow is attached
+ */
+static bool
+shadow_pool_collect(session_t *ps) {
+  shadow_pool_t * const pool = ps->shadow_pool;
+
+  // Drain the wakeup pipe before taking the list, so a job finishing in
+  // between wakes us up again
+  {
+    char buf[64];
+    while (read(pool->wake_fds[0], buf, sizeof(buf)) > 0)
+      continue;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  shadow_job_t *jobs = pool->done;
+  pool->done = NULL;
+  pthread_mutex_unlock(&pool->lock);
+
+  bool attached = false;
+  for (shadow_job_t *job = jobs, *next = NULL; job; job = next) {
+    next = job->next;
+    win * const w = job->w;
+    if (w && job->data) {
+      w->shadow_job = NULL;
+      free_paint(ps, &w->shadow_paint);
+      w->shadow_outdated = false;
+      if (win_bind_shadow(ps, w, job->data, job->swidth, job->sheight)) {
+        add_damage_win(ps, w);
+        attached = true;
+      }
+      job->data = NULL;
+    }
+    else if (w) {
+      // Rasterization failed, retry on next paint
+      w->shadow_job = NULL;
+    }
+    cxfree(job->rects);
+    free(job->data);
+    free(job);
+  }
+
+  return attached;
+}
+#endif
+
 /**
  * Generate a 1x1 <code>Picture</code> of a particular color.
  */
@@ -649,6 +1248,137 @@ wid_get_prop_adv(const session_t *ps, Window w, Atom atom, long offset,
   };
 }
 
+/**
+ * Get a window property through the property cache of its window.
+ *
+ * The property is cached only if we are notified of its changes, that is,
+ * it's on a mapped frame window or on a client window we listen to
+ * PropertyNotify events on. Cached properties are fetched from offset 0
+ * with enough length to serve later lookups of other offsets as well.
+ *
+ * The returned value is owned by the cache and stays valid until the next
+ * call or the next event. It must not be freed.
+ *
+ * @param ps current session
+ * @param w struct _win of the window
+ * @param wid the frame or client window of <code>w</code>
+ * @return the property, with <code>nitems</code> 0 if it's missing or
+ *         doesn't match the requested type and format
+ */
+winprop_t
+win_get_prop(session_t *ps, win *w, Window wid, Atom atom, long offset,
+    long length, Atom rtype, int rformat) {
+  const winprop_t prop_none = {
+    .data.p8 = NULL,
+    .nitems = 0,
+    .type = AnyPropertyType,
+    .format = 0
+  };
+
+  free_winprop(&ps->prop_uncached);
+
+  const bool cacheable = IsViewable == w->a.map_state
+    && (wid == w->id || (wid == w->client_win
+          && (determine_evmask(ps, wid, WIN_EVMODE_CLIENT)
+            & PropertyChangeMask)));
+  // The window may be gone already
+  if (!cacheable) {
+    ++ps->prop_cache_misses;
+    set_ignore_next(ps);
+    ps->prop_uncached = wid_get_prop_adv(ps, wid, atom, offset, length,
+        rtype, rformat);
+    return ps->prop_uncached;
+  }
+
+  winprop_cache_t *pc = NULL;
+  for (pc = w->prop_cache; pc; pc = pc->next)
+    if (wid == pc->wid && atom == pc->atom)
+      break;
+
+  if (pc && (!pc->partial || offset + length <= pc->length)) {
+    ++ps->prop_cache_hits;
+  }
+  else {
+    ++ps->prop_cache_misses;
+
+    if (!pc) {
+      pc = malloc(sizeof(winprop_cache_t));
+      if (!pc) {
+        printf_errf("(): Failed to allocate memory for property cache.");
+        return prop_none;
+      }
+      pc->wid = wid;
+      pc->atom = atom;
+      pc->prop = prop_none;
+      pc->next = w->prop_cache;
+      w->prop_cache = pc;
+    }
+    free_winprop(&pc->prop);
+
+    Atom type = None;
+    int format = 0;
+    unsigned long nitems = 0, after = 0;
+    unsigned char *data = NULL;
+
+    pc->length = max_i(offset + length, WINPROP_CACHE_LEN);
+    pc->partial = false;
+    set_ignore_next(ps);
+    if (Success == XGetWindowProperty(ps->dpy, wid, atom, 0L, pc->length,
+          False, AnyPropertyType, &type, &format, &nitems, &after, &data)
+        && nitems && (8 == format || 16 == format || 32 == format)) {
+      pc->prop = (winprop_t) {
+        .data.p8 = data,
+        .nitems = nitems,
+        .type = type,
+        .format = format,
+      };
+      pc->partial = after;
+    }
+    else {
+      cxfree(data);
+    }
+  }
+
+  // Serve the requested part
+  const winprop_t *pprop = &pc->prop;
+  if (!pprop->nitems
+      || (AnyPropertyType != rtype && pprop->type != rtype)
+      || (rformat && pprop->format != rformat))
+    return prop_none;
+
+  // Offset is in 32-bit multiples, while items are of the property format
+  const unsigned long per32 = 32 / pprop->format;
+  const unsigned long start = offset * per32;
+  if (start >= pprop->nitems)
+    return prop_none;
+
+  winprop_t ret = *pprop;
+  switch (pprop->format) {
+    case 8:   ret.data.p8 += start;   break;
+    case 16:  ret.data.p16 += start;  break;
+    case 32:  ret.data.p32 += start;  break;
+  }
+  ret.nitems = min_i(pprop->nitems - start, length * per32);
+
+  return ret;
+}
+
+/**
+ * Drop a cached property of a window.
+ */
+static void
+win_prop_cache_invalidate(win *w, Window wid, Atom atom) {
+  for (winprop_cache_t **ppc = &w->prop_cache; *ppc; ppc = &(*ppc)->next) {
+    winprop_cache_t *pc = *ppc;
+    if (wid == pc->wid && atom == pc->atom) {
+      *ppc = pc->next;
+      free_winprop(&pc->prop);
+      free(pc);
+      return;
+    }
+  }
+}
+
 /**
  * Check if a window has rounded corners.
  */
@@ -810,17 +1540,12 @@ recheck_focus(session_t *ps) {
   return NULL;
 }
 
-static bool
-get_root_tile(session_t *ps) {
-  /*
-  if (ps->o.paint_on_overlay) {
-    return ps->root_picture;
-  } */
-
-  assert(!ps->root_tile_paint.pixmap);
-  ps->root_tile_fill = false;
-
-  bool fill = false;
+/**
+ * Get the background pixmap set on the root window, None if there isn't
+ * any.
+ */
+static Pixmap
+get_root_tile_pixmap(session_t *ps) {
   Pixmap pixmap = None;
 
   // Get the values of background attributes
@@ -830,22 +1555,53 @@ get_root_tile(session_t *ps) {
         1L, XA_PIXMAP, 32);
     if (prop.nitems) {
       pixmap = *prop.data.p32;
-      fill = false;
       free_winprop(&prop);
       break;
     }
     free_winprop(&prop);
   }
 
-  // Make sure the pixmap we got is valid
-  if (pixmap && !validate_pixmap(ps, pixmap))
-    pixmap = None;
+  return pixmap;
+}
+
+static bool
+get_root_tile(session_t *ps) {
+  /*
+  if (ps->o.paint_on_overlay) {
+    return ps->root_picture;
+  } */
+
+  assert(!ps->root_tile_paint.pixmap);
+  ps->root_tile_fill = false;
+
+  bool fill = false;
+  Pixmap pixmap = get_root_tile_pixmap(ps);
+
+  // Make sure the pixmap we got is valid, and get its size
+  if (pixmap) {
+    Window rroot = None;
+    int rx = 0, ry = 0;
+    unsigned rwid = 0, rhei = 0, rborder = 0, rdepth = 0;
+    if (XGetGeometry(ps->dpy, pixmap, &rroot, &rx, &ry,
+          &rwid, &rhei, &rborder, &rdepth) && rwid && rhei) {
+      ps->root_tile_width = rwid;
+      ps->root_tile_height = rhei;
+    }
+    else
+      pixmap = None;
+  }
 
   // Create a pixmap if there isn't any
   if (!pixmap) {
     pixmap = XCreatePixmap(ps->dpy, ps->root, 1, 1, ps->depth);
+    ps->root_tile_width = ps->root_tile_height = 1;
     fill = true;
   }
+  // Track changes to the contents of the background pixmap, so they
+  // don't require refetching it
+  else
+    ps->root_tile_damage = XDamageCreate(ps->dpy, pixmap,
+        XDamageReportNonEmpty);
 
   // Create Picture
   {
@@ -868,8 +1624,9 @@ get_root_tile(session_t *ps) {
 
   ps->root_tile_fill = fill;
   ps->root_tile_paint.pixmap = pixmap;
+  ps->root_tile_pixmap_damaged = false;
 #ifdef CONFIG_VSYNC_OPENGL
-  if (BKEND_GLX == ps->o.backend)
+  if (bkend_paint_glx(ps))
     return glx_bind_pixmap(ps, &ps->root_tile_paint.ptex, ps->root_tile_paint.pixmap, 0, 0, 0);
 #endif
 
@@ -883,6 +1640,13 @@ static void
 paint_root(session_t *ps, XserverRegion reg_paint) {
   if (!ps->root_tile_paint.pixmap)
     get_root_tile(ps);
+  // Rebind the texture if the background pixmap is drawn to
+  else if (ps->root_tile_pixmap_damaged) {
+    if (!paint_bind_tex(ps, &ps->root_tile_paint, 0, 0, 0,
+          !ps->o.glx_no_rebind_pixmap))
+      printf_errf("(): Failed to rebind root tile texture.");
+  }
+  ps->root_tile_pixmap_damaged = false;
 
   win_render(ps, NULL, 0, 0, ps->root_width, ps->root_height, 1.0, reg_paint,
       NULL, ps->root_tile_paint.pict);
@@ -1033,79 +1797,288 @@ find_client_win(session_t *ps, Window w) {
 
   cxfree(children);
 
-  return ret;
+  return ret;
+}
+
+/**
+ * Retrieve frame extents from a window.
+ */
+static void
+get_frame_extents(session_t *ps, win *w, Window client) {
+  cmemzero_one(&w->frame_extents);
+
+  winprop_t prop = win_get_prop(ps, w, client, ps->atom_frame_extents,
+    0L, 4L, XA_CARDINAL, 32);
+
+  if (4 == prop.nitems) {
+    const long * const extents = prop.data.p32;
+    w->frame_extents.left = extents[0];
+    w->frame_extents.right = extents[1];
+    w->frame_extents.top = extents[2];
+    w->frame_extents.bottom = extents[3];
+
+    if (ps->o.frame_opacity)
+      update_reg_ignore_expire(ps, w);
+  }
+
+#ifdef DEBUG_FRAME
+  printf_dbgf("(%#010lx): %d, %d, %d, %d\n", w->id,
+      w->frame_extents.left, w->frame_extents.right,
+      w->frame_extents.top, w->frame_extents.bottom);
+#endif
+}
+
+/**
+ * Get the alpha value of the mask for an opacity in <code>double</code>,
+ * quantized by <code>--alpha-step</code> if it's set.
+ */
+static inline int
+get_alpha_d(const session_t *ps, double o) {
+  o = normalize_d(o);
+  if (ps->o.alpha_step > 0.0)
+    o = normalize_d(round(o / ps->o.alpha_step) * ps->o.alpha_step);
+  return round(o * (ALPHA_PICT_NUM - 1));
+}
+
+/**
+ * Get the alpha value of the mask for an opacity in
+ * <code>opacity_t</code>.
+ */
+static inline int
+get_alpha_o(const session_t *ps, opacity_t o) {
+  return get_alpha_d(ps, (double) o / OPAQUE);
+}
+
+/**
+ * Unlink an alpha picture from the LRU list.
+ */
+static inline void
+alpha_pict_unlink(session_t *ps, alpha_pict_t *e) {
+  if (e->prev) e->prev->next = e->next;
+  else ps->alpha_picts_head = e->next;
+  if (e->next) e->next->prev = e->prev;
+  else ps->alpha_picts_tail = e->prev;
+  e->prev = e->next = NULL;
+}
+
+/**
+ * Link an alpha picture to the head of the LRU list.
+ */
+static inline void
+alpha_pict_push(session_t *ps, alpha_pict_t *e) {
+  e->prev = NULL;
+  e->next = ps->alpha_picts_head;
+  if (ps->alpha_picts_head) ps->alpha_picts_head->prev = e;
+  else ps->alpha_picts_tail = e;
+  ps->alpha_picts_head = e;
+}
+
+/**
+ * Get alpha <code>Picture</code> for an opacity in
+ * <code>opacity_t</code>.
+ *
+ * Pictures are created on first use and the least recently used one is
+ * freed when more than <code>ALPHA_PICT_CACHE_MAX</code> are alive.
+ * Returns None for an opaque mask.
+ */
+static Picture
+get_alpha_pict_o(session_t *ps, opacity_t o) {
+  const int alpha = get_alpha_o(ps, o);
+  if (ALPHA_PICT_NUM - 1 == alpha)
+    return None;
+
+  alpha_pict_t *e = &ps->alpha_picts[alpha];
+  if (e->pict) {
+    if (ps->alpha_picts_head != e) {
+      alpha_pict_unlink(ps, e);
+      alpha_pict_push(ps, e);
+    }
+    return e->pict;
+  }
+
+  if (ps->alpha_picts_cnt >= ALPHA_PICT_CACHE_MAX) {
+    alpha_pict_t *lru = ps->alpha_picts_tail;
+    alpha_pict_unlink(ps, lru);
+    free_picture(ps, &lru->pict);
+    --ps->alpha_picts_cnt;
+  }
+
+  e->pict = solid_picture(ps, false,
+      (double) alpha / (ALPHA_PICT_NUM - 1), 0, 0, 0);
+  if (e->pict) {
+    alpha_pict_push(ps, e);
+    ++ps->alpha_picts_cnt;
+  }
+
+  return e->pict;
+}
+
+/**
+ * Get alpha <code>Picture</code> for an opacity in <code>double</code>.
+ */
+static inline Picture
+get_alpha_pict_d(session_t *ps, double o) {
+  return get_alpha_pict_o(ps, normalize_d(o) * OPAQUE);
+}
+
+/**
+ * Free all alpha pictures.
+ */
+static void
+free_alpha_picts(session_t *ps) {
+  for (int i = 0; i < ALPHA_PICT_NUM; ++i) {
+    free_picture(ps, &ps->alpha_picts[i].pict);
+    ps->alpha_picts[i].prev = ps->alpha_picts[i].next = NULL;
+  }
+  ps->alpha_picts_head = ps->alpha_picts_tail = NULL;
+  ps->alpha_picts_cnt = 0;
+}
+
+/**
+ * Make room for one more window in <code>ps->paint_hot</code>.
+ *
+ * @return true if there's room, false if memory allocation failed
+ */
+static bool
+paint_hot_reserve(session_t *ps) {
+  // Only complain once, this would otherwise be printed every frame
+  static bool reported = false;
+
+  if (ps->paint_hot_cnt < ps->paint_hot_max)
+    return true;
+
+  int max = max_i(ps->paint_hot_max * 2, WIN_ARENA_CHUNK);
+  win_hot_t *hot = realloc(ps->paint_hot, max * sizeof(win_hot_t));
+  if (hot)
+    ps->paint_hot = hot;
+  int *solid = (hot ? realloc(ps->paint_solid, max * sizeof(int)): NULL);
+  if (solid)
+    ps->paint_solid = solid;
+  if (!hot || !solid) {
+    if (!reported)
+      printf_errf("(): Failed to allocate memory for hot window state. "
+          "Some windows won't be painted.");
+    reported = true;
+    return false;
+  }
+
+  ps->paint_hot_max = max;
+  return true;
 }
 
 /**
- * Retrieve frame extents from a window.
+ * Append the hot state of a window to paint to <code>ps->paint_hot</code>.
+ *
+ * Room for it must have been made with <code>paint_hot_reserve()</code>.
  */
 static void
-get_frame_extents(session_t *ps, win *w, Window client) {
-  cmemzero_one(&w->frame_extents);
+paint_hot_add(session_t *ps, win *w) {
+  assert(ps->paint_hot_cnt < ps->paint_hot_max);
+
+  win_hot_t *h = &ps->paint_hot[ps->paint_hot_cnt++];
+  h->w = w;
+  h->reg_ignore = w->reg_ignore;
+  h->border_size = w->border_size;
+  h->extents = w->extents;
+  h->shadow = w->shadow;
+  h->shadow_rect = (XRectangle) {
+    .x = w->a.x + w->shadow_dx,
+    .y = w->a.y + w->shadow_dy,
+    .width = w->shadow_width,
+    .height = w->shadow_height,
+  };
+  h->blur_background = w->blur_background && (!win_is_solid(ps, w)
+      || (ps->o.blur_background_frame && w->frame_opacity));
+  h->variant = 0;
+  h->prepainted = false;
 
-  winprop_t prop = wid_get_prop(ps, client, ps->atom_frame_extents,
-    4L, XA_CARDINAL, 32);
+  // An animated window is painted in its animated rectangle only, without
+  // shadow or blur, as both are built for the real geometry
+  if (win_is_animated(w)) {
+    h->border_size = h->extents = w->anim_reg;
+    h->shadow = false;
+    h->blur_background = false;
+  }
+}
 
-  if (4 == prop.nitems) {
-    const long * const extents = prop.data.p32;
-    w->frame_extents.left = extents[0];
-    w->frame_extents.right = extents[1];
-    w->frame_extents.top = extents[2];
-    w->frame_extents.bottom = extents[3];
+/**
+ * Sample whether the full-screen window the screen could be unredirected
+ * for got damaged in this frame.
+ */
+static void
+unredir_sample(session_t *ps, win *w) {
+  const Window wid = (w ? w->id: None);
+  // unredir_is_video() needs up to fps * period frames in the ring
+  const int len = min_l((long) ps->o.unredir_if_possible_video_fps
+      * unredir_video_period(ps) / MS_PER_SEC + 1, UNREDIR_HIST_MAX);
 
-    if (ps->o.frame_opacity)
-      update_reg_ignore_expire(ps, w);
+  if (len != ps->unredir_damage_hist_len) {
+    ps->unredir_damage_hist = crealloc(ps->unredir_damage_hist, len,
+        time_ms_t);
+    ps->unredir_damage_hist_len = len;
+    ps->unredir_damage_idx = 0;
+    memset(ps->unredir_damage_hist, 0, len * sizeof(time_ms_t));
+    ps->unredir_win = wid;
   }
 
-#ifdef DEBUG_FRAME
-  printf_dbgf("(%#010lx): %d, %d, %d, %d\n", w->id,
-      w->frame_extents.left, w->frame_extents.right,
-      w->frame_extents.top, w->frame_extents.bottom);
-#endif
+  if (wid != ps->unredir_win) {
+    ps->unredir_win = wid;
+    ps->unredir_damage_idx = 0;
+    memset(ps->unredir_damage_hist, 0,
+        ps->unredir_damage_hist_len * sizeof(time_ms_t));
+  }
+  else if (wid && ps->unredir_win_damaged) {
+    ps->unredir_damage_hist[ps->unredir_damage_idx] = ps->fade_time;
+    ps->unredir_damage_idx = (ps->unredir_damage_idx + 1)
+      % ps->unredir_damage_hist_len;
+  }
 
-  free_winprop(&prop);
+  ps->unredir_win_damaged = false;
 }
 
 /**
- * Get alpha <code>Picture</code> for an opacity in <code>double</code>.
+ * Check if the full-screen window the screen could be unredirected for
+ * looks like a game or a video: it has been so for a quarter of the
+ * unredirection delay, and got damaged at least at the configured rate
+ * meanwhile.
  */
-static inline Picture
-get_alpha_pict_d(session_t *ps, double o) {
-  assert((round(normalize_d(o) / ps->o.alpha_step)) <= round(1.0 / ps->o.alpha_step));
-  return ps->alpha_picts[(int) (round(normalize_d(o)
-        / ps->o.alpha_step))];
-}
+static bool
+unredir_is_video(session_t *ps) {
+  if (!ps->o.unredir_if_possible_video_fps)
+    return false;
 
-/**
- * Get alpha <code>Picture</code> for an opacity in
- * <code>opacity_t</code>.
- */
-static inline Picture
-get_alpha_pict_o(session_t *ps, opacity_t o) {
-  return get_alpha_pict_d(ps, (double) o / OPAQUE);
+  const time_ms_t period = unredir_video_period(ps);
+  if (ps->fade_time - ps->tmout_unredir->firstrun < period)
+    return false;
+
+  int nframes = 0;
+  for (int i = 0; i < ps->unredir_damage_hist_len; ++i)
+    if (ps->unredir_damage_hist[i]
+        && ps->fade_time - ps->unredir_damage_hist[i] <= period)
+      ++nframes;
+
+  return nframes * MS_PER_SEC
+    >= (long) ps->o.unredir_if_possible_video_fps * period;
 }
 
 static win *
 paint_preprocess(session_t *ps, win *list) {
   win *t = NULL, *next = NULL;
 
-  // Fading step calculation
-  time_ms_t steps = 0L;
-  if (ps->fade_time) {
-    steps = ((get_time_ms() - ps->fade_time) + FADE_DELTA_TOLERANCE * ps->o.fade_delta) / ps->o.fade_delta;
-  }
-  // Reset fade_time if unset, or there appears to be a time disorder
-  if (!ps->fade_time || steps < 0L) {
-    ps->fade_time = get_time_ms();
-    steps = 0L;
-  }
-  ps->fade_time += steps * ps->o.fade_delta;
+  ps->paint_hot_cnt = 0;
+
+  // Sample the frame timestamp once, so all fades in this frame advance
+  // to the same point in time
+  ps->fade_time = get_time_ms();
 
   XserverRegion last_reg_ignore = None;
 
   bool unredir_possible = false;
   // Trace whether it's the highest window to paint
   bool is_highest = true;
+  // Small windows skipped above the highest window
+  int noverlays = 0;
+  win *unredir_w = NULL;
   for (win *w = list; w; w = next) {
     bool to_paint = true;
     const winmode_t mode_old = w->mode;
@@ -1118,7 +2091,13 @@ paint_preprocess(session_t *ps, win *list) {
     {
       // Remove built shadow if needed
       if (w->flags & WFLAG_SIZE_CHANGE)
-        free_paint(ps, &w->shadow_paint);
+        win_expire_shadow(ps, w);
+
+      // Expire reg_ignore from this window downwards if its region changed
+      if (w->reg_ignore_expire) {
+        ps->reg_ignore_expire = true;
+        w->reg_ignore_expire = false;
+      }
 
       // Destroy reg_ignore on all windows if they should expire
       if (ps->reg_ignore_expire)
@@ -1140,7 +2119,10 @@ paint_preprocess(session_t *ps, win *list) {
     }
 
     // Run fading
-    run_fade(ps, w, steps);
+    run_fade(ps, w);
+
+    // Run geometry animation
+    run_anim(ps, w);
 
     // Opacity will not change, from now on.
 
@@ -1151,10 +2133,14 @@ paint_preprocess(session_t *ps, win *list) {
         || w->a.x + w->a.width < 1 || w->a.y + w->a.height < 1
         || w->a.x >= ps->root_width || w->a.y >= ps->root_height
         || ((IsUnmapped == w->a.map_state || w->destroyed) && !w->paint.pixmap)
-        || get_alpha_pict_o(ps, w->opacity) == ps->alpha_picts[0]
+        || !get_alpha_o(ps, w->opacity)
         || w->paint_excluded)
       to_paint = false;
 
+    // A window without room for its hot state can't be painted
+    if (to_paint && !paint_hot_reserve(ps))
+      to_paint = false;
+
     // to_paint will never change afterward
 
     // Determine mode as early as possible
@@ -1212,7 +2198,7 @@ paint_preprocess(session_t *ps, win *list) {
 
         // If the window is solid, we add the window region to the
         // ignored region
-        if (win_is_solid(ps, w)) {
+        if (win_is_solid(ps, w) && !win_is_animated(w)) {
           if (!w->frame_opacity) {
             if (w->border_size)
               w->reg_ignore = copy_region(ps, w->border_size);
@@ -1245,12 +2231,21 @@ paint_preprocess(session_t *ps, win *list) {
       // fading is enabled, and could create inconsistency when the wallpaper
       // is not correctly set.
       if (ps->o.unredir_if_possible && is_highest && to_paint) {
-        is_highest = false;
-        if (win_is_solid(ps, w)
-            && (!w->frame_opacity || !win_has_frame(w))
-            && win_is_fullscreen(ps, w)
-            && !w->unredir_if_possible_excluded)
-          unredir_possible = true;
+        // The X server paints small windows like notifications and
+        // tooltips over a full-screen window fine without us, only
+        // losing their effects
+        if (win_is_unredir_overlay(ps, w))
+          ++noverlays;
+        else {
+          is_highest = false;
+          if (win_is_solid(ps, w) && !win_is_animated(w)
+              && (!w->frame_opacity || !win_has_frame(w))
+              && win_is_fullscreen(ps, w)
+              && !w->unredir_if_possible_excluded) {
+            unredir_possible = true;
+            unredir_w = w;
+          }
+        }
       }
 
       // Reset flags
@@ -1263,6 +2258,7 @@ paint_preprocess(session_t *ps, win *list) {
     if (to_paint) {
       w->prev_trans = t;
       t = w;
+      paint_hot_add(ps, w);
     }
     else {
       assert(w->destroyed == (w->fade_callback == destroy_callback));
@@ -1283,18 +2279,36 @@ paint_preprocess(session_t *ps, win *list) {
   }
 
 
+  if (ps->o.unredir_if_possible)
+    unredir_sample(ps, unredir_w);
+
   // If possible, unredirect all windows and stop painting
   if (UNSET != ps->o.redirected_force)
     unredir_possible = !ps->o.redirected_force;
 
   // If there's no window to paint, and the screen isn't redirected,
   // don't redirect it.
-  if (ps->o.unredir_if_possible && is_highest && !ps->redirected)
+  if (ps->o.unredir_if_possible && is_highest && !noverlays
+      && !ps->redirected)
     unredir_possible = true;
   if (unredir_possible) {
+    // Windows above one unredirected alone are not painted at all, so it
+    // must stay the topmost
+    const bool alone = (unredir_w && !noverlays
+        && UNSET == ps->o.redirected_force);
+    if (ps->unredir_only && unredir_w && unredir_w->id != ps->unredir_only)
+      redir_start(ps);
+    else if (ps->unredir_only && !alone)
+      redir_stop(ps);
+
     if (ps->redirected) {
-      if (!ps->o.unredir_if_possible_delay || ps->tmout_unredir_hit)
-        redir_stop(ps);
+      if (!ps->o.unredir_if_possible_delay || ps->tmout_unredir_hit
+          || (ps->tmout_unredir->enabled && unredir_is_video(ps))) {
+        if (alone)
+          redir_stop_win(ps, unredir_w);
+        else
+          redir_stop(ps);
+      }
       else if (!ps->tmout_unredir->enabled) {
         timeout_reset(ps, ps->tmout_unredir);
         ps->tmout_unredir->enabled = true;
@@ -1315,6 +2329,19 @@ paint_preprocess(session_t *ps, win *list) {
 static inline void
 win_paint_shadow(session_t *ps, win *w,
     XserverRegion reg_paint, const reg_data_t *pcache_reg) {
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  // Render the shadow analytically, without a shadow pixmap
+  if (glx_use_gpu_shadow(ps, w)) {
+    if (glx_shadow_dst(ps, w->a.x + w->shadow_dx, w->a.y + w->shadow_dy,
+          w->shadow_width, w->shadow_height,
+          w->a.x + w->shadow_dx + ps->cgsize / 2,
+          w->a.y + w->shadow_dy + ps->cgsize / 2, w->widthb, w->heightb,
+          ps->psglx->z, w->shadow_opacity, reg_paint, pcache_reg))
+      ps->psglx->z += 1;
+    return;
+  }
+#endif
+
   // Bind shadow pixmap to GLX texture if needed
   paint_bind_tex(ps, &w->shadow_paint, 0, 0, 32, false);
 
@@ -1417,19 +2444,134 @@ xr_blur_dst(session_t *ps, Picture tgt_buffer,
   return true;
 }
 
-/*
- * WORK-IN-PROGRESS!
-static void
-xr_take_screenshot(session_t *ps) {
-  XImage *img = XGetImage(ps->dpy, get_tgt_window(ps), 0, 0,
-      ps->root_width, ps->root_height, AllPlanes, XYPixmap);
-  if (!img) {
-    printf_errf("(): Failed to get XImage.");
-    return NULL;
+/**
+ * @brief Blur an area on a buffer with a downsampled pyramid.
+ *
+ * The X Render counterpart of the dual kawase blur. Each level halves the
+ * resolution with a bilinear transform and applies a small binomial
+ * kernel, then the levels are upscaled back the same way, so the server
+ * convolves far fewer pixels than a full resolution kernel would need.
+ *
+ * @param ps current session
+ * @param tgt_buffer a buffer as both source and destination
+ * @param x x pos
+ * @param y y pos
+ * @param wid width
+ * @param hei height
+ * @param reg_clip a clipping region to be applied on intermediate buffers
+ *
+ * @return true if successful, false otherwise
+ */
+static bool
+xr_pyramid_blur_dst(session_t *ps, Picture tgt_buffer,
+    int x, int y, int wid, int hei, XserverRegion reg_clip) {
+  const int levels = ps->o.blur_strength.iterations;
+  assert(levels > 0 && levels < MAX_BLUR_PASS);
+
+  // Larger offsets of the kawase blur spread further, which a wider kernel
+  // approximates here
+  static const double BINOMIAL_3[] = { 1, 2, 1 };
+  static const double BINOMIAL_5[] = { 1, 4, 6, 4, 1 };
+  const int ksize = (ps->o.blur_strength.offset > 3.0 ? 5: 3);
+  XFixed kern[2 + 5 * 5];
+  {
+    const double *row = (5 == ksize ? BINOMIAL_5: BINOMIAL_3);
+    const double sum = 1 << (ksize - 1);
+    kern[0] = kern[1] = XDoubleToFixed(ksize);
+    for (int j = 0; j < ksize; ++j)
+      for (int i = 0; i < ksize; ++i)
+        kern[2 + j * ksize + i] = XDoubleToFixed(row[i] * row[j] / (sum * sum));
+  }
+
+  // Blur a padded area, so pixels outside the window affect its edges
+  const int pad = (ksize / 2 + 1) << levels;
+  const int sx = max_i(x - pad, 0);
+  const int sy = max_i(y - pad, 0);
+  const int swid = min_i(x + wid + pad, ps->root_width) - sx;
+  const int shei = min_i(y + hei + pad, ps->root_height) - sy;
+  if (swid <= 0 || shei <= 0)
+    return true;
+
+  Picture picts[MAX_BLUR_PASS] = { None };
+  Picture tmp_picts[MAX_BLUR_PASS] = { None };
+  int widths[MAX_BLUR_PASS], heights[MAX_BLUR_PASS];
+  bool success = false;
+
+  {
+    XRenderPictureAttributes pa = { .repeat = RepeatPad };
+    for (int i = 0; i <= levels; ++i) {
+      widths[i] = (i ? max_i((widths[i - 1] + 1) / 2, 1): swid);
+      heights[i] = (i ? max_i((heights[i - 1] + 1) / 2, 1): shei);
+      picts[i] = xr_build_picture(ps, widths[i], heights[i], NULL);
+      if (i)
+        tmp_picts[i] = xr_build_picture(ps, widths[i], heights[i], NULL);
+      if (!picts[i] || (i && !tmp_picts[i])) {
+        printf_errf("(): Failed to build intermediate Picture.");
+        goto xr_pyramid_blur_dst_end;
+      }
+      XRenderChangePicture(ps->dpy, picts[i], CPRepeat, &pa);
+      if (i)
+        XRenderChangePicture(ps->dpy, tmp_picts[i], CPRepeat, &pa);
+    }
+  }
+
+  XRenderComposite(ps->dpy, PictOpSrc, tgt_buffer, None, picts[0],
+      sx, sy, 0, 0, 0, 0, swid, shei);
+
+  XTransform xform = { {
+    { XDoubleToFixed(2), XDoubleToFixed(0), XDoubleToFixed(0) },
+    { XDoubleToFixed(0), XDoubleToFixed(2), XDoubleToFixed(0) },
+    { XDoubleToFixed(0), XDoubleToFixed(0), XDoubleToFixed(1) },
+  } };
+  XTransform xform_identity = { {
+    { XDoubleToFixed(1), XDoubleToFixed(0), XDoubleToFixed(0) },
+    { XDoubleToFixed(0), XDoubleToFixed(1), XDoubleToFixed(0) },
+    { XDoubleToFixed(0), XDoubleToFixed(0), XDoubleToFixed(1) },
+  } };
+
+  // Downsample, bilinear filtering at half resolution averages 2x2 pixels
+  for (int i = 1; i <= levels; ++i) {
+    XRenderSetPictureTransform(ps->dpy, picts[i - 1], &xform);
+    XRenderSetPictureFilter(ps->dpy, picts[i - 1], XRFILTER_BILINEAR,
+        NULL, 0);
+    XRenderComposite(ps->dpy, PictOpSrc, picts[i - 1], None, tmp_picts[i],
+        0, 0, 0, 0, 0, 0, widths[i], heights[i]);
+    XRenderSetPictureTransform(ps->dpy, picts[i - 1], &xform_identity);
+    xrfilter_reset(ps, picts[i - 1]);
+
+    XRenderSetPictureFilter(ps->dpy, tmp_picts[i], XRFILTER_CONVOLUTION,
+        kern, 2 + ksize * ksize);
+    XRenderComposite(ps->dpy, PictOpSrc, tmp_picts[i], None, picts[i],
+        0, 0, 0, 0, 0, 0, widths[i], heights[i]);
+  }
+
+  // Upsample back to full resolution
+  xform.matrix[0][0] = xform.matrix[1][1] = XDoubleToFixed(0.5);
+  for (int i = levels; i > 0; --i) {
+    if (1 == i && reg_clip)
+      XFixesSetPictureClipRegion(ps->dpy, picts[0], x - sx, y - sy,
+          reg_clip);
+    XRenderSetPictureTransform(ps->dpy, picts[i], &xform);
+    XRenderSetPictureFilter(ps->dpy, picts[i], XRFILTER_BILINEAR, NULL, 0);
+    XRenderComposite(ps->dpy, PictOpSrc, picts[i], None, picts[i - 1],
+        0, 0, 0, 0, 0, 0, widths[i - 1], heights[i - 1]);
+  }
+  if (reg_clip)
+    XFixesSetPictureClipRegion(ps->dpy, picts[0], 0, 0, None);
+
+  XRenderComposite(ps->dpy, PictOpSrc, picts[0], None, tgt_buffer,
+      x - sx, y - sy, 0, 0, x, y, wid, hei);
+
+  success = true;
+
+xr_pyramid_blur_dst_end:
+  for (int i = 0; i <= levels; ++i) {
+    free_picture(ps, &picts[i]);
+    free_picture(ps, &tmp_picts[i]);
   }
-  assert(0 == img->xoffset);
+
+  return success;
 }
-*/
 
 /**
  * Blur the background of a window.
@@ -1501,8 +2643,11 @@ win_blur_background(session_t *ps, win *w, Picture tgt_buffer,
           XFixesSubtractRegion(ps->dpy, reg_noframe, reg_all, reg_noframe);
           free_region(ps, &reg_all);
         }
-        xr_blur_dst(ps, tgt_buffer, x, y, wid, hei, ps->blur_kerns_cache,
-            reg_noframe);
+        if (BLRMTHD_KAWASE == ps->o.blur_method)
+          xr_pyramid_blur_dst(ps, tgt_buffer, x, y, wid, hei, reg_noframe);
+        else
+          xr_blur_dst(ps, tgt_buffer, x, y, wid, hei, ps->blur_kerns_cache,
+              reg_noframe);
         free_region(ps, &reg_noframe);
       }
       break;
@@ -1531,8 +2676,8 @@ render_(session_t *ps, int x, int y, int dx, int dy, int wid, int hei,
     case BKEND_XRENDER:
     case BKEND_XR_GLX_HYBRID:
       {
-        Picture alpha_pict = get_alpha_pict_d(ps, opacity);
-        if (alpha_pict != ps->alpha_picts[0]) {
+        if (get_alpha_d(ps, opacity)) {
+          Picture alpha_pict = get_alpha_pict_d(ps, opacity);
           int op = ((!argb && !alpha_pict) ? PictOpSrc: PictOpOver);
           XRenderComposite(ps->dpy, op, pict, alpha_pict,
               ps->tgt_buffer.pict, x, y, 0, 0, dx, dy, wid, hei);
@@ -1541,6 +2686,7 @@ render_(session_t *ps, int x, int y, int dx, int dy, int wid, int hei,
       }
 #ifdef CONFIG_VSYNC_OPENGL
     case BKEND_GLX:
+    case BKEND_GLX_CORE:
       glx_render(ps, ptex, x, y, dx, dy, wid, hei,
           ps->psglx->z, opacity, argb, neg, reg_paint, pcache_reg, pprogram);
       ps->psglx->z += 1;
@@ -1552,13 +2698,159 @@ render_(session_t *ps, int x, int y, int dx, int dy, int wid, int hei,
 }
 
 /**
- * Paint a window itself and dim it if asked.
+ * Paint a whole window into its animated rectangle.
+ *
+ * Frame opacity is not honored while animating.
  */
-static inline void
-win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
-    const reg_data_t *pcache_reg) {
-  glx_mark(ps, w->id, true);
+static void
+win_render_anim(session_t *ps, win *w, double opacity,
+    XserverRegion reg_paint, const reg_data_t *pcache_reg, Picture pict) {
+  const XRectangle *r = &w->anim_rect;
+  const double scale = w->anim_scale;
+
+  switch (ps->o.backend) {
+    case BKEND_XRENDER:
+    case BKEND_XR_GLX_HYBRID:
+      {
+        if (!get_alpha_d(ps, opacity))
+          break;
+        Picture alpha_pict = get_alpha_pict_d(ps, opacity);
+
+        XTransform xform = { {
+          { XDoubleToFixed(1.0 / scale), XDoubleToFixed(0), XDoubleToFixed(0) },
+          { XDoubleToFixed(0), XDoubleToFixed(1.0 / scale), XDoubleToFixed(0) },
+          { XDoubleToFixed(0), XDoubleToFixed(0), XDoubleToFixed(1) },
+        } };
+        XRenderSetPictureTransform(ps->dpy, pict, &xform);
+        XRenderSetPictureFilter(ps->dpy, pict, XRFILTER_BILINEAR, NULL, 0);
+        XRenderComposite(ps->dpy, PictOpOver, pict, alpha_pict,
+            ps->tgt_buffer.pict, 0, 0, 0, 0,
+            r->x, r->y, r->width, r->height);
+
+        xform.matrix[0][0] = xform.matrix[1][1] = XDoubleToFixed(1);
+        XRenderSetPictureTransform(ps->dpy, pict, &xform);
+        xrfilter_reset(ps, pict);
+      }
+      break;
+#ifdef CONFIG_VSYNC_OPENGL
+    case BKEND_GLX:
+      // Map the real window rectangle onto the animated one. The Y axis of
+      // GL points upwards.
+      glPushMatrix();
+      glTranslated(r->x - scale * w->a.x,
+          (ps->root_height - r->y) - scale * (ps->root_height - w->a.y),
+          0.0);
+      glScaled(scale, scale, 1.0);
+      // Clip rectangles are in screen space and can't go through the
+      // transform. Rely on the stencil buffer set up by set_tgt_clip()
+      // instead, which means no clipping with --glx-no-stencil.
+      glx_render(ps, w->paint.ptex, 0, 0, w->a.x, w->a.y,
+          w->widthb, w->heightb, ps->psglx->z, opacity,
+          (WMODE_ARGB == w->mode || ps->o.force_win_blend),
+          w->invert_color, None, NULL, &ps->o.glx_prog_win);
+      ps->psglx->z += 1;
+      glPopMatrix();
+      break;
+#endif
+#ifdef CONFIG_GLX_CORE
+    case BKEND_GLX_CORE:
+      {
+        // Same mapping as above, done by the vertex shader
+        const GLfloat xform[4] = {
+          scale, scale, r->x - scale * w->a.x,
+          (ps->root_height - r->y) - scale * (ps->root_height - w->a.y),
+        };
+        const glx_win_params_t params = {
+          .opacity = opacity,
+          .argb = (WMODE_ARGB == w->mode || ps->o.force_win_blend),
+          .neg = w->invert_color,
+        };
+        glx_core_render(ps, w->paint.ptex, 0, 0, w->a.x, w->a.y,
+            w->widthb, w->heightb, &params, xform, None, NULL, NULL);
+      }
+      break;
+#endif
+    default:
+      assert(0);
+  }
+}
+
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+/**
+ * Fill in the parameters of painting a window with a shader variant.
+ */
+static void
+win_variant_params(session_t *ps, win *w, double opacity,
+    glx_win_params_t *pparams) {
+  *pparams = (glx_win_params_t) {
+    .opacity = opacity,
+    .argb = (WMODE_ARGB == w->mode || ps->o.force_win_blend),
+    .neg = w->invert_color,
+    .dim = (w->dim ? win_dim_opacity(ps, w): 0.0),
+    .frame_opacity = w->frame_opacity,
+  };
+
+  if (w->frame_opacity) {
+    // Same clamping as the piecewise painting in win_paint_win(), for
+    // window managers reporting frame extents larger than the window
+    const margin_t extents = win_calc_frame_extents(ps, w);
+    const int l = min_i(extents.left, w->widthb);
+    const int t = min_i(extents.top, w->heightb);
+    pparams->body = (XRectangle) {
+      .x = w->a.x + l,
+      .y = w->a.y + t,
+      .width = max_i(w->widthb - extents.right, l) - l,
+      .height = max_i(w->heightb - extents.bottom, t) - t,
+    };
+  }
+}
+#endif
+
+/**
+ * Paint a whole window in one pass with a specialized GLSL shader variant,
+ * or with glx_core.
+ *
+ * @param pdimmed set to whether the window is dimmed in the pass
+ * @return false if the window is to be painted the usual way
+ */
+static bool
+win_render_variant(session_t *ps, win *w, double opacity,
+    XserverRegion reg_paint, const reg_data_t *pcache_reg, bool *pdimmed) {
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  glx_win_params_t params;
+#ifdef CONFIG_GLX_CORE
+  if (glx_is_core(ps)) {
+    win_variant_params(ps, w, opacity, &params);
+    return glx_core_render(ps, w->paint.ptex, 0, 0, w->a.x, w->a.y,
+        w->widthb, w->heightb, &params, NULL, reg_paint, pcache_reg,
+        pdimmed);
+  }
+#endif
+
+  if (!glx_use_win_variants(ps))
+    return false;
+
+  win_variant_params(ps, w, opacity, &params);
+  if (!glx_render_win(ps, w->paint.ptex, 0, 0, w->a.x, w->a.y,
+        w->widthb, w->heightb, ps->psglx->z, &params,
+        reg_paint, pcache_reg, pdimmed))
+    return false;
+  ps->psglx->z += 1;
+
+  return true;
+#else
+  return false;
+#endif
+}
 
+/**
+ * Fetch the pixmap of a window and build its Picture, if they are not
+ * there yet.
+ *
+ * @return the drawable to paint the window from
+ */
+static Drawable
+win_bind_paint(session_t *ps, win *w) {
   // Fetch Pixmap
   if (!w->paint.pixmap && ps->has_name_pixmap) {
     set_ignore_next(ps);
@@ -1583,6 +2875,19 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
     }
   }
 
+  return draw;
+}
+
+/**
+ * Paint a window itself and dim it if asked.
+ */
+static inline void
+win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
+    const reg_data_t *pcache_reg) {
+  glx_mark(ps, w->id, true);
+
+  const Drawable draw = win_bind_paint(ps, w);
+
   if (IsViewable == w->a.map_state)
     xr_sync(ps, draw, &w->fence);
 
@@ -1601,6 +2906,7 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
     return;
   }
 
+  const bool animated = win_is_animated(w);
   const int x = w->a.x;
   const int y = w->a.y;
   const int wid = w->widthb;
@@ -1613,7 +2919,7 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
     Picture newpict = xr_build_picture(ps, wid, hei, w->pictfmt);
     if (newpict) {
       // Apply clipping region to save some CPU
-      if (reg_paint) {
+      if (reg_paint && !animated) {
         XserverRegion reg = copy_region(ps, reg_paint);
         XFixesTranslateRegion(ps->dpy, reg, -x, -y);
         XFixesSetPictureClipRegion(ps->dpy, newpict, 0, 0, reg);
@@ -1634,8 +2940,16 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
   }
 
   const double dopacity = get_opacity_percent(w);
+  bool dimmed = false;
 
-  if (!w->frame_opacity) {
+  if (animated) {
+    win_render_anim(ps, w, dopacity, reg_paint, pcache_reg, pict);
+  }
+  else if (win_render_variant(ps, w, dopacity, reg_paint, pcache_reg,
+        &dimmed)) {
+    // Frame opacity and dimming are handled by the shader variant
+  }
+  else if (!w->frame_opacity) {
     win_render(ps, w, 0, 0, wid, hei, dopacity, reg_paint, pcache_reg, pict);
   }
   else {
@@ -1696,10 +3010,8 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
     free_picture(ps, &pict);
 
   // Dimming the window if needed
-  if (w->dim) {
-    double dim_opacity = ps->o.inactive_dim;
-    if (!ps->o.inactive_dim_fixed)
-      dim_opacity *= get_opacity_percent(w);
+  if (w->dim && !dimmed) {
+    const double dim_opacity = win_dim_opacity(ps, w);
 
     switch (ps->o.backend) {
       case BKEND_XRENDER:
@@ -1718,6 +3030,8 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
             .width = wid,
             .height = hei,
           };
+          if (animated)
+            rect = w->anim_rect;
 
           XRenderFillRectangles(ps->dpy, PictOpOver, ps->tgt_buffer.pict,
               &color, &rect, 1);
@@ -1725,8 +3039,14 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
         break;
 #ifdef CONFIG_VSYNC_OPENGL
       case BKEND_GLX:
-        glx_dim_dst(ps, x, y, wid, hei, ps->psglx->z - 0.7, dim_opacity,
-            reg_paint, pcache_reg);
+      case BKEND_GLX_CORE:
+        if (animated)
+          glx_dim_dst(ps, w->anim_rect.x, w->anim_rect.y,
+              w->anim_rect.width, w->anim_rect.height,
+              ps->psglx->z - 0.7, dim_opacity, reg_paint, pcache_reg);
+        else
+          glx_dim_dst(ps, x, y, wid, hei, ps->psglx->z - 0.7, dim_opacity,
+              reg_paint, pcache_reg);
         break;
 #endif
     }
@@ -1735,6 +3055,80 @@ win_paint_win(session_t *ps, win *w, XserverRegion reg_paint,
   glx_mark(ps, w->id, false);
 }
 
+/**
+ * Paint solid windows ahead of stacking order, grouped by shader variant
+ * to reduce program switches.
+ *
+ * A solid window is in the ignore region of every window below it, so
+ * nothing painted later in the frame overlaps it except windows and
+ * shadows above it. Blurring samples pixels around its region, so windows
+ * above the lowest one with a blurred background stay in order.
+ */
+static void
+paint_solid_prepass(session_t *ps, XserverRegion region,
+    XserverRegion reg_tmp) {
+  for (int i = 0; i < ps->paint_hot_cnt; ++i)
+    ps->paint_hot[i].prepainted = false;
+
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  if (!glx_use_win_variants(ps))
+    return;
+
+  // Pick solid windows from the bottom upwards, insertion-sorting them by
+  // variant. Equal variants keep their stacking order.
+  int cnt = 0;
+  for (int i = ps->paint_hot_cnt - 1; i >= 0; --i) {
+    win_hot_t *h = &ps->paint_hot[i];
+    win *w = h->w;
+    if (!w)
+      continue;
+    if (h->blur_background)
+      break;
+    if (!win_is_solid(ps, w) || win_is_animated(w) || w->frame_opacity)
+      continue;
+    // Its own shadow is painted later and must be kept off its body
+    if (h->shadow && !h->border_size)
+      continue;
+
+    glx_win_params_t params;
+    win_variant_params(ps, w, get_opacity_percent(w), &params);
+    h->variant = glx_win_variant_key(ps, w->paint.ptex, &params);
+
+    int j = cnt++;
+    for (; j > 0 && ps->paint_hot[ps->paint_solid[j - 1]].variant
+        > h->variant; --j)
+      ps->paint_solid[j] = ps->paint_solid[j - 1];
+    ps->paint_solid[j] = i;
+  }
+
+  for (int k = 0; k < cnt; ++k) {
+    const int i = ps->paint_solid[k];
+    win_hot_t *h = &ps->paint_hot[i];
+    const win_hot_t *above = (i ? &ps->paint_hot[i - 1]: NULL);
+
+    // The same region the window is painted on in stacking order
+    XserverRegion reg_paint = reg_tmp;
+    if (above && above->reg_ignore) {
+      XFixesSubtractRegion(ps->dpy, reg_paint, region, above->reg_ignore);
+      if (h->border_size)
+        XFixesIntersectRegion(ps->dpy, reg_paint, reg_paint, h->border_size);
+    }
+    else if (h->border_size)
+      XFixesIntersectRegion(ps->dpy, reg_paint, region, h->border_size);
+    else
+      reg_paint = region;
+
+    reg_data_t cache_reg = REG_DATA_INIT;
+    if (!is_region_empty(ps, reg_paint, &cache_reg)) {
+      set_tgt_clip(ps, reg_paint, &cache_reg);
+      win_paint_win(ps, h->w, reg_paint, &cache_reg);
+    }
+    free_reg_data(&cache_reg);
+    h->prepainted = true;
+  }
+#endif
+}
+
 /**
  * Rebuild cached <code>screen_reg</code>.
  */
@@ -1755,8 +3149,30 @@ rebuild_shadow_exclude_reg(session_t *ps) {
   ps->shadow_exclude_reg = rect_to_reg(ps, &rect);
 }
 
+/**
+ * Rebuild <code>cshadow_picture</code> from the shadow color.
+ */
+static void
+rebuild_cshadow_picture(session_t *ps) {
+  if (ps->cshadow_picture != ps->black_picture)
+    free_picture(ps, &ps->cshadow_picture);
+
+  // Generates another Picture for shadows if the color is modified by
+  // user
+  if (!ps->o.shadow_red && !ps->o.shadow_green && !ps->o.shadow_blue) {
+    ps->cshadow_picture = ps->black_picture;
+  } else {
+    ps->cshadow_picture = solid_picture(ps, true, 1,
+        ps->o.shadow_red, ps->o.shadow_green, ps->o.shadow_blue);
+  }
+}
+
 static void
-paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t) {
+paint_all(session_t *ps, XserverRegion region, XserverRegion region_real) {
+  // Lowest window to paint
+  const win_hot_t *t = (ps->paint_hot_cnt ?
+      &ps->paint_hot[ps->paint_hot_cnt - 1]: NULL);
+
   if (!region_real)
     region_real = region;
 
@@ -1764,6 +3180,9 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
   static struct timespec last_paint = { 0 };
 #endif
   XserverRegion reg_paint = None, reg_tmp = None, reg_tmp2 = None;
+  struct timespec paint_start = { 0 };
+  if (ps->o.offscreen_width || ps->redir_stats.frame_pending)
+    paint_start = get_time_timespec();
 
 #ifdef CONFIG_VSYNC_OPENGL
   if (bkend_use_glx(ps)) {
@@ -1800,7 +3219,7 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
             ps->root_width, ps->root_height, ps->depth);
       }
 
-      if (BKEND_GLX != ps->o.backend)
+      if (!bkend_paint_glx(ps))
         ps->tgt_buffer.pict = XRenderCreatePicture(ps->dpy,
             ps->tgt_buffer.pixmap, XRenderFindVisualFormat(ps->dpy, ps->vis),
             0, 0);
@@ -1820,6 +3239,7 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
       break;
     case BKEND_GLX:
     case BKEND_XR_GLX_HYBRID:
+    case BKEND_GLX_CORE:
       glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
       glClear(GL_COLOR_BUFFER_BIT);
       glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -1845,31 +3265,43 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
     reg_tmp = XFixesCreateRegion(ps->dpy, NULL, 0);
   reg_tmp2 = XFixesCreateRegion(ps->dpy, NULL, 0);
 
-  for (win *w = t; w; w = w->prev_trans) {
+  paint_solid_prepass(ps, region, reg_tmp);
+
+  // Walk the hot state array from the lowest window upwards
+  for (int i = ps->paint_hot_cnt - 1; i >= 0; --i) {
+    const win_hot_t *h = &ps->paint_hot[i];
+    const win_hot_t *above = (i ? &ps->paint_hot[i - 1]: NULL);
+    win *w = h->w;
+    if (!w)
+      continue;
+
+    // Lazy shadow building, which may finish only on a later paint
+    const bool gpu_shadow = glx_use_gpu_shadow(ps, w);
+    if (h->shadow && !gpu_shadow
+        && (!w->shadow_paint.pixmap || w->shadow_outdated))
+      win_request_shadow(ps, w);
+
     // Painting shadow
-    if (w->shadow) {
-      // Lazy shadow building
-      if (!w->shadow_paint.pixmap)
-        win_build_shadow(ps, w, 1);
+    if (h->shadow && (gpu_shadow || w->shadow_paint.pixmap)) {
 
       // Shadow is to be painted based on the ignore region of current
       // window
-      if (w->reg_ignore) {
-        if (w == t) {
+      if (h->reg_ignore) {
+        if (h == t) {
           // If it's the first cycle and reg_tmp2 is not ready, calculate
           // the paint region here
           reg_paint = reg_tmp;
-          XFixesSubtractRegion(ps->dpy, reg_paint, region, w->reg_ignore);
+          XFixesSubtractRegion(ps->dpy, reg_paint, region, h->reg_ignore);
         }
         else {
           // Otherwise, used the cached region during last cycle
           reg_paint = reg_tmp2;
         }
-        XFixesIntersectRegion(ps->dpy, reg_paint, reg_paint, w->extents);
+        XFixesIntersectRegion(ps->dpy, reg_paint, reg_paint, h->extents);
       }
       else {
         reg_paint = reg_tmp;
-        XFixesIntersectRegion(ps->dpy, reg_paint, region, w->extents);
+        XFixesIntersectRegion(ps->dpy, reg_paint, region, h->extents);
       }
 
       if (ps->shadow_exclude_reg)
@@ -1878,22 +3310,17 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
 
       // Might be worthwhile to crop the region to shadow border
       {
-        XRectangle rec_shadow_border = {
-          .x = w->a.x + w->shadow_dx,
-          .y = w->a.y + w->shadow_dy,
-          .width = w->shadow_width,
-          .height = w->shadow_height
-        };
         XserverRegion reg_shadow = XFixesCreateRegion(ps->dpy,
-            &rec_shadow_border, 1);
+            (XRectangle *) &h->shadow_rect, 1);
         XFixesIntersectRegion(ps->dpy, reg_paint, reg_paint, reg_shadow);
         free_region(ps, &reg_shadow);
       }
 
       // Clear the shadow here instead of in make_shadow() for saving GPU
-      // power and handling shaped windows
-      if (ps->o.clear_shadow && w->border_size)
-        XFixesSubtractRegion(ps->dpy, reg_paint, reg_paint, w->border_size);
+      // power and handling shaped windows. A prepainted window is already
+      // below its shadow, which must not darken it.
+      if ((ps->o.clear_shadow || h->prepainted) && h->border_size)
+        XFixesSubtractRegion(ps->dpy, reg_paint, reg_paint, h->border_size);
 
 #ifdef CONFIG_XINERAMA
       if (ps->o.xinerama_shadow_crop && w->xinerama_scr >= 0)
@@ -1917,32 +3344,29 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
     // Calculate the region based on the reg_ignore of the next (higher)
     // window and the bounding region
     reg_paint = reg_tmp;
-    if (w->prev_trans && w->prev_trans->reg_ignore) {
-      XFixesSubtractRegion(ps->dpy, reg_paint, region,
-          w->prev_trans->reg_ignore);
+    if (above && above->reg_ignore) {
+      XFixesSubtractRegion(ps->dpy, reg_paint, region, above->reg_ignore);
       // Copy the subtracted region to be used for shadow painting in next
       // cycle
       XFixesCopyRegion(ps->dpy, reg_tmp2, reg_paint);
 
-      if (w->border_size)
-        XFixesIntersectRegion(ps->dpy, reg_paint, reg_paint, w->border_size);
+      if (h->border_size)
+        XFixesIntersectRegion(ps->dpy, reg_paint, reg_paint, h->border_size);
     }
     else {
-      if (w->border_size)
-        XFixesIntersectRegion(ps->dpy, reg_paint, region, w->border_size);
+      if (h->border_size)
+        XFixesIntersectRegion(ps->dpy, reg_paint, region, h->border_size);
       else
         reg_paint = region;
     }
 
-    {
+    if (!h->prepainted) {
       reg_data_t cache_reg = REG_DATA_INIT;
       if (!is_region_empty(ps, reg_paint, &cache_reg)) {
         set_tgt_clip(ps, reg_paint, &cache_reg);
         // Blur window background
-        if (w->blur_background && (!win_is_solid(ps, w)
-              || (ps->o.blur_background_frame && w->frame_opacity))) {
+        if (h->blur_background)
           win_blur_background(ps, w, ps->tgt_buffer.pict, reg_paint, &cache_reg);
-        }
 
         // Painting the window
         win_paint_win(ps, w, reg_paint, &cache_reg);
@@ -1964,74 +3388,82 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
     // effect
     XSync(ps->dpy, False);
 #ifdef CONFIG_VSYNC_OPENGL
-    if (glx_has_context(ps)) {
-      if (ps->o.vsync_use_glfinish)
-        glFinish();
-      else
-        glFlush();
-      glXWaitX();
-    }
-#endif
-  }
-
-  // Wait for VBlank. We could do it aggressively (send the painting
-  // request and XFlush() on VBlank) or conservatively (send the request
-  // only on VBlank).
-  if (!ps->o.vsync_aggressive)
-    vsync_wait(ps);
-
-  switch (ps->o.backend) {
-    case BKEND_XRENDER:
-      // DBE painting mode, only need to swap the buffer
-      if (ps->o.dbe) {
-        XdbeSwapInfo swap_info = {
-          .swap_window = get_tgt_window(ps),
-          // Is it safe to use XdbeUndefined?
-          .swap_action = XdbeCopied
-        };
-        XdbeSwapBuffers(ps->dpy, &swap_info, 1);
-      }
-      // No-DBE painting mode
-      else if (ps->tgt_buffer.pict != ps->tgt_picture) {
-        XRenderComposite(
-          ps->dpy, PictOpSrc, ps->tgt_buffer.pict, None,
-          ps->tgt_picture, 0, 0, 0, 0,
-          0, 0, ps->root_width, ps->root_height);
-      }
-      break;
-#ifdef CONFIG_VSYNC_OPENGL
-    case BKEND_XR_GLX_HYBRID:
-      XSync(ps->dpy, False);
-      if (ps->o.vsync_use_glfinish)
-        glFinish();
-      else
-        glFlush();
-      glXWaitX();
-      assert(ps->tgt_buffer.pixmap);
-      xr_sync(ps, ps->tgt_buffer.pixmap, &ps->tgt_buffer_fence);
-      paint_bind_tex_real(ps, &ps->tgt_buffer,
-          ps->root_width, ps->root_height, ps->depth,
-          !ps->o.glx_no_rebind_pixmap);
-      // See #163
-      xr_sync(ps, ps->tgt_buffer.pixmap, &ps->tgt_buffer_fence);
+    if (glx_has_context(ps)) {
       if (ps->o.vsync_use_glfinish)
         glFinish();
       else
         glFlush();
       glXWaitX();
-      glx_render(ps, ps->tgt_buffer.ptex, 0, 0, 0, 0,
-          ps->root_width, ps->root_height, 0, 1.0, false, false,
-          region_real, NULL, NULL);
-      // No break here!
-    case BKEND_GLX:
-      if (ps->o.glx_use_copysubbuffermesa)
-        glx_swap_copysubbuffermesa(ps, region_real);
-      else
-        glXSwapBuffers(ps->dpy, get_tgt_window(ps));
-      break;
+    }
 #endif
-    default:
-      assert(0);
+  }
+
+  // Wait for VBlank. We could do it aggressively (send the painting
+  // request and XFlush() on VBlank) or conservatively (send the request
+  // only on VBlank).
+  if (!ps->o.vsync_aggressive)
+    vsync_wait(ps);
+
+  // Offscreen mode has no window to put the frame on
+  if (!ps->o.offscreen_width) {
+    switch (ps->o.backend) {
+      case BKEND_XRENDER:
+        // DBE painting mode, only need to swap the buffer
+        if (ps->o.dbe) {
+          XdbeSwapInfo swap_info = {
+            .swap_window = get_tgt_window(ps),
+            // Is it safe to use XdbeUndefined?
+            .swap_action = XdbeCopied
+          };
+          XdbeSwapBuffers(ps->dpy, &swap_info, 1);
+        }
+        // No-DBE painting mode
+        else if (ps->tgt_buffer.pict != ps->tgt_picture) {
+          XRenderComposite(
+            ps->dpy, PictOpSrc, ps->tgt_buffer.pict, None,
+            ps->tgt_picture, 0, 0, 0, 0,
+            0, 0, ps->root_width, ps->root_height);
+        }
+        break;
+#ifdef CONFIG_VSYNC_OPENGL
+      case BKEND_XR_GLX_HYBRID:
+        XSync(ps->dpy, False);
+        if (ps->o.vsync_use_glfinish)
+          glFinish();
+        else
+          glFlush();
+        glXWaitX();
+        assert(ps->tgt_buffer.pixmap);
+        xr_sync(ps, ps->tgt_buffer.pixmap, &ps->tgt_buffer_fence);
+        paint_bind_tex_real(ps, &ps->tgt_buffer,
+            ps->root_width, ps->root_height, ps->depth,
+            !ps->o.glx_no_rebind_pixmap);
+        // See #163
+        xr_sync(ps, ps->tgt_buffer.pixmap, &ps->tgt_buffer_fence);
+        if (ps->o.vsync_use_glfinish)
+          glFinish();
+        else
+          glFlush();
+        glXWaitX();
+        glx_render(ps, ps->tgt_buffer.ptex, 0, 0, 0, 0,
+            ps->root_width, ps->root_height, 0, 1.0, false, false,
+            region_real, NULL, NULL);
+        // No break here!
+      case BKEND_GLX:
+        if (ps->o.glx_use_copysubbuffermesa)
+          glx_swap_copysubbuffermesa(ps, region_real);
+        else
+          glXSwapBuffers(ps->dpy, get_tgt_window(ps));
+        break;
+#endif
+#ifdef CONFIG_GLX_CORE
+      case BKEND_GLX_CORE:
+        glx_core_present(ps, region_real);
+        break;
+#endif
+      default:
+        assert(0);
+    }
   }
   glx_mark_frame(ps);
 
@@ -2047,6 +3479,27 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
   }
 #endif
 
+  // The first frame after redirection rebinds every window
+  if (ps->redir_stats.frame_pending) {
+    redir_stats_t *pst = &ps->redir_stats;
+    pst->frame_pending = false;
+    pst->frame_us = get_time_us_since(paint_start);
+    pst->total_us += pst->frame_us;
+#ifdef DEBUG_REDIR
+    print_timestamp(ps);
+    printf_dbgf("(): Redirection took %ld us, its first frame %ld us.\n",
+        pst->start_us, pst->frame_us);
+#endif
+  }
+
+  if (ps->o.offscreen_width)
+    offscreen_frame(ps, region_real, &paint_start);
+
+#ifdef CONFIG_DBUS
+  if (ps->capture)
+    capture_frame(ps, region_real);
+#endif
+
   XFixesDestroyRegion(ps->dpy, region);
 
 #ifdef DEBUG_REPAINT
@@ -2057,20 +3510,153 @@ paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t
   printf("[ %5ld:%09ld ] ", diff.tv_sec, diff.tv_nsec);
   last_paint = now;
   printf("paint:");
-  for (win *w = t; w; w = w->prev_trans)
-    printf(" %#010lx", w->id);
+  for (int i = ps->paint_hot_cnt - 1; i >= 0; --i)
+    if (ps->paint_hot[i].w)
+      printf(" %#010lx", ps->paint_hot[i].w->id);
   putchar('\n');
   fflush(stdout);
 #endif
 
-  // Check if fading is finished on all painted windows
-  {
-    win *pprev = NULL;
-    for (win *w = t; w; w = pprev) {
-      pprev = w->prev_trans;
-      check_fade_fin(ps, w);
+  // Check if fading is finished on all painted windows. A callback may
+  // destroy a window, which clears its entry in paint_hot.
+  for (int i = ps->paint_hot_cnt - 1; i >= 0; --i)
+    if (ps->paint_hot[i].w)
+      check_fade_fin(ps, ps->paint_hot[i].w);
+}
+
+/**
+ * Prepare offscreen mode, opening the file frame timings go to.
+ */
+static bool
+offscreen_init(session_t *ps) {
+  FILE *f = stdout;
+  if (ps->o.offscreen_dump) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/timings.tsv", ps->o.offscreen_dump);
+    if (!(f = ps->offscreen_timings = fopen(path, "w"))) {
+      printf_errf("(): Failed to open \"%s\" for writing.", path);
+      return false;
+    }
+  }
+
+  fputs("frame\tpaint_us\tdamaged_px\n", f);
+
+  return true;
+}
+
+/**
+ * Read the painting buffer of XRender backend as tightly packed RGB888
+ * data, top row first.
+ */
+static bool
+xr_read_frame(session_t *ps, unsigned char *rgb) {
+  if (!ps->tgt_buffer.pixmap) {
+    printf_errf("(): No painting buffer to read.");
+    return false;
+  }
+
+  XImage *img = XGetImage(ps->dpy, ps->tgt_buffer.pixmap, 0, 0,
+      ps->root_width, ps->root_height, AllPlanes, ZPixmap);
+  if (!img) {
+    printf_errf("(): Failed to get XImage.");
+    return false;
+  }
+
+  const unsigned long masks[3] = {
+    ps->vis->red_mask, ps->vis->green_mask, ps->vis->blue_mask };
+  int shifts[3] = { 0 };
+  for (int c = 0; c < 3; ++c)
+    while (shifts[c] < 32 && !((masks[c] >> shifts[c]) & 1))
+      ++shifts[c];
+
+  for (int y = 0; y < ps->root_height; ++y)
+    for (int x = 0; x < ps->root_width; ++x) {
+      const unsigned long pixel = XGetPixel(img, x, y);
+      for (int c = 0; c < 3; ++c)
+        *(rgb++) = (pixel & masks[c]) >> shifts[c];
+    }
+
+  XDestroyImage(img);
+
+  return true;
+}
+
+/**
+ * Dump the last frame painted in offscreen mode to a binary PPM file.
+ */
+static bool
+offscreen_dump(session_t *ps) {
+  unsigned char *rgb =
+    cmalloc(3 * ps->root_width * ps->root_height, unsigned char);
+  bool success = false;
+
+#ifdef CONFIG_VSYNC_OPENGL
+  if (bkend_use_glx(ps))
+    success = glx_read_frame(ps, rgb);
+  else
+#endif
+    success = xr_read_frame(ps, rgb);
+
+  if (success) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/frame-%06u.ppm", ps->o.offscreen_dump,
+        ps->offscreen_frame);
+    FILE *f = fopen(path, "wb");
+    if (f) {
+      fprintf(f, "P6\n%d %d\n255\n", ps->root_width, ps->root_height);
+      success = (fwrite(rgb, 3 * ps->root_width, ps->root_height, f)
+          == ps->root_height);
+      success = !fclose(f) && success;
+    }
+    else {
+      success = false;
     }
+    if (!success)
+      printf_errf("(): Failed to write \"%s\".", path);
+  }
+
+  free(rgb);
+
+  return success;
+}
+
+/**
+ * Finish a frame painted in offscreen mode, writing its timing and
+ * dumping it if requested.
+ *
+ * @param ps current session
+ * @param damage region painted in the frame
+ * @param pstart time painting of the frame started
+ */
+static void
+offscreen_frame(session_t *ps, XserverRegion damage,
+    const struct timespec *pstart) {
+  // Timings only mean something once painting really completed
+#ifdef CONFIG_VSYNC_OPENGL
+  if (glx_has_context(ps))
+    glFinish();
+#endif
+  XSync(ps->dpy, False);
+
+  struct timespec now = get_time_timespec(), start = *pstart, diff = { 0 };
+  timespec_subtract(&diff, &now, &start);
+
+  long damaged = 0;
+  {
+    int nrects = 0;
+    XRectangle *rects = XFixesFetchRegion(ps->dpy, damage, &nrects);
+    for (int i = 0; i < nrects; ++i)
+      damaged += (long) rects[i].width * rects[i].height;
+    cxfree(rects);
   }
+
+  ++ps->offscreen_frame;
+  fprintf((ps->offscreen_timings ? ps->offscreen_timings: stdout),
+      "%u\t%ld\t%ld\n", ps->offscreen_frame,
+      diff.tv_sec * 1000000L + diff.tv_nsec / 1000L, damaged);
+
+  if (ps->o.offscreen_dump)
+    offscreen_dump(ps);
 }
 
 static void
@@ -2126,21 +3712,18 @@ repair_win(session_t *ps, win *w) {
 }
 
 static wintype_t
-wid_get_prop_wintype(session_t *ps, Window wid) {
-  set_ignore_next(ps);
-  winprop_t prop = wid_get_prop(ps, wid, ps->atom_win_type, 32L, XA_ATOM, 32);
+wid_get_prop_wintype(session_t *ps, win *w, Window wid) {
+  winprop_t prop = win_get_prop(ps, w, wid, ps->atom_win_type, 0L, 32L,
+      XA_ATOM, 32);
 
   for (unsigned i = 0; i < prop.nitems; ++i) {
     for (wintype_t j = 1; j < NUM_WINTYPES; ++j) {
       if (ps->atoms_wintypes[j] == (Atom) prop.data.p32[i]) {
-        free_winprop(&prop);
         return j;
       }
     }
   }
 
-  free_winprop(&prop);
-
   return WINTYPE_UNKNOWN;
 }
 
@@ -2229,6 +3812,10 @@ map_win(session_t *ps, Window id) {
   set_fade_callback(ps, w, finish_map_win, true);
   win_determine_fade(ps, w);
 
+  // Grow the window from its center
+  if (ps->o.animations && w->fade)
+    win_anim_start(ps, w, 0.0, 0.0, ps->o.animation_scale, 0.0, 0.0, 1.0);
+
   win_determine_blur_background(ps, w);
 
   w->damaged = false;
@@ -2272,7 +3859,8 @@ finish_unmap_win(session_t *ps, win *w) {
 
   free_wpaint(ps, w);
   free_region(ps, &w->border_size);
-  free_paint(ps, &w->shadow_paint);
+  win_free_shadow(ps, w);
+  win_anim_stop(ps, w);
 }
 
 static void
@@ -2304,8 +3892,14 @@ unmap_win(session_t *ps, win *w) {
   if (w->fade)
     win_validate_pixmap(ps, w);
 
+  // Shrink the window towards its center while it fades out
+  if (ps->o.animations && w->fade)
+    win_anim_start(ps, w, w->anim_dx, w->anim_dy, w->anim_scale,
+        0.0, 0.0, ps->o.animation_scale);
+
   // don't care about properties anymore
   win_ev_stop(ps, w);
+  win_prop_cache_clear(w);
 
 #ifdef CONFIG_DBUS
   // Send D-Bus signal
@@ -2316,17 +3910,15 @@ unmap_win(session_t *ps, win *w) {
 }
 
 static opacity_t
-wid_get_opacity_prop(session_t *ps, Window wid, opacity_t def) {
+wid_get_opacity_prop(session_t *ps, win *w, Window wid, opacity_t def) {
   opacity_t val = def;
 
-  winprop_t prop = wid_get_prop(ps, wid, ps->atom_opacity, 1L,
+  winprop_t prop = win_get_prop(ps, w, wid, ps->atom_opacity, 0L, 1L,
       XA_CARDINAL, 32);
 
   if (prop.nitems)
     val = *prop.data.p32;
 
-  free_winprop(&prop);
-
   return val;
 }
 
@@ -2468,6 +4060,9 @@ win_update_shape(session_t *ps, win *w) {
 
     win_on_factor_change(ps, w);
 
+    // The shadow follows the bounding shape
+    win_expire_shadow(ps, w);
+
     /*
     // If clear_shadow state on the window possibly changed, destroy the old
     // shadow_pict
@@ -2484,8 +4079,8 @@ win_update_shape(session_t *ps, win *w) {
  */
 static void
 win_update_prop_shadow_raw(session_t *ps, win *w) {
-  winprop_t prop = wid_get_prop(ps, w->id, ps->atom_compton_shadow, 1,
-      XA_CARDINAL, 32);
+  winprop_t prop = win_get_prop(ps, w, w->id, ps->atom_compton_shadow, 0L,
+      1L, XA_CARDINAL, 32);
 
   if (!prop.nitems) {
     w->prop_shadow = -1;
@@ -2493,8 +4088,6 @@ win_update_prop_shadow_raw(session_t *ps, win *w) {
   else {
     w->prop_shadow = *prop.data.p32;
   }
-
-  free_winprop(&prop);
 }
 
 /**
@@ -2671,6 +4264,43 @@ win_on_factor_change(session_t *ps, win *w) {
         ps->o.unredir_if_possible_blacklist, &w->cache_uipblst);
 }
 
+/**
+ * Function to be called when a window moved, or one of its properties
+ * changed.
+ *
+ * Only condition lists depending on the change are re-matched, cached
+ * results of the others stay valid.
+ *
+ * @param ps current session
+ * @param w struct _win of the window
+ * @param pos whether the window moved
+ * @param atom the property changed, if <code>pos</code> is false
+ */
+static void
+win_on_dep_change(session_t *ps, win *w, bool pos, Atom atom) {
+#define DEP(lst) (pos ? condlst_dep_pos(ps->o.lst) \
+    : condlst_dep_atom(ps, ps->o.lst, atom))
+  if (DEP(shadow_blacklist))
+    win_determine_shadow(ps, w);
+  if (DEP(fade_blacklist))
+    win_determine_fade(ps, w);
+  if (DEP(invert_color_list))
+    win_determine_invert_color(ps, w);
+  if (DEP(focus_blacklist))
+    win_update_focused(ps, w);
+  if (DEP(blur_background_blacklist))
+    win_determine_blur_background(ps, w);
+  if (DEP(opacity_rules))
+    win_update_opacity_rule(ps, w);
+  if (IsViewable == w->a.map_state && DEP(paint_blacklist))
+    w->paint_excluded = win_match(ps, w, ps->o.paint_blacklist,
+        &w->cache_pblst);
+  if (IsViewable == w->a.map_state && DEP(unredir_if_possible_blacklist))
+    w->unredir_if_possible_excluded = win_match(ps, w,
+        ps->o.unredir_if_possible_blacklist, &w->cache_uipblst);
+#undef DEP
+}
+
 /**
  * Process needed window updates.
  */
@@ -2724,7 +4354,7 @@ win_upd_wintype(session_t *ps, win *w) {
   const wintype_t wtype_old = w->window_type;
 
   // Detect window type here
-  w->window_type = wid_get_prop_wintype(ps, w->client_win);
+  w->window_type = wid_get_prop_wintype(ps, w, w->client_win);
 
   // Conform to EWMH standard, if _NET_WM_WINDOW_TYPE is not present, take
   // override-redirect windows or windows without WM_TRANSIENT_FOR as
@@ -2751,6 +4381,7 @@ win_upd_wintype(session_t *ps, win *w) {
 static void
 win_mark_client(session_t *ps, win *w, Window client) {
   w->client_win = client;
+  win_prop_cache_clear(w);
 
   // If the window isn't mapped yet, stop here, as the function will be
   // called in map_win()
@@ -2798,6 +4429,7 @@ win_unmark_client(session_t *ps, win *w) {
   Window client = w->client_win;
 
   w->client_win = None;
+  win_prop_cache_clear(w);
 
   // Recheck event mask
   XSelectInput(ps->dpy, client,
@@ -2843,10 +4475,169 @@ win_recheck_client(session_t *ps, win *w) {
   win_mark_client(ps, w, cw);
 }
 
+/**
+ * Get a window record from the window arena.
+ *
+ * Records are allocated WIN_ARENA_CHUNK at a time, so they stay close to
+ * each other in memory.
+ *
+ * @return an uninitialized window record, or NULL on failure
+ */
+static win *
+win_alloc(session_t *ps) {
+  if (!ps->win_free) {
+    win_arena_chunk_t *chunk = malloc(sizeof(win_arena_chunk_t));
+    if (!chunk)
+      return NULL;
+    chunk->next = ps->win_chunks;
+    ps->win_chunks = chunk;
+
+    for (int i = WIN_ARENA_CHUNK - 1; i >= 0; --i) {
+      chunk->wins[i].next = ps->win_free;
+      ps->win_free = &chunk->wins[i];
+    }
+  }
+
+  win *w = ps->win_free;
+  ps->win_free = w->next;
+
+  return w;
+}
+
+/**
+ * Return a window record to the window arena.
+ */
+static void
+win_release(session_t *ps, win *w) {
+  w->next = ps->win_free;
+  ps->win_free = w;
+}
+
+/**
+ * Free all memory of the window arena.
+ *
+ * All window records must have been released beforehand.
+ */
+static void
+win_arena_destroy(session_t *ps) {
+  win_arena_chunk_t *next = NULL;
+  for (win_arena_chunk_t *chunk = ps->win_chunks; chunk; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+
+  ps->win_chunks = NULL;
+  ps->win_free = NULL;
+}
+
+/**
+ * Add a window to the window hash.
+ */
+static bool
+win_hash_add(session_t *ps, win *w) {
+  // Keep the load factor under 1
+  if (ps->win_hash_cnt >= ps->win_hash_size) {
+    const unsigned size_old = ps->win_hash_size;
+    win **hash_old = ps->win_hash;
+    const unsigned size = (size_old ? size_old * 2: WIN_HASH_INIT_SIZE);
+    win **hash = calloc(size, sizeof(win *));
+    if (!hash) {
+      printf_errf("(): Failed to allocate memory for window hash.");
+      return false;
+    }
+
+    ps->win_hash = hash;
+    ps->win_hash_size = size;
+    ps->win_hash_bits = 0;
+    while ((1U << ps->win_hash_bits) < size)
+      ++ps->win_hash_bits;
+    for (unsigned i = 0; i < size_old; ++i) {
+      win *next = NULL;
+      for (win *w2 = hash_old[i]; w2; w2 = next) {
+        next = w2->hash_next;
+        const unsigned idx = win_hash_idx(ps, w2->id);
+        w2->hash_next = hash[idx];
+        hash[idx] = w2;
+      }
+    }
+    free(hash_old);
+  }
+
+  const unsigned idx = win_hash_idx(ps, w->id);
+  w->hash_next = ps->win_hash[idx];
+  ps->win_hash[idx] = w;
+  ++ps->win_hash_cnt;
+
+  return true;
+}
+
+/**
+ * Remove a window from the window hash.
+ */
+static void
+win_hash_remove(session_t *ps, win *w) {
+  if (!ps->win_hash)
+    return;
+
+  for (win **pw = &ps->win_hash[win_hash_idx(ps, w->id)]; *pw;
+      pw = &(*pw)->hash_next) {
+    if (w == *pw) {
+      *pw = w->hash_next;
+      w->hash_next = NULL;
+      --ps->win_hash_cnt;
+      return;
+    }
+  }
+}
+
+/**
+ * Unlink a window from the window stack.
+ */
+static void
+win_stack_unlink(session_t *ps, win *w) {
+  if (w->prev)
+    w->prev->next = w->next;
+  else
+    ps->list = w->next;
+
+  if (w->next)
+    w->next->prev = w->prev;
+  else
+    ps->list_bottom = w->prev;
+
+  w->next = w->prev = NULL;
+}
+
+/**
+ * Insert a window into the window stack.
+ *
+ * @param ps current session
+ * @param w window to insert, must not be in the stack
+ * @param below window to put <code>w</code> directly above, NULL to put
+ *    <code>w</code> at the bottom
+ */
+static void
+win_stack_insert(session_t *ps, win *w, win *below) {
+  w->next = below;
+  w->prev = (below ? below->prev: ps->list_bottom);
+
+  if (w->prev)
+    w->prev->next = w;
+  else
+    ps->list = w;
+
+  if (below)
+    below->prev = w;
+  else
+    ps->list_bottom = w;
+}
+
 static bool
 add_win(session_t *ps, Window id, Window prev) {
   const static win win_def = {
     .next = NULL,
+    .prev = NULL,
+    .hash_next = NULL,
     .prev_trans = NULL,
 
     .id = None,
@@ -2866,6 +4657,7 @@ add_win(session_t *ps, Window id, Window prev) {
     .need_configure = false,
     .queue_configure = { },
     .reg_ignore = None,
+    .reg_ignore_expire = false,
     .widthb = 0,
     .heightb = 0,
     .destroyed = false,
@@ -2887,6 +4679,7 @@ add_win(session_t *ps, Window id, Window prev) {
     .class_instance = NULL,
     .class_general = NULL,
     .role = NULL,
+    .prop_cache = NULL,
     .cache_sblst = NULL,
     .cache_fblst = NULL,
     .cache_fcblst = NULL,
@@ -2903,6 +4696,24 @@ add_win(session_t *ps, Window id, Window prev) {
     .fade = false,
     .fade_force = UNSET,
     .fade_callback = NULL,
+    .fade_start = 0,
+    .fade_end = 0,
+    .fade_start_time = 0L,
+    .fade_duration = 0L,
+
+    .anim_start_dx = 0.0,
+    .anim_start_dy = 0.0,
+    .anim_start_scale = 1.0,
+    .anim_end_dx = 0.0,
+    .anim_end_dy = 0.0,
+    .anim_end_scale = 1.0,
+    .anim_dx = 0.0,
+    .anim_dy = 0.0,
+    .anim_scale = 1.0,
+    .anim_running = false,
+    .anim_start_time = 0L,
+    .anim_duration = 0L,
+    .anim_reg = None,
 
     .frame_opacity = 0.0,
     .frame_extents = MARGIN_INIT,
@@ -2915,6 +4726,10 @@ add_win(session_t *ps, Window id, Window prev) {
     .shadow_width = 0,
     .shadow_height = 0,
     .shadow_paint = PAINT_INIT,
+    .shadow_outdated = false,
+#ifdef CONFIG_SHADOW_THREADS
+    .shadow_job = NULL,
+#endif
     .prop_shadow = -1,
 
     .dim = false,
@@ -2931,7 +4746,7 @@ add_win(session_t *ps, Window id, Window prev) {
   }
 
   // Allocate and initialize the new win structure
-  win *new = malloc(sizeof(win));
+  win *new = win_alloc(ps);
 
 #ifdef DEBUG_EVENTS
   printf_dbgf("(%#010lx): %p\n", id, new);
@@ -2944,16 +4759,9 @@ add_win(session_t *ps, Window id, Window prev) {
 
   memcpy(new, &win_def, sizeof(win));
 
-  // Find window insertion point
-  win **p = NULL;
-  if (prev) {
-    for (p = &ps->list; *p; p = &(*p)->next) {
-      if ((*p)->id == prev && !(*p)->destroyed)
-        break;
-    }
-  } else {
-    p = &ps->list;
-  }
+  // Find window insertion point. The window goes to the top if prev is
+  // None, and to the bottom if prev isn't found.
+  win *below = (prev ? find_win(ps, prev): ps->list);
 
   // Fill structure
   new->id = id;
@@ -2964,7 +4772,7 @@ add_win(session_t *ps, Window id, Window prev) {
     // Failed to get window attributes probably means the window is gone
     // already. IsUnviewable means the window is already reparented
     // elsewhere.
-    free(new);
+    win_release(ps, new);
     return false;
   }
 
@@ -2984,8 +4792,12 @@ add_win(session_t *ps, Window id, Window prev) {
 
   calc_win_size(ps, new);
 
-  new->next = *p;
-  *p = new;
+  if (!win_hash_add(ps, new)) {
+    free_win_res(ps, new);
+    win_release(ps, new);
+    return false;
+  }
+  win_stack_insert(ps, new, below);
 
 #ifdef CONFIG_DBUS
   // Send D-Bus signal
@@ -3001,79 +4813,84 @@ add_win(session_t *ps, Window id, Window prev) {
   return true;
 }
 
+/**
+ * Restack a batch of windows in one pass.
+ *
+ * Each window is put directly above the window with ID
+ * <code>new_above</code>, or at the bottom if it's None. Requests are
+ * applied in order.
+ */
 static void
-restack_win(session_t *ps, win *w, Window new_above) {
-  Window old_above;
-
-  update_reg_ignore_expire(ps, w);
-
-  if (w->next) {
-    old_above = w->next->id;
-  } else {
-    old_above = None;
-  }
+restack_wins(session_t *ps, const restack_t *reqs, int count) {
+  bool changed = false;
 
-  if (old_above != new_above) {
-    win **prev = NULL, **prev_old = NULL;
+  for (int i = 0; i < count; ++i) {
+    win * const w = reqs[i].w;
+    const Window new_above = reqs[i].new_above;
+    const Window old_above = (w->next ? w->next->id: None);
 
-    // unhook
-    for (prev = &ps->list; *prev; prev = &(*prev)->next) {
-      if ((*prev) == w) break;
-    }
-
-    prev_old = prev;
-
-    bool found = false;
+    if (old_above == new_above)
+      continue;
 
-    // rehook
-    for (prev = &ps->list; *prev; prev = &(*prev)->next) {
-      if ((*prev)->id == new_above && !(*prev)->destroyed) {
-        found = true;
-        break;
+    win *below = NULL;
+    if (new_above) {
+      below = find_win(ps, new_above);
+      if (!below || w == below) {
+        printf_errf("(%#010lx, %#010lx): "
+            "Failed to found new above window.", w->id, new_above);
+        continue;
       }
     }
 
-    if (new_above && !found) {
-      printf_errf("(%#010lx, %#010lx): "
-          "Failed to found new above window.", w->id, new_above);
-      return;
-    }
+    win_stack_unlink(ps, w);
+    win_stack_insert(ps, w, below);
+    changed = true;
+  }
 
-    *prev_old = w->next;
+  if (!changed)
+    return;
 
-    w->next = *prev;
-    *prev = w;
+  // Restacking changes the windows above the restacked ones, and all
+  // windows in between the old and new positions
+  ps->reg_ignore_expire = true;
 
 #ifdef DEBUG_RESTACK
-    {
-      const char *desc;
-      char *window_name = NULL;
-      bool to_free;
-      win* c = ps->list;
+  {
+    const char *desc;
+    char *window_name = NULL;
+    bool to_free;
+    win* c = ps->list;
 
-      printf_dbgf("(%#010lx, %#010lx): "
-             "Window stack modified. Current stack:\n", w->id, new_above);
+    printf_dbgf("(): Window stack modified. Current stack:\n");
 
-      for (; c; c = c->next) {
-        window_name = "(Failed to get title)";
+    for (; c; c = c->next) {
+      window_name = "(Failed to get title)";
 
-        to_free = ev_window_name(ps, c->id, &window_name);
+      to_free = ev_window_name(ps, c->id, &window_name);
 
-        desc = "";
-        if (c->destroyed) desc = "(D) ";
-        printf("%#010lx \"%s\" %s", c->id, window_name, desc);
-        if (c->next)
-          printf("-> ");
+      desc = "";
+      if (c->destroyed) desc = "(D) ";
+      printf("%#010lx \"%s\" %s", c->id, window_name, desc);
+      if (c->next)
+        printf("-> ");
 
-        if (to_free) {
-          cxfree(window_name);
-          window_name = NULL;
-        }
+      if (to_free) {
+        cxfree(window_name);
+        window_name = NULL;
       }
-      fputs("\n", stdout);
     }
-#endif
+    fputs("\n", stdout);
   }
+#endif
+}
+
+/**
+ * Restack a window.
+ */
+static void
+restack_win(session_t *ps, win *w, Window new_above) {
+  const restack_t req = { .w = w, .new_above = new_above };
+  restack_wins(ps, &req, 1);
 }
 
 static bool
@@ -3083,8 +4900,19 @@ static void
 configure_win(session_t *ps, XConfigureEvent *ce) {
   // On root window changes
   if (ce->window == ps->root) {
+    // The offscreen target keeps its own size
+    if (ps->o.offscreen_width)
+      return;
+
     free_paint(ps, &ps->tgt_buffer);
 
+#ifdef CONFIG_DBUS
+    // The capture ring is sized for the old screen, clients have to
+    // start over
+    if (ce->width != ps->root_width || ce->height != ps->root_height)
+      capture_stop(ps);
+#endif
+
     ps->root_width = ce->width;
     ps->root_height = ce->height;
 
@@ -3103,12 +4931,12 @@ configure_win(session_t *ps, XConfigureEvent *ce) {
     if (ps->o.glx_reinit_on_root_change && ps->psglx) {
       if (!glx_reinit(ps, bkend_use_glx(ps)))
         printf_errf("(): Failed to reinitialize GLX, troubles ahead.");
-      if (BKEND_GLX == ps->o.backend && !init_filters(ps))
+      if (bkend_paint_glx(ps) && !init_filters(ps))
         printf_errf("(): Failed to initialize filters.");
     }
 
     // GLX root change callback
-    if (BKEND_GLX == ps->o.backend)
+    if (bkend_paint_glx(ps))
       glx_on_root_change(ps);
 #endif
 
@@ -3130,41 +4958,56 @@ configure_win(session_t *ps, XConfigureEvent *ce) {
     w->queue_configure = *ce;
     restack_win(ps, w, ce->above);
   } else {
-    if (!(w->need_configure)) {
+    const bool queued = w->need_configure;
+    if (!queued)
       restack_win(ps, w, ce->above);
-    }
-
-    bool factor_change = false;
 
-    // Windows restack (including window restacks happened when this
-    // window is not mapped) could mess up all reg_ignore
-    ps->reg_ignore_expire = true;
+    // Windows restacks happened when this window is not mapped could mess
+    // up all reg_ignore
+    if (queued)
+      ps->reg_ignore_expire = true;
 
     w->need_configure = false;
 
+    const bool moved = (w->a.x != ce->x || w->a.y != ce->y);
+    const bool resized = (w->a.width != ce->width
+        || w->a.height != ce->height
+        || w->a.border_width != ce->border_width);
+
     damage = XFixesCreateRegion(ps->dpy, 0, 0);
     if (w->extents != None) {
       XFixesCopyRegion(ps->dpy, damage, w->extents);
     }
 
-    // If window geometry did not change, don't free extents here
-    if (w->a.x != ce->x || w->a.y != ce->y
-        || w->a.width != ce->width || w->a.height != ce->height
-        || w->a.border_width != ce->border_width) {
-      factor_change = true;
+    // Only reg_ignore of this window and lower ones cover this window
+    if (moved || resized)
+      win_expire_reg_ignore(w);
+
+    if (resized) {
       free_region(ps, &w->extents);
       free_region(ps, &w->border_size);
     }
+    else if (moved) {
+      // A pure move keeps the shape, so translate cached regions instead
+      // of fetching them again
+      const int dx = ce->x - w->a.x, dy = ce->y - w->a.y;
+      if (w->extents)
+        XFixesTranslateRegion(ps->dpy, w->extents, dx, dy);
+      if (w->border_size)
+        XFixesTranslateRegion(ps->dpy, w->border_size, dx, dy);
+    }
+
+    // Slide moved windows from where they are displayed now
+    if (ps->o.animations && w->to_paint && moved && !resized)
+      win_anim_start(ps, w, w->anim_dx + w->a.x - ce->x,
+          w->anim_dy + w->a.y - ce->y, w->anim_scale, 0.0, 0.0, 1.0);
 
     w->a.x = ce->x;
     w->a.y = ce->y;
 
-    if (w->a.width != ce->width || w->a.height != ce->height
-        || w->a.border_width != ce->border_width)
+    if (resized) {
       free_wpaint(ps, w);
 
-    if (w->a.width != ce->width || w->a.height != ce->height
-        || w->a.border_width != ce->border_width) {
       w->a.width = ce->width;
       w->a.height = ce->height;
       w->a.border_width = ce->border_width;
@@ -3177,16 +5020,25 @@ configure_win(session_t *ps, XConfigureEvent *ce) {
     }
 
     if (damage) {
-      XserverRegion extents = win_extents(ps, w);
-      XFixesUnionRegion(ps->dpy, damage, damage, extents);
-      XFixesDestroyRegion(ps->dpy, extents);
+      if (w->extents) {
+        XFixesUnionRegion(ps->dpy, damage, damage, w->extents);
+      }
+      else {
+        XserverRegion extents = win_extents(ps, w);
+        XFixesUnionRegion(ps->dpy, damage, damage, extents);
+        XFixesDestroyRegion(ps->dpy, extents);
+      }
       add_damage(ps, damage);
     }
 
-    if (factor_change) {
+    if (resized) {
       cxinerama_win_upd_scr(ps, w);
       win_on_factor_change(ps, w);
     }
+    else if (moved) {
+      cxinerama_win_upd_scr(ps, w);
+      win_on_pos_change(ps, w);
+    }
   }
 
   // override_redirect flag cannot be changed after window creation, as far
@@ -3202,6 +5054,9 @@ circulate_win(session_t *ps, XCirculateEvent *ce) {
   if (!w) return;
 
   if (ce->place == PlaceOnTop) {
+    // Already on top, there's no window to place it above
+    if (w == ps->list)
+      return;
     new_above = ps->list->id;
   } else {
     new_above = None;
@@ -3211,43 +5066,39 @@ circulate_win(session_t *ps, XCirculateEvent *ce) {
 }
 
 static void
-finish_destroy_win(session_t *ps, Window id) {
-  win **prev = NULL, *w = NULL;
+finish_destroy_win(session_t *ps, win *w) {
+  assert(w->destroyed);
 
 #ifdef DEBUG_EVENTS
-  printf_dbgf("(%#010lx): Starting...\n", id);
+  printf_dbgf("(%#010lx \"%s\"): %p\n", w->id, w->name, w);
 #endif
 
-  for (prev = &ps->list; (w = *prev); prev = &w->next) {
-    if (w->id == id && w->destroyed) {
-#ifdef DEBUG_EVENTS
-      printf_dbgf("(%#010lx \"%s\"): %p\n", id, w->name, w);
-#endif
+  finish_unmap_win(ps, w);
+  win_stack_unlink(ps, w);
 
-      finish_unmap_win(ps, w);
-      *prev = w->next;
+  // Clear active_win if it's pointing to the destroyed window
+  if (w == ps->active_win)
+    ps->active_win = NULL;
 
-      // Clear active_win if it's pointing to the destroyed window
-      if (w == ps->active_win)
-        ps->active_win = NULL;
+  free_win_res(ps, w);
 
-      free_win_res(ps, w);
+  // Drop w from all prev_trans to avoid accessing freed memory in
+  // repair_win()
+  for (win *w2 = ps->list; w2; w2 = w2->next)
+    if (w == w2->prev_trans)
+      w2->prev_trans = NULL;
 
-      // Drop w from all prev_trans to avoid accessing freed memory in
-      // repair_win()
-      for (win *w2 = ps->list; w2; w2 = w2->next)
-        if (w == w2->prev_trans)
-          w2->prev_trans = NULL;
+  // Same for the hot state array
+  for (int i = 0; i < ps->paint_hot_cnt; ++i)
+    if (w == ps->paint_hot[i].w)
+      ps->paint_hot[i].w = NULL;
 
-      free(w);
-      break;
-    }
-  }
+  win_release(ps, w);
 }
 
 static void
 destroy_callback(session_t *ps, win *w) {
-  finish_destroy_win(ps, w->id);
+  finish_destroy_win(ps, w);
 }
 
 static void
@@ -3262,6 +5113,7 @@ destroy_win(session_t *ps, Window id) {
     unmap_win(ps, w);
 
     w->destroyed = true;
+    win_hash_remove(ps, w);
 
     if (ps->o.no_fading_destroyed_argb)
       win_determine_fade(ps, w);
@@ -3296,6 +5148,33 @@ root_damaged(session_t *ps) {
   force_repaint(ps);
 }
 
+/**
+ * Repair the damaged part of the root tile pixmap.
+ */
+static void
+repair_root_tile(session_t *ps) {
+  XserverRegion parts = XFixesCreateRegion(ps->dpy, 0, 0);
+  set_ignore_next(ps);
+  XDamageSubtract(ps->dpy, ps->root_tile_damage, None, parts);
+  ps->root_tile_pixmap_damaged = true;
+
+  if (!ps->redirected) {
+    free_region(ps, &parts);
+    return;
+  }
+
+  // A tile smaller than the screen is repeated, so a part of it may
+  // appear in multiple places
+  if (ps->root_tile_width < ps->root_width
+      || ps->root_tile_height < ps->root_height) {
+    free_region(ps, &parts);
+    force_repaint(ps);
+    return;
+  }
+
+  add_damage(ps, parts);
+}
+
 static void
 damage_win(session_t *ps, XDamageNotifyEvent *de) {
   /*
@@ -3304,10 +5183,18 @@ damage_win(session_t *ps, XDamageNotifyEvent *de) {
     return;
   } */
 
+  if (ps->root_tile_damage && ps->root_tile_damage == de->damage) {
+    repair_root_tile(ps);
+    return;
+  }
+
   win *w = find_win(ps, de->drawable);
 
   if (!w) return;
 
+  if (w->id == ps->unredir_win)
+    ps->unredir_win_damaged = true;
+
   repair_win(ps, w);
 }
 
@@ -3796,6 +5683,29 @@ force_repaint(session_t *ps) {
   }
 }
 
+/**
+ * Enable focus tracking.
+ */
+void
+opts_init_track_focus(session_t *ps) {
+  // Already tracking focus
+  if (ps->o.track_focus)
+    return;
+
+  ps->o.track_focus = true;
+
+  if (!ps->o.use_ewmh_active_win) {
+    // Start listening to FocusChange events
+    for (win *w = ps->list; w; w = w->next)
+      if (IsViewable == w->a.map_state)
+        XSelectInput(ps->dpy, w->id,
+            determine_evmask(ps, w->id, WIN_EVMODE_FRAME));
+  }
+
+  // Recheck focus
+  recheck_focus(ps);
+}
+
 #ifdef CONFIG_DBUS
 /** @name DBus hooks
  */
@@ -3808,7 +5718,10 @@ void
 win_set_shadow_force(session_t *ps, win *w, switch_t val) {
   if (val != w->shadow_force) {
     w->shadow_force = val;
-    win_determine_shadow(ps, w);
+    if (ps->dbus_batch)
+      w->dbus_redet |= WIN_REDET_SHADOW;
+    else
+      win_determine_shadow(ps, w);
     ps->ev_received = true;
   }
 }
@@ -3820,7 +5733,10 @@ void
 win_set_fade_force(session_t *ps, win *w, switch_t val) {
   if (val != w->fade_force) {
     w->fade_force = val;
-    win_determine_fade(ps, w);
+    if (ps->dbus_batch)
+      w->dbus_redet |= WIN_REDET_FADE;
+    else
+      win_determine_fade(ps, w);
     ps->ev_received = true;
   }
 }
@@ -3832,7 +5748,10 @@ void
 win_set_focused_force(session_t *ps, win *w, switch_t val) {
   if (val != w->focused_force) {
     w->focused_force = val;
-    win_update_focused(ps, w);
+    if (ps->dbus_batch)
+      w->dbus_redet |= WIN_REDET_FOCUSED;
+    else
+      win_update_focused(ps, w);
     ps->ev_received = true;
   }
 }
@@ -3844,45 +5763,365 @@ void
 win_set_invert_color_force(session_t *ps, win *w, switch_t val) {
   if (val != w->invert_color_force) {
     w->invert_color_force = val;
-    win_determine_invert_color(ps, w);
+    if (ps->dbus_batch)
+      w->dbus_redet |= WIN_REDET_INVERT_COLOR;
+    else
+      win_determine_invert_color(ps, w);
     ps->ev_received = true;
   }
 }
 
 /**
- * Enable focus tracking.
+ * Set no_fading_openclose option.
  */
 void
-opts_init_track_focus(session_t *ps) {
-  // Already tracking focus
-  if (ps->o.track_focus)
-    return;
+opts_set_no_fading_openclose(session_t *ps, bool newval) {
+  if (newval != ps->o.no_fading_openclose) {
+    ps->o.no_fading_openclose = newval;
+    if (ps->dbus_batch)
+      ps->dbus_redet_all |= WIN_REDET_FADE;
+    else
+      for (win *w = ps->list; w; w = w->next)
+        win_determine_fade(ps, w);
+    ps->ev_received = true;
+  }
+}
 
-  ps->o.track_focus = true;
+/**
+ * Recompute the window states changed by a batch of D-Bus changes, in a
+ * single pass over the window list.
+ */
+void
+win_batch_redetermine(session_t *ps) {
+  for (win *w = ps->list; w; w = w->next) {
+    const unsigned redet = ps->dbus_redet_all | w->dbus_redet;
+    w->dbus_redet = 0;
+    if (redet & WIN_REDET_SHADOW)
+      win_determine_shadow(ps, w);
+    if (redet & WIN_REDET_FADE)
+      win_determine_fade(ps, w);
+    if (redet & WIN_REDET_FOCUSED)
+      win_update_focused(ps, w);
+    if (redet & WIN_REDET_INVERT_COLOR)
+      win_determine_invert_color(ps, w);
+  }
+  ps->dbus_redet_all = 0;
+}
 
-  if (!ps->o.use_ewmh_active_win) {
-    // Start listening to FocusChange events
-    for (win *w = ps->list; w; w = w->next)
-      if (IsViewable == w->a.map_state)
-        XSelectInput(ps->dpy, w->id,
-            determine_evmask(ps, w->id, WIN_EVMODE_FRAME));
+/**
+ * Start capturing painted frames into a shared memory ring.
+ *
+ * Does nothing if frames are being captured already.
+ *
+ * @param ps current session
+ * @param nslots number of frames the ring holds, 0 for the default
+ */
+bool
+capture_start(session_t *ps, unsigned nslots) {
+  if (ps->capture)
+    return true;
+
+  if (!nslots)
+    nslots = CAPTURE_SLOTS_DEF;
+  nslots = min_i(max_i(nslots, CAPTURE_SLOTS_MIN), CAPTURE_SLOTS_MAX);
+
+  capture_t *cap = ccalloc(1, capture_t);
+  cap->fd = -1;
+  ps->capture = cap;
+
+  const size_t stride = (size_t) ps->root_width * 4;
+  const size_t slot_offset = capture_align(sizeof(capture_ring_t));
+  const size_t data_offset = capture_align(sizeof(capture_slot_t));
+  const size_t slot_size =
+    capture_align(data_offset + stride * ps->root_height);
+  cap->size = slot_offset + slot_size * nslots;
+
+  // The name is only needed until the shared memory is opened
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "/compton-capture-%d", getpid());
+    cap->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (cap->fd >= 0)
+      shm_unlink(name);
+  }
+  if (cap->fd < 0 || ftruncate(cap->fd, cap->size)) {
+    printf_errf("(): Failed to create shared memory: %s", strerror(errno));
+    goto capture_start_err;
+  }
+  cap->ring = mmap(NULL, cap->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      cap->fd, 0);
+  if (MAP_FAILED == cap->ring) {
+    cap->ring = NULL;
+    printf_errf("(): Failed to map shared memory: %s", strerror(errno));
+    goto capture_start_err;
+  }
+
+  *cap->ring = (capture_ring_t) {
+    .magic = CAPTURE_MAGIC,
+    .version = CAPTURE_VERSION,
+    .width = ps->root_width,
+    .height = ps->root_height,
+    .stride = stride,
+    .nslots = nslots,
+    .slot_offset = slot_offset,
+    .slot_size = slot_size,
+    .data_offset = data_offset,
+  };
+
+#ifdef CONFIG_VSYNC_OPENGL
+  if (bkend_use_glx(ps)) {
+    if (!glx_capture_init(ps, cap))
+      goto capture_start_err;
   }
+  else
+#endif
+  if (!capture_xr_init(ps, cap))
+    goto capture_start_err;
 
-  // Recheck focus
-  recheck_focus(ps);
+  // The first frame in each slot is copied whole
+  for (unsigned i = 0; i < nslots; ++i)
+    cap->dirty[i] = get_screen_region(ps);
+
+  force_repaint(ps);
+
+  return true;
+
+capture_start_err:
+  capture_stop(ps);
+
+  return false;
 }
 
 /**
- * Set no_fading_openclose option.
+ * Stop capturing frames, telling readers of the ring it's closed.
  */
 void
-opts_set_no_fading_openclose(session_t *ps, bool newval) {
-  if (newval != ps->o.no_fading_openclose) {
-    ps->o.no_fading_openclose = newval;
-    for (win *w = ps->list; w; w = w->next)
-      win_determine_fade(ps, w);
-    ps->ev_received = true;
+capture_stop(session_t *ps) {
+  capture_t *cap = ps->capture;
+  if (!cap)
+    return;
+
+  ps->capture = NULL;
+
+  for (int i = 0; i < 2; ++i)
+    cxfree(cap->pending[i].rects);
+
+#ifdef CONFIG_VSYNC_OPENGL
+  if (glx_has_context(ps))
+    glx_capture_deinit(ps, cap);
+#endif
+
+  if (cap->shminfo.shmseg)
+    XShmDetach(ps->dpy, &cap->shminfo);
+  if (cap->shminfo.shmaddr)
+    shmdt(cap->shminfo.shmaddr);
+
+  for (int i = 0; i < CAPTURE_SLOTS_MAX; ++i)
+    free_region(ps, &cap->dirty[i]);
+
+  if (cap->ring) {
+    cap->ring->closed = 1;
+    munmap(cap->ring, cap->size);
+  }
+  if (cap->fd >= 0)
+    close(cap->fd);
+
+  free(cap);
+}
+
+/**
+ * Prepare reading captured frames through MIT-SHM on XRender backend.
+ *
+ * Xlib can only attach SysV shared memory, so XShmGetImage() reads into
+ * a staging segment that damaged rectangles are copied out of.
+ */
+static bool
+capture_xr_init(session_t *ps, capture_t *cap) {
+  if (!XShmQueryExtension(ps->dpy)) {
+    printf_errf("(): MIT-SHM extension unavailable.");
+    return false;
+  }
+
+  const int shmid = shmget(IPC_PRIVATE,
+      (size_t) ps->root_width * ps->root_height * 4, IPC_CREAT | 0600);
+  if (shmid < 0) {
+    printf_errf("(): Failed to create SysV shared memory: %s",
+        strerror(errno));
+    return false;
+  }
+
+  char *shmaddr = shmat(shmid, NULL, 0);
+  if ((char *) -1 == shmaddr) {
+    printf_errf("(): Failed to attach SysV shared memory: %s",
+        strerror(errno));
+    shmctl(shmid, IPC_RMID, NULL);
+    return false;
+  }
+
+  cap->shminfo.shmid = shmid;
+  cap->shminfo.shmaddr = shmaddr;
+  cap->shminfo.readOnly = False;
+  if (!XShmAttach(ps->dpy, &cap->shminfo)) {
+    printf_errf("(): Failed to attach SysV shared memory to X server.");
+    cap->shminfo.shmseg = None;
+    shmctl(shmid, IPC_RMID, NULL);
+    return false;
+  }
+
+  // The segment goes away once both sides detach
+  XSync(ps->dpy, False);
+  shmctl(shmid, IPC_RMID, NULL);
+
+  return true;
+}
+
+/**
+ * Read rectangles of the painted frame from X server into pixel data of
+ * a slot.
+ */
+static bool
+capture_xr_read(session_t *ps, capture_t *cap, unsigned char *data,
+    const XRectangle *rects, int nrects) {
+  // The painting buffer holds the same frame and, unlike the target
+  // window, is never obscured
+  const Drawable d = (!ps->o.dbe && ps->tgt_buffer.pixmap ?
+      ps->tgt_buffer.pixmap: get_tgt_window(ps));
+  const size_t stride = cap->ring->stride;
+
+  for (int i = 0; i < nrects; ++i) {
+    const XRectangle *r = &rects[i];
+    XImage *img = XShmCreateImage(ps->dpy, ps->vis, ps->depth, ZPixmap,
+        cap->shminfo.shmaddr, &cap->shminfo, r->width, r->height);
+    if (!img) {
+      printf_errf("(): Failed to create XImage.");
+      return false;
+    }
+
+    const bool success = (32 == img->bits_per_pixel
+        && LSBFirst == img->byte_order
+        && XShmGetImage(ps->dpy, d, img, r->x, r->y, AllPlanes));
+    if (success)
+      for (int j = 0; j < r->height; ++j)
+        memcpy(data + (r->y + j) * stride + r->x * 4,
+            img->data + (size_t) j * img->bytes_per_line, r->width * 4);
+    XDestroyImage(img);
+
+    if (!success) {
+      printf_errf("(): Failed to read a 32-bit LSBFirst image of the frame.");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Capture a painted frame into the shared memory ring.
+ *
+ * @param ps current session
+ * @param damage region that changed since the previous frame
+ */
+static void
+capture_frame(session_t *ps, XserverRegion damage) {
+  capture_t * const cap = ps->capture;
+
+  XserverRegion reg = copy_region(ps, damage);
+  XFixesIntersectRegion(ps->dpy, reg, reg, ps->screen_reg);
+  for (unsigned i = 0; i < cap->ring->nslots; ++i)
+    XFixesUnionRegion(ps->dpy, cap->dirty[i], cap->dirty[i], reg);
+
+  const uint64_t seq = ++cap->seq;
+  const unsigned idx = (seq - 1) % cap->ring->nslots;
+  capture_slot_t * const slot = capture_slot(cap, idx);
+
+  // Invalidate the slot before touching it
+  slot->seq = 0;
+  __sync_synchronize();
+
+  // Record what changed since the previous frame
+  {
+    int nrects = 0;
+    XRectangle *rects = XFixesFetchRegion(ps->dpy, reg, &nrects);
+    slot->nrects = (1 != seq && nrects <= CAPTURE_RECTS_MAX ? nrects: 0);
+    for (unsigned i = 0; i < slot->nrects; ++i)
+      slot->rects[i] = (capture_rect_t) {
+        .x = rects[i].x,
+        .y = rects[i].y,
+        .width = rects[i].width,
+        .height = rects[i].height,
+      };
+    cxfree(rects);
+  }
+  free_region(ps, &reg);
+
+  // Copy only what changed since the slot was last written
+  capture_pending_t *pend = &cap->pending[cap->pending_cur];
+  pend->seq = seq;
+  pend->rects = XFixesFetchRegion(ps->dpy, cap->dirty[idx], &pend->nrects);
+  XFixesSetRegion(ps->dpy, cap->dirty[idx], NULL, 0);
+
+#ifdef CONFIG_VSYNC_OPENGL
+  if (bkend_use_glx(ps)) {
+    glx_capture_read(ps, pend);
+    cap->pending_cur = !cap->pending_cur;
+    // Collect the previous frame, whose readback had a whole frame of
+    // time to complete
+    capture_finish(ps, (pend->pbo ? &cap->pending[cap->pending_cur]: pend));
+    return;
+  }
+#endif
+
+  capture_finish(ps, pend);
+}
+
+/**
+ * Copy a captured frame into its slot and publish it.
+ */
+static void
+capture_finish(session_t *ps, capture_pending_t *pend) {
+  capture_t * const cap = ps->capture;
+  if (!pend->seq)
+    return;
+
+  const unsigned idx = (pend->seq - 1) % cap->ring->nslots;
+  unsigned char * const data = capture_slot_data(cap, idx);
+  bool success = false;
+
+#ifdef CONFIG_VSYNC_OPENGL
+  if (bkend_use_glx(ps))
+    success = glx_capture_finish(ps, pend, data, cap->ring->stride);
+  else
+#endif
+    success = capture_xr_read(ps, cap, data, pend->rects, pend->nrects);
+
+  if (success) {
+    __sync_synchronize();
+    capture_slot(cap, idx)->seq = pend->seq;
+    cap->ring->latest_seq = pend->seq;
+  }
+  // The slot may hold a torn frame, copy it whole next time
+  else {
+    XserverRegion reg = get_screen_region(ps);
+    XFixesCopyRegion(ps->dpy, cap->dirty[idx], reg);
+    free_region(ps, &reg);
   }
+
+  cxfree(pend->rects);
+  pend->rects = NULL;
+  pend->nrects = 0;
+  pend->seq = 0;
+}
+
+/**
+ * Publish all captured frames still being read back.
+ */
+static void
+capture_flush(session_t *ps) {
+  capture_t * const cap = ps->capture;
+
+  // The current element is the older one if both are pending
+  capture_finish(ps, &cap->pending[cap->pending_cur]);
+  capture_finish(ps, &cap->pending[!cap->pending_cur]);
 }
 
 //!@}
@@ -4185,10 +6424,14 @@ ev_property_notify(session_t *ps, XPropertyEvent *ev) {
       update_ewmh_active_win(ps);
     }
     else {
-      // Destroy the root "image" if the wallpaper probably changed
+      // Destroy the root "image" if the wallpaper probably changed. If
+      // only the contents of the same pixmap changed, the damage on it
+      // takes care of that.
       for (int p = 0; background_props_str[p]; p++) {
         if (ev->atom == get_atom(ps, background_props_str[p])) {
-          root_damaged(ps);
+          if (!ps->root_tile_paint.pixmap || ps->root_tile_fill
+              || get_root_tile_pixmap(ps) != ps->root_tile_paint.pixmap)
+            root_damaged(ps);
           break;
         }
       }
@@ -4198,6 +6441,15 @@ ev_property_notify(session_t *ps, XPropertyEvent *ev) {
     return;
   }
 
+  // Drop the cached value of the property
+  {
+    win *w = find_win(ps, ev->window);
+    if (!w)
+      w = find_toplevel(ps, ev->window);
+    if (w)
+      win_prop_cache_invalidate(w, ev->window, ev->atom);
+  }
+
   // If WM_STATE changes
   if (ev->atom == ps->atom_client) {
     // Check whether it could be a client window
@@ -4229,10 +6481,10 @@ ev_property_notify(session_t *ps, XPropertyEvent *ev) {
   if (ev->atom == ps->atom_opacity) {
     win *w = NULL;
     if ((w = find_win(ps, ev->window)))
-      w->opacity_prop = wid_get_opacity_prop(ps, w->id, OPAQUE);
+      w->opacity_prop = wid_get_opacity_prop(ps, w, w->id, OPAQUE);
     else if (ps->o.detect_client_opacity
         && (w = find_toplevel(ps, ev->window)))
-      w->opacity_prop_client = wid_get_opacity_prop(ps, w->client_win,
+      w->opacity_prop_client = wid_get_opacity_prop(ps, w, w->client_win,
             OPAQUE);
     if (w) {
       w->flags |= WFLAG_OPCT_CHANGE;
@@ -4254,7 +6506,7 @@ ev_property_notify(session_t *ps, XPropertyEvent *ev) {
       && (ps->atom_name == ev->atom || ps->atom_name_ewmh == ev->atom)) {
     win *w = find_toplevel(ps, ev->window);
     if (w && 1 == win_get_name(ps, w)) {
-      win_on_factor_change(ps, w);
+      win_on_prop_change(ps, w, ev->atom);
     }
   }
 
@@ -4263,7 +6515,7 @@ ev_property_notify(session_t *ps, XPropertyEvent *ev) {
     win *w = find_toplevel(ps, ev->window);
     if (w) {
       win_get_class(ps, w);
-      win_on_factor_change(ps, w);
+      win_on_prop_change(ps, w, ev->atom);
     }
   }
 
@@ -4271,7 +6523,7 @@ ev_property_notify(session_t *ps, XPropertyEvent *ev) {
   if (ps->o.track_wdata && ps->atom_role == ev->atom) {
     win *w = find_toplevel(ps, ev->window);
     if (w && 1 == win_get_role(ps, w)) {
-      win_on_factor_change(ps, w);
+      win_on_prop_change(ps, w, ev->atom);
     }
   }
 
@@ -4298,7 +6550,7 @@ ev_property_notify(session_t *ps, XPropertyEvent *ev) {
       if (!w)
         w = find_toplevel(ps, ev->window);
       if (w)
-        win_on_factor_change(ps, w);
+        win_on_prop_change(ps, w, ev->atom);
       break;
     }
   }
@@ -4499,7 +6751,23 @@ usage(int ret) {
     "  Opacity change between steps while fading out. (default 0.03)\n"
     "\n"
     "-D fade-delta-time\n"
-    "  The time between steps in a fade in milliseconds. (default 10)\n"
+    "  The time a fade takes per fade step, in milliseconds. Also the\n"
+    "  frame interval while fading if the refresh rate is unknown.\n"
+    "  (default 10)\n"
+    "\n"
+    "--fade-easing curve\n"
+    "  Easing curve of fades. Possible values: linear, ease-in,\n"
+    "  ease-out, ease-in-out. (default linear)\n"
+    "\n"
+    "--animations\n"
+    "  Scale fading windows in/out on map/unmap and slide them when\n"
+    "  they move. Uses the --fade-easing curve.\n"
+    "\n"
+    "--animation-duration milliseconds\n"
+    "  Duration of a window geometry animation. (default 150)\n"
+    "\n"
+    "--animation-scale scale\n"
+    "  Scale windows are mapped from and unmapped to. (default 0.9)\n"
     "\n"
     "-m opacity\n"
     "  The opacity for menus. (default 1.0)\n"
@@ -4642,8 +6910,8 @@ usage(int ret) {
     "  during VBlank. This switch may be lifted out at any moment.\n"
     "\n"
     "--alpha-step val\n"
-    "  X Render backend: Step for pregenerating alpha pictures. \n"
-    "  0.01 - 1.0. Defaults to 0.03.\n"
+    "  X Render backend: Step to quantize opacity of alpha pictures to.\n"
+    "  0.01 - 1.0, or 0 for exact opacity. Defaults to 0.\n"
     "\n"
     "--dbe\n"
     "  Enable DBE painting mode, intended to use with VSync to\n"
@@ -4676,6 +6944,17 @@ usage(int ret) {
     "  Conditions of windows that shouldn't be considered full-screen\n"
     "  for unredirecting screen.\n"
     "\n"
+    "--unredir-if-possible-video-fps fps\n"
+    "  Unredirect after a quarter of the delay if the full-screen window\n"
+    "  is damaged at least at this rate meanwhile, like games and videos\n"
+    "  do. Defaults to 0 (disabled).\n"
+    "\n"
+    "--unredir-if-possible-overlay-ratio ratio\n"
+    "  Keep the screen unredirected while windows above the full-screen\n"
+    "  one each cover at most this fraction of the screen, like\n"
+    "  notifications and tooltips. They are painted without effects\n"
+    "  meanwhile. Defaults to 0 (disabled).\n"
+    "\n"
     "--focus-exclude condition\n"
     "  Specify a list of conditions of windows that should always be\n"
     "  considered focused.\n"
@@ -4713,6 +6992,7 @@ usage(int ret) {
     "--blur-strength level\n"
     "  Only valid for '--blur-method kawase'!\n"
     "  The strength of the kawase blur as an integer between 1 and 20. Defaults to 5.\n"
+    "  X Render backends approximate it with a downsampled pyramid.\n"
     "\n"
     "--blur-kern matrix\n"
     "  Only valid for '--blur-method convolution'!\n"
@@ -4766,14 +7046,28 @@ usage(int ret) {
     "  screen." WARNING "\n"
     "\n"
 #undef WARNING
+#ifndef CONFIG_SHADOW_THREADS
+#define WARNING WARNING_DISABLED
+#else
+#define WARNING
+#endif
+    "--shadow-threads count\n"
+    "  Rasterize shadows on this many worker threads, so building a\n"
+    "  shadow never stalls painting. A window shows its outdated shadow,\n"
+    "  or none, until the new one is ready. Defaults to 0, which builds\n"
+    "  shadows synchronously." WARNING "\n"
+    "\n"
+#undef WARNING
 #ifndef CONFIG_VSYNC_OPENGL
 #define WARNING "(GLX BACKENDS DISABLED AT COMPILE TIME)"
 #else
 #define WARNING
 #endif
     "--backend backend\n"
-    "  Choose backend. Possible choices are xrender, glx, and\n"
-    "  xr_glx_hybrid" WARNING ".\n"
+    "  Choose backend. Possible choices are xrender, glx, xr_glx_hybrid\n"
+    "  and glx_core" WARNING ". glx_core paints with an OpenGL 3.3 core\n"
+    "  profile and doesn't support blur yet. It's experimental and only\n"
+    "  built with ENABLE_GLX_CORE.\n"
     "\n"
     "--glx-no-stencil\n"
     "  GLX backend: Avoid using stencil buffer. Might cause issues\n"
@@ -4812,6 +7106,17 @@ usage(int ret) {
     "  GLX backend: Use GL_EXT_gpu_shader4 for some optimization on blur\n"
     "  GLSL code. My tests on GTX 670 show no noticeable effect.\n"
     "\n"
+    "--glx-program-cache\n"
+    "  GLX backend: Cache linked GLSL program binaries in\n"
+    "  $XDG_CACHE_HOME/compton to speed up startup and reinitialization.\n"
+    "  Requires GL_ARB_get_program_binary.\n"
+    "\n"
+    "--glx-shader-variants\n"
+    "  GLX backend: Paint windows with GLSL programs specialized for their\n"
+    "  alpha, opacity, color inversion, dimming and frame opacity, instead\n"
+    "  of the fixed-function pipeline. Solid windows are painted first,\n"
+    "  grouped by program. Ignored with --glx-fshader-win.\n"
+    "\n"
     "--xrender-sync\n"
     "  Attempt to synchronize client applications' draw calls with XSync(),\n"
     "  used on GLX backend to ensure up-to-date window content is painted.\n"
@@ -4844,12 +7149,40 @@ usage(int ret) {
     "  Enable remote control via D-Bus. See the D-BUS API section in the\n"
     "  man page for more details." WARNING "\n"
     "\n"
-    "--benchmark cycles\n"
-    "  Benchmark mode. Repeatedly paint until reaching the specified cycles.\n"
+    "--benchmark cycles\n"
+    "  Benchmark mode. Repeatedly paint until reaching the specified cycles.\n"
+    "\n"
+    "--benchmark-wid window-id\n"
+    "  Specify window ID to repaint in benchmark mode. If omitted or is 0,\n"
+    "  the whole screen is repainted.\n"
+    "\n"
+    "--offscreen WIDTHxHEIGHT\n"
+    "  Paint into an offscreen target of the specified size instead of the\n"
+    "  screen, writing the paint time of each frame. Not supported by\n"
+    "  xr_glx_hybrid backend.\n"
+    "\n"
+    "--offscreen-dump directory\n"
+    "  Write frames painted in offscreen mode to binary PPM files, and\n"
+    "  their timings to timings.tsv, in the specified directory.\n"
+    "\n"
+#undef WARNING
+#ifndef CONFIG_TRACE
+#define WARNING WARNING_DISABLED
+#else
+#define WARNING
+#endif
+    "--trace-record path\n"
+    "  Record the events compton handles, and the windows existing on\n"
+    "  start, to the specified file." WARNING "\n"
+    "\n"
+    "--trace-replay path\n"
+    "  Replay a recorded trace by recreating its windows and events, then\n"
+    "  print the cost of handling each event type and of painting, and\n"
+    "  exit." WARNING "\n"
     "\n"
-    "--benchmark-wid window-id\n"
-    "  Specify window ID to repaint in benchmark mode. If omitted or is 0,\n"
-    "  the whole screen is repainted.\n"
+    "--trace-replay-speed factor\n"
+    "  Speed factor of trace replay. Defaults to 1. 0 replays each record\n"
+    "  as soon as the previous one is painted.\n"
     ;
   FILE *f = (ret ? stderr: stdout);
   fputs(usage_text, f);
@@ -5513,6 +7846,17 @@ parse_config(session_t *ps, struct options_tmp *pcfgtmp) {
   // -O (fade_out_step)
   if (config_lookup_float(&cfg, "fade-out-step", &dval))
     ps->o.fade_out_step = normalize_d(dval) * OPAQUE;
+  // --fade-easing
+  if (config_lookup_string(&cfg, "fade-easing", &sval)
+      && !parse_fade_easing(ps, sval))
+    exit(1);
+  // --animations
+  lcfg_lookup_bool(&cfg, "animations", &ps->o.animations);
+  // --animation-duration
+  if (lcfg_lookup_int(&cfg, "animation-duration", &ival))
+    ps->o.animation_duration = ival;
+  // --animation-scale
+  config_lookup_float(&cfg, "animation-scale", &ps->o.animation_scale);
   // -r (shadow_radius)
   lcfg_lookup_int(&cfg, "shadow-radius", &ps->o.shadow_radius);
   // -o (shadow_opacity)
@@ -5577,6 +7921,8 @@ parse_config(session_t *ps, struct options_tmp *pcfgtmp) {
   // --xinerama-shadow-crop
   lcfg_lookup_bool(&cfg, "xinerama-shadow-crop",
       &ps->o.xinerama_shadow_crop);
+  // --shadow-threads
+  lcfg_lookup_int(&cfg, "shadow-threads", &ps->o.shadow_threads);
   // --detect-client-opacity
   lcfg_lookup_bool(&cfg, "detect-client-opacity",
       &ps->o.detect_client_opacity);
@@ -5605,6 +7951,12 @@ parse_config(session_t *ps, struct options_tmp *pcfgtmp) {
   // --unredir-if-possible-delay
   if (lcfg_lookup_int(&cfg, "unredir-if-possible-delay", &ival))
     ps->o.unredir_if_possible_delay = ival;
+  // --unredir-if-possible-video-fps
+  lcfg_lookup_int(&cfg, "unredir-if-possible-video-fps",
+      &ps->o.unredir_if_possible_video_fps);
+  // --unredir-if-possible-overlay-ratio
+  config_lookup_float(&cfg, "unredir-if-possible-overlay-ratio",
+      &ps->o.unredir_if_possible_overlay_ratio);
   // --inactive-dim-fixed
   lcfg_lookup_bool(&cfg, "inactive-dim-fixed", &ps->o.inactive_dim_fixed);
   // --detect-transient
@@ -5662,6 +8014,10 @@ parse_config(session_t *ps, struct options_tmp *pcfgtmp) {
     exit(1);
   // --glx-use-gpushader4
   lcfg_lookup_bool(&cfg, "glx-use-gpushader4", &ps->o.glx_use_gpushader4);
+  // --glx-program-cache
+  lcfg_lookup_bool(&cfg, "glx-program-cache", &ps->o.glx_program_cache);
+  // --glx-shader-variants
+  lcfg_lookup_bool(&cfg, "glx-shader-variants", &ps->o.glx_shader_variants);
   // --xrender-sync
   lcfg_lookup_bool(&cfg, "xrender-sync", &ps->o.xrender_sync);
   // --xrender-sync-fence
@@ -5782,6 +8138,20 @@ get_cfg(session_t *ps, int argc, char *const *argv, bool first_pass) {
     { "no-name-pixmap", no_argument, NULL, 320 },
     { "blur-method", required_argument, NULL, 321 },
     { "blur-strength", required_argument, NULL, 322 },
+    { "fade-easing", required_argument, NULL, 323 },
+    { "animations", no_argument, NULL, 324 },
+    { "animation-duration", required_argument, NULL, 325 },
+    { "animation-scale", required_argument, NULL, 326 },
+    { "glx-program-cache", no_argument, NULL, 327 },
+    { "shadow-threads", required_argument, NULL, 328 },
+    { "offscreen", required_argument, NULL, 329 },
+    { "offscreen-dump", required_argument, NULL, 330 },
+    { "trace-record", required_argument, NULL, 331 },
+    { "trace-replay", required_argument, NULL, 332 },
+    { "trace-replay-speed", required_argument, NULL, 333 },
+    { "unredir-if-possible-video-fps", required_argument, NULL, 334 },
+    { "unredir-if-possible-overlay-ratio", required_argument, NULL, 335 },
+    { "glx-shader-variants", no_argument, NULL, 336 },
     { "reredir-on-root-change", no_argument, NULL, 731 },
     { "glx-reinit-on-root-change", no_argument, NULL, 732 },
     // Must terminate with a NULL entry
@@ -6040,6 +8410,12 @@ get_cfg(session_t *ps, int argc, char *const *argv, bool first_pass) {
         condlst_add(ps, &ps->o.unredir_if_possible_blacklist, optarg);
         break;
       P_CASELONG(309, unredir_if_possible_delay);
+      P_CASELONG(334, unredir_if_possible_video_fps);
+      case 335:
+        // --unredir-if-possible-overlay-ratio
+        ps->o.unredir_if_possible_overlay_ratio = normalize_d(atof(optarg));
+        break;
+      P_CASEBOOL(336, glx_shader_variants);
       case 310:
         // --write-pid-path
         ps->o.write_pid_path = mstrcpy(optarg);
@@ -6063,6 +8439,43 @@ get_cfg(session_t *ps, int argc, char *const *argv, bool first_pass) {
         if (!parse_blur_strength(ps, strtol(optarg, NULL, 0)))
           exit(1);
         break;
+      case 323:
+        // --fade-easing
+        if (!parse_fade_easing(ps, optarg))
+          exit(1);
+        break;
+      P_CASEBOOL(324, animations);
+      P_CASELONG(325, animation_duration);
+      case 326:
+        // --animation-scale
+        ps->o.animation_scale = atof(optarg);
+        break;
+      P_CASEBOOL(327, glx_program_cache);
+      P_CASELONG(328, shadow_threads);
+      case 329:
+        // --offscreen
+        if (!parse_offscreen(ps, optarg))
+          exit(1);
+        break;
+      case 330:
+        // --offscreen-dump
+        free(ps->o.offscreen_dump);
+        ps->o.offscreen_dump = mstrcpy(optarg);
+        break;
+      case 331:
+        // --trace-record
+        free(ps->o.trace_record);
+        ps->o.trace_record = mstrcpy(optarg);
+        break;
+      case 332:
+        // --trace-replay
+        free(ps->o.trace_replay);
+        ps->o.trace_replay = mstrcpy(optarg);
+        break;
+      case 333:
+        // --trace-replay-speed
+        ps->o.trace_replay_speed = atof(optarg);
+        break;
       P_CASEBOOL(731, reredir_on_root_change);
       P_CASEBOOL(732, glx_reinit_on_root_change);
       default:
@@ -6078,7 +8491,11 @@ get_cfg(session_t *ps, int argc, char *const *argv, bool first_pass) {
 
   // Range checking and option assignments
   ps->o.fade_delta = max_i(ps->o.fade_delta, 1);
+  ps->o.animation_duration = max_i(ps->o.animation_duration, 0);
+  ps->o.animation_scale = normalize_d_range(ps->o.animation_scale, 0.01, 1.0);
   ps->o.shadow_radius = max_i(ps->o.shadow_radius, 1);
+  ps->o.shadow_threads = normalize_i_range(ps->o.shadow_threads, 0,
+      SHADOW_THREADS_MAX);
   ps->o.shadow_red = normalize_d(ps->o.shadow_red);
   ps->o.shadow_green = normalize_d(ps->o.shadow_green);
   ps->o.shadow_blue = normalize_d(ps->o.shadow_blue);
@@ -6087,7 +8504,10 @@ get_cfg(session_t *ps, int argc, char *const *argv, bool first_pass) {
   ps->o.shadow_opacity = normalize_d(ps->o.shadow_opacity);
   cfgtmp.menu_opacity = normalize_d(cfgtmp.menu_opacity);
   ps->o.refresh_rate = normalize_i_range(ps->o.refresh_rate, 0, 300);
-  ps->o.alpha_step = normalize_d_range(ps->o.alpha_step, 0.01, 1.0);
+  if (ps->o.alpha_step > 0.0)
+    ps->o.alpha_step = normalize_d_range(ps->o.alpha_step, 0.01, 1.0);
+  else
+    ps->o.alpha_step = 0.0;
   if (OPAQUE == ps->o.inactive_opacity) {
     ps->o.inactive_opacity = 0;
   }
@@ -6115,6 +8535,50 @@ get_cfg(session_t *ps, int argc, char *const *argv, bool first_pass) {
   if (ps->o.xrender_sync_fence)
     ps->o.xrender_sync = true;
 
+  // Offscreen mode has no window to swap or synchronize with
+  if (ps->o.offscreen_width) {
+    if (BKEND_XR_GLX_HYBRID == ps->o.backend) {
+      printf_errf("(): Offscreen mode doesn't support xr_glx_hybrid backend.");
+      exit(1);
+    }
+    ps->o.vsync = VSYNC_NONE;
+    ps->o.sw_opti = false;
+    ps->o.dbe = false;
+    ps->o.glx_use_copysubbuffermesa = false;
+    ps->o.glx_copy_from_front = false;
+    // The offscreen target keeps its contents, like a copied back buffer
+    ps->o.glx_swap_method = 1;
+  }
+  else if (ps->o.offscreen_dump) {
+    printf_errf("(): --offscreen-dump has no effect without --offscreen.");
+  }
+
+  // glx_core paints to a framebuffer object that keeps its contents too,
+  // and can't copy from the front buffer without the fixed-function pipeline
+  if (BKEND_GLX_CORE == ps->o.backend) {
+    ps->o.glx_copy_from_front = false;
+    ps->o.glx_swap_method = 1;
+    if (ps->o.glx_fshader_win_str) {
+      printf_errf("(): --glx-fshader-win isn't supported by the glx_core "
+          "backend.");
+      exit(1);
+    }
+  }
+
+  ps->o.unredir_if_possible_video_fps = normalize_i_range(
+      ps->o.unredir_if_possible_video_fps, 0, UNREDIR_VIDEO_FPS_MAX);
+  ps->o.unredir_if_possible_overlay_ratio =
+    normalize_d(ps->o.unredir_if_possible_overlay_ratio);
+
+  if (ps->o.trace_record && ps->o.trace_replay) {
+    printf_errf("(): Can't record and replay a trace at the same time.");
+    exit(1);
+  }
+  if (ps->o.trace_replay_speed < 0.0) {
+    printf_errf("(): Invalid trace replay speed.");
+    exit(1);
+  }
+
   // Other variables determined by options
 
   // Determine whether we need to track focus changes
@@ -6127,12 +8591,6 @@ get_cfg(session_t *ps, int argc, char *const *argv, bool first_pass) {
     ps->o.track_leader = true;
   }
 
-  // Blur method kawase is not compatible with the xrender backend
-  if (ps->o.backend != BKEND_GLX && ps->o.blur_method == BLRMTHD_KAWASE) {
-      printf_errf("(): Blur method 'kawase' is incompatible with the XRender backend. Fall back to default.\n");
-      ps->o.blur_method = BLRMTHD_CONV;
-  }
-
   // Fill default blur kernel
   if (ps->o.blur_background && (BLRMTHD_CONV == ps->o.blur_method) && !ps->o.blur_kerns[0]) {
     // Convolution filter parameter (box blur)
@@ -6533,25 +8991,6 @@ vsync_deinit(session_t *ps) {
     VSYNC_FUNCS_DEINIT[ps->o.vsync](ps);
 }
 
-/**
- * Pregenerate alpha pictures.
- */
-static void
-init_alpha_picts(session_t *ps) {
-  int i;
-  int num = round(1.0 / ps->o.alpha_step) + 1;
-
-  ps->alpha_picts = malloc(sizeof(Picture) * num);
-
-  for (i = 0; i < num; ++i) {
-    double o = i * ps->o.alpha_step;
-    if ((1.0 - o) > ps->o.alpha_step)
-      ps->alpha_picts[i] = solid_picture(ps, false, o, 0, 0, 0);
-    else
-      ps->alpha_picts[i] = None;
-  }
-}
-
 /**
  * Initialize double buffer.
  */
@@ -6636,10 +9075,15 @@ init_filters(session_t *ps) {
         }
 #ifdef CONFIG_VSYNC_OPENGL
       case BKEND_GLX:
-        {
-          if (!glx_init_blur(ps))
-            return false;
-        }
+        // Blur programs are built on first use in glx_blur_dst()
+#ifndef CONFIG_VSYNC_OPENGL_GLSL
+        printf_errf("(): GLSL support not compiled in. Cannot do blur with GLX backend.");
+        return false;
+#endif
+        break;
+      case BKEND_GLX_CORE:
+        printf_errf("(): Blur isn't supported by the glx_core backend.");
+        return false;
 #endif
     }
   }
@@ -6653,6 +9097,7 @@ init_filters(session_t *ps) {
 static void
 redir_start(session_t *ps) {
   if (!ps->redirected) {
+    const struct timespec start = get_time_timespec();
 #ifdef DEBUG_REDIR
     print_timestamp(ps);
     printf_dbgf("(): Screen redirected.\n");
@@ -6663,7 +9108,16 @@ redir_start(session_t *ps) {
     if (ps->overlay)
       XMapWindow(ps->dpy, ps->overlay);
 
-    XCompositeRedirectSubwindows(ps->dpy, ps->root, CompositeRedirectManual);
+    // Other windows stayed redirected and kept their pixmaps if only a
+    // full-screen window was unredirected
+    if (ps->unredir_only) {
+      set_ignore_next(ps);
+      XCompositeRedirectWindow(ps->dpy, ps->unredir_only,
+          CompositeRedirectManual);
+      ps->unredir_only = None;
+    }
+    else
+      XCompositeRedirectSubwindows(ps->dpy, ps->root, CompositeRedirectManual);
 
     /*
     // Unredirect GL context window as this may have an effect on VSync:
@@ -6681,6 +9135,13 @@ redir_start(session_t *ps) {
 
     // Repaint the whole screen
     force_repaint(ps);
+    redir_prewarm(ps);
+
+    redir_stats_t *pst = &ps->redir_stats;
+    ++pst->nstart;
+    pst->start_us = get_time_us_since(start);
+    pst->total_us += pst->start_us;
+    pst->frame_pending = true;
   }
 }
 
@@ -6828,12 +9289,70 @@ timeout_reset(session_t *ps, timeout_t *ptmout) {
   ptmout->firstrun = ptmout->lastrun = get_time_ms();
 }
 
+/**
+ * Fetch pixmaps and build Pictures or textures of windows about to be
+ * painted right after redirection, so the first frame doesn't have to.
+ *
+ * Windows that kept theirs are skipped.
+ */
+static void
+redir_prewarm(session_t *ps) {
+  for (win *w = ps->list; w; w = w->next) {
+    if (!w->to_paint || w->destroyed || IsViewable != w->a.map_state)
+      continue;
+
+    // Same as win_paint_win(), the pixmap must be up to date before
+    // it's bound
+    const Drawable draw = win_bind_paint(ps, w);
+    xr_sync(ps, draw, &w->fence);
+    paint_bind_tex(ps, &w->paint, 0, 0, 0,
+        (!ps->o.glx_no_rebind_pixmap && w->pixmap_damaged));
+    w->pixmap_damaged = false;
+  }
+}
+
+/**
+ * Unredirect a full-screen window alone.
+ *
+ * Other windows stay redirected under it and keep their pixmaps,
+ * Pictures and textures, so redirecting again only needs to rebind this
+ * one.
+ */
+static void
+redir_stop_win(session_t *ps, win *w) {
+  if (ps->redirected) {
+    const struct timespec start = get_time_timespec();
+#ifdef DEBUG_REDIR
+    print_timestamp(ps);
+    printf_dbgf("(%#010lx): Window unredirected.\n", w->id);
+#endif
+    // Its pixmap is no longer updated
+    free_wpaint(ps, w);
+
+    XCompositeUnredirectWindow(ps->dpy, w->id, CompositeRedirectManual);
+    if (ps->overlay)
+      XUnmapWindow(ps->dpy, ps->overlay);
+
+    // Must call XSync() here
+    XSync(ps->dpy, False);
+
+    ps->redirected = false;
+    ps->unredir_only = w->id;
+
+    redir_stats_t *pst = &ps->redir_stats;
+    ++pst->nstop;
+    pst->stop_us = get_time_us_since(start);
+    pst->total_us += pst->stop_us;
+  }
+}
+
 /**
  * Unredirect all windows.
  */
 static void
 redir_stop(session_t *ps) {
-  if (ps->redirected) {
+  if (ps->redirected || ps->unredir_only) {
+    const struct timespec start = get_time_timespec();
 #ifdef DEBUG_REDIR
     print_timestamp(ps);
     printf_dbgf("(): Screen unredirected.\n");
@@ -6844,6 +9363,9 @@ redir_stop(session_t *ps) {
     for (win *w = ps->list; w; w = w->next)
       free_wpaint(ps, w);
 
+    // The window unredirected alone is no longer ours to unredirect
+    if (ps->unredir_only)
+      set_ignore_next(ps);
     XCompositeUnredirectSubwindows(ps->dpy, ps->root, CompositeRedirectManual);
     // Unmap overlay window
     if (ps->overlay)
@@ -6853,6 +9375,12 @@ redir_stop(session_t *ps) {
     XSync(ps->dpy, False);
 
     ps->redirected = false;
+    ps->unredir_only = None;
+
+    redir_stats_t *pst = &ps->redir_stats;
+    ++pst->nstop;
+    pst->stop_us = get_time_us_since(start);
+    pst->total_us += pst->stop_us;
   }
 }
 
@@ -6863,6 +9391,8 @@ static bool
 tmout_unredir_callback(session_t *ps, timeout_t *tmout) {
   ps->tmout_unredir_hit = true;
   tmout->enabled = false;
+  // Run a frame right away instead of waiting for the next event
+  ps->ev_received = true;
 
   return true;
 }
@@ -6883,7 +9413,15 @@ mainloop(session_t *ps) {
     XEvent ev = { };
 
     XNextEvent(ps->dpy, &ev);
-    ev_handle(ps, &ev);
+#ifdef CONFIG_TRACE
+    if (ps->trace) {
+      trace_ev_begin(ps, &ev);
+      ev_handle(ps, &ev);
+      trace_ev_end(ps, &ev);
+    }
+    else
+#endif
+      ev_handle(ps, &ev);
     ps->ev_received = true;
 
     return true;
@@ -6895,6 +9433,12 @@ mainloop(session_t *ps) {
   }
 #endif
 
+#ifdef CONFIG_SHADOW_THREADS
+  // Paint newly finished shadows right away
+  if (ps->shadow_pool && shadow_pool_collect(ps))
+    ps->ev_received = true;
+#endif
+
   if (ps->reset)
     return false;
 
@@ -6943,6 +9487,17 @@ mainloop(session_t *ps) {
     }
   }
 
+#ifdef CONFIG_DBUS
+  // Publish captured frames before going to sleep
+  if (ps->capture)
+    capture_flush(ps);
+#endif
+
+#ifdef CONFIG_TRACE
+  if (ps->trace)
+    trace_flush(ps);
+#endif
+
   // Polling
   fds_poll(ps, ptv);
   free(ptv);
@@ -6980,6 +9535,150 @@ cxinerama_upd_scrs(session_t *ps) {
 #endif
 }
 
+/**
+ * Default values of all options.
+ */
+static const options_t options_def = {
+  .config_file = NULL,
+  .display = NULL,
+  .backend = BKEND_XRENDER,
+  .glx_no_stencil = false,
+  .glx_copy_from_front = false,
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  .glx_prog_win = GLX_PROG_MAIN_INIT,
+#endif
+  .mark_wmwin_focused = false,
+  .mark_ovredir_focused = false,
+  .fork_after_register = false,
+  .synchronize = false,
+  .detect_rounded_corners = false,
+  .paint_on_overlay = false,
+  .resize_damage = 0,
+  .unredir_if_possible = false,
+  .unredir_if_possible_blacklist = NULL,
+  .unredir_if_possible_delay = 0,
+  .unredir_if_possible_video_fps = 0,
+  .unredir_if_possible_overlay_ratio = 0.0,
+  .redirected_force = UNSET,
+  .stoppaint_force = UNSET,
+  .dbus = false,
+  .benchmark = 0,
+  .benchmark_wid = None,
+  .trace_replay_speed = 1.0,
+  .logpath = NULL,
+
+  .refresh_rate = 0,
+  .sw_opti = false,
+  .vsync = VSYNC_NONE,
+  .dbe = false,
+  .vsync_aggressive = false,
+
+  .wintype_shadow = { false },
+  .shadow_red = 0.0,
+  .shadow_green = 0.0,
+  .shadow_blue = 0.0,
+  .shadow_radius = 12,
+  .shadow_offset_x = -15,
+  .shadow_offset_y = -15,
+  .shadow_opacity = .75,
+  .clear_shadow = false,
+  .shadow_blacklist = NULL,
+  .shadow_ignore_shaped = false,
+  .respect_prop_shadow = false,
+  .xinerama_shadow_crop = false,
+  .shadow_threads = 0,
+
+  .wintype_fade = { false },
+  .fade_in_step = 0.028 * OPAQUE,
+  .fade_out_step = 0.03 * OPAQUE,
+  .fade_delta = 10,
+  .fade_easing = FADE_EASING_LINEAR,
+
+  .animations = false,
+  .animation_duration = 150,
+  .animation_scale = 0.9,
+  .no_fading_openclose = false,
+  .no_fading_destroyed_argb = false,
+  .fade_blacklist = NULL,
+
+  .wintype_opacity = { 0.0 },
+  .inactive_opacity = 0,
+  .inactive_opacity_override = false,
+  .active_opacity = 0,
+  .frame_opacity = 0.0,
+  .detect_client_opacity = false,
+  .alpha_step = 0.0,
+
+  .blur_background = false,
+  .blur_background_frame = false,
+  .blur_background_fixed = false,
+  .blur_background_blacklist = NULL,
+  .blur_method = BLRMTHD_CONV,
+  .blur_kerns = { NULL },
+  .blur_strength = { .iterations = 3, .offset = 2.75 },
+  .inactive_dim = 0.0,
+  .inactive_dim_fixed = false,
+  .invert_color_list = NULL,
+  .opacity_rules = NULL,
+
+  .wintype_focus = { false },
+  .use_ewmh_active_win = false,
+  .focus_blacklist = NULL,
+  .detect_transient = false,
+  .detect_client_leader = false,
+
+  .track_focus = false,
+  .track_wdata = false,
+  .track_leader = false,
+};
+
+/**
+ * Reset all options to their default values.
+ */
+static void
+options_init(session_t *ps) {
+  memcpy(&ps->o, &options_def, sizeof(options_t));
+
+  wintype_arr_enable(ps->o.wintype_focus);
+  ps->o.wintype_focus[WINTYPE_UNKNOWN] = false;
+  ps->o.wintype_focus[WINTYPE_NORMAL] = false;
+  ps->o.wintype_focus[WINTYPE_UTILITY] = false;
+}
+
+/**
+ * Free memory owned by an option set.
+ */
+static void
+options_free(options_t *o) {
+#ifdef CONFIG_C2
+  free_wincondlst(&o->shadow_blacklist);
+  free_wincondlst(&o->fade_blacklist);
+  free_wincondlst(&o->focus_blacklist);
+  free_wincondlst(&o->invert_color_list);
+  free_wincondlst(&o->blur_background_blacklist);
+  free_wincondlst(&o->opacity_rules);
+  free_wincondlst(&o->paint_blacklist);
+  free_wincondlst(&o->unredir_if_possible_blacklist);
+#endif
+
+  free(o->config_file);
+  free(o->write_pid_path);
+  free(o->display);
+  free(o->display_repr);
+  free(o->logpath);
+  free(o->glx_fshader_win_str);
+  free(o->offscreen_dump);
+  free(o->trace_record);
+  free(o->trace_replay);
+  for (int i = 0; i < MAX_BLUR_PASS; ++i)
+    free(o->blur_kerns[i]);
+
+  o->config_file = o->write_pid_path = o->display = o->display_repr
+    = o->logpath = o->glx_fshader_win_str = o->offscreen_dump
+    = o->trace_record = o->trace_replay = NULL;
+  memset(o->blur_kerns, 0, sizeof(o->blur_kerns));
+}
+
 /**
  * Initialize a session.
  *
@@ -7002,95 +9701,15 @@ session_init(session_t *ps_old, int argc, char **argv) {
     .overlay = None,
     .root_tile_fill = false,
     .root_tile_paint = PAINT_INIT,
+    .root_tile_damage = None,
+    .root_tile_pixmap_damaged = false,
+    .root_tile_width = 0,
+    .root_tile_height = 0,
     .screen_reg = None,
     .tgt_picture = None,
     .tgt_buffer = PAINT_INIT,
     .root_dbe = None,
     .reg_win = None,
-    .o = {
-      .config_file = NULL,
-      .display = NULL,
-      .backend = BKEND_XRENDER,
-      .glx_no_stencil = false,
-      .glx_copy_from_front = false,
-#ifdef CONFIG_VSYNC_OPENGL_GLSL
-      .glx_prog_win = GLX_PROG_MAIN_INIT,
-#endif
-      .mark_wmwin_focused = false,
-      .mark_ovredir_focused = false,
-      .fork_after_register = false,
-      .synchronize = false,
-      .detect_rounded_corners = false,
-      .paint_on_overlay = false,
-      .resize_damage = 0,
-      .unredir_if_possible = false,
-      .unredir_if_possible_blacklist = NULL,
-      .unredir_if_possible_delay = 0,
-      .redirected_force = UNSET,
-      .stoppaint_force = UNSET,
-      .dbus = false,
-      .benchmark = 0,
-      .benchmark_wid = None,
-      .logpath = NULL,
-
-      .refresh_rate = 0,
-      .sw_opti = false,
-      .vsync = VSYNC_NONE,
-      .dbe = false,
-      .vsync_aggressive = false,
-
-      .wintype_shadow = { false },
-      .shadow_red = 0.0,
-      .shadow_green = 0.0,
-      .shadow_blue = 0.0,
-      .shadow_radius = 12,
-      .shadow_offset_x = -15,
-      .shadow_offset_y = -15,
-      .shadow_opacity = .75,
-      .clear_shadow = false,
-      .shadow_blacklist = NULL,
-      .shadow_ignore_shaped = false,
-      .respect_prop_shadow = false,
-      .xinerama_shadow_crop = false,
-
-      .wintype_fade = { false },
-      .fade_in_step = 0.028 * OPAQUE,
-      .fade_out_step = 0.03 * OPAQUE,
-      .fade_delta = 10,
-      .no_fading_openclose = false,
-      .no_fading_destroyed_argb = false,
-      .fade_blacklist = NULL,
-
-      .wintype_opacity = { 0.0 },
-      .inactive_opacity = 0,
-      .inactive_opacity_override = false,
-      .active_opacity = 0,
-      .frame_opacity = 0.0,
-      .detect_client_opacity = false,
-      .alpha_step = 0.03,
-
-      .blur_background = false,
-      .blur_background_frame = false,
-      .blur_background_fixed = false,
-      .blur_background_blacklist = NULL,
-      .blur_method = BLRMTHD_CONV,
-      .blur_kerns = { NULL },
-      .blur_strength = { .iterations = 3, .offset = 2.75 },
-      .inactive_dim = 0.0,
-      .inactive_dim_fixed = false,
-      .invert_color_list = NULL,
-      .opacity_rules = NULL,
-
-      .wintype_focus = { false },
-      .use_ewmh_active_win = false,
-      .focus_blacklist = NULL,
-      .detect_transient = false,
-      .detect_client_leader = false,
-
-      .track_focus = false,
-      .track_wdata = false,
-      .track_leader = false,
-    },
 
     .pfds_read = NULL,
     .pfds_write = NULL,
@@ -7102,7 +9721,10 @@ session_init(session_t *ps_old, int argc, char **argv) {
     .all_damage_last = { None },
     .time_start = { 0, 0 },
     .redirected = false,
-    .alpha_picts = NULL,
+    .alpha_picts = { { .pict = None } },
+    .alpha_picts_head = NULL,
+    .alpha_picts_tail = NULL,
+    .alpha_picts_cnt = 0,
     .reg_ignore_expire = false,
     .idling = false,
     .fade_time = 0L,
@@ -7115,8 +9737,19 @@ session_init(session_t *ps_old, int argc, char **argv) {
     .n_expose = 0,
 
     .list = NULL,
+    .list_bottom = NULL,
+    .win_hash = NULL,
+    .win_hash_size = 0,
+    .win_hash_bits = 0,
+    .win_hash_cnt = 0,
     .active_win = NULL,
     .active_leader = None,
+    .paint_hot = NULL,
+    .paint_hot_cnt = 0,
+    .paint_hot_max = 0,
+    .paint_solid = NULL,
+    .win_chunks = NULL,
+    .win_free = NULL,
 
     .black_picture = None,
     .cshadow_picture = None,
@@ -7125,6 +9758,9 @@ session_init(session_t *ps_old, int argc, char **argv) {
     .cgsize = 0,
     .shadow_corner = NULL,
     .shadow_top = NULL,
+#ifdef CONFIG_SHADOW_THREADS
+    .shadow_pool = NULL,
+#endif
 
     .refresh_rate = 0,
     .refresh_intv = 0UL,
@@ -7171,10 +9807,18 @@ session_init(session_t *ps_old, int argc, char **argv) {
     .atom_win_type = None,
     .atoms_wintypes = { 0 },
     .track_atom_lst = NULL,
+    .prop_cache_hits = 0,
+    .prop_cache_misses = 0,
+    .prop_uncached = { .data.p8 = NULL, .nitems = 0 },
 
 #ifdef CONFIG_DBUS
     .dbus_conn = NULL,
     .dbus_service = NULL,
+    .dbus_diff_attrs = 0,
+    .dbus_diff_owner = NULL,
+    .dbus_txn = NULL,
+    .dbus_batch = false,
+    .dbus_redet_all = 0,
 #endif
   };
 
@@ -7185,10 +9829,7 @@ session_init(session_t *ps_old, int argc, char **argv) {
   ps->ignore_tail = &ps->ignore_head;
   gettimeofday(&ps->time_start, NULL);
 
-  wintype_arr_enable(ps->o.wintype_focus);
-  ps->o.wintype_focus[WINTYPE_UNKNOWN] = false;
-  ps->o.wintype_focus[WINTYPE_NORMAL] = false;
-  ps->o.wintype_focus[WINTYPE_UTILITY] = false;
+  options_init(ps);
 
   // First pass
   get_cfg(ps, argc, argv, true);
@@ -7228,6 +9869,12 @@ session_init(session_t *ps_old, int argc, char **argv) {
   ps->root_width = DisplayWidth(ps->dpy, ps->scr);
   ps->root_height = DisplayHeight(ps->dpy, ps->scr);
 
+  // Offscreen mode paints a target of its own size
+  if (ps->o.offscreen_width) {
+    ps->root_width = ps->o.offscreen_width;
+    ps->root_height = ps->o.offscreen_height;
+  }
+
   if (!XRenderQueryExtension(ps->dpy,
         &ps->render_event, &ps->render_error)) {
     fprintf(stderr, "No render extension\n");
@@ -7373,6 +10020,9 @@ session_init(session_t *ps_old, int argc, char **argv) {
 #endif
   }
 
+  if (ps->o.offscreen_width && !offscreen_init(ps))
+    exit(1);
+
   // Initialize window GL shader
   if (BKEND_GLX == ps->o.backend && ps->o.glx_fshader_win_str) {
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
@@ -7405,7 +10055,6 @@ session_init(session_t *ps_old, int argc, char **argv) {
     exit(1);
 
   init_atoms(ps);
-  init_alpha_picts(ps);
 
   ps->gaussian_map = make_gaussian_map(ps->o.shadow_radius);
   presum_gaussian(ps, ps->gaussian_map);
@@ -7434,14 +10083,7 @@ session_init(session_t *ps_old, int argc, char **argv) {
   ps->black_picture = solid_picture(ps, true, 1, 0, 0, 0);
   ps->white_picture = solid_picture(ps, true, 1, 1, 1, 1);
 
-  // Generates another Picture for shadows if the color is modified by
-  // user
-  if (!ps->o.shadow_red && !ps->o.shadow_green && !ps->o.shadow_blue) {
-    ps->cshadow_picture = ps->black_picture;
-  } else {
-    ps->cshadow_picture = solid_picture(ps, true, 1,
-        ps->o.shadow_red, ps->o.shadow_green, ps->o.shadow_blue);
-  }
+  rebuild_cshadow_picture(ps);
 
   fds_insert(ps, ConnectionNumber(ps->dpy), POLLIN);
   ps->tmout_unredir = timeout_insert(ps, ps->o.unredir_if_possible_delay,
@@ -7465,6 +10107,12 @@ session_init(session_t *ps_old, int argc, char **argv) {
     cxfree(children);
   }
 
+#ifdef CONFIG_TRACE
+  // Snapshot windows while the server is still grabbed
+  if (ps->o.trace_record && !trace_record_start(ps))
+    exit(1);
+#endif
+
   if (ps->o.track_focus) {
     recheck_focus(ps);
   }
@@ -7486,6 +10134,16 @@ session_init(session_t *ps_old, int argc, char **argv) {
 #endif
   }
 
+  // Start replaying an event trace
+  if (ps->o.trace_record || ps->o.trace_replay) {
+#ifdef CONFIG_TRACE
+    if (ps->o.trace_replay && !trace_replay_start(ps))
+      exit(1);
+#else
+    printf_errfq(1, "(): Event trace support not compiled in!");
+#endif
+  }
+
   // Fork to background, if asked
   if (ps->o.fork_after_register) {
     if (!fork_after(ps)) {
@@ -7498,6 +10156,18 @@ session_init(session_t *ps_old, int argc, char **argv) {
   if (ps->o.fork_after_register || ps->o.logpath)
     ostream_reopen(ps, NULL);
 
+  // Worker threads don't survive fork(), so the pool is started only after
+  // daemonizing
+  if (ps->o.shadow_threads) {
+#ifdef CONFIG_SHADOW_THREADS
+    if (!shadow_pool_init(ps))
+      printf_errf("(): Failed to start shadow worker pool. Building "
+          "shadows synchronously.");
+#else
+    printf_errf("(): Shadow thread support not compiled in.");
+#endif
+  }
+
   write_pid(ps);
 
   // Free the old session
@@ -7522,7 +10192,15 @@ session_destroy(session_t *ps) {
   // Stop listening to events on root window
   XSelectInput(ps->dpy, ps->root, 0);
 
+  if (ps->offscreen_timings) {
+    fclose(ps->offscreen_timings);
+    ps->offscreen_timings = NULL;
+  }
+
 #ifdef CONFIG_DBUS
+  // Stop frame capture while GLX context is still there
+  capture_stop(ps);
+
   // Kill DBus connection
   if (ps->o.dbus)
     cdbus_destroy(ps);
@@ -7530,6 +10208,16 @@ session_destroy(session_t *ps) {
   free(ps->dbus_service);
 #endif
 
+#ifdef CONFIG_TRACE
+  // Stop the trace while its replay timeout is still there
+  trace_destroy(ps);
+#endif
+
+#ifdef CONFIG_SHADOW_THREADS
+  // Stop shadow workers before the windows and shadow tables they use go
+  shadow_pool_destroy(ps);
+#endif
+
   // Free window linked list
   {
     win *next = NULL;
@@ -7541,32 +10229,25 @@ session_destroy(session_t *ps) {
         win_ev_stop(ps, w);
 
       free_win_res(ps, w);
-      free(w);
+      win_release(ps, w);
     }
 
-    ps->list = NULL;
-  }
+    ps->list = ps->list_bottom = NULL;
+    win_arena_destroy(ps);
 
-  // Free alpha_picts
-  {
-    const int max = round(1.0 / ps->o.alpha_step) + 1;
-    for (int i = 0; i < max; ++i)
-      free_picture(ps, &ps->alpha_picts[i]);
-    free(ps->alpha_picts);
-    ps->alpha_picts = NULL;
+    free(ps->win_hash);
+    ps->win_hash = NULL;
+    ps->win_hash_size = ps->win_hash_bits = ps->win_hash_cnt = 0;
+
+    free(ps->paint_hot);
+    ps->paint_hot = NULL;
+    free(ps->paint_solid);
+    ps->paint_solid = NULL;
+    ps->paint_hot_cnt = ps->paint_hot_max = 0;
   }
 
-#ifdef CONFIG_C2
-  // Free blacklists
-  free_wincondlst(&ps->o.shadow_blacklist);
-  free_wincondlst(&ps->o.fade_blacklist);
-  free_wincondlst(&ps->o.focus_blacklist);
-  free_wincondlst(&ps->o.invert_color_list);
-  free_wincondlst(&ps->o.blur_background_blacklist);
-  free_wincondlst(&ps->o.opacity_rules);
-  free_wincondlst(&ps->o.paint_blacklist);
-  free_wincondlst(&ps->o.unredir_if_possible_blacklist);
-#endif
+  // Free alpha_picts
+  free_alpha_picts(ps);
 
   // Free tracked atom list
   {
@@ -7625,20 +10306,15 @@ session_destroy(session_t *ps) {
   free(ps->shadow_corner);
   free(ps->shadow_top);
   free(ps->gaussian_map);
+  free(ps->unredir_damage_hist);
 
-  free(ps->o.config_file);
-  free(ps->o.write_pid_path);
-  free(ps->o.display);
-  free(ps->o.display_repr);
-  free(ps->o.logpath);
-  for (int i = 0; i < MAX_BLUR_PASS; ++i) {
-    free(ps->o.blur_kerns[i]);
+  options_free(&ps->o);
+  free_winprop(&ps->prop_uncached);
+  for (int i = 0; i < MAX_BLUR_PASS; ++i)
     free(ps->blur_kerns_cache[i]);
-  }
   free(ps->pfds_read);
   free(ps->pfds_write);
   free(ps->pfds_except);
-  free(ps->o.glx_fshader_win_str);
   free_xinerama_info(ps);
 
 #ifdef CONFIG_VSYNC_OPENGL
@@ -7687,15 +10363,237 @@ session_destroy(session_t *ps) {
     ps_g = NULL;
 }
 
-/*
-static inline void
-dump_img(session_t *ps) {
-  int len = 0;
-  unsigned char *d = glx_take_screenshot(ps, &len);
-  write_binary_data("/tmp/dump.raw", d, len);
-  free(d);
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+/**
+ * Check if two blur kernel lists are equal.
+ *
+ * The center pixel is ignored as it's rewritten before every blur.
+ */
+static bool
+blur_kerns_equal(XFixed * const *a, XFixed * const *b) {
+  for (int i = 0; i < MAX_BLUR_PASS; ++i) {
+    if (!a[i] || !b[i])
+      return !a[i] && !b[i];
+    if (a[i][0] != b[i][0] || a[i][1] != b[i][1])
+      return false;
+
+    const int wid = XFixedToDouble(a[i][0]), hei = XFixedToDouble(a[i][1]);
+    const int center = 2 + (hei / 2) * wid + wid / 2;
+    for (int j = 2; j < wid * hei + 2; ++j)
+      if (j != center && a[i][j] != b[i][j])
+        return false;
+  }
+
+  return true;
+}
+#endif
+
+/**
+ * Reload options in place on reset.
+ *
+ * Windows, their pixmaps and textures, and backend resources are kept.
+ * Condition lists that did not change keep their compiled form and the
+ * match caches of windows, and only resources depending on changed
+ * options are rebuilt.
+ *
+ * @param ps current session
+ * @param argc number of commandline arguments
+ * @param argv commandline arguments
+ * @return true if options are reloaded, false if a full reset is needed
+ */
+static bool
+session_reload(session_t *ps, int argc, char **argv) {
+  options_t o_old = ps->o;
+  const latom_t *track_atom_lst_old = ps->track_atom_lst;
+
+  options_init(ps);
+  ps->o.display_repr = mstrcpy(o_old.display_repr);
+  ps->o.redirected_force = o_old.redirected_force;
+  ps->o.stoppaint_force = o_old.stoppaint_force;
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  ps->o.glx_prog_win = o_old.glx_prog_win;
+#endif
+
+  get_cfg(ps, argc, argv, true);
+  get_cfg(ps, argc, argv, false);
+
+#define O_CHANGED(name) (o_old.name != ps->o.name)
+#define O_STR_CHANGED(name) (!str_equal_null(o_old.name, ps->o.name))
+
+  // Options baked into the session at initialization need a full reset
+  if (O_CHANGED(backend) || O_CHANGED(vsync) || O_CHANGED(dbe)
+      || O_CHANGED(paint_on_overlay) || O_CHANGED(glx_no_stencil)
+      || O_CHANGED(glx_copy_from_front)
+      || O_CHANGED(glx_use_copysubbuffermesa)
+      || O_CHANGED(glx_no_rebind_pixmap) || O_CHANGED(glx_swap_method)
+      || O_CHANGED(glx_program_cache) || O_CHANGED(sw_opti)
+      || O_CHANGED(refresh_rate) || O_CHANGED(xinerama_shadow_crop)
+      || O_CHANGED(dbus) || O_CHANGED(synchronize)
+      || O_CHANGED(xrender_sync) || O_CHANGED(xrender_sync_fence)
+      || O_CHANGED(no_name_pixmap) || O_CHANGED(no_x_selection)
+      || O_STR_CHANGED(display) || O_STR_CHANGED(logpath)
+      || O_STR_CHANGED(write_pid_path) || O_CHANGED(shadow_threads)
+      || O_CHANGED(offscreen_width) || O_CHANGED(offscreen_height)
+      || O_STR_CHANGED(offscreen_dump)
+      || O_STR_CHANGED(trace_record) || O_STR_CHANGED(trace_replay)
+#ifndef CONFIG_VSYNC_OPENGL_GLSL
+      || O_STR_CHANGED(glx_fshader_win_str)
+#endif
+      ) {
+    options_free(&ps->o);
+    ps->o = o_old;
+    return false;
+  }
+
+#ifdef CONFIG_C2
+  // Keep condition lists that did not change, together with the match
+  // caches pointing into them
+#define RELOAD_CONDLST(name, cache) \
+  if (c2_list_equal(o_old.name, ps->o.name)) { \
+    free_wincondlst(&ps->o.name); \
+    ps->o.name = o_old.name; \
+  } \
+  else { \
+    for (win *w = ps->list; w; w = w->next) \
+      w->cache = NULL; \
+    free_wincondlst(&o_old.name); \
+  } \
+  o_old.name = NULL;
+
+  RELOAD_CONDLST(shadow_blacklist, cache_sblst);
+  RELOAD_CONDLST(fade_blacklist, cache_fblst);
+  RELOAD_CONDLST(focus_blacklist, cache_fcblst);
+  RELOAD_CONDLST(invert_color_list, cache_ivclst);
+  RELOAD_CONDLST(blur_background_blacklist, cache_bbblst);
+  RELOAD_CONDLST(opacity_rules, cache_oparule);
+  RELOAD_CONDLST(paint_blacklist, cache_pblst);
+  RELOAD_CONDLST(unredir_if_possible_blacklist, cache_uipblst);
+#undef RELOAD_CONDLST
+#endif
+
+  // Shadows
+  const bool shadow_geom_changed = O_CHANGED(shadow_radius)
+    || O_CHANGED(shadow_offset_x) || O_CHANGED(shadow_offset_y);
+  const bool shadow_color_changed = O_CHANGED(shadow_red)
+    || O_CHANGED(shadow_green) || O_CHANGED(shadow_blue);
+  const bool shadow_changed = shadow_geom_changed || shadow_color_changed
+    || O_CHANGED(shadow_opacity) || O_CHANGED(clear_shadow);
+
+  if (O_CHANGED(shadow_radius)) {
+#ifdef CONFIG_SHADOW_THREADS
+    shadow_pool_cancel_all(ps);
+#endif
+    free(ps->gaussian_map);
+    ps->gaussian_map = make_gaussian_map(ps->o.shadow_radius);
+    presum_gaussian(ps, ps->gaussian_map);
+  }
+  if (shadow_color_changed)
+    rebuild_cshadow_picture(ps);
+  rebuild_shadow_exclude_reg(ps);
+  const bool rounded_changed = O_CHANGED(detect_rounded_corners);
+  const bool prop_shadow_changed = O_CHANGED(respect_prop_shadow);
+
+  // Alpha pictures
+  if (O_CHANGED(alpha_step))
+    free_alpha_picts(ps);
+
+  // Blur, the normalized kernels are rebuilt on next paint
+  for (int i = 0; i < MAX_BLUR_PASS; ++i) {
+    free(ps->blur_kerns_cache[i]);
+    ps->blur_kerns_cache[i] = NULL;
+  }
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  if (ps->psglx) {
+    if (O_CHANGED(blur_method) || O_CHANGED(glx_use_gpushader4)
+        || O_CHANGED(blur_strength.iterations)
+        || O_CHANGED(blur_strength.offset)
+        || !blur_kerns_equal(o_old.blur_kerns, ps->o.blur_kerns))
+      glx_free_blur(ps);
+
+    if (O_STR_CHANGED(glx_fshader_win_str)) {
+      glx_free_prog_main(ps, &ps->o.glx_prog_win);
+      if (BKEND_GLX == ps->o.backend && ps->o.glx_fshader_win_str
+          && !glx_load_prog_main(ps, NULL, ps->o.glx_fshader_win_str,
+            &ps->o.glx_prog_win))
+        printf_errf("(): Failed to load window shader. Falling back to "
+            "the default one.");
+    }
+  }
+#endif
+
+  if (!init_filters(ps))
+    exit(1);
+
+  ps->tmout_unredir->interval = ps->o.unredir_if_possible_delay;
+
+  // Focus tracking, once enabled, stays on
+  {
+    const bool track_focus = ps->o.track_focus;
+    ps->o.track_focus = o_old.track_focus;
+    if (track_focus)
+      opts_init_track_focus(ps);
+  }
+
+  // Whether windows need to be re-examined for newly tracked data
+  const bool track_more = (ps->o.track_wdata && !o_old.track_wdata)
+    || (ps->o.track_leader && !o_old.track_leader)
+    || (ps->o.frame_opacity && !o_old.frame_opacity)
+    || (ps->o.detect_client_opacity && !o_old.detect_client_opacity)
+    || ps->track_atom_lst != track_atom_lst_old;
+
+#undef O_CHANGED
+#undef O_STR_CHANGED
+
+  for (win *w = ps->list; w; w = w->next) {
+    if (shadow_geom_changed) {
+      calc_win_size(ps, w);
+      // Extents include the shadow, they are rebuilt on next paint
+      if (w->extents) {
+        add_damage(ps, w->extents);
+        free_region(ps, &w->extents);
+      }
+    }
+    else if (shadow_changed)
+      win_free_shadow(ps, w);
+
+    if (IsViewable == w->a.map_state && !w->destroyed) {
+      if (track_more && w->client_win)
+        win_mark_client(ps, w, w->client_win);
+
+      // Shape and _COMPTON_SHADOW state is only fetched when the
+      // options are on, so recheck it if they changed
+      if (rounded_changed) {
+        if (ps->o.detect_rounded_corners)
+          win_update_shape_raw(ps, w);
+        else
+          w->rounded_corners = false;
+      }
+      if (prop_shadow_changed && ps->o.respect_prop_shadow)
+        win_update_prop_shadow_raw(ps, w);
+
+      // Lists may have been removed, so update unconditionally
+      win_determine_shadow(ps, w);
+      win_determine_fade(ps, w);
+      win_determine_invert_color(ps, w);
+      win_update_focused(ps, w);
+      win_determine_blur_background(ps, w);
+      win_update_opacity_rule(ps, w);
+      w->paint_excluded = win_match(ps, w, ps->o.paint_blacklist,
+          &w->cache_pblst);
+      w->unredir_if_possible_excluded = win_match(ps, w,
+          ps->o.unredir_if_possible_blacklist, &w->cache_uipblst);
+    }
+
+    w->flags |= WFLAG_OPCT_CHANGE;
+  }
+
+  options_free(&o_old);
+
+  ps->reset = false;
+  force_repaint(ps);
+
+  return true;
 }
-*/
 
 /**
  * Do the actual work.
@@ -7704,17 +10602,15 @@ dump_img(session_t *ps) {
  */
 static void
 session_run(session_t *ps) {
-  win *t;
-
   if (ps->o.sw_opti)
     ps->paint_tm_offset = get_time_timeval().tv_usec;
 
   ps->reg_ignore_expire = true;
 
-  t = paint_preprocess(ps, ps->list);
+  paint_preprocess(ps, ps->list);
 
   if (ps->redirected)
-    paint_all(ps, None, None, t);
+    paint_all(ps, None, None);
 
   // Initialize idling
   ps->idling = false;
@@ -7744,9 +10640,15 @@ session_run(session_t *ps) {
     // idling will be turned off during paint_preprocess() if needed
     ps->idling = true;
 
-    t = paint_preprocess(ps, ps->list);
+    paint_preprocess(ps, ps->list);
     ps->tmout_unredir_hit = false;
 
+#ifdef CONFIG_DBUS
+    // Tell watching D-Bus clients what changed
+    if (ps->o.dbus)
+      cdbus_ev_win_diff(ps);
+#endif
+
     // If the screen is unredirected, free all_damage to stop painting
     if (!ps->redirected || ON == ps->o.stoppaint_force)
       free_region(ps, &ps->all_damage);
@@ -7757,7 +10659,15 @@ session_run(session_t *ps) {
     resize_region(ps, ps->all_damage, ps->o.resize_damage);
     if (ps->all_damage && !is_region_empty(ps, ps->all_damage, NULL)) {
       static int paint = 0;
-      paint_all(ps, ps->all_damage, all_damage_orig, t);
+#ifdef CONFIG_TRACE
+      if (ps->trace)
+        trace_paint_begin(ps);
+#endif
+      paint_all(ps, ps->all_damage, all_damage_orig);
+#ifdef CONFIG_TRACE
+      if (ps->trace)
+        trace_paint_end(ps);
+#endif
       ps->reg_ignore_expire = false;
       paint++;
       if (ps->o.benchmark && paint >= ps->o.benchmark)
@@ -7769,6 +10679,15 @@ session_run(session_t *ps) {
 
     if (ps->idling)
       ps->fade_time = 0L;
+
+#ifdef CONFIG_TRACE
+    // Report once the replayed trace is fully painted
+    if (ps->idling && trace_finished(ps)) {
+      trace_report(ps);
+      session_destroy(ps);
+      exit(0);
+    }
+#endif
   }
 }
 
@@ -7814,6 +10733,8 @@ main(int argc, char **argv) {
       return 1;
     }
     session_run(ps_g);
+    while (session_reload(ps_g, argc, argv))
+      session_run(ps_g);
     ps_old = ps_g;
     session_destroy(ps_g);
   }
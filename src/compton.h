@@ -27,6 +27,19 @@
 #include <errno.h>
 #endif
 
+#ifdef CONFIG_SHADOW_THREADS
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+#ifdef CONFIG_DBUS
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
 // == Functions ==
 
 // inline functions must be made static to compile correctly under clang:
@@ -181,6 +194,16 @@ free_damage(session_t *ps, Damage *p) {
   }
 }
 
+/**
+ * Check if two strings are equal, treating two NULLs as equal.
+ */
+static inline bool
+str_equal_null(const char *a, const char *b) {
+  if (!a || !b)
+    return a == b;
+  return !strcmp(a, b);
+}
+
 /**
  * Destroy a condition list.
  */
@@ -223,7 +246,7 @@ paint_isvalid(session_t *ps, const paint_t *ppaint) {
     return false;
 
 #ifdef CONFIG_VSYNC_OPENGL
-  if (BKEND_GLX == ps->o.backend && !glx_tex_binded(ppaint->ptex, None))
+  if (bkend_paint_glx(ps) && !glx_tex_binded(ppaint->ptex, None))
     return false;
 #endif
 
@@ -250,7 +273,7 @@ paint_bind_tex_real(session_t *ps, paint_t *ppaint,
 static inline bool
 paint_bind_tex(session_t *ps, paint_t *ppaint,
     unsigned wid, unsigned hei, unsigned depth, bool force) {
-  if (BKEND_GLX == ps->o.backend)
+  if (bkend_paint_glx(ps))
     return paint_bind_tex_real(ps, ppaint, wid, hei, depth, force);
   return true;
 }
@@ -284,6 +307,33 @@ free_wpaint(session_t *ps, win *w) {
   free_fence(ps, &w->fence);
 }
 
+/**
+ * Drop all cached properties of a window.
+ */
+static inline void
+win_prop_cache_clear(win *w) {
+  while (w->prop_cache) {
+    winprop_cache_t *pc = w->prop_cache;
+    w->prop_cache = pc->next;
+    free_winprop(&pc->prop);
+    free(pc);
+  }
+}
+
+/**
+ * Cancel the pending shadow rasterization job of a window.
+ */
+static inline void
+win_cancel_shadow(session_t *ps, win *w) {
+#ifdef CONFIG_SHADOW_THREADS
+  // The job itself is freed when it's collected
+  if (w->shadow_job) {
+    w->shadow_job->w = NULL;
+    w->shadow_job = NULL;
+  }
+#endif
+}
+
 /**
  * Destroy all resources in a <code>struct _win</code>.
  */
@@ -293,13 +343,19 @@ free_win_res(session_t *ps, win *w) {
   free_region(ps, &w->extents);
   free_paint(ps, &w->paint);
   free_region(ps, &w->border_size);
+  win_cancel_shadow(ps, w);
   free_paint(ps, &w->shadow_paint);
   free_damage(ps, &w->damage);
   free_region(ps, &w->reg_ignore);
+  free_region(ps, &w->anim_reg);
+  win_prop_cache_clear(w);
   free(w->name);
   free(w->class_instance);
   free(w->class_general);
   free(w->role);
+#ifdef CONFIG_DBUS
+  cdbus_free_win_state(w);
+#endif
 }
 
 /**
@@ -307,12 +363,15 @@ free_win_res(session_t *ps, win *w) {
  */
 static inline void
 free_root_tile(session_t *ps) {
+  free_damage(ps, &ps->root_tile_damage);
   free_picture(ps, &ps->root_tile_paint.pict);
   free_texture(ps, &ps->root_tile_paint.ptex);
   if (ps->root_tile_fill)
     free_pixmap(ps, &ps->root_tile_paint.pixmap);
   ps->root_tile_paint.pixmap = None;
   ps->root_tile_fill = false;
+  ps->root_tile_pixmap_damaged = false;
+  ps->root_tile_width = ps->root_tile_height = 0;
 }
 
 /**
@@ -382,7 +441,7 @@ wid_set_text_prop(session_t *ps, Window wid, Atom prop_atom, char *str) {
 }
 
 static void
-run_fade(session_t *ps, win *w, unsigned steps);
+run_fade(session_t *ps, win *w);
 
 static void
 set_fade_callback(session_t *ps, win *w,
@@ -403,6 +462,16 @@ static void
 set_fade_callback(session_t *ps, win *w,
     void (*callback) (session_t *ps, win *w), bool exec_callback);
 
+static void
+win_anim_start(session_t *ps, win *w, double dx, double dy, double scale,
+    double end_dx, double end_dy, double end_scale);
+
+static void
+win_anim_stop(session_t *ps, win *w);
+
+static void
+run_anim(session_t *ps, win *w);
+
 static double
 gaussian(double r, double x, double y);
 
@@ -416,12 +485,52 @@ sum_gaussian(conv *map, double opacity,
 static void
 presum_gaussian(session_t *ps, conv *map);
 
-static XImage *
-make_shadow(session_t *ps, double opacity, int width, int height);
+static unsigned char *
+make_shadow_data(const session_t *ps, double opacity, int width, int height);
+
+static unsigned char *
+make_shadow_data_shaped(const session_t *ps, double opacity,
+    int width, int height, const XRectangle *rects, int nrects);
+
+static XRectangle *
+win_shadow_rects(session_t *ps, win *w, int *nrects);
 
 static bool
 win_build_shadow(session_t *ps, win *w, double opacity);
 
+static bool
+win_bind_shadow(session_t *ps, win *w, unsigned char *data,
+    int swidth, int sheight);
+
+static void
+win_request_shadow(session_t *ps, win *w);
+
+static void
+win_expire_shadow(session_t *ps, win *w);
+
+static void
+win_free_shadow(session_t *ps, win *w);
+
+#ifdef CONFIG_SHADOW_THREADS
+static void *
+shadow_worker(void *arg);
+
+static bool
+shadow_pool_init(session_t *ps);
+
+static void
+shadow_pool_destroy(session_t *ps);
+
+static bool
+shadow_pool_submit(session_t *ps, win *w);
+
+static void
+shadow_pool_cancel_all(session_t *ps);
+
+static bool
+shadow_pool_collect(session_t *ps);
+#endif
+
 static Picture
 solid_picture(session_t *ps, bool argb, double a,
               double r, double g, double b);
@@ -497,6 +606,20 @@ update_reg_ignore_expire(session_t *ps, const win *w) {
     ps->reg_ignore_expire = true;
 }
 
+/**
+ * Determine if a change of a window's region affects
+ * <code>reg_ignore</code>, and expire it from this window downwards
+ * accordingly.
+ *
+ * Higher windows don't include this window in their
+ * <code>reg_ignore</code>, so they are left alone.
+ */
+static inline void
+win_expire_reg_ignore(win *w) {
+  if (w->to_paint && WMODE_SOLID == w->mode)
+    w->reg_ignore_expire = true;
+}
+
 /**
  * Check whether a window has WM frames.
  */
@@ -592,6 +715,30 @@ win_match(session_t *ps, win *w, c2_lptr_t *condlst, const c2_lptr_t **cache) {
 #endif
 }
 
+/**
+ * Check if any condition in a list depends on window position.
+ */
+static inline bool
+condlst_dep_pos(const c2_lptr_t *condlst) {
+#ifdef CONFIG_C2
+  return c2_list_dep_pos(condlst);
+#else
+  return false;
+#endif
+}
+
+/**
+ * Check if any condition in a list depends on a window property.
+ */
+static inline bool
+condlst_dep_atom(session_t *ps, const c2_lptr_t *condlst, Atom atom) {
+#ifdef CONFIG_C2
+  return c2_list_dep_atom(ps, condlst, atom);
+#else
+  return false;
+#endif
+}
+
 static bool
 condlst_add(session_t *ps, c2_lptr_t **pcondlst, const char *pattern);
 
@@ -660,6 +807,9 @@ group_is_focused(session_t *ps, Window leader) {
 static win *
 recheck_focus(session_t *ps);
 
+static Pixmap
+get_root_tile_pixmap(session_t *ps);
+
 static bool
 get_root_tile(session_t *ps);
 
@@ -684,6 +834,21 @@ find_client_win(session_t *ps, Window w);
 static void
 get_frame_extents(session_t *ps, win *w, Window client);
 
+/**
+ * Get the time span the damage rate of the full-screen window is
+ * checked over, a quarter of the unredirection delay.
+ */
+static inline time_ms_t
+unredir_video_period(session_t *ps) {
+  return max_l(ps->o.unredir_if_possible_delay / 4, 1);
+}
+
+static void
+unredir_sample(session_t *ps, win *w);
+
+static bool
+unredir_is_video(session_t *ps);
+
 static win *
 paint_preprocess(session_t *ps, win *list);
 
@@ -721,6 +886,20 @@ win_render(session_t *ps, win *w, int x, int y, int wid, int hei,
       reg_paint, pcache_reg, (w ? &ps->o.glx_prog_win: NULL));
 }
 
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+static void
+win_variant_params(session_t *ps, win *w, double opacity,
+    glx_win_params_t *pparams);
+#endif
+
+static bool
+win_render_variant(session_t *ps, win *w, double opacity,
+    XserverRegion reg_paint, const reg_data_t *pcache_reg, bool *pdimmed);
+
+static void
+paint_solid_prepass(session_t *ps, XserverRegion region,
+    XserverRegion reg_tmp);
+
 static inline void
 set_tgt_clip(session_t *ps, XserverRegion reg, const reg_data_t *pcache_reg) {
   switch (ps->o.backend) {
@@ -730,6 +909,7 @@ set_tgt_clip(session_t *ps, XserverRegion reg, const reg_data_t *pcache_reg) {
       break;
 #ifdef CONFIG_VSYNC_OPENGL
     case BKEND_GLX:
+    case BKEND_GLX_CORE:
       glx_set_clip(ps, reg, pcache_reg);
       break;
 #endif
@@ -741,6 +921,10 @@ xr_blur_dst(session_t *ps, Picture tgt_buffer,
     int x, int y, int wid, int hei, XFixed **blur_kerns,
     XserverRegion reg_clip);
 
+static bool
+xr_pyramid_blur_dst(session_t *ps, Picture tgt_buffer,
+    int x, int y, int wid, int hei, XserverRegion reg_clip);
+
 /**
  * Normalize a convolution kernel.
  */
@@ -754,17 +938,79 @@ normalize_conv_kern(int wid, int hei, XFixed *kern) {
     kern[i] = XDoubleToFixed(XFixedToDouble(kern[i]) * factor);
 }
 
+static bool
+paint_hot_reserve(session_t *ps);
+
 static void
-paint_all(session_t *ps, XserverRegion region, XserverRegion region_real, win *t);
+paint_hot_add(session_t *ps, win *w);
+
+static void
+paint_all(session_t *ps, XserverRegion region, XserverRegion region_real);
+
+static bool
+offscreen_init(session_t *ps);
+
+static bool
+xr_read_frame(session_t *ps, unsigned char *rgb);
+
+static bool
+offscreen_dump(session_t *ps);
+
+static void
+offscreen_frame(session_t *ps, XserverRegion damage,
+    const struct timespec *pstart);
 
 static void
 add_damage(session_t *ps, XserverRegion damage);
 
+#ifdef CONFIG_DBUS
+/**
+ * Round a size in a frame capture ring up to <code>CAPTURE_ALIGN</code>.
+ */
+static inline size_t
+capture_align(size_t size) {
+  return (size + CAPTURE_ALIGN - 1) / CAPTURE_ALIGN * CAPTURE_ALIGN;
+}
+
+/**
+ * Get the header of a slot in the frame capture ring.
+ */
+static inline capture_slot_t *
+capture_slot(capture_t *cap, unsigned idx) {
+  return (capture_slot_t *) ((char *) cap->ring + cap->ring->slot_offset
+      + (size_t) idx * cap->ring->slot_size);
+}
+
+/**
+ * Get the pixel data of a slot in the frame capture ring.
+ */
+static inline unsigned char *
+capture_slot_data(capture_t *cap, unsigned idx) {
+  return (unsigned char *) capture_slot(cap, idx) + cap->ring->data_offset;
+}
+
+static bool
+capture_xr_init(session_t *ps, capture_t *cap);
+
+static bool
+capture_xr_read(session_t *ps, capture_t *cap, unsigned char *data,
+    const XRectangle *rects, int nrects);
+
+static void
+capture_frame(session_t *ps, XserverRegion damage);
+
+static void
+capture_finish(session_t *ps, capture_pending_t *pend);
+
+static void
+capture_flush(session_t *ps);
+#endif
+
 static void
 repair_win(session_t *ps, win *w);
 
 static wintype_t
-wid_get_prop_wintype(session_t *ps, Window w);
+wid_get_prop_wintype(session_t *ps, win *w, Window wid);
 
 static void
 map_win(session_t *ps, Window id);
@@ -782,25 +1028,36 @@ static void
 unmap_win(session_t *ps, win *w);
 
 static opacity_t
-wid_get_opacity_prop(session_t *ps, Window wid, opacity_t def);
+wid_get_opacity_prop(session_t *ps, win *w, Window wid, opacity_t def);
 
 /**
  * Reread opacity property of a window.
  */
 static inline void
 win_update_opacity_prop(session_t *ps, win *w) {
-  w->opacity_prop = wid_get_opacity_prop(ps, w->id, OPAQUE);
+  w->opacity_prop = wid_get_opacity_prop(ps, w, w->id, OPAQUE);
   if (!ps->o.detect_client_opacity || !w->client_win
       || w->id == w->client_win)
     w->opacity_prop_client = OPAQUE;
   else
-    w->opacity_prop_client = wid_get_opacity_prop(ps, w->client_win,
+    w->opacity_prop_client = wid_get_opacity_prop(ps, w, w->client_win,
           OPAQUE);
 }
 
 static double
 get_opacity_percent(win *w);
 
+/**
+ * Get the opacity of the black layer dimming a window.
+ */
+static inline double
+win_dim_opacity(session_t *ps, win *w) {
+  double dim_opacity = ps->o.inactive_dim;
+  if (!ps->o.inactive_dim_fixed)
+    dim_opacity *= get_opacity_percent(w);
+  return dim_opacity;
+}
+
 static void
 win_determine_mode(session_t *ps, win *w);
 
@@ -885,6 +1142,22 @@ win_on_wtype_change(session_t *ps, win *w);
 static void
 win_on_factor_change(session_t *ps, win *w);
 
+static void
+win_prop_cache_invalidate(win *w, Window wid, Atom atom);
+
+static void
+win_on_dep_change(session_t *ps, win *w, bool pos, Atom atom);
+
+static inline void
+win_on_pos_change(session_t *ps, win *w) {
+  win_on_dep_change(ps, w, true, None);
+}
+
+static inline void
+win_on_prop_change(session_t *ps, win *w, Atom atom) {
+  win_on_dep_change(ps, w, false, atom);
+}
+
 static void
 win_upd_run(session_t *ps, win *w, win_upd_t *pupd);
 
@@ -906,12 +1179,36 @@ win_unmark_client(session_t *ps, win *w);
 static void
 win_recheck_client(session_t *ps, win *w);
 
+static win *
+win_alloc(session_t *ps);
+
+static void
+win_release(session_t *ps, win *w);
+
+static void
+win_arena_destroy(session_t *ps);
+
+static bool
+win_hash_add(session_t *ps, win *w);
+
+static void
+win_hash_remove(session_t *ps, win *w);
+
+static void
+win_stack_unlink(session_t *ps, win *w);
+
+static void
+win_stack_insert(session_t *ps, win *w, win *below);
+
 static bool
 add_win(session_t *ps, Window id, Window prev);
 
 static void
 restack_win(session_t *ps, win *w, Window new_above);
 
+static void
+restack_wins(session_t *ps, const restack_t *reqs, int count);
+
 static void
 configure_win(session_t *ps, XConfigureEvent *ce);
 
@@ -919,7 +1216,7 @@ static void
 circulate_win(session_t *ps, XCirculateEvent *ce);
 
 static void
-finish_destroy_win(session_t *ps, Window id);
+finish_destroy_win(session_t *ps, win *w);
 
 static void
 destroy_callback(session_t *ps, win *w);
@@ -927,6 +1224,9 @@ destroy_callback(session_t *ps, win *w);
 static void
 destroy_win(session_t *ps, Window id);
 
+static void
+repair_root_tile(session_t *ps);
+
 static void
 damage_win(session_t *ps, XDamageNotifyEvent *de);
 
@@ -1282,7 +1582,7 @@ static void
 vsync_wait(session_t *ps);
 
 static void
-init_alpha_picts(session_t *ps);
+free_alpha_picts(session_t *ps);
 
 static bool
 init_dbe(session_t *ps);
@@ -1293,6 +1593,12 @@ init_overlay(session_t *ps);
 static void
 redir_start(session_t *ps);
 
+static void
+redir_prewarm(session_t *ps);
+
+static void
+redir_stop_win(session_t *ps, win *w);
+
 static void
 redir_stop(session_t *ps);
 
@@ -1341,12 +1647,26 @@ cxinerama_win_upd_scr(session_t *ps, win *w) {
 static void
 cxinerama_upd_scrs(session_t *ps);
 
+static void
+options_init(session_t *ps);
+
+static void
+options_free(options_t *o);
+
 static session_t *
 session_init(session_t *ps_old, int argc, char **argv);
 
 static void
 session_destroy(session_t *ps);
 
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+static bool
+blur_kerns_equal(XFixed * const *a, XFixed * const *b);
+#endif
+
+static bool
+session_reload(session_t *ps, int argc, char **argv);
+
 static void
 session_run(session_t *ps);
 
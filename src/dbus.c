@@ -17,6 +17,12 @@ bool
 cdbus_init(session_t *ps) {
   DBusError err = { };
 
+  // Targets are looked up with bsearch()
+  if (!cdbus_tables_sorted()) {
+    printf_errf("(): D-Bus lookup tables aren't sorted by name.");
+    return false;
+  }
+
   // Initialize
   dbus_error_init(&err);
 
@@ -85,6 +91,16 @@ cdbus_init(session_t *ps) {
     return false;
   }
 
+  // Get notified of clients leaving the bus, to drop their state
+  dbus_bus_add_match(ps->dbus_conn,
+      "type='signal',sender='org.freedesktop.DBus',"
+      "interface='org.freedesktop.DBus',member='NameOwnerChanged'", &err);
+  if (dbus_error_is_set(&err)) {
+    printf_errf("(): Failed to add D-Bus match for NameOwnerChanged.");
+    dbus_error_free(&err);
+    return false;
+  }
+
   return true;
 }
 
@@ -111,6 +127,11 @@ cdbus_destroy(session_t *ps) {
     dbus_connection_close(ps->dbus_conn);
     dbus_connection_unref(ps->dbus_conn);
   }
+
+  cdbus_txn_free(ps->dbus_txn);
+  ps->dbus_txn = NULL;
+  free(ps->dbus_diff_owner);
+  ps->dbus_diff_owner = NULL;
 }
 
 /** @name DBusTimeout handling
@@ -274,6 +295,20 @@ cdbus_apdarg_uint32(session_t *ps, DBusMessage *msg, const void *data) {
   return true;
 }
 
+/**
+ * Callback to append an Unix file descriptor argument to a message.
+ */
+static bool
+cdbus_apdarg_fd(session_t *ps, DBusMessage *msg, const void *data) {
+  if (!dbus_message_append_args(msg, DBUS_TYPE_UNIX_FD, data,
+        DBUS_TYPE_INVALID)) {
+    printf_errf("(): Failed to append argument.");
+    return false;
+  }
+
+  return true;
+}
+
 /**
  * Callback to append a double argument to a message.
  */
@@ -381,6 +416,399 @@ cdbus_apdarg_wids(session_t *ps, DBusMessage *msg, const void *data) {
   free(arr);
   return true;
 }
+
+/**
+ * Callback to append the changed attributes of all windows to a
+ * <code>win_diff</code> signal.
+ *
+ * The changes are collected in the <code>cdbus_diff_t</code> passed as
+ * data, the stored window states are left alone. Returns false if
+ * nothing changed, so no signal is sent.
+ */
+static bool
+cdbus_apdarg_win_diff(session_t *ps, DBusMessage *msg, const void *data) {
+  cdbus_diff_t *pdiff = (cdbus_diff_t *) data;
+  DBusMessageIter iter = { }, arr = { };
+
+  dbus_message_iter_init_append(msg, &iter);
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+        "(" CDBUS_TYPE_WINDOW_STR "asav)", &arr)) {
+    printf_errf("(): Failed to append argument.");
+    return false;
+  }
+
+  for (win *w = ps->list; w; w = w->next) {
+    if (w->destroyed)
+      continue;
+
+    if (!w->dbus_state)
+      w->dbus_state = calloc(NUM_CDBUS_WATTRS, sizeof(cdbus_val_t));
+    const cdbus_val_t *state = w->dbus_state;
+    if (!state) {
+      printf_errf("(): Failed to allocate memory for window state.");
+      continue;
+    }
+
+    if (pdiff->nwins == pdiff->capacity) {
+      const int capacity = (pdiff->capacity ? pdiff->capacity * 2: 8);
+      cdbus_win_diff_t *wins = realloc(pdiff->wins,
+          sizeof(cdbus_win_diff_t) * capacity);
+      if (!wins) {
+        printf_errf("(): Failed to allocate memory for window changes.");
+        dbus_message_iter_abandon_container(&iter, &arr);
+        return false;
+      }
+      pdiff->wins = wins;
+      pdiff->capacity = capacity;
+    }
+
+    // Find out changed attributes
+    cdbus_win_diff_t *pwd = &pdiff->wins[pdiff->nwins];
+    pwd->w = w;
+    pwd->nattrs = 0;
+    for (int i = 0; i < NUM_CDBUS_WATTRS; ++i) {
+      if (!(ps->dbus_diff_attrs & ((uint64_t) 1 << i)))
+        continue;
+      cdbus_val_t *pval = &pwd->vals[i];
+      *pval = (cdbus_val_t) { .valid = false };
+      cdbus_wattr_get(ps, w, i, pval);
+      if (!cdbus_val_eq(CDBUS_WATTRS[i].type, &state[i], pval))
+        pwd->attrs[pwd->nattrs++] = i;
+    }
+    if (!pwd->nattrs)
+      continue;
+
+    if (!cdbus_iter_append_win(&arr, w, pwd->vals, pwd->attrs,
+          pwd->nattrs)) {
+      printf_errf("(): Failed to append argument.");
+      dbus_message_iter_abandon_container(&iter, &arr);
+      return false;
+    }
+    ++pdiff->nwins;
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &arr)) {
+    printf_errf("(): Failed to append argument.");
+    return false;
+  }
+
+  return pdiff->nwins > 0;
+}
+
+/**
+ * Store the values sent in a <code>win_diff</code> signal as the last
+ * sent window states.
+ */
+static void
+cdbus_diff_store(cdbus_diff_t *pdiff) {
+  for (int i = 0; i < pdiff->nwins; ++i) {
+    const cdbus_win_diff_t *pwd = &pdiff->wins[i];
+    cdbus_val_t *state = pwd->w->dbus_state;
+    for (int j = 0; j < pwd->nattrs; ++j) {
+      const cdbus_wattr_t attr = pwd->attrs[j];
+      if (DBUS_TYPE_STRING == CDBUS_WATTRS[attr].type) {
+        free((char *) state[attr].v.s);
+        state[attr] = pwd->vals[attr];
+        state[attr].v.s = (pwd->vals[attr].v.s ?
+            mstrcpy(pwd->vals[attr].v.s): NULL);
+      }
+      else
+        state[attr] = pwd->vals[attr];
+    }
+  }
+}
+
+/**
+ * Append the snapshot of one window to an array.
+ */
+static bool
+cdbus_iter_append_snapshot(session_t *ps, DBusMessageIter *arr, win *w,
+    const cdbus_snapshot_req_t *preq) {
+  cdbus_val_t vals[NUM_CDBUS_WATTRS];
+  for (int i = 0; i < preq->nattrs; ++i)
+    cdbus_wattr_get(ps, w, preq->attrs[i], &vals[preq->attrs[i]]);
+
+  return cdbus_iter_append_win(arr, w, vals, preq->attrs, preq->nattrs);
+}
+
+/**
+ * Callback to append the requested attributes of windows to a
+ * <code>win_snapshot</code> reply.
+ */
+static bool
+cdbus_apdarg_win_snapshot(session_t *ps, DBusMessage *msg, const void *data) {
+  const cdbus_snapshot_req_t *preq = data;
+  DBusMessageIter iter = { }, arr = { };
+
+  dbus_message_iter_init_append(msg, &iter);
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+        "(" CDBUS_TYPE_WINDOW_STR "asav)", &arr)) {
+    printf_errf("(): Failed to append argument.");
+    return false;
+  }
+
+  bool success = true;
+  if (preq->nwids) {
+    for (int i = 0; success && i < preq->nwids; ++i) {
+      win *w = find_win(ps, preq->wids[i]);
+      if (w)
+        success = cdbus_iter_append_snapshot(ps, &arr, w, preq);
+    }
+  }
+  else {
+    for (win *w = ps->list; success && w; w = w->next)
+      if (!w->destroyed)
+        success = cdbus_iter_append_snapshot(ps, &arr, w, preq);
+  }
+
+  if (!success) {
+    printf_errf("(): Failed to append argument.");
+    dbus_message_iter_abandon_container(&iter, &arr);
+    return false;
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &arr)) {
+    printf_errf("(): Failed to append argument.");
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Callback to append a <code>cdbus_tval_t</code> argument to a message.
+ */
+static bool
+cdbus_apdarg_val(session_t *ps, DBusMessage *msg, const void *data) {
+  const cdbus_tval_t *ptval = data;
+  DBusMessageIter iter = { };
+
+  dbus_message_iter_init_append(msg, &iter);
+  if (!cdbus_iter_append_basic(&iter, ptval->type, ptval->pval)) {
+    printf_errf("(): Failed to append argument.");
+    return false;
+  }
+
+  return true;
+}
+///@}
+
+/** @name Window attributes
+ */
+///@{
+/**
+ * Find a window attribute by name.
+ *
+ * @return index of the attribute, -1 if not found
+ */
+static int
+cdbus_wattr_find(const char *name) {
+  const cdbus_wattr_info_t *pattr = cdbus_table_find(CDBUS_WATTRS, name);
+
+  return (pattr ? pattr - CDBUS_WATTRS: -1);
+}
+
+/**
+ * Read the value of a window attribute.
+ *
+ * Strings are borrowed from the window.
+ */
+static void
+cdbus_wattr_get(session_t *ps, win *w, cdbus_wattr_t attr, cdbus_val_t *pval) {
+  pval->valid = true;
+
+#define cdbus_m_wattr_get(tgt, memb, val) \
+    case CDBUS_WATTR_ ## tgt: pval->v.memb = (val); break
+
+  switch (attr) {
+    cdbus_m_wattr_get(ID, u, w->id);
+    cdbus_m_wattr_get(NEXT, u, (w->next ? w->next->id: 0));
+    cdbus_m_wattr_get(MAP_STATE, b, !!w->a.map_state);
+    cdbus_m_wattr_get(MODE, e, w->mode);
+    cdbus_m_wattr_get(CLIENT_WIN, u, w->client_win);
+    cdbus_m_wattr_get(DAMAGED, b, w->damaged);
+    cdbus_m_wattr_get(DESTROYED, b, w->destroyed);
+    cdbus_m_wattr_get(WINDOW_TYPE, e, w->window_type);
+    cdbus_m_wattr_get(WMWIN, b, w->wmwin);
+    cdbus_m_wattr_get(LEADER, u, w->leader);
+    cdbus_m_wattr_get(FOCUSED_REAL, b, win_is_focused_real(ps, w));
+    cdbus_m_wattr_get(FADE_FORCE, e, w->fade_force);
+    cdbus_m_wattr_get(SHADOW_FORCE, e, w->shadow_force);
+    cdbus_m_wattr_get(FOCUSED_FORCE, e, w->focused_force);
+    cdbus_m_wattr_get(INVERT_COLOR_FORCE, e, w->invert_color_force);
+    cdbus_m_wattr_get(NAME, s, w->name);
+    cdbus_m_wattr_get(CLASS_INSTANCE, s, w->class_instance);
+    cdbus_m_wattr_get(CLASS_GENERAL, s, w->class_general);
+    cdbus_m_wattr_get(ROLE, s, w->role);
+    cdbus_m_wattr_get(OPACITY, u, w->opacity);
+    cdbus_m_wattr_get(OPACITY_TGT, u, w->opacity_tgt);
+    cdbus_m_wattr_get(OPACITY_PROP, u, w->opacity_prop);
+    cdbus_m_wattr_get(OPACITY_PROP_CLIENT, u, w->opacity_prop_client);
+    cdbus_m_wattr_get(OPACITY_SET, u, w->opacity_set);
+    cdbus_m_wattr_get(FRAME_OPACITY, d, w->frame_opacity);
+    cdbus_m_wattr_get(LEFT_WIDTH, u, w->frame_extents.left);
+    cdbus_m_wattr_get(RIGHT_WIDTH, u, w->frame_extents.right);
+    cdbus_m_wattr_get(TOP_WIDTH, u, w->frame_extents.top);
+    cdbus_m_wattr_get(BOTTOM_WIDTH, u, w->frame_extents.bottom);
+    cdbus_m_wattr_get(SHADOW, b, w->shadow);
+    cdbus_m_wattr_get(FADE, b, w->fade);
+    cdbus_m_wattr_get(INVERT_COLOR, b, w->invert_color);
+    cdbus_m_wattr_get(BLUR_BACKGROUND, b, w->blur_background);
+    case NUM_CDBUS_WATTRS:
+      assert(0);
+      pval->valid = false;
+      break;
+  }
+
+#undef cdbus_m_wattr_get
+}
+
+/**
+ * Check if two window attribute values are equal.
+ */
+static bool
+cdbus_val_eq(cdbus_vtype_t type, const cdbus_val_t *a, const cdbus_val_t *b) {
+  if (!a->valid || !b->valid)
+    return a->valid == b->valid;
+
+  switch (type) {
+    case DBUS_TYPE_BOOLEAN: return !a->v.b == !b->v.b;
+    case DBUS_TYPE_UINT32:  return a->v.u == b->v.u;
+    case DBUS_TYPE_DOUBLE:  return a->v.d == b->v.d;
+    case CDBUS_TYPE_ENUM:   return a->v.e == b->v.e;
+    case DBUS_TYPE_STRING:
+      if (!a->v.s || !b->v.s)
+        return a->v.s == b->v.s;
+      return !strcmp(a->v.s, b->v.s);
+  }
+
+  assert(0);
+  return false;
+}
+
+/**
+ * Append a value to a message.
+ */
+static bool
+cdbus_iter_append_basic(DBusMessageIter *iter, cdbus_vtype_t type,
+    const cdbus_val_t *pval) {
+  if (DBUS_TYPE_STRING == type) {
+    const char *str = (pval->v.s ? pval->v.s: "");
+    return dbus_message_iter_append_basic(iter, type, &str);
+  }
+
+  return dbus_message_iter_append_basic(iter, type,
+      cdbus_val_data(type, (cdbus_val_t *) pval));
+}
+
+/**
+ * Append a value to a message as a variant.
+ */
+static bool
+cdbus_iter_append_val(DBusMessageIter *iter, cdbus_vtype_t type,
+    const cdbus_val_t *pval) {
+  const char sig[] = { type, '\0' };
+  DBusMessageIter sub = { };
+
+  if (!dbus_message_iter_open_container(iter, DBUS_TYPE_VARIANT, sig, &sub))
+    return false;
+  if (!cdbus_iter_append_basic(&sub, type, pval)) {
+    dbus_message_iter_abandon_container(iter, &sub);
+    return false;
+  }
+
+  return dbus_message_iter_close_container(iter, &sub);
+}
+
+/**
+ * Append a (window ID, attribute names, attribute values) struct to an
+ * array.
+ *
+ * @param vals values of all attributes, indexed by attribute
+ * @param attrs attributes to include
+ */
+static bool
+cdbus_iter_append_win(DBusMessageIter *arr, win *w, const cdbus_val_t *vals,
+    const cdbus_wattr_t *attrs, int nattrs) {
+  DBusMessageIter st = { }, names = { }, values = { };
+  cdbus_window_t wid = w->id;
+
+  if (!dbus_message_iter_open_container(arr, DBUS_TYPE_STRUCT, NULL, &st))
+    return false;
+
+  bool success = dbus_message_iter_append_basic(&st, CDBUS_TYPE_WINDOW, &wid);
+
+  if (success && (success = dbus_message_iter_open_container(&st,
+          DBUS_TYPE_ARRAY, DBUS_TYPE_STRING_AS_STRING, &names))) {
+    for (int i = 0; success && i < nattrs; ++i)
+      success = dbus_message_iter_append_basic(&names, DBUS_TYPE_STRING,
+          &CDBUS_WATTRS[attrs[i]].name);
+    if (success)
+      success = dbus_message_iter_close_container(&st, &names);
+    else
+      dbus_message_iter_abandon_container(&st, &names);
+  }
+
+  if (success && (success = dbus_message_iter_open_container(&st,
+          DBUS_TYPE_ARRAY, DBUS_TYPE_VARIANT_AS_STRING, &values))) {
+    for (int i = 0; success && i < nattrs; ++i)
+      success = cdbus_iter_append_val(&values, CDBUS_WATTRS[attrs[i]].type,
+          &vals[attrs[i]]);
+    if (success)
+      success = dbus_message_iter_close_container(&st, &values);
+    else
+      dbus_message_iter_abandon_container(&st, &values);
+  }
+
+  if (!success) {
+    dbus_message_iter_abandon_container(arr, &st);
+    return false;
+  }
+
+  return dbus_message_iter_close_container(arr, &st);
+}
+
+/**
+ * Parse an array of window attribute names.
+ *
+ * Sends an error reply if an attribute is not found.
+ *
+ * @param pattrs place to store the attributes, which must have space for
+ *        <code>ntargets</code> items
+ * @return true if all attributes are found
+ */
+static bool
+cdbus_wattr_parse(session_t *ps, DBusMessage *msg, char **targets,
+    int ntargets, cdbus_wattr_t *pattrs) {
+  for (int i = 0; i < ntargets; ++i) {
+    int idx = cdbus_wattr_find(targets[i]);
+    if (idx < 0) {
+      printf_errf("(): " CDBUS_ERROR_BADTGT_S, targets[i]);
+      cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S,
+          targets[i]);
+      return false;
+    }
+    pattrs[i] = idx;
+  }
+
+  return true;
+}
+
+/**
+ * Free the attribute values last sent for a window.
+ */
+void
+cdbus_free_win_state(win *w) {
+  cdbus_val_t *state = w->dbus_state;
+  if (!state)
+    return;
+
+  for (int i = 0; i < NUM_CDBUS_WATTRS; ++i)
+    if (DBUS_TYPE_STRING == CDBUS_WATTRS[i].type)
+      free((char *) state[i].v.s);
+  free(state);
+  w->dbus_state = NULL;
+}
 ///@}
 
 /**
@@ -542,212 +970,784 @@ cdbus_loop(session_t *ps) {
     cdbus_process(ps, msg);
 }
 
-/** @name Message processing
+/** @name Targets
  */
 ///@{
 
 /**
- * Process a message from D-Bus.
+ * Set the overrides of window states.
  */
 static void
-cdbus_process(session_t *ps, DBusMessage *msg) {
-  bool success = false;
-
-#define cdbus_m_ismethod(method) \
-  dbus_message_is_method_call(msg, CDBUS_INTERFACE_NAME, method)
+cdbus_win_set_fade_force(session_t *ps, win *w, const cdbus_val_t *pval) {
+  win_set_fade_force(ps, w, pval->v.e);
+}
 
-  if (cdbus_m_ismethod("reset")) {
-    ps->reset = true;
-    if (!dbus_message_get_no_reply(msg))
-      cdbus_reply_bool(ps, msg, true);
-    success = true;
-  }
-  else if (cdbus_m_ismethod("repaint")) {
-    force_repaint(ps);
-    if (!dbus_message_get_no_reply(msg))
-      cdbus_reply_bool(ps, msg, true);
-    success = true;
-  }
-  else if (cdbus_m_ismethod("list_win")) {
-    success = cdbus_process_list_win(ps, msg);
-  }
-  else if (cdbus_m_ismethod("win_get")) {
-    success = cdbus_process_win_get(ps, msg);
-  }
-  else if (cdbus_m_ismethod("win_set")) {
-    success = cdbus_process_win_set(ps, msg);
-  }
-  else if (cdbus_m_ismethod("find_win")) {
-    success = cdbus_process_find_win(ps, msg);
-  }
-  else if (cdbus_m_ismethod("opts_get")) {
-    success = cdbus_process_opts_get(ps, msg);
-  }
-  else if (cdbus_m_ismethod("opts_set")) {
-    success = cdbus_process_opts_set(ps, msg);
-  }
-#undef cdbus_m_ismethod
-  else if (dbus_message_is_method_call(msg,
-        "org.freedesktop.DBus.Introspectable", "Introspect")) {
-    success = cdbus_process_introspect(ps, msg);
-  }
-  else if (dbus_message_is_method_call(msg,
-        "org.freedesktop.DBus.Peer", "Ping")) {
-    cdbus_reply(ps, msg, NULL, NULL);
-    success = true;
-  }
-  else if (dbus_message_is_method_call(msg,
-        "org.freedesktop.DBus.Peer", "GetMachineId")) {
-    char *uuid = dbus_get_local_machine_id();
-    if (uuid) {
-      cdbus_reply_string(ps, msg, uuid);
-      dbus_free(uuid);
-      success = true;
-    }
-  }
-  else if (dbus_message_is_signal(msg, "org.freedesktop.DBus", "NameAcquired")
-      || dbus_message_is_signal(msg, "org.freedesktop.DBus", "NameLost")) {
-    success = true;
-  }
-  else {
-    if (DBUS_MESSAGE_TYPE_ERROR == dbus_message_get_type(msg)) {
-      printf_errf("(): Error message of path \"%s\" "
-          "interface \"%s\", member \"%s\", error \"%s\"",
-          dbus_message_get_path(msg), dbus_message_get_interface(msg),
-          dbus_message_get_member(msg), dbus_message_get_error_name(msg));
-    }
-    else {
-      printf_errf("(): Illegal message of type \"%s\", path \"%s\" "
-          "interface \"%s\", member \"%s\"",
-          cdbus_repr_msgtype(msg), dbus_message_get_path(msg),
-          dbus_message_get_interface(msg), dbus_message_get_member(msg));
-    }
-    if (DBUS_MESSAGE_TYPE_METHOD_CALL == dbus_message_get_type(msg)
-        && !dbus_message_get_no_reply(msg))
-      cdbus_reply_err(ps, msg, CDBUS_ERROR_BADMSG, CDBUS_ERROR_BADMSG_S);
-    success = true;
-  }
+static void
+cdbus_win_set_focused_force(session_t *ps, win *w, const cdbus_val_t *pval) {
+  win_set_focused_force(ps, w, pval->v.e);
+}
 
-  // If the message could not be processed, and an reply is expected, return
-  // an empty reply.
-  if (!success && DBUS_MESSAGE_TYPE_METHOD_CALL == dbus_message_get_type(msg)
-      && !dbus_message_get_no_reply(msg))
-    cdbus_reply_err(ps, msg, CDBUS_ERROR_UNKNOWN, CDBUS_ERROR_UNKNOWN_S);
+static void
+cdbus_win_set_invert_color_force(session_t *ps, win *w,
+    const cdbus_val_t *pval) {
+  win_set_invert_color_force(ps, w, pval->v.e);
+}
 
-  // Free the message
-  dbus_message_unref(msg);
+static void
+cdbus_win_set_shadow_force(session_t *ps, win *w, const cdbus_val_t *pval) {
+  win_set_shadow_force(ps, w, pval->v.e);
 }
 
+/// Window attributes settable with <code>win_set</code>, sorted by name.
+static const cdbus_wsetter_t CDBUS_WSETTERS[] = {
+  { "fade_force", CDBUS_TYPE_ENUM, cdbus_win_set_fade_force },
+  { "focused_force", CDBUS_TYPE_ENUM, cdbus_win_set_focused_force },
+  { "invert_color_force", CDBUS_TYPE_ENUM, cdbus_win_set_invert_color_force },
+  { "shadow_force", CDBUS_TYPE_ENUM, cdbus_win_set_shadow_force },
+};
+
 /**
- * Process a list_win D-Bus request.
+ * Define a getter of an option that is a member of <code>options_t</code>.
  */
-static bool
-cdbus_process_list_win(session_t *ps, DBusMessage *msg) {
-  cdbus_reply(ps, msg, cdbus_apdarg_wids, NULL);
+#define cdbus_m_opts_getter(tgt, memb) \
+static void \
+cdbus_opts_get_ ## tgt(session_t *ps, cdbus_val_t *pval) { \
+  pval->v.memb = ps->o.tgt; \
+}
 
-  return true;
+cdbus_m_opts_getter(config_file, s)
+cdbus_m_opts_getter(display_repr, s)
+cdbus_m_opts_getter(write_pid_path, s)
+cdbus_m_opts_getter(mark_wmwin_focused, b)
+cdbus_m_opts_getter(mark_ovredir_focused, b)
+cdbus_m_opts_getter(fork_after_register, b)
+cdbus_m_opts_getter(detect_rounded_corners, b)
+cdbus_m_opts_getter(paint_on_overlay, b)
+cdbus_m_opts_getter(unredir_if_possible, b)
+cdbus_m_opts_getter(unredir_if_possible_delay, i)
+cdbus_m_opts_getter(unredir_if_possible_video_fps, i)
+cdbus_m_opts_getter(unredir_if_possible_overlay_ratio, d)
+cdbus_m_opts_getter(redirected_force, e)
+cdbus_m_opts_getter(stoppaint_force, e)
+cdbus_m_opts_getter(logpath, s)
+cdbus_m_opts_getter(synchronize, b)
+cdbus_m_opts_getter(refresh_rate, i)
+cdbus_m_opts_getter(sw_opti, b)
+cdbus_m_opts_getter(dbe, b)
+cdbus_m_opts_getter(vsync_aggressive, b)
+cdbus_m_opts_getter(shadow_red, d)
+cdbus_m_opts_getter(shadow_green, d)
+cdbus_m_opts_getter(shadow_blue, d)
+cdbus_m_opts_getter(shadow_radius, i)
+cdbus_m_opts_getter(shadow_offset_x, i)
+cdbus_m_opts_getter(shadow_offset_y, i)
+cdbus_m_opts_getter(shadow_opacity, d)
+cdbus_m_opts_getter(clear_shadow, b)
+cdbus_m_opts_getter(xinerama_shadow_crop, b)
+cdbus_m_opts_getter(shadow_threads, i)
+cdbus_m_opts_getter(fade_delta, i)
+cdbus_m_opts_getter(fade_in_step, i)
+cdbus_m_opts_getter(fade_out_step, i)
+cdbus_m_opts_getter(no_fading_openclose, b)
+cdbus_m_opts_getter(animations, b)
+cdbus_m_opts_getter(animation_duration, i)
+cdbus_m_opts_getter(animation_scale, d)
+cdbus_m_opts_getter(blur_background, b)
+cdbus_m_opts_getter(blur_background_frame, b)
+cdbus_m_opts_getter(blur_background_fixed, b)
+cdbus_m_opts_getter(inactive_dim, d)
+cdbus_m_opts_getter(inactive_dim_fixed, b)
+cdbus_m_opts_getter(use_ewmh_active_win, b)
+cdbus_m_opts_getter(detect_transient, b)
+cdbus_m_opts_getter(detect_client_leader, b)
+cdbus_m_opts_getter(track_focus, b)
+cdbus_m_opts_getter(track_wdata, b)
+cdbus_m_opts_getter(track_leader, b)
+#ifdef CONFIG_VSYNC_OPENGL
+cdbus_m_opts_getter(glx_no_stencil, b)
+cdbus_m_opts_getter(glx_copy_from_front, b)
+cdbus_m_opts_getter(glx_use_copysubbuffermesa, b)
+cdbus_m_opts_getter(glx_no_rebind_pixmap, b)
+cdbus_m_opts_getter(glx_swap_method, i)
+#endif
+#undef cdbus_m_opts_getter
+
+static void
+cdbus_opts_get_version(session_t *ps, cdbus_val_t *pval) {
+  pval->v.s = COMPTON_VERSION;
 }
 
-/**
- * Process a win_get D-Bus request.
- */
+static void
+cdbus_opts_get_pid(session_t *ps, cdbus_val_t *pval) {
+  pval->v.i = getpid();
+}
+
+static void
+cdbus_opts_get_display(session_t *ps, cdbus_val_t *pval) {
+  pval->v.s = DisplayString(ps->dpy);
+}
+
+/**
+ * Get window property cache statistics.
+ */
+static void
+cdbus_opts_get_prop_cache_hits(session_t *ps, cdbus_val_t *pval) {
+  pval->v.t = ps->prop_cache_hits;
+}
+
+static void
+cdbus_opts_get_prop_cache_misses(session_t *ps, cdbus_val_t *pval) {
+  pval->v.t = ps->prop_cache_misses;
+}
+
+/**
+ * Get screen redirection transition statistics.
+ */
+static void
+cdbus_opts_get_redir_transitions(session_t *ps, cdbus_val_t *pval) {
+  pval->v.t = ps->redir_stats.nstop + ps->redir_stats.nstart;
+}
+
+static void
+cdbus_opts_get_redir_stop_us(session_t *ps, cdbus_val_t *pval) {
+  pval->v.i = ps->redir_stats.stop_us;
+}
+
+static void
+cdbus_opts_get_redir_start_us(session_t *ps, cdbus_val_t *pval) {
+  pval->v.i = ps->redir_stats.start_us;
+}
+
+static void
+cdbus_opts_get_redir_frame_us(session_t *ps, cdbus_val_t *pval) {
+  pval->v.i = ps->redir_stats.frame_us;
+}
+
+static void
+cdbus_opts_get_redir_total_us(session_t *ps, cdbus_val_t *pval) {
+  pval->v.t = ps->redir_stats.total_us;
+}
+
+/**
+ * Get ID of the X composite overlay window.
+ */
+static void
+cdbus_opts_get_paint_on_overlay_id(session_t *ps, cdbus_val_t *pval) {
+  pval->v.u = ps->overlay;
+}
+
+static void
+cdbus_opts_get_vsync(session_t *ps, cdbus_val_t *pval) {
+  assert(ps->o.vsync < sizeof(VSYNC_STRS) / sizeof(VSYNC_STRS[0]));
+  pval->v.s = VSYNC_STRS[ps->o.vsync];
+}
+
+static void
+cdbus_opts_get_backend(session_t *ps, cdbus_val_t *pval) {
+  assert(ps->o.backend < sizeof(BACKEND_STRS) / sizeof(BACKEND_STRS[0]));
+  pval->v.s = BACKEND_STRS[ps->o.backend];
+}
+
+static void
+cdbus_opts_get_fade_easing(session_t *ps, cdbus_val_t *pval) {
+  assert(ps->o.fade_easing < sizeof(FADE_EASING_STRS) / sizeof(FADE_EASING_STRS[0]));
+  pval->v.s = FADE_EASING_STRS[ps->o.fade_easing];
+}
+
+#define cdbus_m_opts_get_entry(tgt, type) \
+  { MSTR(tgt), type, cdbus_opts_get_ ## tgt }
+
+/// Options readable with <code>opts_get</code>, sorted by name.
+static const cdbus_opt_getter_t CDBUS_OPTS_GET[] = {
+  cdbus_m_opts_get_entry(animation_duration, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(animation_scale, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_get_entry(animations, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(backend, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(blur_background, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(blur_background_fixed, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(blur_background_frame, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(clear_shadow, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(config_file, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(dbe, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(detect_client_leader, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(detect_rounded_corners, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(detect_transient, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(display, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(display_repr, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(fade_delta, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(fade_easing, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(fade_in_step, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(fade_out_step, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(fork_after_register, DBUS_TYPE_BOOLEAN),
+#ifdef CONFIG_VSYNC_OPENGL
+  cdbus_m_opts_get_entry(glx_copy_from_front, DBUS_TYPE_BOOLEAN),
+#endif
+#ifdef CONFIG_VSYNC_OPENGL
+  cdbus_m_opts_get_entry(glx_no_rebind_pixmap, DBUS_TYPE_BOOLEAN),
+#endif
+#ifdef CONFIG_VSYNC_OPENGL
+  cdbus_m_opts_get_entry(glx_no_stencil, DBUS_TYPE_BOOLEAN),
+#endif
+#ifdef CONFIG_VSYNC_OPENGL
+  cdbus_m_opts_get_entry(glx_swap_method, DBUS_TYPE_INT32),
+#endif
+#ifdef CONFIG_VSYNC_OPENGL
+  cdbus_m_opts_get_entry(glx_use_copysubbuffermesa, DBUS_TYPE_BOOLEAN),
+#endif
+  cdbus_m_opts_get_entry(inactive_dim, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_get_entry(inactive_dim_fixed, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(logpath, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(mark_ovredir_focused, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(mark_wmwin_focused, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(no_fading_openclose, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(paint_on_overlay, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(paint_on_overlay_id, DBUS_TYPE_UINT32),
+  cdbus_m_opts_get_entry(pid, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(prop_cache_hits, DBUS_TYPE_UINT64),
+  cdbus_m_opts_get_entry(prop_cache_misses, DBUS_TYPE_UINT64),
+  cdbus_m_opts_get_entry(redir_frame_us, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(redir_start_us, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(redir_stop_us, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(redir_total_us, DBUS_TYPE_UINT64),
+  cdbus_m_opts_get_entry(redir_transitions, DBUS_TYPE_UINT64),
+  cdbus_m_opts_get_entry(redirected_force, CDBUS_TYPE_ENUM),
+  cdbus_m_opts_get_entry(refresh_rate, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(shadow_blue, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_get_entry(shadow_green, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_get_entry(shadow_offset_x, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(shadow_offset_y, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(shadow_opacity, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_get_entry(shadow_radius, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(shadow_red, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_get_entry(shadow_threads, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(stoppaint_force, CDBUS_TYPE_ENUM),
+  cdbus_m_opts_get_entry(sw_opti, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(synchronize, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(track_focus, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(track_leader, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(track_wdata, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(unredir_if_possible, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(unredir_if_possible_delay, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(unredir_if_possible_overlay_ratio, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_get_entry(unredir_if_possible_video_fps, DBUS_TYPE_INT32),
+  cdbus_m_opts_get_entry(use_ewmh_active_win, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(version, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(vsync, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(vsync_aggressive, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_get_entry(write_pid_path, DBUS_TYPE_STRING),
+  cdbus_m_opts_get_entry(xinerama_shadow_crop, DBUS_TYPE_BOOLEAN),
+};
+#undef cdbus_m_opts_get_entry
+
 static bool
-cdbus_process_win_get(session_t *ps, DBusMessage *msg) {
-  cdbus_window_t wid = None;
-  const char *target = NULL;
-  DBusError err = { };
+cdbus_opts_set_clear_shadow(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  if (ps->o.clear_shadow != pval->v.b) {
+    ps->o.clear_shadow = pval->v.b;
+    cdbus_force_repaint(ps);
+  }
+  return true;
+}
 
-  if (!dbus_message_get_args(msg, &err,
-        CDBUS_TYPE_WINDOW, &wid,
-        DBUS_TYPE_STRING, &target,
-        DBUS_TYPE_INVALID)) {
-    printf_errf("(): Failed to parse argument of \"win_get\" (%s).",
-        err.message);
-    dbus_error_free(&err);
+static bool
+cdbus_opts_set_fade_delta(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  ps->o.fade_delta = max_i(pval->v.i, 1);
+  return true;
+}
+
+static bool
+cdbus_opts_set_fade_in_step(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  ps->o.fade_in_step = normalize_d(pval->v.d) * OPAQUE;
+  return true;
+}
+
+static bool
+cdbus_opts_set_fade_out_step(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  ps->o.fade_out_step = normalize_d(pval->v.d) * OPAQUE;
+  return true;
+}
+
+static bool
+cdbus_opts_set_no_fading_openclose(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  opts_set_no_fading_openclose(ps, pval->v.b);
+  return true;
+}
+
+static bool
+cdbus_opts_set_redirected_force(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  ps->o.redirected_force = pval->v.e;
+  cdbus_force_repaint(ps);
+  return true;
+}
+
+static bool
+cdbus_opts_set_stoppaint_force(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  ps->o.stoppaint_force = pval->v.e;
+  return true;
+}
+
+static bool
+cdbus_opts_set_track_focus(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  // You could enable this option, but never turn if off
+  if (pval->v.b) {
+    opts_init_track_focus(ps);
+  }
+  return true;
+}
+
+static bool
+cdbus_opts_set_unredir_if_possible(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  if (ps->o.unredir_if_possible != pval->v.b) {
+    ps->o.unredir_if_possible = pval->v.b;
+    ps->ev_received = true;
+  }
+  return true;
+}
+
+static bool
+cdbus_opts_set_vsync(session_t *ps, DBusMessage *msg,
+    const cdbus_val_t *pval) {
+  vsync_deinit(ps);
+  if (!parse_vsync(ps, pval->v.s)) {
+    printf_errf("(): " CDBUS_ERROR_BADARG_S, 1, "Value invalid.");
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADARG, CDBUS_ERROR_BADARG_S, 1, "Value invalid.");
     return false;
   }
+  if (!vsync_init(ps)) {
+    printf_errf("(): " CDBUS_ERROR_CUSTOM_S, "Failed to initialize specified VSync method.");
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_CUSTOM, CDBUS_ERROR_CUSTOM_S, "Failed to initialize specified VSync method.");
+    return false;
+  }
+  return true;
+}
 
-  win *w = find_win(ps, wid);
+#define cdbus_m_opts_set_entry(tgt, type) \
+  { MSTR(tgt), type, cdbus_opts_set_ ## tgt }
+
+/// Options settable with <code>opts_set</code>, sorted by name.
+static const cdbus_opt_setter_t CDBUS_OPTS_SET[] = {
+  cdbus_m_opts_set_entry(clear_shadow, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_set_entry(fade_delta, DBUS_TYPE_INT32),
+  cdbus_m_opts_set_entry(fade_in_step, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_set_entry(fade_out_step, DBUS_TYPE_DOUBLE),
+  cdbus_m_opts_set_entry(no_fading_openclose, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_set_entry(redirected_force, CDBUS_TYPE_ENUM),
+  cdbus_m_opts_set_entry(stoppaint_force, CDBUS_TYPE_ENUM),
+  cdbus_m_opts_set_entry(track_focus, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_set_entry(unredir_if_possible, DBUS_TYPE_BOOLEAN),
+  cdbus_m_opts_set_entry(vsync, DBUS_TYPE_STRING),
+};
+#undef cdbus_m_opts_set_entry
 
-  if (!w) {
-    printf_errf("(): Window %#010x not found.", wid);
-    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADWIN, CDBUS_ERROR_BADWIN_S, wid);
-    return true;
+/**
+ * Check if a lookup table is sorted by name.
+ */
+static bool
+cdbus_table_sorted_real(const void *table, size_t num, size_t size) {
+  for (size_t i = 1; i < num; ++i) {
+    const char *prev = *(const char * const *) ((const char *) table + (i - 1) * size);
+    const char *cur = *(const char * const *) ((const char *) table + i * size);
+    if (strcmp(prev, cur) >= 0) {
+      printf_errf("(): \"%s\" is out of order.", cur);
+      return false;
+    }
   }
 
-#define cdbus_m_win_get_do(tgt, apdarg_func) \
-  if (!strcmp(MSTR(tgt), target)) { \
-    apdarg_func(ps, msg, w->tgt); \
-    return true; \
+  return true;
+}
+
+#define cdbus_table_sorted(table) \
+  cdbus_table_sorted_real((table), sizeof(table) / sizeof((table)[0]), \
+      sizeof((table)[0]))
+
+/**
+ * Check if all lookup tables are sorted by name.
+ */
+static bool
+cdbus_tables_sorted(void) {
+  return cdbus_table_sorted(CDBUS_METHODS)
+    && cdbus_table_sorted(CDBUS_WATTRS)
+    && cdbus_table_sorted(CDBUS_WSETTERS)
+    && cdbus_table_sorted(CDBUS_OPTS_GET)
+    && cdbus_table_sorted(CDBUS_OPTS_SET);
+}
+
+#undef cdbus_table_sorted
+///@}
+
+/** @name Message processing
+ */
+///@{
+
+/**
+ * Process a message from D-Bus.
+ */
+static void
+cdbus_process(session_t *ps, DBusMessage *msg) {
+  bool success = false;
+  const cdbus_method_t *pmethod = NULL;
+
+  // Look up methods of our interface by name
+  if (DBUS_MESSAGE_TYPE_METHOD_CALL == dbus_message_get_type(msg)) {
+    const char *interface = dbus_message_get_interface(msg);
+    const char *member = dbus_message_get_member(msg);
+    if (interface && member && !strcmp(CDBUS_INTERFACE_NAME, interface))
+      pmethod = cdbus_table_find(CDBUS_METHODS, member);
   }
 
-  cdbus_m_win_get_do(id, cdbus_reply_wid);
+  if (pmethod) {
+    success = pmethod->func(ps, msg);
+  }
+  else if (dbus_message_is_method_call(msg,
+        "org.freedesktop.DBus.Introspectable", "Introspect")) {
+    success = cdbus_process_introspect(ps, msg);
+  }
+  else if (dbus_message_is_method_call(msg,
+        "org.freedesktop.DBus.Peer", "Ping")) {
+    cdbus_reply(ps, msg, NULL, NULL);
+    success = true;
+  }
+  else if (dbus_message_is_method_call(msg,
+        "org.freedesktop.DBus.Peer", "GetMachineId")) {
+    char *uuid = dbus_get_local_machine_id();
+    if (uuid) {
+      cdbus_reply_string(ps, msg, uuid);
+      dbus_free(uuid);
+      success = true;
+    }
+  }
+  else if (dbus_message_is_signal(msg, "org.freedesktop.DBus", "NameAcquired")
+      || dbus_message_is_signal(msg, "org.freedesktop.DBus", "NameLost")) {
+    success = true;
+  }
+  else if (dbus_message_is_signal(msg, "org.freedesktop.DBus",
+        "NameOwnerChanged")) {
+    success = cdbus_process_name_owner_changed(ps, msg);
+  }
+  else {
+    if (DBUS_MESSAGE_TYPE_ERROR == dbus_message_get_type(msg)) {
+      printf_errf("(): Error message of path \"%s\" "
+          "interface \"%s\", member \"%s\", error \"%s\"",
+          dbus_message_get_path(msg), dbus_message_get_interface(msg),
+          dbus_message_get_member(msg), dbus_message_get_error_name(msg));
+    }
+    else {
+      printf_errf("(): Illegal message of type \"%s\", path \"%s\" "
+          "interface \"%s\", member \"%s\"",
+          cdbus_repr_msgtype(msg), dbus_message_get_path(msg),
+          dbus_message_get_interface(msg), dbus_message_get_member(msg));
+    }
+    if (DBUS_MESSAGE_TYPE_METHOD_CALL == dbus_message_get_type(msg)
+        && !dbus_message_get_no_reply(msg))
+      cdbus_reply_err(ps, msg, CDBUS_ERROR_BADMSG, CDBUS_ERROR_BADMSG_S);
+    success = true;
+  }
+
+  // If the message could not be processed, and an reply is expected, return
+  // an empty reply.
+  if (!success && DBUS_MESSAGE_TYPE_METHOD_CALL == dbus_message_get_type(msg)
+      && !dbus_message_get_no_reply(msg))
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_UNKNOWN, CDBUS_ERROR_UNKNOWN_S);
+
+  // Free the message
+  dbus_message_unref(msg);
+}
+
+/**
+ * Process a reset D-Bus request.
+ */
+static bool
+cdbus_process_reset(session_t *ps, DBusMessage *msg) {
+  ps->reset = true;
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, true);
 
-  // next
-  if (!strcmp("next", target)) {
-    cdbus_reply_wid(ps, msg, (w->next ? w->next->id: 0));
+  return true;
+}
+
+/**
+ * Process a repaint D-Bus request.
+ */
+static bool
+cdbus_process_repaint(session_t *ps, DBusMessage *msg) {
+  force_repaint(ps);
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, true);
+
+  return true;
+}
+
+/**
+ * Process a capture_start D-Bus request.
+ *
+ * Replies with a file descriptor of the shared memory ring painted
+ * frames are captured into. All clients share the same ring, so the slot
+ * count only matters to the first one.
+ */
+static bool
+cdbus_process_capture_start(session_t *ps, DBusMessage *msg) {
+  dbus_uint32_t nslots = 0;
+  if (!cdbus_msg_get_arg(msg, 0, DBUS_TYPE_UINT32, &nslots))
+    return false;
+
+  if (nslots && (nslots < CAPTURE_SLOTS_MIN || nslots > CAPTURE_SLOTS_MAX)) {
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADARG, CDBUS_ERROR_BADARG_S, 0,
+        "Slot count out of range.");
     return true;
   }
 
-  // map_state
-  if (!strcmp("map_state", target)) {
-    cdbus_reply_bool(ps, msg, w->a.map_state);
+  if (!capture_start(ps, nslots)) {
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_CUSTOM, CDBUS_ERROR_CUSTOM_S,
+        "Failed to start capturing frames.");
     return true;
   }
 
-  cdbus_m_win_get_do(mode, cdbus_reply_enum);
-  cdbus_m_win_get_do(client_win, cdbus_reply_wid);
-  cdbus_m_win_get_do(damaged, cdbus_reply_bool);
-  cdbus_m_win_get_do(destroyed, cdbus_reply_bool);
-  cdbus_m_win_get_do(window_type, cdbus_reply_enum);
-  cdbus_m_win_get_do(wmwin, cdbus_reply_bool);
-  cdbus_m_win_get_do(leader, cdbus_reply_wid);
-  // focused_real
-  if (!strcmp("focused_real", target)) {
-    cdbus_reply_bool(ps, msg, win_is_focused_real(ps, w));
-    return true;
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_fd(ps, msg, ps->capture->fd);
+
+  return true;
+}
+
+/**
+ * Process a capture_stop D-Bus request.
+ */
+static bool
+cdbus_process_capture_stop(session_t *ps, DBusMessage *msg) {
+  capture_stop(ps);
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, true);
+
+  return true;
+}
+
+/**
+ * Free a transaction.
+ */
+static void
+cdbus_txn_free(cdbus_txn_t *txn) {
+  if (!txn)
+    return;
+
+  for (int i = 0; i < txn->nops; ++i) {
+    const cdbus_txn_op_t *op = &txn->ops[i];
+    if (DBUS_TYPE_STRING == (op->popt ? op->popt->type: op->pwin->type))
+      free((char *) op->val.v.s);
+  }
+  free(txn->ops);
+  free(txn->owner);
+  free(txn);
+}
+
+/**
+ * Queue a change in a transaction.
+ *
+ * A later change to the same target replaces the earlier one.
+ */
+static bool
+cdbus_txn_add(cdbus_txn_t *txn, const cdbus_opt_setter_t *popt,
+    const cdbus_wsetter_t *pwin, Window wid, const cdbus_val_t *pval) {
+  const cdbus_vtype_t type = (popt ? popt->type: pwin->type);
+  cdbus_txn_op_t *op = NULL;
+
+  for (int i = 0; i < txn->nops; ++i)
+    if (txn->ops[i].popt == popt && txn->ops[i].pwin == pwin
+        && txn->ops[i].wid == wid) {
+      op = &txn->ops[i];
+      if (DBUS_TYPE_STRING == type)
+        free((char *) op->val.v.s);
+      break;
+    }
+
+  if (!op) {
+    if (txn->nops == txn->capacity) {
+      const int capacity = (txn->capacity ? txn->capacity * 2: 8);
+      cdbus_txn_op_t *ops = realloc(txn->ops, sizeof(cdbus_txn_op_t) * capacity);
+      if (!ops) {
+        printf_errf("(): Failed to allocate memory for transaction.");
+        return false;
+      }
+      txn->ops = ops;
+      txn->capacity = capacity;
+    }
+    op = &txn->ops[txn->nops++];
+    op->popt = popt;
+    op->pwin = pwin;
+    op->wid = wid;
   }
-  cdbus_m_win_get_do(fade_force, cdbus_reply_enum);
-  cdbus_m_win_get_do(shadow_force, cdbus_reply_enum);
-  cdbus_m_win_get_do(focused_force, cdbus_reply_enum);
-  cdbus_m_win_get_do(invert_color_force, cdbus_reply_enum);
-  cdbus_m_win_get_do(name, cdbus_reply_string);
-  cdbus_m_win_get_do(class_instance, cdbus_reply_string);
-  cdbus_m_win_get_do(class_general, cdbus_reply_string);
-  cdbus_m_win_get_do(role, cdbus_reply_string);
-
-  cdbus_m_win_get_do(opacity, cdbus_reply_uint32);
-  cdbus_m_win_get_do(opacity_tgt, cdbus_reply_uint32);
-  cdbus_m_win_get_do(opacity_prop, cdbus_reply_uint32);
-  cdbus_m_win_get_do(opacity_prop_client, cdbus_reply_uint32);
-  cdbus_m_win_get_do(opacity_set, cdbus_reply_uint32);
-
-  cdbus_m_win_get_do(frame_opacity, cdbus_reply_double);
-  if (!strcmp("left_width", target)) {
-    cdbus_reply_uint32(ps, msg, w->frame_extents.left);
-    return true;
+
+  op->val = *pval;
+  if (DBUS_TYPE_STRING == type)
+    op->val.v.s = mstrcpy(pval->v.s);
+
+  return true;
+}
+
+/**
+ * Process a begin D-Bus request.
+ *
+ * Following opts_set and win_set requests from the same client are
+ * queued until commit. Only one transaction can be open at a time.
+ * Beginning again drops the client's open transaction, while other
+ * clients get an error until it's committed, rolled back, or the client
+ * leaves the bus.
+ */
+static bool
+cdbus_process_begin(session_t *ps, DBusMessage *msg) {
+  if (ps->dbus_txn) {
+    if (strcmp(((cdbus_txn_t *) ps->dbus_txn)->owner,
+          cdbus_msg_sender(msg))) {
+      printf_errf("(): " CDBUS_ERROR_CUSTOM_S,
+          "Another client has a transaction open.");
+      cdbus_reply_err(ps, msg, CDBUS_ERROR_CUSTOM, CDBUS_ERROR_CUSTOM_S,
+          "Another client has a transaction open.");
+      return true;
+    }
+    printf_errf("(): Dropping the open transaction of \"%s\".",
+        ((cdbus_txn_t *) ps->dbus_txn)->owner);
+    cdbus_txn_free(ps->dbus_txn);
+    ps->dbus_txn = NULL;
+  }
+
+  cdbus_txn_t *txn = calloc(1, sizeof(cdbus_txn_t));
+  if (!txn || !(txn->owner = mstrcpy(cdbus_msg_sender(msg)))) {
+    printf_errf("(): Failed to allocate memory for transaction.");
+    free(txn);
+    return false;
   }
-  if (!strcmp("right_width", target)) {
-    cdbus_reply_uint32(ps, msg, w->frame_extents.right);
+  ps->dbus_txn = txn;
+
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, true);
+
+  return true;
+}
+
+/**
+ * Process a commit D-Bus request.
+ *
+ * Applies the queued changes in order, recomputes the affected window
+ * states in one pass, and repaints at most once. Applying stops at the
+ * first change that fails, which is replied as an error. Changes to
+ * windows that are gone are skipped.
+ */
+static bool
+cdbus_process_commit(session_t *ps, DBusMessage *msg) {
+  cdbus_txn_t *txn = cdbus_txn_get(ps, msg);
+  if (!txn) {
+    printf_errf("(): " CDBUS_ERROR_CUSTOM_S, "No transaction to commit.");
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_CUSTOM, CDBUS_ERROR_CUSTOM_S,
+        "No transaction to commit.");
     return true;
   }
-  if (!strcmp("top_width", target)) {
-    cdbus_reply_uint32(ps, msg, w->frame_extents.top);
+
+  bool success = true;
+  ps->dbus_batch = true;
+  for (int i = 0; success && i < txn->nops; ++i) {
+    const cdbus_txn_op_t *op = &txn->ops[i];
+    if (op->popt) {
+      success = op->popt->set(ps, msg, &op->val);
+    }
+    else {
+      win *w = find_win(ps, op->wid);
+      if (w)
+        op->pwin->set(ps, w, &op->val);
+      else
+        printf_errf("(): Window %#010lx is gone, skipping \"%s\".",
+            op->wid, op->pwin->name);
+    }
+  }
+  ps->dbus_batch = false;
+
+  win_batch_redetermine(ps);
+  if (txn->repaint)
+    force_repaint(ps);
+
+  cdbus_txn_free(txn);
+  ps->dbus_txn = NULL;
+
+  if (success && !dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, true);
+
+  return true;
+}
+
+/**
+ * Process a rollback D-Bus request, dropping the queued changes.
+ */
+static bool
+cdbus_process_rollback(session_t *ps, DBusMessage *msg) {
+  cdbus_txn_t *txn = cdbus_txn_get(ps, msg);
+  if (!txn) {
+    printf_errf("(): " CDBUS_ERROR_CUSTOM_S, "No transaction to roll back.");
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_CUSTOM, CDBUS_ERROR_CUSTOM_S,
+        "No transaction to roll back.");
     return true;
   }
-  if (!strcmp("bottom_width", target)) {
-    cdbus_reply_uint32(ps, msg, w->frame_extents.bottom);
+
+  cdbus_txn_free(txn);
+  ps->dbus_txn = NULL;
+
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, true);
+
+  return true;
+}
+
+/**
+ * Process a list_win D-Bus request.
+ */
+static bool
+cdbus_process_list_win(session_t *ps, DBusMessage *msg) {
+  cdbus_reply(ps, msg, cdbus_apdarg_wids, NULL);
+
+  return true;
+}
+
+/**
+ * Process a win_get D-Bus request.
+ */
+static bool
+cdbus_process_win_get(session_t *ps, DBusMessage *msg) {
+  cdbus_window_t wid = None;
+  const char *target = NULL;
+  DBusError err = { };
+
+  if (!dbus_message_get_args(msg, &err,
+        CDBUS_TYPE_WINDOW, &wid,
+        DBUS_TYPE_STRING, &target,
+        DBUS_TYPE_INVALID)) {
+    printf_errf("(): Failed to parse argument of \"win_get\" (%s).",
+        err.message);
+    dbus_error_free(&err);
+    return false;
+  }
+
+  win *w = find_win(ps, wid);
+
+  if (!w) {
+    printf_errf("(): Window %#010x not found.", wid);
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADWIN, CDBUS_ERROR_BADWIN_S, wid);
     return true;
   }
 
-  cdbus_m_win_get_do(shadow, cdbus_reply_bool);
-  cdbus_m_win_get_do(fade, cdbus_reply_bool);
-  cdbus_m_win_get_do(invert_color, cdbus_reply_bool);
-  cdbus_m_win_get_do(blur_background, cdbus_reply_bool);
-#undef cdbus_m_win_get_do
+  const int attr = cdbus_wattr_find(target);
+  if (attr < 0) {
+    printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
+    return true;
+  }
 
-  printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
-  cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
+  cdbus_val_t val = { .valid = false };
+  cdbus_wattr_get(ps, w, attr, &val);
+  cdbus_reply_val(ps, msg, CDBUS_WATTRS[attr].type, &val);
 
   return true;
 }
@@ -779,56 +1779,180 @@ cdbus_process_win_set(session_t *ps, DBusMessage *msg) {
     return true;
   }
 
-#define cdbus_m_win_set_do(tgt, type, real_type) \
-  if (!strcmp(MSTR(tgt), target)) { \
-    real_type val; \
-    if (!cdbus_msg_get_arg(msg, 2, type, &val)) \
-      return false; \
-    w->tgt = val; \
-    goto cdbus_process_win_set_success; \
+  const cdbus_wsetter_t *psetter = cdbus_table_find(CDBUS_WSETTERS, target);
+  if (!psetter) {
+    printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
+    return true;
   }
 
-  if (!strcmp("shadow_force", target)) {
-    cdbus_enum_t val = UNSET;
-    if (!cdbus_msg_get_arg(msg, 2, CDBUS_TYPE_ENUM, &val))
-      return false;
-    win_set_shadow_force(ps, w, val);
-    goto cdbus_process_win_set_success;
-  }
+  cdbus_val_t val = { .valid = false };
+  if (!cdbus_msg_get_val(msg, 2, psetter->type, &val))
+    return false;
 
-  if (!strcmp("fade_force", target)) {
-    cdbus_enum_t val = UNSET;
-    if (!cdbus_msg_get_arg(msg, 2, CDBUS_TYPE_ENUM, &val))
+  cdbus_txn_t *txn = cdbus_txn_get(ps, msg);
+  if (txn) {
+    if (!cdbus_txn_add(txn, NULL, psetter, w->id, &val))
       return false;
-    win_set_fade_force(ps, w, val);
-    goto cdbus_process_win_set_success;
   }
+  else
+    psetter->set(ps, w, &val);
 
-  if (!strcmp("focused_force", target)) {
-    cdbus_enum_t val = UNSET;
-    if (!cdbus_msg_get_arg(msg, 2, CDBUS_TYPE_ENUM, &val))
-      return false;
-    win_set_focused_force(ps, w, val);
-    goto cdbus_process_win_set_success;
+  if (!dbus_message_get_no_reply(msg))
+    cdbus_reply_bool(ps, msg, true);
+  return true;
+}
+
+/**
+ * Process a win_snapshot D-Bus request.
+ *
+ * Takes an array of attribute names and an array of window IDs, and
+ * replies with a (window ID, attribute names, attribute values) struct for
+ * each window. An empty window ID array selects all windows that are not
+ * destroyed. Windows that are not found are skipped.
+ */
+static bool
+cdbus_process_win_snapshot(session_t *ps, DBusMessage *msg) {
+  char **targets = NULL;
+  int ntargets = 0;
+  cdbus_window_t *wids = NULL;
+  int nwids = 0;
+  DBusError err = { };
+
+  if (!dbus_message_get_args(msg, &err,
+        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &targets, &ntargets,
+        DBUS_TYPE_ARRAY, CDBUS_TYPE_WINDOW, &wids, &nwids,
+        DBUS_TYPE_INVALID)) {
+    printf_errf("(): Failed to parse argument of \"win_snapshot\" (%s).",
+        err.message);
+    dbus_error_free(&err);
+    return false;
   }
 
-  if (!strcmp("invert_color_force", target)) {
-    cdbus_enum_t val = UNSET;
-    if (!cdbus_msg_get_arg(msg, 2, CDBUS_TYPE_ENUM, &val))
-      return false;
-    win_set_invert_color_force(ps, w, val);
-    goto cdbus_process_win_set_success;
+  cdbus_wattr_t attrs[NUM_CDBUS_WATTRS];
+  if (ntargets > NUM_CDBUS_WATTRS) {
+    printf_errf("(): " CDBUS_ERROR_BADARG_S, 0, "Too many attributes.");
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADARG, CDBUS_ERROR_BADARG_S, 0,
+        "Too many attributes.");
   }
-#undef cdbus_m_win_set_do
+  else if (cdbus_wattr_parse(ps, msg, targets, ntargets, attrs)) {
+    const cdbus_snapshot_req_t req = {
+      .attrs = attrs,
+      .nattrs = ntargets,
+      .wids = wids,
+      .nwids = nwids,
+    };
+    cdbus_reply(ps, msg, cdbus_apdarg_win_snapshot, &req);
+  }
+
+  dbus_free_string_array(targets);
+
+  return true;
+}
+
+/**
+ * Stop sending <code>win_diff</code> signals and drop the stored window
+ * states.
+ */
+static void
+cdbus_unwatch(session_t *ps) {
+  ps->dbus_diff_attrs = 0;
+  free(ps->dbus_diff_owner);
+  ps->dbus_diff_owner = NULL;
+  for (win *w = ps->list; w; w = w->next)
+    cdbus_free_win_state(w);
+}
+
+/**
+ * Process a NameOwnerChanged signal from the bus, dropping the state of
+ * a client that left.
+ */
+static bool
+cdbus_process_name_owner_changed(session_t *ps, DBusMessage *msg) {
+  const char *name = NULL, *old_owner = NULL, *new_owner = NULL;
+
+  if (!dbus_message_get_args(msg, NULL,
+        DBUS_TYPE_STRING, &name,
+        DBUS_TYPE_STRING, &old_owner,
+        DBUS_TYPE_STRING, &new_owner,
+        DBUS_TYPE_INVALID))
+    return false;
 
-  printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
-  cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
+  // A client is gone when its unique name loses its owner
+  if (*new_owner)
+    return true;
+
+  if (ps->dbus_diff_owner && !strcmp(ps->dbus_diff_owner, name))
+    cdbus_unwatch(ps);
+
+  if (ps->dbus_txn && !strcmp(((cdbus_txn_t *) ps->dbus_txn)->owner, name)) {
+    cdbus_txn_free(ps->dbus_txn);
+    ps->dbus_txn = NULL;
+  }
 
   return true;
+}
+
+/**
+ * Process a win_watch D-Bus request.
+ *
+ * Takes an array of attribute names to send <code>win_diff</code> signals
+ * for, replacing the previous set. An empty array stops the signals. The
+ * first signal after the call carries the full state of all windows.
+ *
+ * Only one client can watch at a time. The watch is dropped when it
+ * leaves the bus.
+ */
+static bool
+cdbus_process_win_watch(session_t *ps, DBusMessage *msg) {
+  char **targets = NULL;
+  int ntargets = 0;
+  DBusError err = { };
+
+  if (!dbus_message_get_args(msg, &err,
+        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &targets, &ntargets,
+        DBUS_TYPE_INVALID)) {
+    printf_errf("(): Failed to parse argument of \"win_watch\" (%s).",
+        err.message);
+    dbus_error_free(&err);
+    return false;
+  }
+
+  const char *sender = cdbus_msg_sender(msg);
+  if (ps->dbus_diff_owner && strcmp(ps->dbus_diff_owner, sender)) {
+    printf_errf("(): " CDBUS_ERROR_CUSTOM_S,
+        "Windows are watched by another client.");
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_CUSTOM, CDBUS_ERROR_CUSTOM_S,
+        "Windows are watched by another client.");
+    dbus_free_string_array(targets);
+    return true;
+  }
+
+  uint64_t mask = 0;
+  for (int i = 0; i < ntargets; ++i) {
+    int idx = cdbus_wattr_find(targets[i]);
+    if (idx < 0) {
+      printf_errf("(): " CDBUS_ERROR_BADTGT_S, targets[i]);
+      cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S,
+          targets[i]);
+      dbus_free_string_array(targets);
+      return true;
+    }
+    mask |= (uint64_t) 1 << idx;
+  }
+  dbus_free_string_array(targets);
+
+  // Drop the stored state so the next signal is a full one
+  cdbus_unwatch(ps);
+  if (mask) {
+    ps->dbus_diff_attrs = mask;
+    ps->dbus_diff_owner = mstrcpy(sender);
+  }
+  ps->ev_received = true;
 
-cdbus_process_win_set_success:
   if (!dbus_message_get_no_reply(msg))
     cdbus_reply_bool(ps, msg, true);
+
   return true;
 }
 
@@ -881,106 +2005,16 @@ cdbus_process_opts_get(session_t *ps, DBusMessage *msg) {
   if (!cdbus_msg_get_arg(msg, 0, DBUS_TYPE_STRING, &target))
     return false;
 
-#define cdbus_m_opts_get_do(tgt, apdarg_func) \
-  if (!strcmp(MSTR(tgt), target)) { \
-    apdarg_func(ps, msg, ps->o.tgt); \
-    return true; \
-  }
-
-  // version
-  if (!strcmp("version", target)) {
-    cdbus_reply_string(ps, msg, COMPTON_VERSION);
-    return true;
-  }
-
-  // pid
-  if (!strcmp("pid", target)) {
-    cdbus_reply_int32(ps, msg, getpid());
-    return true;
-  }
-
-  // display
-  if (!strcmp("display", target)) {
-    cdbus_reply_string(ps, msg, DisplayString(ps->dpy));
-    return true;
-  }
-
-  cdbus_m_opts_get_do(config_file, cdbus_reply_string);
-  cdbus_m_opts_get_do(display_repr, cdbus_reply_string);
-  cdbus_m_opts_get_do(write_pid_path, cdbus_reply_string);
-  cdbus_m_opts_get_do(mark_wmwin_focused, cdbus_reply_bool);
-  cdbus_m_opts_get_do(mark_ovredir_focused, cdbus_reply_bool);
-  cdbus_m_opts_get_do(fork_after_register, cdbus_reply_bool);
-  cdbus_m_opts_get_do(detect_rounded_corners, cdbus_reply_bool);
-  cdbus_m_opts_get_do(paint_on_overlay, cdbus_reply_bool);
-  // paint_on_overlay_id: Get ID of the X composite overlay window
-  if (!strcmp("paint_on_overlay_id", target)) {
-    cdbus_reply_uint32(ps, msg, ps->overlay);
-    return true;
-  }
-  cdbus_m_opts_get_do(unredir_if_possible, cdbus_reply_bool);
-  cdbus_m_opts_get_do(unredir_if_possible_delay, cdbus_reply_int32);
-  cdbus_m_opts_get_do(redirected_force, cdbus_reply_enum);
-  cdbus_m_opts_get_do(stoppaint_force, cdbus_reply_enum);
-  cdbus_m_opts_get_do(logpath, cdbus_reply_string);
-  cdbus_m_opts_get_do(synchronize, cdbus_reply_bool);
-
-  cdbus_m_opts_get_do(refresh_rate, cdbus_reply_int32);
-  cdbus_m_opts_get_do(sw_opti, cdbus_reply_bool);
-  if (!strcmp("vsync", target)) {
-    assert(ps->o.vsync < sizeof(VSYNC_STRS) / sizeof(VSYNC_STRS[0]));
-    cdbus_reply_string(ps, msg, VSYNC_STRS[ps->o.vsync]);
-    return true;
-  }
-  if (!strcmp("backend", target)) {
-    assert(ps->o.backend < sizeof(BACKEND_STRS) / sizeof(BACKEND_STRS[0]));
-    cdbus_reply_string(ps, msg, BACKEND_STRS[ps->o.backend]);
+  const cdbus_opt_getter_t *pgetter = cdbus_table_find(CDBUS_OPTS_GET, target);
+  if (!pgetter) {
+    printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
     return true;
   }
-  cdbus_m_opts_get_do(dbe, cdbus_reply_bool);
-  cdbus_m_opts_get_do(vsync_aggressive, cdbus_reply_bool);
 
-  cdbus_m_opts_get_do(shadow_red, cdbus_reply_double);
-  cdbus_m_opts_get_do(shadow_green, cdbus_reply_double);
-  cdbus_m_opts_get_do(shadow_blue, cdbus_reply_double);
-  cdbus_m_opts_get_do(shadow_radius, cdbus_reply_int32);
-  cdbus_m_opts_get_do(shadow_offset_x, cdbus_reply_int32);
-  cdbus_m_opts_get_do(shadow_offset_y, cdbus_reply_int32);
-  cdbus_m_opts_get_do(shadow_opacity, cdbus_reply_double);
-  cdbus_m_opts_get_do(clear_shadow, cdbus_reply_bool);
-  cdbus_m_opts_get_do(xinerama_shadow_crop, cdbus_reply_bool);
-
-  cdbus_m_opts_get_do(fade_delta, cdbus_reply_int32);
-  cdbus_m_opts_get_do(fade_in_step, cdbus_reply_int32);
-  cdbus_m_opts_get_do(fade_out_step, cdbus_reply_int32);
-  cdbus_m_opts_get_do(no_fading_openclose, cdbus_reply_bool);
-
-  cdbus_m_opts_get_do(blur_background, cdbus_reply_bool);
-  cdbus_m_opts_get_do(blur_background_frame, cdbus_reply_bool);
-  cdbus_m_opts_get_do(blur_background_fixed, cdbus_reply_bool);
-
-  cdbus_m_opts_get_do(inactive_dim, cdbus_reply_double);
-  cdbus_m_opts_get_do(inactive_dim_fixed, cdbus_reply_bool);
-
-  cdbus_m_opts_get_do(use_ewmh_active_win, cdbus_reply_bool);
-  cdbus_m_opts_get_do(detect_transient, cdbus_reply_bool);
-  cdbus_m_opts_get_do(detect_client_leader, cdbus_reply_bool);
-
-#ifdef CONFIG_VSYNC_OPENGL
-  cdbus_m_opts_get_do(glx_no_stencil, cdbus_reply_bool);
-  cdbus_m_opts_get_do(glx_copy_from_front, cdbus_reply_bool);
-  cdbus_m_opts_get_do(glx_use_copysubbuffermesa, cdbus_reply_bool);
-  cdbus_m_opts_get_do(glx_no_rebind_pixmap, cdbus_reply_bool);
-  cdbus_m_opts_get_do(glx_swap_method, cdbus_reply_int32);
-#endif
-
-  cdbus_m_opts_get_do(track_focus, cdbus_reply_bool);
-  cdbus_m_opts_get_do(track_wdata, cdbus_reply_bool);
-  cdbus_m_opts_get_do(track_leader, cdbus_reply_bool);
-#undef cdbus_m_opts_get_do
-
-  printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
-  cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
+  cdbus_val_t val = { .valid = false };
+  pgetter->get(ps, &val);
+  cdbus_reply_val(ps, msg, pgetter->type, &val);
 
   return true;
 }
@@ -995,127 +2029,25 @@ cdbus_process_opts_set(session_t *ps, DBusMessage *msg) {
   if (!cdbus_msg_get_arg(msg, 0, DBUS_TYPE_STRING, &target))
     return false;
 
-#define cdbus_m_opts_set_do(tgt, type, real_type) \
-  if (!strcmp(MSTR(tgt), target)) { \
-    real_type val; \
-    if (!cdbus_msg_get_arg(msg, 1, type, &val)) \
-      return false; \
-    ps->o.tgt = val; \
-    goto cdbus_process_opts_set_success; \
-  }
-
-  // fade_delta
-  if (!strcmp("fade_delta", target)) {
-    int32_t val = 0.0;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_INT32, &val))
-      return false;
-    ps->o.fade_delta = max_i(val, 1);
-    goto cdbus_process_opts_set_success;
-  }
-
-  // fade_in_step
-  if (!strcmp("fade_in_step", target)) {
-    double val = 0.0;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_DOUBLE, &val))
-      return false;
-    ps->o.fade_in_step = normalize_d(val) * OPAQUE;
-    goto cdbus_process_opts_set_success;
-  }
-
-  // fade_out_step
-  if (!strcmp("fade_out_step", target)) {
-    double val = 0.0;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_DOUBLE, &val))
-      return false;
-    ps->o.fade_out_step = normalize_d(val) * OPAQUE;
-    goto cdbus_process_opts_set_success;
-  }
-
-  // no_fading_openclose
-  if (!strcmp("no_fading_openclose", target)) {
-    dbus_bool_t val = FALSE;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_BOOLEAN, &val))
-      return false;
-    opts_set_no_fading_openclose(ps, val);
-    goto cdbus_process_opts_set_success;
-  }
-
-  // unredir_if_possible
-  if (!strcmp("unredir_if_possible", target)) {
-    dbus_bool_t val = FALSE;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_BOOLEAN, &val))
-      return false;
-    if (ps->o.unredir_if_possible != val) {
-      ps->o.unredir_if_possible = val;
-      ps->ev_received = true;
-    }
-    goto cdbus_process_opts_set_success;
+  const cdbus_opt_setter_t *psetter = cdbus_table_find(CDBUS_OPTS_SET, target);
+  if (!psetter) {
+    printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
+    cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
+    return true;
   }
 
-  // clear_shadow
-  if (!strcmp("clear_shadow", target)) {
-    dbus_bool_t val = FALSE;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_BOOLEAN, &val))
-      return false;
-    if (ps->o.clear_shadow != val) {
-      ps->o.clear_shadow = val;
-      force_repaint(ps);
-    }
-    goto cdbus_process_opts_set_success;
-  }
+  cdbus_val_t val = { .valid = false };
+  if (!cdbus_msg_get_val(msg, 1, psetter->type, &val))
+    return false;
 
-  // track_focus
-  if (!strcmp("track_focus", target)) {
-    dbus_bool_t val = FALSE;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_BOOLEAN, &val))
+  cdbus_txn_t *txn = cdbus_txn_get(ps, msg);
+  if (txn) {
+    if (!cdbus_txn_add(txn, psetter, NULL, None, &val))
       return false;
-    // You could enable this option, but never turn if off
-    if (val) {
-      opts_init_track_focus(ps);
-    }
-    goto cdbus_process_opts_set_success;
   }
-
-  // vsync
-  if (!strcmp("vsync", target)) {
-    const char * val = NULL;
-    if (!cdbus_msg_get_arg(msg, 1, DBUS_TYPE_STRING, &val))
-      return false;
-    vsync_deinit(ps);
-    if (!parse_vsync(ps, val)) {
-      printf_errf("(): " CDBUS_ERROR_BADARG_S, 1, "Value invalid.");
-      cdbus_reply_err(ps, msg, CDBUS_ERROR_BADARG, CDBUS_ERROR_BADARG_S, 1, "Value invalid.");
-    }
-    else if (!vsync_init(ps)) {
-      printf_errf("(): " CDBUS_ERROR_CUSTOM_S, "Failed to initialize specified VSync method.");
-      cdbus_reply_err(ps, msg, CDBUS_ERROR_CUSTOM, CDBUS_ERROR_CUSTOM_S, "Failed to initialize specified VSync method.");
-    }
-    else
-      goto cdbus_process_opts_set_success;
+  else if (!psetter->set(ps, msg, &val))
     return true;
-  }
-
-  // redirected_force
-  if (!strcmp("redirected_force", target)) {
-    cdbus_enum_t val = UNSET;
-    if (!cdbus_msg_get_arg(msg, 1, CDBUS_TYPE_ENUM, &val))
-      return false;
-    ps->o.redirected_force = val;
-    force_repaint(ps);
-    goto cdbus_process_opts_set_success;
-  }
-
-  // stoppaint_force
-  cdbus_m_opts_set_do(stoppaint_force, CDBUS_TYPE_ENUM, cdbus_enum_t);
-
-#undef cdbus_m_opts_set_do
 
-  printf_errf("(): " CDBUS_ERROR_BADTGT_S, target);
-  cdbus_reply_err(ps, msg, CDBUS_ERROR_BADTGT, CDBUS_ERROR_BADTGT_S, target);
-
-  return true;
-
-cdbus_process_opts_set_success:
   if (!dbus_message_get_no_reply(msg))
     cdbus_reply_bool(ps, msg, true);
   return true;
@@ -1160,6 +2092,34 @@ cdbus_process_introspect(session_t *ps, DBusMessage *msg) {
     "    <signal name='win_focusout'>\n"
     "      <arg name='wid' type='" CDBUS_TYPE_WINDOW_STR "'/>\n"
     "    </signal>\n"
+    "    <signal name='win_diff'>\n"
+    "      <arg name='wins' type='a(" CDBUS_TYPE_WINDOW_STR "asav)'/>\n"
+    "    </signal>\n"
+    "    <method name='win_snapshot'>\n"
+    "      <arg name='attrs' direction='in' type='as'/>\n"
+    "      <arg name='wids' direction='in' type='a" CDBUS_TYPE_WINDOW_STR "'/>\n"
+    "      <arg name='wins' direction='out' type='a(" CDBUS_TYPE_WINDOW_STR "asav)'/>\n"
+    "    </method>\n"
+    "    <method name='win_watch'>\n"
+    "      <arg name='attrs' direction='in' type='as'/>\n"
+    "      <arg name='success' direction='out' type='b'/>\n"
+    "    </method>\n"
+    "    <method name='begin'>\n"
+    "      <arg name='success' direction='out' type='b'/>\n"
+    "    </method>\n"
+    "    <method name='commit'>\n"
+    "      <arg name='success' direction='out' type='b'/>\n"
+    "    </method>\n"
+    "    <method name='rollback'>\n"
+    "      <arg name='success' direction='out' type='b'/>\n"
+    "    </method>\n"
+    "    <method name='capture_start'>\n"
+    "      <arg name='nslots' direction='in' type='u'/>\n"
+    "      <arg name='ring' direction='out' type='h'/>\n"
+    "    </method>\n"
+    "    <method name='capture_stop'>\n"
+    "      <arg name='success' direction='out' type='b'/>\n"
+    "    </method>\n"
     "    <method name='reset' />\n"
     "    <method name='repaint' />\n"
     "  </interface>\n"
@@ -1209,4 +2169,16 @@ cdbus_ev_win_focusin(session_t *ps, win *w) {
   if (ps->dbus_conn)
     cdbus_signal_wid(ps, "win_focusin", w->id);
 }
+
+void
+cdbus_ev_win_diff(session_t *ps) {
+  if (!ps->dbus_conn || !ps->dbus_diff_attrs)
+    return;
+
+  // Changes not sent are found again next time
+  cdbus_diff_t diff = { .wins = NULL, .nwins = 0, .capacity = 0 };
+  if (cdbus_signal(ps, "win_diff", cdbus_apdarg_win_diff, &diff))
+    cdbus_diff_store(&diff);
+  free(diff.wins);
+}
 //!@}
@@ -42,6 +42,209 @@ typedef uint16_t cdbus_enum_t;
 #define CDBUS_TYPE_ENUM         DBUS_TYPE_UINT16
 #define CDBUS_TYPE_ENUM_STR     DBUS_TYPE_UINT16_AS_STRING
 
+/// Window attributes, in the order of their names.
+///
+/// The enum doubles as the index into <code>CDBUS_WATTRS</code>, which is
+/// binary searched by name, so new attributes must be inserted in
+/// alphabetical order here too.
+typedef enum {
+  CDBUS_WATTR_BLUR_BACKGROUND,
+  CDBUS_WATTR_BOTTOM_WIDTH,
+  CDBUS_WATTR_CLASS_GENERAL,
+  CDBUS_WATTR_CLASS_INSTANCE,
+  CDBUS_WATTR_CLIENT_WIN,
+  CDBUS_WATTR_DAMAGED,
+  CDBUS_WATTR_DESTROYED,
+  CDBUS_WATTR_FADE,
+  CDBUS_WATTR_FADE_FORCE,
+  CDBUS_WATTR_FOCUSED_FORCE,
+  CDBUS_WATTR_FOCUSED_REAL,
+  CDBUS_WATTR_FRAME_OPACITY,
+  CDBUS_WATTR_ID,
+  CDBUS_WATTR_INVERT_COLOR,
+  CDBUS_WATTR_INVERT_COLOR_FORCE,
+  CDBUS_WATTR_LEADER,
+  CDBUS_WATTR_LEFT_WIDTH,
+  CDBUS_WATTR_MAP_STATE,
+  CDBUS_WATTR_MODE,
+  CDBUS_WATTR_NAME,
+  CDBUS_WATTR_NEXT,
+  CDBUS_WATTR_OPACITY,
+  CDBUS_WATTR_OPACITY_PROP,
+  CDBUS_WATTR_OPACITY_PROP_CLIENT,
+  CDBUS_WATTR_OPACITY_SET,
+  CDBUS_WATTR_OPACITY_TGT,
+  CDBUS_WATTR_RIGHT_WIDTH,
+  CDBUS_WATTR_ROLE,
+  CDBUS_WATTR_SHADOW,
+  CDBUS_WATTR_SHADOW_FORCE,
+  CDBUS_WATTR_TOP_WIDTH,
+  CDBUS_WATTR_WINDOW_TYPE,
+  CDBUS_WATTR_WMWIN,
+  NUM_CDBUS_WATTRS,
+} cdbus_wattr_t;
+
+/// D-Bus type of a window attribute value, as a type code.
+typedef int cdbus_vtype_t;
+
+/// A value of a window attribute or an option.
+typedef struct {
+  /// Whether the value is filled.
+  bool valid;
+  union {
+    dbus_bool_t b;
+    int32_t i;
+    /// Also used for window IDs.
+    uint32_t u;
+    /// Counters that may outgrow 32 bits.
+    uint64_t t;
+    double d;
+    cdbus_enum_t e;
+    /// Owned copy when stored in a window state, borrowed otherwise.
+    const char *s;
+  } v;
+} cdbus_val_t;
+
+/// Description of a window attribute.
+typedef struct {
+  const char *name;
+  cdbus_vtype_t type;
+} cdbus_wattr_info_t;
+
+/// Arguments of a <code>win_snapshot</code> request.
+typedef struct {
+  const cdbus_wattr_t *attrs;
+  int nattrs;
+  const cdbus_window_t *wids;
+  int nwids;
+} cdbus_snapshot_req_t;
+
+/// Changed attributes of a window in a <code>win_diff</code> signal.
+typedef struct {
+  win *w;
+  cdbus_wattr_t attrs[NUM_CDBUS_WATTRS];
+  int nattrs;
+  /// New values, indexed by attribute. Strings are borrowed.
+  cdbus_val_t vals[NUM_CDBUS_WATTRS];
+} cdbus_win_diff_t;
+
+/// Changes in a <code>win_diff</code> signal being built, stored as the
+/// last sent window states only once the signal is queued.
+typedef struct {
+  cdbus_win_diff_t *wins;
+  int nwins;
+  int capacity;
+} cdbus_diff_t;
+
+/// A value with its type, to append to a message.
+typedef struct {
+  cdbus_vtype_t type;
+  const cdbus_val_t *pval;
+} cdbus_tval_t;
+
+/// A method of the compton D-Bus interface.
+typedef struct {
+  const char *name;
+  bool (*func)(session_t *ps, DBusMessage *msg);
+} cdbus_method_t;
+
+/// A window attribute settable with <code>win_set</code>.
+typedef struct {
+  const char *name;
+  cdbus_vtype_t type;
+  void (*set)(session_t *ps, win *w, const cdbus_val_t *pval);
+} cdbus_wsetter_t;
+
+/// An option readable with <code>opts_get</code>.
+typedef struct {
+  const char *name;
+  cdbus_vtype_t type;
+  void (*get)(session_t *ps, cdbus_val_t *pval);
+} cdbus_opt_getter_t;
+
+/// An option settable with <code>opts_set</code>.
+typedef struct {
+  const char *name;
+  cdbus_vtype_t type;
+  /// Returns false if an error reply is sent instead.
+  bool (*set)(session_t *ps, DBusMessage *msg, const cdbus_val_t *pval);
+} cdbus_opt_setter_t;
+
+/// A change queued in a D-Bus transaction.
+typedef struct {
+  /// Setter of the option to change, NULL for a window attribute.
+  const cdbus_opt_setter_t *popt;
+  /// Setter of the window attribute to change, NULL for an option.
+  const cdbus_wsetter_t *pwin;
+  /// Window to change.
+  Window wid;
+  /// New value. Strings are owned.
+  cdbus_val_t val;
+} cdbus_txn_op_t;
+
+/// Changes collected between <code>begin</code> and <code>commit</code>.
+typedef struct {
+  /// Unique bus name of the client that began the transaction.
+  char *owner;
+  cdbus_txn_op_t *ops;
+  int nops;
+  int capacity;
+  /// Whether a full repaint is requested while applying the changes.
+  bool repaint;
+} cdbus_txn_t;
+
+/**
+ * Compare a name with the name of a table entry, for bsearch().
+ *
+ * All lookup tables have the name as their first member.
+ */
+static inline int
+cdbus_cmp_name(const void *key, const void *entry) {
+  return strcmp(key, *(const char * const *) entry);
+}
+
+/// Find an entry by name in a lookup table sorted by name.
+#define cdbus_table_find(table, name) \
+  bsearch((name), (table), sizeof(table) / sizeof((table)[0]), \
+      sizeof((table)[0]), cdbus_cmp_name)
+
+/// Names and types of window attributes, sorted by name for bsearch().
+static const cdbus_wattr_info_t CDBUS_WATTRS[NUM_CDBUS_WATTRS] = {
+  [CDBUS_WATTR_BLUR_BACKGROUND]     = { "blur_background", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_BOTTOM_WIDTH]        = { "bottom_width", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_CLASS_GENERAL]       = { "class_general", DBUS_TYPE_STRING },
+  [CDBUS_WATTR_CLASS_INSTANCE]      = { "class_instance", DBUS_TYPE_STRING },
+  [CDBUS_WATTR_CLIENT_WIN]          = { "client_win", CDBUS_TYPE_WINDOW },
+  [CDBUS_WATTR_DAMAGED]             = { "damaged", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_DESTROYED]           = { "destroyed", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_FADE]                = { "fade", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_FADE_FORCE]          = { "fade_force", CDBUS_TYPE_ENUM },
+  [CDBUS_WATTR_FOCUSED_FORCE]       = { "focused_force", CDBUS_TYPE_ENUM },
+  [CDBUS_WATTR_FOCUSED_REAL]        = { "focused_real", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_FRAME_OPACITY]       = { "frame_opacity", DBUS_TYPE_DOUBLE },
+  [CDBUS_WATTR_ID]                  = { "id", CDBUS_TYPE_WINDOW },
+  [CDBUS_WATTR_INVERT_COLOR]        = { "invert_color", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_INVERT_COLOR_FORCE]  = { "invert_color_force", CDBUS_TYPE_ENUM },
+  [CDBUS_WATTR_LEADER]              = { "leader", CDBUS_TYPE_WINDOW },
+  [CDBUS_WATTR_LEFT_WIDTH]          = { "left_width", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_MAP_STATE]           = { "map_state", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_MODE]                = { "mode", CDBUS_TYPE_ENUM },
+  [CDBUS_WATTR_NAME]                = { "name", DBUS_TYPE_STRING },
+  [CDBUS_WATTR_NEXT]                = { "next", CDBUS_TYPE_WINDOW },
+  [CDBUS_WATTR_OPACITY]             = { "opacity", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_OPACITY_PROP]        = { "opacity_prop", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_OPACITY_PROP_CLIENT] = { "opacity_prop_client", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_OPACITY_SET]         = { "opacity_set", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_OPACITY_TGT]         = { "opacity_tgt", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_RIGHT_WIDTH]         = { "right_width", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_ROLE]                = { "role", DBUS_TYPE_STRING },
+  [CDBUS_WATTR_SHADOW]              = { "shadow", DBUS_TYPE_BOOLEAN },
+  [CDBUS_WATTR_SHADOW_FORCE]        = { "shadow_force", CDBUS_TYPE_ENUM },
+  [CDBUS_WATTR_TOP_WIDTH]           = { "top_width", DBUS_TYPE_UINT32 },
+  [CDBUS_WATTR_WINDOW_TYPE]         = { "window_type", CDBUS_TYPE_ENUM },
+  [CDBUS_WATTR_WMWIN]               = { "wmwin", DBUS_TYPE_BOOLEAN },
+};
+
 static dbus_bool_t
 cdbus_callback_add_timeout(DBusTimeout *timeout, void *data);
 
@@ -87,6 +290,9 @@ cdbus_apdarg_int32(session_t *ps, DBusMessage *msg, const void *data);
 static bool
 cdbus_apdarg_uint32(session_t *ps, DBusMessage *msg, const void *data);
 
+static bool
+cdbus_apdarg_fd(session_t *ps, DBusMessage *msg, const void *data);
+
 static bool
 cdbus_apdarg_double(session_t *ps, DBusMessage *msg, const void *data);
 
@@ -102,6 +308,51 @@ cdbus_apdarg_string(session_t *ps, DBusMessage *msg, const void *data);
 static bool
 cdbus_apdarg_wids(session_t *ps, DBusMessage *msg, const void *data);
 
+static bool
+cdbus_apdarg_win_diff(session_t *ps, DBusMessage *msg, const void *data);
+
+static void
+cdbus_diff_store(cdbus_diff_t *pdiff);
+
+static bool
+cdbus_iter_append_snapshot(session_t *ps, DBusMessageIter *arr, win *w,
+    const cdbus_snapshot_req_t *preq);
+
+static bool
+cdbus_apdarg_win_snapshot(session_t *ps, DBusMessage *msg, const void *data);
+
+static bool
+cdbus_apdarg_val(session_t *ps, DBusMessage *msg, const void *data);
+
+/** @name Window attributes
+ */
+///@{
+static int
+cdbus_wattr_find(const char *name);
+
+static void
+cdbus_wattr_get(session_t *ps, win *w, cdbus_wattr_t attr, cdbus_val_t *pval);
+
+static bool
+cdbus_val_eq(cdbus_vtype_t type, const cdbus_val_t *a, const cdbus_val_t *b);
+
+static bool
+cdbus_iter_append_basic(DBusMessageIter *iter, cdbus_vtype_t type,
+    const cdbus_val_t *pval);
+
+static bool
+cdbus_iter_append_val(DBusMessageIter *iter, cdbus_vtype_t type,
+    const cdbus_val_t *pval);
+
+static bool
+cdbus_iter_append_win(DBusMessageIter *arr, win *w, const cdbus_val_t *vals,
+    const cdbus_wattr_t *attrs, int nattrs);
+
+static bool
+cdbus_wattr_parse(session_t *ps, DBusMessage *msg, char **targets,
+    int ntargets, cdbus_wattr_t *pattrs);
+///@}
+
 /** @name DBus signal sending
  */
 ///@{
@@ -176,6 +427,14 @@ cdbus_reply_uint32(session_t *ps, DBusMessage *srcmsg, uint32_t val) {
   return cdbus_reply(ps, srcmsg, cdbus_apdarg_uint32, &val);
 }
 
+/**
+ * Send a reply with an Unix file descriptor argument.
+ */
+static inline bool
+cdbus_reply_fd(session_t *ps, DBusMessage *srcmsg, int fd) {
+  return cdbus_reply(ps, srcmsg, cdbus_apdarg_fd, &fd);
+}
+
 /**
  * Send a reply with a double argument.
  */
@@ -208,11 +467,94 @@ cdbus_reply_enum(session_t *ps, DBusMessage *srcmsg, cdbus_enum_t eval) {
   return cdbus_reply(ps, srcmsg, cdbus_apdarg_enum, &eval);
 }
 
+/**
+ * Send a reply with an argument of the given type.
+ */
+static inline bool
+cdbus_reply_val(session_t *ps, DBusMessage *srcmsg, cdbus_vtype_t type,
+    const cdbus_val_t *pval) {
+  const cdbus_tval_t tval = { .type = type, .pval = pval };
+  return cdbus_reply(ps, srcmsg, cdbus_apdarg_val, &tval);
+}
+
 ///@}
 
 static bool
 cdbus_msg_get_arg(DBusMessage *msg, int count, const int type, void *pdest);
 
+/** @name Transactions
+ */
+///@{
+static void
+cdbus_txn_free(cdbus_txn_t *txn);
+
+static bool
+cdbus_txn_add(cdbus_txn_t *txn, const cdbus_opt_setter_t *popt,
+    const cdbus_wsetter_t *pwin, Window wid, const cdbus_val_t *pval);
+
+/**
+ * Get the sender of a message, "" if it has none.
+ */
+static inline const char *
+cdbus_msg_sender(DBusMessage *msg) {
+  const char *sender = dbus_message_get_sender(msg);
+  return (sender ? sender: "");
+}
+
+/**
+ * Get the transaction the sender of a message has begun, NULL if it has
+ * none.
+ */
+static inline cdbus_txn_t *
+cdbus_txn_get(session_t *ps, DBusMessage *msg) {
+  cdbus_txn_t *txn = ps->dbus_txn;
+  if (txn && !ps->dbus_batch && !strcmp(txn->owner, cdbus_msg_sender(msg)))
+    return txn;
+  return NULL;
+}
+
+/**
+ * Request a full repaint, once at the end of a transaction if one is being
+ * applied.
+ */
+static inline void
+cdbus_force_repaint(session_t *ps) {
+  if (ps->dbus_batch)
+    ((cdbus_txn_t *) ps->dbus_txn)->repaint = true;
+  else
+    force_repaint(ps);
+}
+///@}
+
+/**
+ * Get the member of a value that stores the given type.
+ */
+static inline void *
+cdbus_val_data(cdbus_vtype_t type, cdbus_val_t *pval) {
+  switch (type) {
+    case DBUS_TYPE_BOOLEAN: return &pval->v.b;
+    case DBUS_TYPE_INT32:   return &pval->v.i;
+    case DBUS_TYPE_UINT32:  return &pval->v.u;
+    case DBUS_TYPE_UINT64:  return &pval->v.t;
+    case DBUS_TYPE_DOUBLE:  return &pval->v.d;
+    case CDBUS_TYPE_ENUM:   return &pval->v.e;
+    case DBUS_TYPE_STRING:  return &pval->v.s;
+  }
+
+  assert(0);
+  return NULL;
+}
+
+/**
+ * Get n-th argument of a D-Bus message as a value of the given type.
+ */
+static inline bool
+cdbus_msg_get_val(DBusMessage *msg, int count, cdbus_vtype_t type,
+    cdbus_val_t *pval) {
+  return (pval->valid = cdbus_msg_get_arg(msg, count, type,
+        cdbus_val_data(type, pval)));
+}
+
 /**
  * Return a string representation of a D-Bus message type.
  */
@@ -237,6 +579,18 @@ cdbus_process_win_get(session_t *ps, DBusMessage *msg);
 static bool
 cdbus_process_win_set(session_t *ps, DBusMessage *msg);
 
+static bool
+cdbus_process_win_snapshot(session_t *ps, DBusMessage *msg);
+
+static void
+cdbus_unwatch(session_t *ps);
+
+static bool
+cdbus_process_name_owner_changed(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_process_win_watch(session_t *ps, DBusMessage *msg);
+
 static bool
 cdbus_process_find_win(session_t *ps, DBusMessage *msg);
 
@@ -249,4 +603,50 @@ cdbus_process_opts_set(session_t *ps, DBusMessage *msg);
 static bool
 cdbus_process_introspect(session_t *ps, DBusMessage *msg);
 
+static bool
+cdbus_process_reset(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_process_begin(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_process_commit(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_process_rollback(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_process_repaint(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_process_capture_start(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_process_capture_stop(session_t *ps, DBusMessage *msg);
+
+static bool
+cdbus_table_sorted_real(const void *table, size_t num, size_t size);
+
+static bool
+cdbus_tables_sorted(void);
+
+/// Methods of the compton D-Bus interface, sorted by name for bsearch().
+static const cdbus_method_t CDBUS_METHODS[] = {
+  { "begin", cdbus_process_begin },
+  { "capture_start", cdbus_process_capture_start },
+  { "capture_stop", cdbus_process_capture_stop },
+  { "commit", cdbus_process_commit },
+  { "find_win", cdbus_process_find_win },
+  { "list_win", cdbus_process_list_win },
+  { "opts_get", cdbus_process_opts_get },
+  { "opts_set", cdbus_process_opts_set },
+  { "repaint", cdbus_process_repaint },
+  { "reset", cdbus_process_reset },
+  { "rollback", cdbus_process_rollback },
+  { "win_get", cdbus_process_win_get },
+  { "win_set", cdbus_process_win_set },
+  { "win_snapshot", cdbus_process_win_snapshot },
+  { "win_watch", cdbus_process_win_watch },
+};
+
 ///@}
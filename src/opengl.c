@@ -62,6 +62,13 @@ glx_init(session_t *ps, bool need_render) {
   bool success = false;
   XVisualInfo *pvis = NULL;
 
+#ifndef CONFIG_GLX_CORE
+  if (BKEND_GLX_CORE == ps->o.backend) {
+    printf_errf("(): glx_core backend support not compiled in.");
+    goto glx_init_end;
+  }
+#endif
+
   // Check for GLX extension
   if (!ps->glx_exists) {
     if (glXQueryExtension(ps->dpy, &ps->glx_event, &ps->glx_error))
@@ -111,6 +118,11 @@ glx_init(session_t *ps, bool need_render) {
       ppass->unifm_offset_x = -1;
       ppass->unifm_offset_y = -1;
     }
+
+    {
+      static const glx_prog_shadow_t PROG_SHADOW_DEF = GLX_PROG_SHADOW_INIT;
+      ps->psglx->shadow_prog = PROG_SHADOW_DEF;
+    }
 #endif
   }
 
@@ -118,6 +130,11 @@ glx_init(session_t *ps, bool need_render) {
 
   if (!psglx->context) {
     // Get GLX context
+#ifdef CONFIG_GLX_CORE
+    if (glx_is_core(ps))
+      psglx->context = glx_core_create_context(ps, pvis);
+    else
+#endif
 #ifndef DEBUG_GLX_DEBUG_CONTEXT
     psglx->context = glXCreateContext(ps->dpy, pvis, None, GL_TRUE);
 #else
@@ -172,12 +189,27 @@ glx_init(session_t *ps, bool need_render) {
 
   }
 
+  // Paint to a framebuffer object in offscreen mode, and with glx_core,
+  // which presents it as an emulated back buffer. The stencil check below
+  // applies to it then.
+  if (need_render && (ps->o.offscreen_width || glx_is_core(ps))
+      && !psglx->tgt_fbo && !glx_init_offscreen(ps))
+    goto glx_init_end;
+
   // Ensure we have a stencil buffer. X Fixes does not guarantee rectangles
   // in regions don't overlap, so we must use stencil buffer to make sure
   // we don't paint a region for more than one time, I think?
   if (need_render && !ps->o.glx_no_stencil) {
     GLint val = 0;
-    glGetIntegerv(GL_STENCIL_BITS, &val);
+#ifdef CONFIG_VSYNC_OPENGL_FBO
+    // GL_STENCIL_BITS is gone from core profiles, ask the framebuffer
+    // object instead
+    if (psglx->tgt_fbo)
+      glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER,
+          GL_STENCIL_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &val);
+    else
+#endif
+      glGetIntegerv(GL_STENCIL_BITS, &val);
     if (!val) {
       printf_errf("(): Target window doesn't have stencil buffer.");
       goto glx_init_end;
@@ -185,10 +217,10 @@ glx_init(session_t *ps, bool need_render) {
   }
 
   // Check GL_ARB_texture_non_power_of_two, requires a GLX context and
-  // must precede FBConfig fetching
+  // must precede FBConfig fetching. It's part of OpenGL core since 2.0.
   if (need_render)
-    psglx->has_texture_non_power_of_two = glx_hasglext(ps,
-        "GL_ARB_texture_non_power_of_two");
+    psglx->has_texture_non_power_of_two = glx_is_core(ps)
+      || glx_hasglext(ps, "GL_ARB_texture_non_power_of_two");
 
   // Acquire function addresses
   if (need_render) {
@@ -237,6 +269,11 @@ glx_init(session_t *ps, bool need_render) {
       goto glx_init_end;
     }
 #endif
+
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+    if (ps->o.glx_program_cache)
+      glx_prog_cache_init(ps);
+#endif
   }
 
   // Acquire FBConfigs
@@ -245,11 +282,17 @@ glx_init(session_t *ps, bool need_render) {
 
   // Render preparations
   if (need_render) {
+#ifdef CONFIG_GLX_CORE
+    if (glx_is_core(ps) && !glx_core_init(ps))
+      goto glx_init_end;
+#endif
+
     glx_on_root_change(ps);
 
     glDisable(GL_DEPTH_TEST);
     glDepthMask(GL_FALSE);
-    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    if (!glx_is_core(ps))
+      glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
     glDisable(GL_BLEND);
 
     if (!ps->o.glx_no_stencil) {
@@ -279,7 +322,10 @@ glx_init_end:
 
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
 
-static void
+/**
+ * Free a GLSL main program.
+ */
+void
 glx_free_prog_main(session_t *ps, glx_prog_main_t *pprogram) {
   if (!pprogram)
     return;
@@ -292,6 +338,51 @@ glx_free_prog_main(session_t *ps, glx_prog_main_t *pprogram) {
   pprogram->unifm_tex = -1;
 }
 
+/**
+ * Free blur programs. They are rebuilt on next use.
+ */
+void
+glx_free_blur(session_t *ps) {
+  for (int i = 0; i < MAX_BLUR_PASS; ++i) {
+    glx_blur_pass_t *ppass = &ps->psglx->blur_passes[i];
+    if (ppass->frag_shader)
+      glDeleteShader(ppass->frag_shader);
+    if (ppass->prog)
+      glDeleteProgram(ppass->prog);
+    ppass->frag_shader = 0;
+    ppass->prog = 0;
+  }
+  ps->psglx->blur_init_failed = false;
+}
+
+/**
+ * Free the shadow program. It's rebuilt on next use.
+ */
+void
+glx_free_shadow(session_t *ps) {
+  static const glx_prog_shadow_t PROG_SHADOW_DEF = GLX_PROG_SHADOW_INIT;
+
+  if (ps->psglx->shadow_prog.prog)
+    glDeleteProgram(ps->psglx->shadow_prog.prog);
+  ps->psglx->shadow_prog = PROG_SHADOW_DEF;
+  ps->psglx->shadow_init_failed = false;
+}
+
+/**
+ * Free window shader variants. They are rebuilt on next use.
+ */
+void
+glx_free_win_variants(session_t *ps) {
+  glx_use_program(ps, 0);
+  for (int i = 0; i < GLX_WVAR_NUM; ++i) {
+    glx_prog_variant_t *pvar = &ps->psglx->win_variants[i];
+    if (pvar->prog)
+      glDeleteProgram(pvar->prog);
+    pvar->prog = 0;
+    pvar->failed = false;
+  }
+}
+
 #endif
 
 /**
@@ -308,19 +399,34 @@ glx_destroy(session_t *ps) {
 
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
   // Free GLSL shaders/programs
-  for (int i = 0; i < MAX_BLUR_PASS; ++i) {
-    glx_blur_pass_t *ppass = &ps->psglx->blur_passes[i];
-    if (ppass->frag_shader)
-      glDeleteShader(ppass->frag_shader);
-    if (ppass->prog)
-      glDeleteProgram(ppass->prog);
-  }
+  glx_free_blur(ps);
+  glx_free_shadow(ps);
+  glx_free_win_variants(ps);
+#ifdef CONFIG_GLX_CORE
+  glx_core_destroy(ps);
+#endif
 
   glx_free_prog_main(ps, &ps->o.glx_prog_win);
 
+  free(ps->psglx->prog_cache_dir);
+  ps->psglx->prog_cache_dir = NULL;
+
   glx_check_err(ps);
 #endif
 
+#if defined(CONFIG_VSYNC_OPENGL_GLSL) || defined(CONFIG_VSYNC_OPENGL_FBO)
+  // Free offscreen framebuffer
+  if (ps->psglx->tgt_fbo) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &ps->psglx->tgt_fbo);
+    ps->psglx->tgt_fbo = 0;
+  }
+  if (ps->psglx->tgt_rbs[0] || ps->psglx->tgt_rbs[1]) {
+    glDeleteRenderbuffers(2, ps->psglx->tgt_rbs);
+    ps->psglx->tgt_rbs[0] = ps->psglx->tgt_rbs[1] = 0;
+  }
+#endif
+
   // Free FBConfigs
   for (int i = 0; i <= OPENGL_MAX_DEPTH; ++i) {
     free(ps->psglx->fbconfigs[i]);
@@ -337,6 +443,65 @@ glx_destroy(session_t *ps) {
   ps->psglx = NULL;
 }
 
+#ifdef CONFIG_VSYNC_OPENGL_FBO
+/**
+ * Allocate the renderbuffers of the target framebuffer object at the
+ * current screen size.
+ */
+static void
+glx_alloc_tgt_rbs(session_t *ps) {
+  glx_session_t *psglx = ps->psglx;
+
+  glBindRenderbuffer(GL_RENDERBUFFER, psglx->tgt_rbs[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8,
+      ps->root_width, ps->root_height);
+  glBindRenderbuffer(GL_RENDERBUFFER, psglx->tgt_rbs[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
+      ps->root_width, ps->root_height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+#endif
+
+/**
+ * Create the framebuffer object painted to in offscreen mode or with
+ * glx_core, and bind it.
+ */
+static bool
+glx_init_offscreen(session_t *ps) {
+#ifdef CONFIG_VSYNC_OPENGL_FBO
+  glx_session_t *psglx = ps->psglx;
+
+  glGenFramebuffers(1, &psglx->tgt_fbo);
+  glGenRenderbuffers(2, psglx->tgt_rbs);
+  if (!psglx->tgt_fbo || !psglx->tgt_rbs[0] || !psglx->tgt_rbs[1]) {
+    printf_errf("(): Failed to generate offscreen framebuffer.");
+    return false;
+  }
+
+  glx_alloc_tgt_rbs(ps);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, psglx->tgt_fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+      GL_RENDERBUFFER, psglx->tgt_rbs[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+      GL_RENDERBUFFER, psglx->tgt_rbs[1]);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    printf_errf("(): Offscreen framebuffer attachment failed.");
+    return false;
+  }
+
+  glx_bind_tgt(ps);
+  glReadBuffer(glx_tgt_buffer(ps));
+
+  glx_check_err(ps);
+
+  return true;
+#else
+  printf_errf("(): FBO support not compiled in, can't paint offscreen.");
+  return false;
+#endif
+}
+
 /**
  * Reinitialize GLX.
  */
@@ -366,6 +531,13 @@ void
 glx_on_root_change(session_t *ps) {
   glViewport(0, 0, ps->root_width, ps->root_height);
 
+#ifdef CONFIG_GLX_CORE
+  if (glx_is_core(ps)) {
+    glx_core_on_root_change(ps);
+    return;
+  }
+#endif
+
   // Initialize matrix, copied from dcompmgr
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
@@ -483,19 +655,13 @@ glx_init_conv_blur(session_t *ps) {
 #ifdef DEBUG_GLX
         printf_dbgf("(): Generated convolution shader:\n%s\n", shader_str);
 #endif
-        ppass->frag_shader = glx_create_shader(GL_FRAGMENT_SHADER, shader_str);
+        // Build program
+        ppass->prog = glx_create_program_cached(ps, NULL, shader_str);
         free(shader_str);
       }
 
-      if (!ppass->frag_shader) {
-        printf_errf("(): Failed to create fragment shader %d.", i);
-        return false;
-      }
-
-      // Build program
-      ppass->prog = glx_create_program(&ppass->frag_shader, 1);
       if (!ppass->prog) {
-        printf_errf("(): Failed to create GLSL program.");
+        printf_errf("(): Failed to create GLSL program %d.", i);
         return false;
       }
 
@@ -626,18 +792,12 @@ glx_init_kawase_blur(session_t *ps) {
 #ifdef DEBUG_GLX
       printf_dbgf("(): Generated kawase downsample shader:\n%s\n", shader_str);
 #endif
-      down_pass->frag_shader = glx_create_shader(GL_FRAGMENT_SHADER, shader_str);
+      // Build program
+      down_pass->prog = glx_create_program_cached(ps, NULL, shader_str);
       free(shader_str);
 
-      if (!down_pass->frag_shader) {
-        printf_errf("(): Failed to create kawase downsample fragment shader.");
-        return false;
-      }
-
-      // Build program
-      down_pass->prog = glx_create_program(&down_pass->frag_shader, 1);
       if (!down_pass->prog) {
-        printf_errf("(): Failed to create GLSL program.");
+        printf_errf("(): Failed to create kawase downsample GLSL program.");
         return false;
       }
 
@@ -674,18 +834,12 @@ glx_init_kawase_blur(session_t *ps) {
 #ifdef DEBUG_GLX
       printf_dbgf("(): Generated kawase upsample shader:\n%s\n", shader_str);
 #endif
-      up_pass->frag_shader = glx_create_shader(GL_FRAGMENT_SHADER, shader_str);
+      // Build program
+      up_pass->prog = glx_create_program_cached(ps, NULL, shader_str);
       free(shader_str);
 
-      if (!up_pass->frag_shader) {
-        printf_errf("(): Failed to create kawase upsample fragment shader.");
-        return false;
-      }
-
-      // Build program
-      up_pass->prog = glx_create_program(&up_pass->frag_shader, 1);
       if (!up_pass->prog) {
-        printf_errf("(): Failed to create GLSL program.");
+        printf_errf("(): Failed to create kawase upsample GLSL program.");
         return false;
       }
 
@@ -743,7 +897,7 @@ glx_load_prog_main(session_t *ps,
   assert(pprogram);
 
   // Build program
-  pprogram->prog = glx_create_program_from_str(vshader_str, fshader_str);
+  pprogram->prog = glx_create_program_cached(ps, vshader_str, fshader_str);
   if (!pprogram->prog) {
     printf_errf("(): Failed to create GLSL program.");
     return false;
@@ -1031,7 +1185,9 @@ glx_bind_pixmap(session_t *ps, glx_texture_t **pptex, Pixmap pixmap,
     return false;
   }
 
-  glEnable(ptex->target);
+  // Texture targets are only enabled in the fixed-function pipeline
+  if (!glx_is_core(ps))
+    glEnable(ptex->target);
 
   // Create texture
   if (!ptex->texture) {
@@ -1066,7 +1222,8 @@ glx_bind_pixmap(session_t *ps, glx_texture_t **pptex, Pixmap pixmap,
 
   // Cleanup
   glBindTexture(ptex->target, 0);
-  glDisable(ptex->target);
+  if (!glx_is_core(ps))
+    glDisable(ptex->target);
 
   glx_check_err(ps);
 
@@ -1100,6 +1257,7 @@ glx_release_pixmap(session_t *ps, glx_texture_t *ptex) {
 void
 glx_paint_pre(session_t *ps, XserverRegion *preg) {
   ps->psglx->z = 0.0;
+  glx_unbind_program(ps);
   // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   // Get buffer age
@@ -1265,26 +1423,33 @@ glx_set_clip(session_t *ps, XserverRegion reg, const reg_data_t *pcache_reg) {
     glDepthMask(GL_FALSE);
     glStencilOp(GL_REPLACE, GL_KEEP, GL_KEEP);
 
-    glBegin(GL_QUADS);
+#ifdef CONFIG_GLX_CORE
+    if (glx_is_core(ps))
+      glx_core_stencil_rects(ps, rects, nrects);
+    else
+#endif
+    {
+      glBegin(GL_QUADS);
 
-    for (int i = 0; i < nrects; ++i) {
-      GLint rx = rects[i].x;
-      GLint ry = ps->root_height - rects[i].y;
-      GLint rxe = rx + rects[i].width;
-      GLint rye = ry - rects[i].height;
-      GLint z = 0;
+      for (int i = 0; i < nrects; ++i) {
+        GLint rx = rects[i].x;
+        GLint ry = ps->root_height - rects[i].y;
+        GLint rxe = rx + rects[i].width;
+        GLint rye = ry - rects[i].height;
+        GLint z = 0;
 
 #ifdef DEBUG_GLX
-      printf_dbgf("(): Rect %d: %d, %d, %d, %d\n", i, rx, ry, rxe, rye);
+        printf_dbgf("(): Rect %d: %d, %d, %d, %d\n", i, rx, ry, rxe, rye);
 #endif
 
-      glVertex3i(rx, ry, z);
-      glVertex3i(rxe, ry, z);
-      glVertex3i(rxe, rye, z);
-      glVertex3i(rx, rye, z);
-    }
+        glVertex3i(rx, ry, z);
+        glVertex3i(rxe, ry, z);
+        glVertex3i(rxe, rye, z);
+        glVertex3i(rx, rye, z);
+      }
 
-    glEnd();
+      glEnd();
+    }
 
     glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -1489,9 +1654,7 @@ glx_conv_blur_dst(session_t *ps, int dx, int dy, int width, int height, float z,
       }
     }
     else {
-      static const GLenum DRAWBUFS[2] = { GL_BACK };
-      glBindFramebuffer(GL_FRAMEBUFFER, 0);
-      glDrawBuffers(1, DRAWBUFS);
+      glx_bind_tgt(ps);
       if (have_scissors)
         glEnable(GL_SCISSOR_TEST);
       if (have_stencil)
@@ -1505,7 +1668,7 @@ glx_conv_blur_dst(session_t *ps, int dx, int dy, int width, int height, float z,
     // glTexEnvf(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_ONE_MINUS_SRC_COLOR);
 
     glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-    glUseProgram(ppass->prog);
+    glx_use_program(ps, ppass->prog);
     if (ppass->unifm_offset_x >= 0)
       glUniform1f(ppass->unifm_offset_x, texfac_x);
     if (ppass->unifm_offset_y >= 0)
@@ -1551,7 +1714,7 @@ glx_conv_blur_dst(session_t *ps, int dx, int dy, int width, int height, float z,
       P_PAINTREG_END();
     }
 
-    glUseProgram(0);
+    glx_use_program(ps, 0);
 
     // Swap tex_scr and tex_scr2
     {
@@ -1680,7 +1843,7 @@ glx_kawase_blur_dst(session_t *ps, int dx, int dy, int width, int height, float
     }
 
     glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-    glUseProgram(down_pass->prog);
+    glx_use_program(ps, down_pass->prog);
     if (down_pass->unifm_offset >= 0)
         glUniform1f(down_pass->unifm_offset, offset);
     if (down_pass->unifm_halfpixel >= 0)
@@ -1743,9 +1906,7 @@ glx_kawase_blur_dst(session_t *ps, int dx, int dy, int width, int height, float
         goto glx_kawase_blur_dst_end;
       }
     } else {
-      static const GLenum DRAWBUFS[2] = { GL_BACK };
-      glBindFramebuffer(GL_FRAMEBUFFER, 0);
-      glDrawBuffers(1, DRAWBUFS);
+      glx_bind_tgt(ps);
       if (have_scissors)
         glEnable(GL_SCISSOR_TEST);
       if (have_stencil)
@@ -1753,7 +1914,7 @@ glx_kawase_blur_dst(session_t *ps, int dx, int dy, int width, int height, float
     }
 
     glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-    glUseProgram(up_pass->prog);
+    glx_use_program(ps, up_pass->prog);
     if (up_pass->unifm_offset >= 0)
         glUniform1f(up_pass->unifm_offset, offset);
     if (up_pass->unifm_halfpixel >= 0)
@@ -1799,7 +1960,7 @@ glx_kawase_blur_dst(session_t *ps, int dx, int dy, int width, int height, float
     P_PAINTREG_END();
   }
 
-  glUseProgram(0);
+  glx_use_program(ps, 0);
   ret = true;
 
 glx_kawase_blur_dst_end:
@@ -1823,7 +1984,16 @@ glx_blur_dst(session_t *ps, int dx, int dy, int width, int height, float z,
     GLfloat factor_center,
     XserverRegion reg_tgt, const reg_data_t *pcache_reg,
     glx_blur_cache_t *pbc) {
-  assert(ps->psglx->blur_passes[0].prog);
+  // Build blur programs on first use
+  if (!ps->psglx->blur_passes[0].prog) {
+    if (ps->psglx->blur_init_failed)
+      return false;
+    if (!glx_init_blur(ps)) {
+      printf_errf("(): Failed to initialize blur. Background blur disabled.");
+      ps->psglx->blur_init_failed = true;
+      return false;
+    }
+  }
 
   bool ret;
   switch (ps->o.blur_method) {
@@ -1853,6 +2023,16 @@ glx_dim_dst(session_t *ps, int dx, int dy, int width, int height, float z,
   // considering all those mess in color negation and modulation
   glEnable(GL_BLEND);
   glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+#ifdef CONFIG_GLX_CORE
+  if (glx_is_core(ps)) {
+    const GLfloat color[4] = { 0.0f, 0.0f, 0.0f, factor };
+    glx_core_fill(ps, dx, dy, width, height, color, reg_tgt, pcache_reg);
+    glDisable(GL_BLEND);
+    glx_check_err(ps);
+    return true;
+  }
+#endif
+  glx_unbind_program(ps);
   glColor4f(0.0f, 0.0f, 0.0f, factor);
 
   {
@@ -1881,6 +2061,324 @@ glx_dim_dst(session_t *ps, int dx, int dy, int width, int height, float z,
   return true;
 }
 
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+/**
+ * Build the GLSL program rendering shadows.
+ */
+static bool
+glx_init_shadow(session_t *ps) {
+  // The shadow of a box is the box convolved with the truncated gaussian
+  // kernel of make_gaussian_map(). The kernel is separable, so every
+  // pixel is a product of two differences of its cumulative distribution
+  // function, which is an erf() normalized over the kernel support.
+  static const char *FRAG_SHADER_SHADOW =
+    "#version 110\n"
+    "uniform vec4 box;\n"
+    "uniform vec4 color;\n"
+    "uniform float sigma_inv;\n"
+    "uniform float norm;\n"
+    "uniform float support;\n"
+    "\n"
+    "// Abramowitz & Stegun 7.1.27, GLSL 1.10 has no erf()\n"
+    "float erf_approx(float x) {\n"
+    "  float a = abs(x);\n"
+    "  float t = 1.0 + (0.278393 + (0.230389 + (0.000972 + 0.078108 * a) * a) * a) * a;\n"
+    "  t *= t;\n"
+    "  return sign(x) * (1.0 - 1.0 / (t * t));\n"
+    "}\n"
+    "\n"
+    "float cdf(float t) {\n"
+    "  return 0.5 + norm * erf_approx(clamp(t, -support, support) * sigma_inv);\n"
+    "}\n"
+    "\n"
+    "void main() {\n"
+    "  vec2 p = gl_FragCoord.xy;\n"
+    "  float a = (cdf(p.x - box.x) - cdf(p.x - box.z))\n"
+    "    * (cdf(p.y - box.y) - cdf(p.y - box.w)) * color.a;\n"
+    "  gl_FragColor = vec4(color.rgb * a, a);\n"
+    "}\n";
+
+  glx_prog_shadow_t *pprogram = &ps->psglx->shadow_prog;
+
+  pprogram->prog = glx_create_program_cached(ps, NULL, FRAG_SHADER_SHADOW);
+  if (!pprogram->prog) {
+    printf_errf("(): Failed to create shadow GLSL program.");
+    return false;
+  }
+
+  // Get uniform addresses
+#define P_GET_UNIFM_LOC(name, target) { \
+      pprogram->target = glGetUniformLocation(pprogram->prog, name); \
+      if (pprogram->target < 0) { \
+        printf_errf("(): Failed to get location of shadow uniform '" name "'. Might be troublesome."); \
+      } \
+    }
+  P_GET_UNIFM_LOC("box", unifm_box);
+  P_GET_UNIFM_LOC("color", unifm_color);
+  P_GET_UNIFM_LOC("sigma_inv", unifm_sigma_inv);
+  P_GET_UNIFM_LOC("norm", unifm_norm);
+  P_GET_UNIFM_LOC("support", unifm_support);
+#undef P_GET_UNIFM_LOC
+
+  glx_check_err(ps);
+
+  return true;
+}
+
+/**
+ * Render the shadow of a box with the shadow GLSL program.
+ *
+ * @param dx,dy,width,height area covered by the shadow
+ * @param bx,by,bwidth,bheight box casting the shadow
+ * @param opacity opacity of the shadow
+ * @return false if the shadow program is unavailable
+ */
+bool
+glx_shadow_dst(session_t *ps, int dx, int dy, int width, int height,
+    int bx, int by, int bwidth, int bheight, float z, GLfloat opacity,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg) {
+  // Build the shadow program on first use
+  if (!ps->psglx->shadow_prog.prog) {
+    if (ps->psglx->shadow_init_failed)
+      return false;
+    if (!glx_init_shadow(ps)) {
+      printf_errf("(): Failed to initialize GPU shadows. Falling back to "
+          "shadow pixmaps.");
+      ps->psglx->shadow_init_failed = true;
+      return false;
+    }
+  }
+
+  const glx_prog_shadow_t *pprogram = &ps->psglx->shadow_prog;
+  const double sigma = ps->o.shadow_radius;
+  const double support = ps->cgsize / 2;
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  glx_use_program(ps, pprogram->prog);
+  // In GL window coordinates, with the Y axis pointing upwards
+  glUniform4f(pprogram->unifm_box, bx, ps->root_height - by - bheight,
+      bx + bwidth, ps->root_height - by);
+  glUniform4f(pprogram->unifm_color, ps->o.shadow_red, ps->o.shadow_green,
+      ps->o.shadow_blue, opacity);
+  glUniform1f(pprogram->unifm_sigma_inv, 1.0 / (sigma * M_SQRT2));
+  glUniform1f(pprogram->unifm_norm,
+      0.5 / erf(support / (sigma * M_SQRT2)));
+  glUniform1f(pprogram->unifm_support, support);
+
+  {
+    P_PAINTREG_START();
+    {
+      GLint rdx = crect.x;
+      GLint rdy = ps->root_height - crect.y;
+      GLint rdxe = rdx + crect.width;
+      GLint rdye = rdy - crect.height;
+
+      glVertex3f(rdx, rdy, z);
+      glVertex3f(rdxe, rdy, z);
+      glVertex3f(rdxe, rdye, z);
+      glVertex3f(rdx, rdye, z);
+    }
+    P_PAINTREG_END();
+  }
+
+  glx_use_program(ps, 0);
+  glDisable(GL_BLEND);
+
+  glx_check_err(ps);
+
+  return true;
+}
+
+/**
+ * Get a window shader variant, building it on first use.
+ *
+ * @return the variant, or NULL if it couldn't be built
+ */
+static glx_prog_variant_t *
+glx_get_win_variant(session_t *ps, int key) {
+  // Variants are specialized by the preprocessor, so each only carries the
+  // work it needs
+  static const char *FRAG_SHADER_WIN =
+    "#ifdef RECT\n"
+    "#extension GL_ARB_texture_rectangle : require\n"
+    "uniform sampler2DRect tex;\n"
+    "#define TEX(c) texture2DRect(tex, c)\n"
+    "#else\n"
+    "uniform sampler2D tex;\n"
+    "#define TEX(c) texture2D(tex, c)\n"
+    "#endif\n"
+    "uniform float opacity;\n"
+    "uniform float dim;\n"
+    "uniform float frame_opacity;\n"
+    "uniform vec4 body;\n"
+    "\n"
+    "void main() {\n"
+    "  vec4 c = TEX(gl_TexCoord[0].st);\n"
+    "#ifndef ARGB\n"
+    "  c.a = 1.0;\n"
+    "#endif\n"
+    "#ifdef INVERT\n"
+    "  // Negation of premultiplied color\n"
+    "  c.rgb = vec3(c.a) - c.rgb;\n"
+    "#endif\n"
+    "#ifdef DIM\n"
+    "  c.rgb *= 1.0 - dim;\n"
+    "#endif\n"
+    "#ifdef FRAME\n"
+    "  vec2 p = gl_FragCoord.xy;\n"
+    "  bool in_body = all(greaterThanEqual(p, body.xy))\n"
+    "    && all(lessThan(p, body.zw));\n"
+    "  c *= in_body ? opacity: frame_opacity;\n"
+    "#elif defined(OPACITY)\n"
+    "  c *= opacity;\n"
+    "#endif\n"
+    "  gl_FragColor = c;\n"
+    "}\n";
+
+  assert(key >= 0 && key < GLX_WVAR_NUM);
+  glx_prog_variant_t *pvar = &ps->psglx->win_variants[key];
+  if (pvar->prog)
+    return pvar;
+  if (pvar->failed)
+    return NULL;
+
+  char defs[128] = "#version 110\n";
+  if (key & GLX_WVAR_ARGB)
+    strcat(defs, "#define ARGB\n");
+  if (key & GLX_WVAR_OPACITY)
+    strcat(defs, "#define OPACITY\n");
+  if (key & GLX_WVAR_INVERT)
+    strcat(defs, "#define INVERT\n");
+  if (key & GLX_WVAR_DIM)
+    strcat(defs, "#define DIM\n");
+  if (key & GLX_WVAR_FRAME)
+    strcat(defs, "#define FRAME\n");
+  if (key & GLX_WVAR_RECT)
+    strcat(defs, "#define RECT\n");
+
+  char *fshader_str = mstrjoin(defs, FRAG_SHADER_WIN);
+  pvar->prog = glx_create_program_cached(ps, NULL, fshader_str);
+  free(fshader_str);
+  if (!pvar->prog) {
+    printf_errf("(): Failed to create window shader variant %#x. "
+        "Falling back to the fixed-function pipeline.", key);
+    pvar->failed = true;
+    return NULL;
+  }
+
+  // Uniforms a variant doesn't use are optimized out, so a location of -1
+  // is expected here
+  pvar->unifm_tex = glGetUniformLocation(pvar->prog, "tex");
+  pvar->unifm_opacity = glGetUniformLocation(pvar->prog, "opacity");
+  pvar->unifm_dim = glGetUniformLocation(pvar->prog, "dim");
+  pvar->unifm_frame_opacity =
+    glGetUniformLocation(pvar->prog, "frame_opacity");
+  pvar->unifm_body = glGetUniformLocation(pvar->prog, "body");
+
+  // The texture unit never changes
+  glx_use_program(ps, pvar->prog);
+  if (pvar->unifm_tex >= 0)
+    glUniform1i(pvar->unifm_tex, 0);
+
+  glx_check_err(ps);
+
+  return pvar;
+}
+
+/**
+ * Get the key of the shader variant painting a window with the given
+ * parameters.
+ *
+ * Windows are sorted by this key to reduce program switches.
+ */
+int
+glx_win_variant_key(session_t *ps, const glx_texture_t *ptex,
+    const glx_win_params_t *pparams) {
+  int key = 0;
+
+  if (pparams->argb || (ptex && ptex->texture
+        && ps->psglx->fbconfigs[ptex->depth]
+        && GLX_TEXTURE_FORMAT_RGBA_EXT
+        == ps->psglx->fbconfigs[ptex->depth]->texture_fmt))
+    key |= GLX_WVAR_ARGB;
+  if (pparams->opacity < 1.0)
+    key |= GLX_WVAR_OPACITY;
+  if (pparams->neg)
+    key |= GLX_WVAR_INVERT;
+  if (pparams->frame_opacity)
+    key |= GLX_WVAR_FRAME | GLX_WVAR_OPACITY;
+  // Dimming blends a black layer over the window and whatever is below it,
+  // so it can only be folded in when nothing shows through
+  if (pparams->dim && !(key & (GLX_WVAR_ARGB | GLX_WVAR_OPACITY)))
+    key |= GLX_WVAR_DIM;
+  if (ptex && GL_TEXTURE_RECTANGLE == ptex->target)
+    key |= GLX_WVAR_RECT;
+
+  return key;
+}
+#endif
+
+/**
+ * Draw the quads of a texture covering a region.
+ */
+static void
+glx_render_tex_quads(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height, int z,
+    bool dual_texture, XserverRegion reg_tgt, const reg_data_t *pcache_reg) {
+  P_PAINTREG_START();
+  {
+    GLfloat rx = (double) (crect.x - dx + x);
+    GLfloat ry = (double) (crect.y - dy + y);
+    GLfloat rxe = rx + (double) crect.width;
+    GLfloat rye = ry + (double) crect.height;
+    // Rectangle textures have [0-w] [0-h] while 2D texture has [0-1] [0-1]
+    // Thanks to amonakov for pointing out!
+    if (GL_TEXTURE_2D == ptex->target) {
+      rx = rx / ptex->width;
+      ry = ry / ptex->height;
+      rxe = rxe / ptex->width;
+      rye = rye / ptex->height;
+    }
+    GLint rdx = crect.x;
+    GLint rdy = ps->root_height - crect.y;
+    GLint rdxe = rdx + crect.width;
+    GLint rdye = rdy - crect.height;
+
+    // Invert Y if needed, this may not work as expected, though. I don't
+    // have such a FBConfig to test with.
+    if (!ptex->y_inverted) {
+      ry = 1.0 - ry;
+      rye = 1.0 - rye;
+    }
+
+#ifdef DEBUG_GLX
+    printf_dbgf("(): Rect %d: %f, %f, %f, %f -> %d, %d, %d, %d\n", ri, rx, ry, rxe, rye, rdx, rdy, rdxe, rdye);
+#endif
+
+#define P_TEXCOORD(cx, cy) { \
+  if (dual_texture) { \
+    glMultiTexCoord2f(GL_TEXTURE0, cx, cy); \
+    glMultiTexCoord2f(GL_TEXTURE1, cx, cy); \
+  } \
+  else glTexCoord2f(cx, cy); \
+}
+    P_TEXCOORD(rx, ry);
+    glVertex3i(rdx, rdy, z);
+
+    P_TEXCOORD(rxe, ry);
+    glVertex3i(rdxe, rdy, z);
+
+    P_TEXCOORD(rxe, rye);
+    glVertex3i(rdxe, rdye, z);
+
+    P_TEXCOORD(rx, rye);
+    glVertex3i(rdx, rdye, z);
+  }
+  P_PAINTREG_END();
+}
+
 /**
  * @brief Render a region with texture data.
  */
@@ -1898,6 +2396,18 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
     return false;
   }
 
+#ifdef CONFIG_GLX_CORE
+  if (glx_is_core(ps)) {
+    const glx_win_params_t params = {
+      .opacity = opacity,
+      .argb = argb,
+      .neg = neg,
+    };
+    return glx_core_render(ps, ptex, x, y, dx, dy, width, height, &params,
+        NULL, reg_tgt, pcache_reg, NULL);
+  }
+#endif
+
 #ifdef DEBUG_GLX_PAINTREG
   glx_render_dots(ps, dx, dy, width, height, z, reg_tgt, pcache_reg);
   return true;
@@ -1907,6 +2417,18 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
       ps->psglx->fbconfigs[ptex->depth]->texture_fmt);
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
   const bool has_prog = pprogram && pprogram->prog;
+
+  // Use a specialized shader variant if there's no custom program
+  if (!has_prog && glx_use_win_variants(ps)) {
+    const glx_win_params_t params = {
+      .opacity = opacity,
+      .argb = argb,
+      .neg = neg,
+    };
+    if (glx_render_win(ps, ptex, x, y, dx, dy, width, height, z, &params,
+          reg_tgt, pcache_reg, NULL))
+      return true;
+  }
 #endif
   bool dual_texture = false;
 
@@ -1933,6 +2455,8 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
 #endif
   {
     // The default, fixed-function path
+    glx_unbind_program(ps);
+
     // Color negation
     if (neg) {
       // Simple color negation
@@ -2009,7 +2533,7 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
   else {
     // Programmable path
     assert(pprogram->prog);
-    glUseProgram(pprogram->prog);
+    glx_use_program(ps, pprogram->prog);
     if (pprogram->unifm_opacity >= 0)
       glUniform1f(pprogram->unifm_opacity, opacity);
     if (pprogram->unifm_invert_color >= 0)
@@ -2032,66 +2556,16 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
   }
 
   // Painting
-  {
-    P_PAINTREG_START();
-    {
-      GLfloat rx = (double) (crect.x - dx + x);
-      GLfloat ry = (double) (crect.y - dy + y);
-      GLfloat rxe = rx + (double) crect.width;
-      GLfloat rye = ry + (double) crect.height;
-      // Rectangle textures have [0-w] [0-h] while 2D texture has [0-1] [0-1]
-      // Thanks to amonakov for pointing out!
-      if (GL_TEXTURE_2D == ptex->target) {
-        rx = rx / ptex->width;
-        ry = ry / ptex->height;
-        rxe = rxe / ptex->width;
-        rye = rye / ptex->height;
-      }
-      GLint rdx = crect.x;
-      GLint rdy = ps->root_height - crect.y;
-      GLint rdxe = rdx + crect.width;
-      GLint rdye = rdy - crect.height;
+  glx_render_tex_quads(ps, ptex, x, y, dx, dy, width, height, z,
+      dual_texture, reg_tgt, pcache_reg);
 
-      // Invert Y if needed, this may not work as expected, though. I don't
-      // have such a FBConfig to test with.
-      if (!ptex->y_inverted) {
-        ry = 1.0 - ry;
-        rye = 1.0 - rye;
-      }
-
-#ifdef DEBUG_GLX
-      printf_dbgf("(): Rect %d: %f, %f, %f, %f -> %d, %d, %d, %d\n", ri, rx, ry, rxe, rye, rdx, rdy, rdxe, rdye);
-#endif
-
-#define P_TEXCOORD(cx, cy) { \
-  if (dual_texture) { \
-    glMultiTexCoord2f(GL_TEXTURE0, cx, cy); \
-    glMultiTexCoord2f(GL_TEXTURE1, cx, cy); \
-  } \
-  else glTexCoord2f(cx, cy); \
-}
-      P_TEXCOORD(rx, ry);
-      glVertex3i(rdx, rdy, z);
-
-      P_TEXCOORD(rxe, ry);
-      glVertex3i(rdxe, rdy, z);
-
-      P_TEXCOORD(rxe, rye);
-      glVertex3i(rdxe, rdye, z);
-
-      P_TEXCOORD(rx, rye);
-      glVertex3i(rdx, rdye, z);
-    }
-    P_PAINTREG_END();
-  }
-
-  // Cleanup
-  glBindTexture(ptex->target, 0);
-  glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
-  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-  glDisable(GL_BLEND);
-  glDisable(GL_COLOR_LOGIC_OP);
-  glDisable(ptex->target);
+  // Cleanup
+  glBindTexture(ptex->target, 0);
+  glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glDisable(GL_BLEND);
+  glDisable(GL_COLOR_LOGIC_OP);
+  glDisable(ptex->target);
 
   if (dual_texture) {
     glActiveTexture(GL_TEXTURE1);
@@ -2102,7 +2576,7 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
 
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
   if (has_prog)
-    glUseProgram(0);
+    glx_use_program(ps, 0);
 #endif
 
   glx_check_err(ps);
@@ -2110,6 +2584,80 @@ glx_render_(session_t *ps, const glx_texture_t *ptex,
   return true;
 }
 
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+/**
+ * Render a region of a window in one pass with a specialized shader
+ * variant.
+ *
+ * The variant stays bound afterwards, so consecutive windows of the same
+ * variant don't switch programs.
+ *
+ * @param pdimmed if not NULL, set to whether the window is dimmed in the
+ *                pass
+ * @return false if the variant is unavailable
+ */
+bool
+glx_render_win(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height, int z,
+    const glx_win_params_t *pparams,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg, bool *pdimmed) {
+  if (!ptex || !ptex->texture) {
+    printf_errf("(): Missing texture.");
+    return false;
+  }
+
+  const int key = glx_win_variant_key(ps, ptex, pparams);
+  const glx_prog_variant_t *pvar = glx_get_win_variant(ps, key);
+  if (!pvar)
+    return false;
+
+  if (pdimmed)
+    *pdimmed = (key & GLX_WVAR_DIM);
+
+#ifdef DEBUG_GLX_PAINTREG
+  glx_render_dots(ps, dx, dy, width, height, z, reg_tgt, pcache_reg);
+  return true;
+#endif
+
+  const bool blend = (key & (GLX_WVAR_ARGB | GLX_WVAR_OPACITY));
+  if (blend) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  }
+
+  glx_use_program(ps, pvar->prog);
+  if (pvar->unifm_opacity >= 0)
+    glUniform1f(pvar->unifm_opacity, pparams->opacity);
+  if (pvar->unifm_dim >= 0)
+    glUniform1f(pvar->unifm_dim, pparams->dim);
+  if (pvar->unifm_frame_opacity >= 0)
+    glUniform1f(pvar->unifm_frame_opacity, pparams->frame_opacity);
+  if (pvar->unifm_body >= 0) {
+    // In GL window coordinates, with the Y axis pointing upwards
+    const XRectangle *pbody = &pparams->body;
+    glUniform4f(pvar->unifm_body, pbody->x,
+        ps->root_height - pbody->y - pbody->height,
+        pbody->x + pbody->width, ps->root_height - pbody->y);
+  }
+
+#ifdef DEBUG_GLX
+  printf_dbgf("(): Draw variant %#x: %d, %d, %d, %d -> %d, %d (%d, %d) z %d\n", key, x, y, width, height, dx, dy, ptex->width, ptex->height, z);
+#endif
+
+  glBindTexture(ptex->target, ptex->texture);
+  glx_render_tex_quads(ps, ptex, x, y, dx, dy, width, height, z,
+      false, reg_tgt, pcache_reg);
+  glBindTexture(ptex->target, 0);
+
+  if (blend)
+    glDisable(GL_BLEND);
+
+  glx_check_err(ps);
+
+  return true;
+}
+#endif
+
 /**
  * Render a region with color.
  */
@@ -2119,11 +2667,21 @@ glx_render_color(session_t *ps, int dx, int dy, int width, int height, int z,
   static int color = 0;
 
   color = color % (3 * 3 * 3 - 1) + 1;
-  glColor4f(1.0 / 3.0 * (color / (3 * 3)),
-      1.0 / 3.0 * (color % (3 * 3) / 3),
-      1.0 / 3.0 * (color % 3),
-      1.0f
-      );
+  const GLfloat rgba[4] = {
+    1.0 / 3.0 * (color / (3 * 3)),
+    1.0 / 3.0 * (color % (3 * 3) / 3),
+    1.0 / 3.0 * (color % 3),
+    1.0f
+  };
+#ifdef CONFIG_GLX_CORE
+  if (glx_is_core(ps)) {
+    glx_core_fill(ps, dx, dy, width, height, rgba, reg_tgt, pcache_reg);
+    glx_check_err(ps);
+    return;
+  }
+#endif
+  glx_unbind_program(ps);
+  glColor4fv(rgba);
   z -= 0.2;
 
   {
@@ -2152,6 +2710,11 @@ glx_render_color(session_t *ps, int dx, int dy, int width, int height, int z,
 static void
 glx_render_dots(session_t *ps, int dx, int dy, int width, int height, int z,
     XserverRegion reg_tgt, const reg_data_t *pcache_reg) {
+  // Points have no place in glx_core, which paints window contents instead
+  if (glx_is_core(ps))
+    return;
+
+  glx_unbind_program(ps);
   glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
   z -= 0.1;
 
@@ -2217,30 +2780,195 @@ glx_swap_copysubbuffermesa(session_t *ps, XserverRegion reg) {
 }
 
 /**
- * @brief Get tightly packed RGB888 data from GL front buffer.
+ * Read the last complete frame as tightly packed RGB888 data, top row
+ * first.
  *
- * Don't expect any sort of decent performance.
- *
- * @returns tightly packed RGB888 data of the size of the screen,
- *          to be freed with `free()`
+ * @param ps current session
+ * @param rgb buffer of <code>3 * root_width * root_height</code> bytes
  */
-unsigned char *
-glx_take_screenshot(session_t *ps, int *out_length) {
-  int length = 3 * ps->root_width * ps->root_height;
-  GLint unpack_align_old = 0;
-  glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_align_old);
-  assert(unpack_align_old > 0);
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  unsigned char *buf = cmalloc(length, unsigned char);
-  glReadBuffer(GL_FRONT);
+bool
+glx_read_frame(session_t *ps, unsigned char *rgb) {
+  const size_t row = (size_t) ps->root_width * 3;
+  GLint pack_align_old = 0;
+  glGetIntegerv(GL_PACK_ALIGNMENT, &pack_align_old);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadBuffer(glx_frame_buffer(ps));
   glReadPixels(0, 0, ps->root_width, ps->root_height, GL_RGB,
-      GL_UNSIGNED_BYTE, buf);
-  glReadBuffer(GL_BACK);
-  glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_align_old);
-  if (out_length)
-    *out_length = sizeof(unsigned char) * length;
-  return buf;
+      GL_UNSIGNED_BYTE, rgb);
+  glReadBuffer(glx_tgt_buffer(ps));
+  glPixelStorei(GL_PACK_ALIGNMENT, pack_align_old);
+
+  // GL rows go from bottom to top
+  unsigned char *tmp = cmalloc(row, unsigned char);
+  for (int i = 0, j = ps->root_height - 1; i < j; ++i, --j) {
+    memcpy(tmp, rgb + i * row, row);
+    memcpy(rgb + i * row, rgb + j * row, row);
+    memcpy(rgb + j * row, tmp, row);
+  }
+  free(tmp);
+
+  glx_check_err(ps);
+
+  return true;
+}
+
+#ifdef CONFIG_DBUS
+/**
+ * Prepare reading captured frames back from GL front buffer.
+ *
+ * Frames are read asynchronously into two pixel-buffer objects if the
+ * implementation supports them, synchronously otherwise.
+ */
+bool
+glx_capture_init(session_t *ps, capture_t *cap) {
+  if (!glx_has_context(ps))
+    return false;
+
+#if defined(CONFIG_VSYNC_OPENGL_GLSL) || defined(CONFIG_VSYNC_OPENGL_FBO)
+  if (!glx_hasglext(ps, "GL_ARB_pixel_buffer_object")) {
+    printf_errf("(): GL_ARB_pixel_buffer_object unsupported, "
+        "reading frames synchronously.");
+    return true;
+  }
+
+  const GLsizeiptr size = (GLsizeiptr) ps->root_width * ps->root_height * 4;
+  for (int i = 0; i < 2; ++i) {
+    glGenBuffers(1, &cap->pending[i].pbo);
+    if (!cap->pending[i].pbo) {
+      printf_errf("(): Failed to create pixel-buffer object, "
+          "reading frames synchronously.");
+      glx_capture_deinit(ps, cap);
+      return true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, cap->pending[i].pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  glx_check_err(ps);
+#endif
+
+  return true;
+}
+
+/**
+ * Free pixel-buffer objects of frame capture.
+ */
+void
+glx_capture_deinit(session_t *ps, capture_t *cap) {
+#if defined(CONFIG_VSYNC_OPENGL_GLSL) || defined(CONFIG_VSYNC_OPENGL_FBO)
+  for (int i = 0; i < 2; ++i) {
+    if (cap->pending[i].pbo) {
+      glDeleteBuffers(1, &cap->pending[i].pbo);
+      cap->pending[i].pbo = 0;
+    }
+  }
+
+  glx_check_err(ps);
+#endif
+}
+
+/**
+ * Start reading the damaged rectangles of a captured frame from GL front
+ * buffer into its pixel-buffer object.
+ *
+ * The pixel-buffer object mirrors the layout of the screen, bottom row
+ * first. Does nothing on synchronous readback.
+ */
+void
+glx_capture_read(session_t *ps, capture_pending_t *pend) {
+#if defined(CONFIG_VSYNC_OPENGL_GLSL) || defined(CONFIG_VSYNC_OPENGL_FBO)
+  if (!pend->pbo)
+    return;
+
+  glReadBuffer(glx_frame_buffer(ps));
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pend->pbo);
+  glPixelStorei(GL_PACK_ROW_LENGTH, ps->root_width);
+  for (int i = 0; i < pend->nrects; ++i) {
+    const XRectangle *r = &pend->rects[i];
+    const int gy = ps->root_height - r->y - r->height;
+    glReadPixels(r->x, gy, r->width, r->height, GL_BGRA, GL_UNSIGNED_BYTE,
+        (GLvoid *) (((size_t) gy * ps->root_width + r->x) * 4));
+  }
+  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glReadBuffer(glx_tgt_buffer(ps));
+
+  glx_check_err(ps);
+#endif
+}
+
+/**
+ * Copy the damaged rectangles of a captured frame into its slot.
+ *
+ * Maps the pixel-buffer object filled by <code>glx_capture_read()</code>,
+ * or reads GL front buffer right away on synchronous readback.
+ *
+ * @param ps current session
+ * @param pend the captured frame
+ * @param data pixel data of the slot
+ * @param stride bytes per row of <code>data</code>
+ */
+bool
+glx_capture_finish(session_t *ps, capture_pending_t *pend,
+    unsigned char *data, int stride) {
+  const unsigned char *mapped = NULL;
+  unsigned char *buf = NULL;
+
+#if defined(CONFIG_VSYNC_OPENGL_GLSL) || defined(CONFIG_VSYNC_OPENGL_FBO)
+  if (pend->pbo) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pend->pbo);
+    mapped = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (!mapped) {
+      printf_errf("(): Failed to map pixel-buffer object.");
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      return false;
+    }
+  }
+#endif
+
+  if (!mapped) {
+    buf = cmalloc(ps->root_width * ps->root_height * 4, unsigned char);
+    glReadBuffer(glx_frame_buffer(ps));
+  }
+
+  for (int i = 0; i < pend->nrects; ++i) {
+    const XRectangle *r = &pend->rects[i];
+    const int gy = ps->root_height - r->y - r->height;
+    const unsigned char *src = NULL;
+    size_t src_stride = 0;
+    if (mapped) {
+      src = mapped + ((size_t) gy * ps->root_width + r->x) * 4;
+      src_stride = (size_t) ps->root_width * 4;
+    }
+    else {
+      glReadPixels(r->x, gy, r->width, r->height, GL_BGRA, GL_UNSIGNED_BYTE,
+          buf);
+      src = buf;
+      src_stride = (size_t) r->width * 4;
+    }
+    // GL rows go from bottom to top
+    for (int j = 0; j < r->height; ++j)
+      memcpy(data + (size_t) (r->y + j) * stride + r->x * 4,
+          src + (size_t) (r->height - 1 - j) * src_stride, r->width * 4);
+  }
+
+  if (mapped) {
+#if defined(CONFIG_VSYNC_OPENGL_GLSL) || defined(CONFIG_VSYNC_OPENGL_FBO)
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+  }
+  else {
+    glReadBuffer(glx_tgt_buffer(ps));
+    free(buf);
+  }
+
+  glx_check_err(ps);
+
+  return true;
 }
+#endif
 
 #ifdef CONFIG_VSYNC_OPENGL_GLSL
 GLuint
@@ -2287,14 +3015,12 @@ glx_create_shader_end:
   return shader;
 }
 
-GLuint
-glx_create_program(const GLuint * const shaders, int nshaders) {
+/**
+ * Attach shaders to a program, link it, and detach them again.
+ */
+static bool
+glx_link_program(GLuint program, const GLuint * const shaders, int nshaders) {
   bool success = false;
-  GLuint program = glCreateProgram();
-  if (!program) {
-    printf_errf("(): Failed to create program.");
-    goto glx_create_program_end;
-  }
 
   for (int i = 0; i < nshaders; ++i)
     glAttachShader(program, shaders[i]);
@@ -2312,17 +3038,27 @@ glx_create_program(const GLuint * const shaders, int nshaders) {
         glGetProgramInfoLog(program, log_len, NULL, log);
         printf_errf("(): Failed to link program: %s", log);
       }
-      goto glx_create_program_end;
+      goto glx_link_program_end;
     }
   }
   success = true;
 
-glx_create_program_end:
-  if (program) {
-    for (int i = 0; i < nshaders; ++i)
-      glDetachShader(program, shaders[i]);
+glx_link_program_end:
+  for (int i = 0; i < nshaders; ++i)
+    glDetachShader(program, shaders[i]);
+
+  return success;
+}
+
+GLuint
+glx_create_program(const GLuint * const shaders, int nshaders) {
+  GLuint program = glCreateProgram();
+  if (!program) {
+    printf_errf("(): Failed to create program.");
+    return 0;
   }
-  if (program && !success) {
+
+  if (!glx_link_program(program, shaders, nshaders)) {
     glDeleteProgram(program);
     program = 0;
   }
@@ -2331,14 +3067,14 @@ glx_create_program_end:
 }
 
 /**
- * @brief Create a program from vertex and fragment shader strings.
+ * Compile vertex and fragment shader strings and link them into a program.
  */
-GLuint
-glx_create_program_from_str(const char *vert_shader_str,
+static bool
+glx_link_program_from_str(GLuint program, const char *vert_shader_str,
     const char *frag_shader_str) {
   GLuint vert_shader = 0;
   GLuint frag_shader = 0;
-  GLuint prog = 0;
+  bool success = false;
 
   if (vert_shader_str)
     vert_shader = glx_create_shader(GL_VERTEX_SHADER, vert_shader_str);
@@ -2354,7 +3090,7 @@ glx_create_program_from_str(const char *vert_shader_str,
       shaders[count++] = frag_shader;
     assert(count <= sizeof(shaders) / sizeof(shaders[0]));
     if (count)
-      prog = glx_create_program(shaders, count);
+      success = glx_link_program(program, shaders, count);
   }
 
   if (vert_shader)
@@ -2362,7 +3098,826 @@ glx_create_program_from_str(const char *vert_shader_str,
   if (frag_shader)
     glDeleteShader(frag_shader);
 
+  return success;
+}
+
+/**
+ * @brief Create a program from vertex and fragment shader strings.
+ */
+GLuint
+glx_create_program_from_str(const char *vert_shader_str,
+    const char *frag_shader_str) {
+  GLuint prog = glCreateProgram();
+  if (!prog) {
+    printf_errf("(): Failed to create program.");
+    return 0;
+  }
+
+  if (!glx_link_program_from_str(prog, vert_shader_str, frag_shader_str)) {
+    glDeleteProgram(prog);
+    prog = 0;
+  }
+
   return prog;
 }
+
+/**
+ * Initialize the GLSL program binary cache.
+ *
+ * Binaries are stored in <code>$XDG_CACHE_HOME/compton</code>, falling
+ * back to <code>~/.cache/compton</code>.
+ */
+static bool
+glx_prog_cache_init(session_t *ps) {
+  glx_session_t *psglx = ps->psglx;
+
+  if (!glx_hasglext(ps, "GL_ARB_get_program_binary")) {
+    printf_errf("(): GL_ARB_get_program_binary unsupported. "
+        "Program cache disabled.");
+    return false;
+  }
+
+  psglx->glGetProgramBinaryProc = (f_GetProgramBinary)
+    glXGetProcAddress((const GLubyte *) "glGetProgramBinary");
+  psglx->glProgramBinaryProc = (f_ProgramBinary)
+    glXGetProcAddress((const GLubyte *) "glProgramBinary");
+  psglx->glProgramParameteriProc = (f_ProgramParameteri)
+    glXGetProcAddress((const GLubyte *) "glProgramParameteri");
+  if (!psglx->glGetProgramBinaryProc || !psglx->glProgramBinaryProc
+      || !psglx->glProgramParameteriProc) {
+    printf_errf("(): Failed to acquire program binary functions. "
+        "Program cache disabled.");
+    return false;
+  }
+
+  char *base = NULL;
+  const char *dir = getenv("XDG_CACHE_HOME");
+  if (dir && strlen(dir))
+    base = mstrcpy(dir);
+  else {
+    const char *home = getenv("HOME");
+    if (!(home && strlen(home))) {
+      printf_errf("(): Cannot locate cache directory. "
+          "Program cache disabled.");
+      return false;
+    }
+    base = mstrjoin(home, "/.cache");
+  }
+
+  // The parent may well exist already
+  mkdir(base, 0700);
+  char *path = mstrjoin(base, "/compton");
+  free(base);
+  if (mkdir(path, 0700) && EEXIST != errno) {
+    printf_errf("(): Failed to create cache directory \"%s\". "
+        "Program cache disabled.", path);
+    free(path);
+    return false;
+  }
+
+  psglx->prog_cache_dir = path;
+
+  return true;
+}
+
+/**
+ * Compute the cache key of a program.
+ *
+ * 64-bit FNV-1a over the GL vendor, renderer and version strings and the
+ * shader sources, so driver updates and shader changes never hit a stale
+ * binary.
+ */
+static uint64_t
+glx_prog_cache_key(const char *vert_shader_str, const char *frag_shader_str) {
+  const char *strs[] = {
+    (const char *) glGetString(GL_VENDOR),
+    (const char *) glGetString(GL_RENDERER),
+    (const char *) glGetString(GL_VERSION),
+    vert_shader_str,
+    frag_shader_str,
+  };
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (int i = 0; i < sizeof(strs) / sizeof(strs[0]); ++i) {
+    // Hash the terminator too, to keep fields apart
+    const char *pc = (strs[i] ? strs[i]: "");
+    do {
+      hash ^= (unsigned char) *pc;
+      hash *= 0x100000001b3ULL;
+    } while (*pc++);
+  }
+
+  return hash;
+}
+
+/**
+ * Get the path of the cache file of a key.
+ */
+static char *
+glx_prog_cache_path(session_t *ps, uint64_t key) {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016" PRIx64 ".bin", key);
+  return mstrjoin(ps->psglx->prog_cache_dir, name);
+}
+
+/**
+ * Load a program from the binary cache.
+ *
+ * @return the program, or 0 on a cache miss or a rejected binary
+ */
+static GLuint
+glx_prog_cache_load(session_t *ps, uint64_t key) {
+  GLuint prog = 0;
+  void *data = NULL;
+  char *path = glx_prog_cache_path(ps, key);
+  FILE *f = fopen(path, "rb");
+  free(path);
+  if (!f)
+    return 0;
+
+  glx_prog_cache_hdr_t hdr;
+  if (1 != fread(&hdr, sizeof(hdr), 1, f)
+      || GLX_PROG_CACHE_MAGIC != hdr.magic || key != hdr.key
+      || !hdr.length || hdr.length > GLX_PROG_CACHE_MAX_LEN)
+    goto glx_prog_cache_load_end;
+
+  data = malloc(hdr.length);
+  if (!data || 1 != fread(data, hdr.length, 1, f))
+    goto glx_prog_cache_load_end;
+
+  prog = glCreateProgram();
+  if (!prog)
+    goto glx_prog_cache_load_end;
+  ps->psglx->glProgramBinaryProc(prog, hdr.format, data, hdr.length);
+
+  // The driver may reject binaries from another build of itself
+  {
+    GLint status = GL_FALSE;
+    glGetProgramiv(prog, GL_LINK_STATUS, &status);
+    if (GL_FALSE == status) {
+      glDeleteProgram(prog);
+      prog = 0;
+    }
+  }
+
+glx_prog_cache_load_end:
+  free(data);
+  fclose(f);
+
+  return prog;
+}
+
+/**
+ * Store the binary of a linked program in the cache.
+ */
+static void
+glx_prog_cache_store(session_t *ps, uint64_t key, GLuint prog) {
+  GLint len = 0;
+  glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &len);
+  if (len <= 0 || len > GLX_PROG_CACHE_MAX_LEN)
+    return;
+
+  void *data = malloc(len);
+  if (!data)
+    return;
+
+  GLsizei written = 0;
+  GLenum format = 0;
+  ps->psglx->glGetProgramBinaryProc(prog, len, &written, &format, data);
+
+  if (written > 0) {
+    glx_prog_cache_hdr_t hdr = {
+      .magic = GLX_PROG_CACHE_MAGIC,
+      .format = format,
+      .key = key,
+      .length = written,
+    };
+
+    // Write to a temporary file and rename, so a concurrent reader never
+    // sees a partial binary
+    char *path = glx_prog_cache_path(ps, key);
+    char *path_tmp = mstrjoin(path, ".tmp");
+    FILE *f = fopen(path_tmp, "wb");
+    if (f) {
+      bool success = (1 == fwrite(&hdr, sizeof(hdr), 1, f)
+          && 1 == fwrite(data, written, 1, f));
+      success = !fclose(f) && success;
+      if (!success || rename(path_tmp, path)) {
+        printf_errf("(): Failed to write program cache file \"%s\".", path);
+        remove(path_tmp);
+      }
+    }
+    free(path_tmp);
+    free(path);
+  }
+
+  free(data);
+}
+
+/**
+ * @brief Create a program from vertex and fragment shader strings, going
+ * through the program binary cache if it's enabled.
+ */
+GLuint
+glx_create_program_cached(session_t *ps, const char *vert_shader_str,
+    const char *frag_shader_str) {
+  if (!ps->psglx->prog_cache_dir)
+    return glx_create_program_from_str(vert_shader_str, frag_shader_str);
+
+  const uint64_t key = glx_prog_cache_key(vert_shader_str, frag_shader_str);
+  GLuint prog = glx_prog_cache_load(ps, key);
+  if (prog)
+    return prog;
+
+  prog = glCreateProgram();
+  if (!prog) {
+    printf_errf("(): Failed to create program.");
+    return 0;
+  }
+
+  // The hint must be set before linking
+  ps->psglx->glProgramParameteriProc(prog,
+      GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  if (!glx_link_program_from_str(prog, vert_shader_str, frag_shader_str)) {
+    glDeleteProgram(prog);
+    return 0;
+  }
+
+  glx_prog_cache_store(ps, key, prog);
+
+  return prog;
+}
+#endif
+
+
+#ifdef CONFIG_GLX_CORE
+/// Uniform block "Win" of the glx_core window program, matching
+/// <code>glx_core_block_t</code>.
+#define GLX_CORE_WIN_BLOCK \
+  "layout(std140) uniform Win {\n" \
+  "  vec4 body;\n" \
+  "  vec4 xform;\n" \
+  "  float opacity;\n" \
+  "  float frame_opacity;\n" \
+  "  float dim;\n" \
+  "  bool argb;\n" \
+  "  bool invert;\n" \
+  "};\n"
+
+/**
+ * Create an OpenGL 3.3 core profile context for the glx_core backend.
+ */
+static GLXContext
+glx_core_create_context(session_t *ps, XVisualInfo *pvis) {
+  GLXFBConfig fbconfig = get_fbconfig_from_visualinfo(ps, pvis);
+  if (!fbconfig) {
+    printf_errf("(): Failed to get GLXFBConfig for root visual %#lx.",
+        pvis->visualid);
+    return NULL;
+  }
+
+  if (!glx_hasglxext(ps, "GLX_ARB_create_context_profile"))
+    return NULL;
+
+  f_glXCreateContextAttribsARB p_glXCreateContextAttribsARB =
+    (f_glXCreateContextAttribsARB)
+    glXGetProcAddress((const GLubyte *) "glXCreateContextAttribsARB");
+  if (!p_glXCreateContextAttribsARB) {
+    printf_errf("(): Failed to get glXCreateContextAttribsARB().");
+    return NULL;
+  }
+
+  static const int attrib_list[] = {
+    GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+    GLX_CONTEXT_MINOR_VERSION_ARB, 3,
+    GLX_CONTEXT_PROFILE_MASK_ARB, GLX_CONTEXT_CORE_PROFILE_BIT_ARB,
+#ifdef DEBUG_GLX_DEBUG_CONTEXT
+    GLX_CONTEXT_FLAGS_ARB, GLX_CONTEXT_DEBUG_BIT_ARB,
 #endif
+    None
+  };
+  return p_glXCreateContextAttribsARB(ps->dpy, fbconfig, NULL, GL_TRUE,
+      attrib_list);
+}
+
+/**
+ * Build a glx_core program and look up its uniforms.
+ */
+static bool
+glx_core_build_prog(session_t *ps, glx_core_prog_t *pprog,
+    const char *vshader_str, const char *fshader_str) {
+  pprog->prog = glx_create_program_cached(ps, vshader_str, fshader_str);
+  if (!pprog->prog)
+    return false;
+
+  pprog->unifm_root_size = glGetUniformLocation(pprog->prog, "root_size");
+  pprog->unifm_color = glGetUniformLocation(pprog->prog, "color");
+
+  const GLuint block_idx = glGetUniformBlockIndex(pprog->prog, "Win");
+  if (GL_INVALID_INDEX != block_idx)
+    glUniformBlockBinding(pprog->prog, block_idx, 0);
 
+  // The texture unit never changes
+  const GLint unifm_tex = glGetUniformLocation(pprog->prog, "tex");
+  if (unifm_tex >= 0) {
+    glx_use_program(ps, pprog->prog);
+    glUniform1i(unifm_tex, 0);
+  }
+
+  return true;
+}
+
+/**
+ * Build the programs and buffers of the glx_core backend.
+ */
+static bool
+glx_core_init(session_t *ps) {
+  static const char *VERT_SHADER_WIN =
+    "#version 330 core\n"
+    GLX_CORE_WIN_BLOCK
+    "layout(location = 0) in vec2 pos;\n"
+    "layout(location = 1) in vec2 coord;\n"
+    "uniform vec2 root_size;\n"
+    "out vec2 tex_coord;\n"
+    "\n"
+    "void main() {\n"
+    "  vec2 p = pos * xform.xy + xform.zw;\n"
+    "  gl_Position = vec4(p / root_size * 2.0 - 1.0, 0.0, 1.0);\n"
+    "  tex_coord = coord;\n"
+    "}\n";
+  static const char *FRAG_SHADER_WIN =
+    GLX_CORE_WIN_BLOCK
+    "uniform SAMPLER tex;\n"
+    "in vec2 tex_coord;\n"
+    "out vec4 frag_color;\n"
+    "\n"
+    "void main() {\n"
+    "  vec4 c = texture(tex, tex_coord);\n"
+    "  if (!argb)\n"
+    "    c.a = 1.0;\n"
+    "  // Negation of premultiplied color\n"
+    "  if (invert)\n"
+    "    c.rgb = vec3(c.a) - c.rgb;\n"
+    "  c.rgb *= 1.0 - dim;\n"
+    "  bool in_body = all(greaterThanEqual(gl_FragCoord.xy, body.xy))\n"
+    "    && all(lessThan(gl_FragCoord.xy, body.zw));\n"
+    "  frag_color = c * (in_body ? opacity: frame_opacity);\n"
+    "}\n";
+  static const char *FRAG_SHADER_PREFIXES[2] = {
+    "#version 330 core\n#define SAMPLER sampler2D\n",
+    "#version 330 core\n#define SAMPLER sampler2DRect\n",
+  };
+  static const char *VERT_SHADER_FILL =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 pos;\n"
+    "uniform vec2 root_size;\n"
+    "\n"
+    "void main() {\n"
+    "  gl_Position = vec4(pos / root_size * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+  static const char *FRAG_SHADER_FILL =
+    "#version 330 core\n"
+    "uniform vec4 color;\n"
+    "out vec4 frag_color;\n"
+    "\n"
+    "void main() {\n"
+    "  frag_color = color;\n"
+    "}\n";
+
+  glx_core_t *pcore = &ps->psglx->core;
+
+  for (int i = 0; i < 2; ++i) {
+    char *fshader_str = mstrjoin(FRAG_SHADER_PREFIXES[i], FRAG_SHADER_WIN);
+    const bool built = glx_core_build_prog(ps, &pcore->win_progs[i],
+        VERT_SHADER_WIN, fshader_str);
+    free(fshader_str);
+    if (!built) {
+      printf_errf("(): Failed to build window program.");
+      return false;
+    }
+  }
+  if (!glx_core_build_prog(ps, &pcore->fill_prog, VERT_SHADER_FILL,
+        FRAG_SHADER_FILL)) {
+    printf_errf("(): Failed to build fill program.");
+    return false;
+  }
+
+  glGenVertexArrays(1, &pcore->vao);
+  glGenBuffers(1, &pcore->vbo);
+  glGenBuffers(1, &pcore->ubo);
+  glGenSamplers(2, pcore->samplers);
+  if (!pcore->vao || !pcore->vbo || !pcore->ubo
+      || !pcore->samplers[0] || !pcore->samplers[1]) {
+    printf_errf("(): Failed to generate GL objects.");
+    return false;
+  }
+
+  // Core profiles draw nothing without a vertex array object. There's
+  // only one, holding interleaved positions and texture coordinates.
+  glBindVertexArray(pcore->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, pcore->vbo);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
+      NULL);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
+      (const GLvoid *) (2 * sizeof(GLfloat)));
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_UNIFORM_BUFFER, pcore->ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(glx_core_block_t), NULL,
+      GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, 0, pcore->ubo);
+  pcore->block_valid = false;
+
+  // Scaled textures are filtered, unscaled ones are sampled pixel by pixel
+  for (int i = 0; i < 2; ++i) {
+    const GLint filter = (i ? GL_LINEAR: GL_NEAREST);
+    glSamplerParameteri(pcore->samplers[i], GL_TEXTURE_MIN_FILTER, filter);
+    glSamplerParameteri(pcore->samplers[i], GL_TEXTURE_MAG_FILTER, filter);
+    glSamplerParameteri(pcore->samplers[i], GL_TEXTURE_WRAP_S,
+        GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(pcore->samplers[i], GL_TEXTURE_WRAP_T,
+        GL_CLAMP_TO_EDGE);
+  }
+
+  glx_check_err(ps);
+
+  return true;
+}
+
+/**
+ * Free the programs and buffers of the glx_core backend.
+ */
+static void
+glx_core_destroy(session_t *ps) {
+  glx_core_t *pcore = &ps->psglx->core;
+
+  glx_use_program(ps, 0);
+  for (int i = 0; i < 2; ++i)
+    if (pcore->win_progs[i].prog)
+      glDeleteProgram(pcore->win_progs[i].prog);
+  if (pcore->fill_prog.prog)
+    glDeleteProgram(pcore->fill_prog.prog);
+  if (pcore->vao) {
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &pcore->vao);
+  }
+  if (pcore->vbo)
+    glDeleteBuffers(1, &pcore->vbo);
+  if (pcore->ubo)
+    glDeleteBuffers(1, &pcore->ubo);
+  if (pcore->samplers[0] || pcore->samplers[1]) {
+    glBindSampler(0, 0);
+    glDeleteSamplers(2, pcore->samplers);
+  }
+  free(pcore->verts);
+
+  memset(pcore, 0, sizeof(glx_core_t));
+}
+
+/**
+ * Callback to run on root window size change with glx_core.
+ */
+static void
+glx_core_on_root_change(session_t *ps) {
+  glx_core_t *pcore = &ps->psglx->core;
+
+  // The emulated back buffer follows the screen, the offscreen target
+  // keeps its own size
+  if (!ps->o.offscreen_width && ps->psglx->tgt_fbo)
+    glx_alloc_tgt_rbs(ps);
+
+  glx_core_prog_t * const progs[] = {
+    &pcore->win_progs[0], &pcore->win_progs[1], &pcore->fill_prog,
+  };
+  for (int i = 0; i < sizeof(progs) / sizeof(progs[0]); ++i) {
+    if (!progs[i]->prog || progs[i]->unifm_root_size < 0)
+      continue;
+    glx_use_program(ps, progs[i]->prog);
+    glUniform2f(progs[i]->unifm_root_size, ps->root_width, ps->root_height);
+  }
+
+  glx_check_err(ps);
+}
+
+/**
+ * Make room for a number of vertices in the vertex scratch buffer.
+ */
+static bool
+glx_core_reserve(session_t *ps, int nverts) {
+  glx_core_t *pcore = &ps->psglx->core;
+
+  if (nverts <= pcore->verts_max)
+    return true;
+
+  const int max = max_i(nverts, pcore->verts_max * 2);
+  GLfloat *verts = realloc(pcore->verts, max * 4 * sizeof(GLfloat));
+  if (!verts) {
+    printf_errf("(): Failed to allocate memory for %d vertices.", max);
+    return false;
+  }
+  pcore->verts = verts;
+  pcore->verts_max = max;
+
+  return true;
+}
+
+/**
+ * Write the two triangles of a rectangle to a vertex array.
+ *
+ * @return the position after the written vertices
+ */
+static inline GLfloat *
+glx_core_put_rect(GLfloat *v, GLfloat x, GLfloat y, GLfloat xe, GLfloat ye,
+    GLfloat s, GLfloat t, GLfloat se, GLfloat te) {
+  const GLfloat quad[6][4] = {
+    { x, y, s, t },
+    { xe, y, se, t },
+    { xe, ye, se, te },
+    { x, y, s, t },
+    { xe, ye, se, te },
+    { x, ye, s, te },
+  };
+  memcpy(v, quad, sizeof(quad));
+
+  return v + 6 * 4;
+}
+
+/**
+ * Build the vertices covering the part of a rectangle to paint, textured
+ * from an area of a texture if there's one.
+ *
+ * Same as the fixed-function path, the painted region is only cut into
+ * rectangles with --glx-no-stencil, and left to the stencil buffer
+ * otherwise.
+ *
+ * @return number of vertices built, -1 on failure
+ */
+static int
+glx_core_build_quads(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg) {
+  XRectangle rec_all = { .x = dx, .y = dy, .width = width, .height = height };
+  const XRectangle *rects = &rec_all;
+  XRectangle *rects_free = NULL;
+  int nrects = 1;
+
+  if (ps->o.glx_no_stencil && reg_tgt) {
+    if (pcache_reg) {
+      rects = pcache_reg->rects;
+      nrects = pcache_reg->nrects;
+    }
+    else {
+      XserverRegion reg_new = XFixesCreateRegion(ps->dpy, &rec_all, 1);
+      XFixesIntersectRegion(ps->dpy, reg_new, reg_new, reg_tgt);
+      nrects = 0;
+      rects = rects_free = XFixesFetchRegion(ps->dpy, reg_new, &nrects);
+      free_region(ps, &reg_new);
+    }
+  }
+
+  if (!glx_core_reserve(ps, nrects * 6)) {
+    cxfree(rects_free);
+    return -1;
+  }
+
+  GLfloat *v = ps->psglx->core.verts;
+  for (int i = 0; i < nrects; ++i) {
+    XRectangle crect;
+    rect_crop(&crect, &rects[i], &rec_all);
+    if (!crect.width || !crect.height)
+      continue;
+
+    // Vertices are in GL window coordinates, with the Y axis pointing
+    // upwards
+    const GLfloat vx = crect.x;
+    const GLfloat vy = ps->root_height - crect.y;
+    GLfloat s = 0.0f, t = 0.0f, se = 0.0f, te = 0.0f;
+    if (ptex) {
+      s = crect.x - dx + x;
+      t = crect.y - dy + y;
+      se = s + crect.width;
+      te = t + crect.height;
+      if (GL_TEXTURE_2D == ptex->target) {
+        s /= ptex->width;
+        se /= ptex->width;
+        t /= ptex->height;
+        te /= ptex->height;
+      }
+      if (!ptex->y_inverted) {
+        const GLfloat h = (GL_TEXTURE_2D == ptex->target ? 1.0f:
+            ptex->height);
+        t = h - t;
+        te = h - te;
+      }
+    }
+    v = glx_core_put_rect(v, vx, vy, vx + crect.width, vy - crect.height,
+        s, t, se, te);
+  }
+
+  cxfree(rects_free);
+
+  return (v - ps->psglx->core.verts) / 4;
+}
+
+/**
+ * Stream the built vertices to the vertex buffer and draw them with the
+ * bound program.
+ */
+static void
+glx_core_draw(session_t *ps, int nverts) {
+  glx_core_t *pcore = &ps->psglx->core;
+
+  // Respecifying the whole store lets the driver hand out fresh memory
+  // instead of waiting for draws still reading the old one
+  glBindBuffer(GL_ARRAY_BUFFER, pcore->vbo);
+  glBufferData(GL_ARRAY_BUFFER, nverts * 4 * sizeof(GLfloat), pcore->verts,
+      GL_STREAM_DRAW);
+  glDrawArrays(GL_TRIANGLES, 0, nverts);
+}
+
+/**
+ * Draw rectangles into the stencil buffer with glx_core.
+ *
+ * Color writes are expected to be masked off by the caller.
+ */
+static void
+glx_core_stencil_rects(session_t *ps, const XRectangle *rects, int nrects) {
+  if (!glx_core_reserve(ps, nrects * 6))
+    return;
+
+  GLfloat *v = ps->psglx->core.verts;
+  for (int i = 0; i < nrects; ++i) {
+    const GLfloat x = rects[i].x;
+    const GLfloat y = ps->root_height - rects[i].y;
+    v = glx_core_put_rect(v, x, y, x + rects[i].width, y - rects[i].height,
+        0.0f, 0.0f, 0.0f, 0.0f);
+  }
+
+  glx_use_program(ps, ps->psglx->core.fill_prog.prog);
+  glx_core_draw(ps, nrects * 6);
+
+  glx_check_err(ps);
+}
+
+/**
+ * Fill a region with a color with glx_core.
+ *
+ * Blending is left to the caller.
+ */
+static void
+glx_core_fill(session_t *ps, int dx, int dy, int width, int height,
+    const GLfloat *color, XserverRegion reg_tgt,
+    const reg_data_t *pcache_reg) {
+  const glx_core_prog_t *pprog = &ps->psglx->core.fill_prog;
+
+  const int nverts = glx_core_build_quads(ps, NULL, 0, 0, dx, dy,
+      width, height, reg_tgt, pcache_reg);
+  if (nverts <= 0)
+    return;
+
+  glx_use_program(ps, pprog->prog);
+  glUniform4fv(pprog->unifm_color, 1, color);
+  glx_core_draw(ps, nverts);
+}
+
+/**
+ * Upload the parameters of a window draw, unless they are already there.
+ */
+static void
+glx_core_set_block(session_t *ps, const glx_core_block_t *pblock) {
+  glx_core_t *pcore = &ps->psglx->core;
+
+  if (pcore->block_valid
+      && !memcmp(&pcore->block, pblock, sizeof(glx_core_block_t)))
+    return;
+
+  glBindBuffer(GL_UNIFORM_BUFFER, pcore->ubo);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glx_core_block_t), pblock);
+  pcore->block = *pblock;
+  pcore->block_valid = true;
+}
+
+/**
+ * Render a region with texture data with glx_core.
+ *
+ * Opacity, frame opacity, color inversion and dimming are all applied in
+ * one pass.
+ *
+ * @param xform scale (x, y) and translation (x, y) applied to the painted
+ *              rectangle in GL window coordinates, NULL for none
+ * @param pdimmed set to whether the window is dimmed in the pass
+ */
+bool
+glx_core_render(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height,
+    const glx_win_params_t *pparams, const GLfloat *xform,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg, bool *pdimmed) {
+  if (!ptex || !ptex->texture) {
+    printf_errf("(): Missing texture.");
+    return false;
+  }
+
+  glx_core_t *pcore = &ps->psglx->core;
+  const bool argb = pparams->argb || (GLX_TEXTURE_FORMAT_RGBA_EXT ==
+      ps->psglx->fbconfigs[ptex->depth]->texture_fmt);
+  const bool frame = pparams->frame_opacity;
+  const bool blend = argb || pparams->opacity < 1.0 || frame;
+  // Dimming blends a black layer over the window and whatever is below it,
+  // so it can only be folded in when nothing shows through
+  const bool dim = pparams->dim && !blend;
+  if (pdimmed)
+    *pdimmed = dim;
+
+  glx_core_block_t block = {
+    .xform = { 1.0f, 1.0f, 0.0f, 0.0f },
+    .opacity = pparams->opacity,
+    .frame_opacity = (frame ? pparams->frame_opacity: pparams->opacity),
+    .dim = (dim ? pparams->dim: 0.0),
+    .argb = argb,
+    .invert = pparams->neg,
+  };
+  if (frame) {
+    // In GL window coordinates, with the Y axis pointing upwards
+    const XRectangle *pbody = &pparams->body;
+    block.body[0] = pbody->x;
+    block.body[1] = ps->root_height - pbody->y - pbody->height;
+    block.body[2] = pbody->x + pbody->width;
+    block.body[3] = ps->root_height - pbody->y;
+  }
+  if (xform)
+    memcpy(block.xform, xform, sizeof(block.xform));
+
+  const int nverts = glx_core_build_quads(ps, ptex, x, y, dx, dy,
+      width, height, reg_tgt, pcache_reg);
+  if (nverts < 0)
+    return false;
+  if (!nverts)
+    return true;
+
+#ifdef DEBUG_GLX
+  printf_dbgf("(): Draw: %d, %d, %d, %d -> %d, %d (%d, %d)\n", x, y, width, height, dx, dy, ptex->width, ptex->height);
+#endif
+
+  if (blend) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  }
+
+  glx_core_set_block(ps, &block);
+  glx_use_program(ps,
+      pcore->win_progs[GL_TEXTURE_RECTANGLE == ptex->target].prog);
+  glBindSampler(0, pcore->samplers[xform ? 1: 0]);
+  glBindTexture(ptex->target, ptex->texture);
+  glx_core_draw(ps, nverts);
+  glBindTexture(ptex->target, 0);
+
+  if (blend)
+    glDisable(GL_BLEND);
+
+  glx_check_err(ps);
+
+  return true;
+}
+
+/**
+ * Put a frame painted with glx_core on screen.
+ *
+ * Painting goes to a framebuffer object that keeps its contents, so only
+ * damaged parts are repainted without reading back the front buffer.
+ * It's blitted to the back buffer here, only the damaged part of it with
+ * --glx-use-copysubbuffermesa.
+ */
+void
+glx_core_present(session_t *ps, XserverRegion reg) {
+  const int w = ps->root_width, h = ps->root_height;
+
+  glx_set_clip(ps, None, NULL);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glDrawBuffer(GL_BACK);
+
+  if (ps->o.glx_use_copysubbuffermesa) {
+    int nrects = 0;
+    XRectangle *rects = XFixesFetchRegion(ps->dpy, reg, &nrects);
+    for (int i = 0; i < nrects; ++i) {
+      const int x = rects[i].x;
+      const int y = h - rects[i].y - rects[i].height;
+      const int xe = x + rects[i].width;
+      const int ye = y + rects[i].height;
+      glBlitFramebuffer(x, y, xe, ye, x, y, xe, ye, GL_COLOR_BUFFER_BIT,
+          GL_NEAREST);
+    }
+    cxfree(rects);
+    glx_swap_copysubbuffermesa(ps, reg);
+  }
+  else {
+    glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT,
+        GL_NEAREST);
+    glXSwapBuffers(ps->dpy, get_tgt_window(ps));
+  }
+
+  glx_bind_tgt(ps);
+
+  glx_check_err(ps);
+}
+#endif
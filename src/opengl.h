@@ -11,7 +11,11 @@
 #include "common.h"
 
 #include <ctype.h>
+#include <math.h>
 #include <locale.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #ifdef DEBUG_GLX_ERR
 
@@ -108,6 +112,19 @@ glx_hasglxext(session_t *ps, const char *ext) {
  */
 static inline bool
 glx_hasglext(session_t *ps, const char *ext) {
+#ifdef CONFIG_GLX_CORE
+  // Core profiles only list extensions one by one
+  if (glx_is_core(ps)) {
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; ++i)
+      if (!strcmp((const char *) glGetStringi(GL_EXTENSIONS, i), ext))
+        return true;
+    printf_errf("(): Missing GL extension %s.", ext);
+    return false;
+  }
+#endif
+
   const char *gl_exts = (const char *) glGetString(GL_EXTENSIONS);
   if (!gl_exts) {
     printf_errf("(): Failed get GL extension list.");
@@ -129,6 +146,53 @@ get_visualinfo_from_visual(session_t *ps, Visual *visual) {
   return XGetVisualInfo(ps->dpy, VisualIDMask, &vreq, &nitems);
 }
 
+/**
+ * Get the buffer painting goes to.
+ */
+static inline GLenum
+glx_tgt_buffer(session_t *ps) {
+  return (ps->psglx->tgt_fbo ? GL_COLOR_ATTACHMENT0: GL_BACK);
+}
+
+/**
+ * Get the buffer holding the last complete frame.
+ */
+static inline GLenum
+glx_frame_buffer(session_t *ps) {
+  return (ps->psglx->tgt_fbo ? GL_COLOR_ATTACHMENT0: GL_FRONT);
+}
+
+/**
+ * Bind the framebuffer painting goes to.
+ */
+static inline void
+glx_bind_tgt(session_t *ps) {
+#if defined(CONFIG_VSYNC_OPENGL_GLSL) || defined(CONFIG_VSYNC_OPENGL_FBO)
+  const GLenum drawbuf = glx_tgt_buffer(ps);
+  glBindFramebuffer(GL_FRAMEBUFFER, ps->psglx->tgt_fbo);
+  glDrawBuffers(1, &drawbuf);
+#endif
+}
+
+/**
+ * Unbind any GLSL program before painting with the fixed-function
+ * pipeline.
+ */
+static inline void
+glx_unbind_program(session_t *ps) {
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+  glx_use_program(ps, 0);
+#endif
+}
+
+#ifdef CONFIG_VSYNC_OPENGL_FBO
+static void
+glx_alloc_tgt_rbs(session_t *ps);
+#endif
+
+static bool
+glx_init_offscreen(session_t *ps);
+
 static bool
 glx_update_fbconfig(session_t *ps);
 
@@ -136,6 +200,11 @@ static int
 glx_cmp_fbconfig(session_t *ps,
     const glx_fbconfig_t *pfbc_a, const glx_fbconfig_t *pfbc_b);
 
+static void
+glx_render_tex_quads(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height, int z,
+    bool dual_texture, XserverRegion reg_tgt, const reg_data_t *pcache_reg);
+
 static void
 glx_render_color(session_t *ps, int dx, int dy, int width, int height, int z,
     XserverRegion reg_tgt, const reg_data_t *pcache_reg);
@@ -143,3 +212,54 @@ glx_render_color(session_t *ps, int dx, int dy, int width, int height, int z,
 static void
 glx_render_dots(session_t *ps, int dx, int dy, int width, int height, int z,
     XserverRegion reg_tgt, const reg_data_t *pcache_reg);
+
+#ifdef CONFIG_VSYNC_OPENGL_GLSL
+static bool
+glx_prog_cache_init(session_t *ps);
+
+static bool
+glx_init_shadow(session_t *ps);
+
+static glx_prog_variant_t *
+glx_get_win_variant(session_t *ps, int key);
+#endif
+
+#ifdef CONFIG_GLX_CORE
+static GLXContext
+glx_core_create_context(session_t *ps, XVisualInfo *pvis);
+
+static bool
+glx_core_build_prog(session_t *ps, glx_core_prog_t *pprog,
+    const char *vshader_str, const char *fshader_str);
+
+static bool
+glx_core_init(session_t *ps);
+
+static void
+glx_core_destroy(session_t *ps);
+
+static void
+glx_core_on_root_change(session_t *ps);
+
+static bool
+glx_core_reserve(session_t *ps, int nverts);
+
+static int
+glx_core_build_quads(session_t *ps, const glx_texture_t *ptex,
+    int x, int y, int dx, int dy, int width, int height,
+    XserverRegion reg_tgt, const reg_data_t *pcache_reg);
+
+static void
+glx_core_draw(session_t *ps, int nverts);
+
+static void
+glx_core_stencil_rects(session_t *ps, const XRectangle *rects, int nrects);
+
+static void
+glx_core_fill(session_t *ps, int dx, int dy, int width, int height,
+    const GLfloat *color, XserverRegion reg_tgt,
+    const reg_data_t *pcache_reg);
+
+static void
+glx_core_set_block(session_t *ps, const glx_core_block_t *pblock);
+#endif
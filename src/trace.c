@@ -0,0 +1,966 @@
+/*
+ * Compton - a compositor for X11
+ *
+ * Based on `xcompmgr` - Copyright (c) 2003, Keith Packard
+ *
+ * Copyright (c) 2011-2013, Christopher Jeffrey
+ * See LICENSE for more information.
+ *
+ */
+
+#include "trace.h"
+
+/**
+ * Allocate a trace and open its file.
+ */
+static trace_t *
+trace_new(const char *path, bool replay) {
+  trace_t *t = allocchk(calloc(1, sizeof(trace_t)));
+  t->replay = replay;
+  if (!(t->f = fopen(path, (replay ? "rb": "wb")))) {
+    printf_errf("(\"%s\"): Failed to open trace file.", path);
+    free(t);
+    return NULL;
+  }
+
+  return t;
+}
+
+/**
+ * Start recording the events compton handles to the file specified by
+ * <code>--trace-record</code>.
+ *
+ * Must be called with the server grabbed, so the snapshot of existing
+ * windows matches the events that follow.
+ */
+bool
+trace_record_start(session_t *ps) {
+  trace_t *t = trace_new(ps->o.trace_record, false);
+  if (!t)
+    return false;
+  ps->trace = t;
+
+  fwrite(TRACE_MAGIC, strlen(TRACE_MAGIC), 1, t->f);
+  trace_put_u32(t, TRACE_VERSION);
+  trace_put_u32(t, ps->root);
+  trace_put_u16(t, ps->root_width);
+  trace_put_u16(t, ps->root_height);
+
+  // Snapshot of existing windows
+  t->last = trace_now();
+  trace_rec_props(ps, ps->root);
+  trace_rec_tree(ps, ps->root, 1);
+
+  if (ferror(t->f)) {
+    printf_errf("(\"%s\"): Failed to write trace file.", ps->o.trace_record);
+    trace_destroy(ps);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Start replaying the trace specified by <code>--trace-replay</code>,
+ * on a separate X connection.
+ */
+bool
+trace_replay_start(session_t *ps) {
+  const char *path = ps->o.trace_replay;
+  trace_t *t = trace_new(path, true);
+  if (!t)
+    return false;
+  ps->trace = t;
+
+  {
+    char magic[sizeof(TRACE_MAGIC) - 1];
+    uint32_t version = 0, old_root = 0;
+    uint16_t width = 0, height = 0;
+    if (1 != fread(magic, sizeof(magic), 1, t->f)
+        || memcmp(magic, TRACE_MAGIC, sizeof(magic))
+        || !trace_get_u32(t, &version) || TRACE_VERSION != version
+        || !trace_get_u32(t, &old_root)
+        || !trace_get_u16(t, &width) || !trace_get_u16(t, &height)) {
+      printf_errf("(\"%s\"): Not a trace file this version of compton "
+          "can replay.", path);
+      goto trace_replay_start_err;
+    }
+    if (width != ps->root_width || height != ps->root_height)
+      printf_errf("(): Trace was recorded on a %dx%d screen, replaying on "
+          "%dx%d.", width, height, ps->root_width, ps->root_height);
+    t->old_root = old_root;
+  }
+
+  if (!(t->dpy = XOpenDisplay(DisplayString(ps->dpy)))) {
+    printf_errf("(): Failed to open X connection for replay.");
+    goto trace_replay_start_err;
+  }
+
+  {
+    const Window root = RootWindow(t->dpy, ps->scr);
+    XGCValues gcv = { .subwindow_mode = IncludeInferiors };
+    t->gc = XCreateGC(t->dpy, root, GCSubwindowMode, &gcv);
+
+    XVisualInfo vi = { };
+    if (XMatchVisualInfo(t->dpy, ps->scr, 32, TrueColor, &vi)) {
+      t->argb_visual = vi.visual;
+      t->argb_cmap = XCreateColormap(t->dpy, root, vi.visual, AllocNone);
+    }
+  }
+
+  t->pixel = 0x336699;
+  t->start = trace_now();
+  trace_read_next(ps);
+  t->tmout = timeout_insert(ps, 0, trace_replay_timeout, NULL);
+
+  return true;
+
+trace_replay_start_err:
+  trace_destroy(ps);
+  return false;
+}
+
+/**
+ * Stop recording or replaying a trace.
+ */
+void
+trace_destroy(session_t *ps) {
+  trace_t *t = ps->trace;
+  if (!t)
+    return;
+
+  if (t->tmout)
+    timeout_drop(ps, t->tmout);
+  if (t->f)
+    fclose(t->f);
+  if (t->dpy) {
+    if (t->gc)
+      XFreeGC(t->dpy, t->gc);
+    if (t->argb_cmap)
+      XFreeColormap(t->dpy, t->argb_cmap);
+    // Closing the connection destroys all replayed windows
+    XCloseDisplay(t->dpy);
+  }
+  free(t->wmap);
+  free(t);
+  ps->trace = NULL;
+}
+
+/**
+ * Write buffered records out, before compton goes to sleep.
+ */
+void
+trace_flush(session_t *ps) {
+  if (!ps->trace->replay)
+    fflush(ps->trace->f);
+}
+
+/**
+ * Whether all records of the trace being replayed have been replayed.
+ */
+bool
+trace_finished(session_t *ps) {
+  return ps->trace && ps->trace->done;
+}
+
+/**
+ * Record an event if we are recording, and start measuring the cost of
+ * handling it.
+ */
+void
+trace_ev_begin(session_t *ps, XEvent *ev) {
+  if (!ps->trace->replay)
+    trace_rec_event(ps, ev);
+  ps->trace->ev_start = trace_now();
+}
+
+/**
+ * Finish measuring the cost of handling an event.
+ */
+void
+trace_ev_end(session_t *ps, XEvent *ev) {
+  trace_t *t = ps->trace;
+  trace_stat_add(&t->ev_stats[ev->type & (TRACE_EV_TYPES - 1)],
+      trace_now() - t->ev_start);
+}
+
+/**
+ * Start measuring the cost of a paint.
+ */
+void
+trace_paint_begin(session_t *ps) {
+  ps->trace->paint_start = trace_now();
+}
+
+/**
+ * Finish measuring the cost of a paint.
+ */
+void
+trace_paint_end(session_t *ps) {
+  trace_t *t = ps->trace;
+  trace_stat_add(&t->paint_stats, trace_now() - t->paint_start);
+}
+
+/**
+ * Print the handler cost of each event type and the paint cost to
+ * stdout, as tab-separated values in microseconds.
+ */
+void
+trace_report(session_t *ps) {
+  trace_t *t = ps->trace;
+
+  printf("# %lu records replayed in %.3f s\n", t->nrecords,
+      (trace_now() - t->start) / 1e9);
+  printf("type\tcount\ttotal_us\tmean_us\tmax_us\n");
+  for (int i = 0; i <= TRACE_EV_TYPES; ++i) {
+    const trace_stat_t *st = (i < TRACE_EV_TYPES ? &t->ev_stats[i]:
+        &t->paint_stats);
+    if (!st->count)
+      continue;
+
+    const char *name = (i < TRACE_EV_TYPES ? trace_ev_name(ps, i): "paint");
+    if (name)
+      printf("%s", name);
+    else
+      printf("%d", i);
+    printf("\t%lu\t%.1f\t%.1f\t%.1f\n", st->count, st->total / 1e3,
+        st->total / 1e3 / st->count, st->max / 1e3);
+  }
+  fflush(stdout);
+}
+
+/**
+ * Get the name of an event type compton handles, NULL if unknown.
+ */
+static const char *
+trace_ev_name(session_t *ps, int type) {
+#define T(name) [name] = #name
+  static const char * const names[LASTEvent] = {
+    T(KeyPress), T(KeyRelease), T(ButtonPress), T(ButtonRelease),
+    T(MotionNotify), T(EnterNotify), T(LeaveNotify), T(FocusIn),
+    T(FocusOut), T(KeymapNotify), T(Expose), T(GraphicsExpose),
+    T(NoExpose), T(VisibilityNotify), T(CreateNotify), T(DestroyNotify),
+    T(UnmapNotify), T(MapNotify), T(MapRequest), T(ReparentNotify),
+    T(ConfigureNotify), T(ConfigureRequest), T(GravityNotify),
+    T(ResizeRequest), T(CirculateNotify), T(CirculateRequest),
+    T(PropertyNotify), T(SelectionClear), T(SelectionRequest),
+    T(SelectionNotify), T(ColormapNotify), T(ClientMessage),
+    T(MappingNotify),
+  };
+#undef T
+
+  if (type < LASTEvent && names[type])
+    return names[type];
+  if (type == ((ps->damage_event + XDamageNotify) & (TRACE_EV_TYPES - 1)))
+    return "DamageNotify";
+  if (ps->shape_exists && type == (ps->shape_event & (TRACE_EV_TYPES - 1)))
+    return "ShapeNotify";
+  if (ps->randr_exists && type == ((ps->randr_event + RRScreenChangeNotify)
+        & (TRACE_EV_TYPES - 1)))
+    return "RRScreenChangeNotify";
+
+  return NULL;
+}
+
+/** @name Trace file encoding
+ *
+ * Values are written in host byte order, traces are meant to be replayed
+ * on the machine they are recorded on.
+ */
+///@{
+static void
+trace_put_u8(trace_t *t, uint8_t v) {
+  fputc(v, t->f);
+}
+
+static void
+trace_put_u16(trace_t *t, uint16_t v) {
+  fwrite(&v, sizeof(v), 1, t->f);
+}
+
+static void
+trace_put_u32(trace_t *t, uint32_t v) {
+  fwrite(&v, sizeof(v), 1, t->f);
+}
+
+static void
+trace_put_str(trace_t *t, const char *s) {
+  const size_t len = min_i(strlen(s), UINT16_MAX);
+  trace_put_u16(t, len);
+  fwrite(s, len, 1, t->f);
+}
+
+static bool
+trace_get_u8(trace_t *t, uint8_t *v) {
+  return 1 == fread(v, sizeof(*v), 1, t->f);
+}
+
+static bool
+trace_get_u16(trace_t *t, uint16_t *v) {
+  return 1 == fread(v, sizeof(*v), 1, t->f);
+}
+
+static bool
+trace_get_u32(trace_t *t, uint32_t *v) {
+  return 1 == fread(v, sizeof(*v), 1, t->f);
+}
+
+/**
+ * Read a string, which the caller must free.
+ */
+static char *
+trace_get_str(trace_t *t) {
+  uint16_t len = 0;
+  if (!trace_get_u16(t, &len))
+    return NULL;
+
+  char *s = allocchk(malloc(len + 1));
+  if (len && 1 != fread(s, len, 1, t->f)) {
+    free(s);
+    return NULL;
+  }
+  s[len] = '\0';
+
+  return s;
+}
+///@}
+
+/** @name Recording
+ */
+///@{
+/**
+ * Write the header of a record: its kind, the microseconds since the
+ * previous record and the window it's about.
+ */
+static void
+trace_rec_begin(trace_t *t, trace_kind_t kind, Window wid) {
+  const uint64_t now = trace_now();
+  const uint64_t delta = now / 1000 - t->last / 1000;
+  t->last = now;
+
+  trace_put_u8(t, kind);
+  trace_put_u32(t, (delta > UINT32_MAX ? UINT32_MAX: delta));
+  trace_put_u32(t, wid);
+}
+
+/**
+ * Record creation of a window.
+ */
+static void
+trace_rec_create(session_t *ps, Window wid, Window parent, int x, int y,
+    int width, int height, int border_width, int depth, int flags) {
+  trace_t *t = ps->trace;
+
+  trace_rec_begin(t, TRACE_CREATE, wid);
+  trace_put_u32(t, parent);
+  trace_put_u16(t, x);
+  trace_put_u16(t, y);
+  trace_put_u16(t, width);
+  trace_put_u16(t, height);
+  trace_put_u16(t, border_width);
+  trace_put_u8(t, depth);
+  trace_put_u8(t, flags);
+}
+
+/**
+ * Record all properties of a window.
+ */
+static void
+trace_rec_props(session_t *ps, Window wid) {
+  int natoms = 0;
+  Atom *atoms = XListProperties(ps->dpy, wid, &natoms);
+
+  for (int i = 0; i < natoms; ++i)
+    trace_rec_prop(ps, wid, atoms[i], PropertyNewValue);
+
+  cxfree(atoms);
+}
+
+/**
+ * Record the current value of a property, or its deletion.
+ *
+ * Atoms are recorded by name, as they differ between X servers. Pixmaps
+ * can't be recreated on replay, so pixmap properties are left out.
+ */
+static void
+trace_rec_prop(session_t *ps, Window wid, Atom atom, int state) {
+  trace_t *t = ps->trace;
+  Atom type = None;
+  int format = 0;
+  unsigned long nitems = 0, after = 0;
+  unsigned char *data = NULL;
+
+  if (PropertyNewValue == state
+      && (Success != XGetWindowProperty(ps->dpy, wid, atom, 0L,
+          TRACE_PROP_MAX / 4, False, AnyPropertyType, &type, &format,
+          &nitems, &after, &data) || !type))
+    state = PropertyDelete;
+  if (XA_PIXMAP == type)
+    goto trace_rec_prop_end;
+
+  char *name = XGetAtomName(ps->dpy, atom);
+  if (!name)
+    goto trace_rec_prop_end;
+
+  trace_rec_begin(t, TRACE_PROPERTY, wid);
+  trace_put_str(t, name);
+  trace_put_u8(t, PropertyDelete == state);
+  cxfree(name);
+
+  if (PropertyNewValue == state) {
+    char *type_name = XGetAtomName(ps->dpy, type);
+    trace_put_str(t, (type_name ? type_name: ""));
+    cxfree(type_name);
+    trace_put_u8(t, format);
+    trace_put_u32(t, nitems);
+
+    for (unsigned long i = 0; i < nitems; ++i) {
+      switch (format) {
+        case 8:
+          trace_put_u8(t, data[i]);
+          break;
+        case 16:
+          trace_put_u16(t, ((short *) data)[i]);
+          break;
+        case 32:
+          if (XA_ATOM == type) {
+            char *s = XGetAtomName(ps->dpy, ((long *) data)[i]);
+            trace_put_str(t, (s ? s: ""));
+            cxfree(s);
+          }
+          else
+            trace_put_u32(t, ((long *) data)[i]);
+          break;
+      }
+    }
+  }
+
+trace_rec_prop_end:
+  cxfree(data);
+}
+
+/**
+ * Record existing children of a window, their properties and their
+ * children, down to <code>TRACE_DEPTH_MAX</code>.
+ */
+static void
+trace_rec_tree(session_t *ps, Window wid, int depth) {
+  Window root_return = None, parent_return = None;
+  Window *children = NULL;
+  unsigned nchildren = 0;
+
+  if (!XQueryTree(ps->dpy, wid, &root_return, &parent_return, &children,
+        &nchildren))
+    return;
+
+  // Children are listed from bottom to top, the order to recreate them
+  for (unsigned i = 0; i < nchildren; ++i) {
+    const Window child = children[i];
+    XWindowAttributes a = { };
+    if (child == ps->reg_win || child == ps->overlay
+        || !XGetWindowAttributes(ps->dpy, child, &a))
+      continue;
+
+    trace_rec_create(ps, child, wid, a.x, a.y, a.width, a.height,
+        a.border_width, a.depth,
+        (a.override_redirect ? TRACE_WIN_OVERRIDE: 0)
+        | (InputOnly == a.class ? TRACE_WIN_INPUT_ONLY: 0)
+        | (IsUnmapped != a.map_state ? TRACE_WIN_MAPPED: 0));
+    trace_rec_props(ps, child);
+    if (depth < TRACE_DEPTH_MAX)
+      trace_rec_tree(ps, child, depth + 1);
+  }
+
+  cxfree(children);
+}
+
+/**
+ * Record an event compton is about to handle.
+ *
+ * Only events that change what's painted are recorded. Shape changes
+ * can't be replayed without copying the shape, and are left out.
+ */
+static void
+trace_rec_event(session_t *ps, XEvent *ev) {
+  trace_t *t = ps->trace;
+
+  switch (ev->type) {
+    case CreateNotify:
+      {
+        XCreateWindowEvent *e = &ev->xcreatewindow;
+        XWindowAttributes a = { };
+        if (!XGetWindowAttributes(ps->dpy, e->window, &a))
+          a.class = InputOutput;
+        trace_rec_create(ps, e->window, e->parent, e->x, e->y, e->width,
+            e->height, e->border_width, a.depth,
+            (e->override_redirect ? TRACE_WIN_OVERRIDE: 0)
+            | (InputOnly == a.class ? TRACE_WIN_INPUT_ONLY: 0));
+      }
+      break;
+    case DestroyNotify:
+      trace_rec_begin(t, TRACE_DESTROY, ev->xdestroywindow.window);
+      break;
+    case MapNotify:
+      {
+        // Properties set before compton listened to them are read on map,
+        // so record them too
+        const Window mwid = ev->xmap.window;
+        Window root_return = None, parent_return = None;
+        Window *children = NULL;
+        unsigned nchildren = 0;
+
+        trace_rec_props(ps, mwid);
+        if (XQueryTree(ps->dpy, mwid, &root_return, &parent_return,
+              &children, &nchildren)) {
+          for (unsigned i = 0; i < nchildren; ++i)
+            trace_rec_props(ps, children[i]);
+          cxfree(children);
+        }
+        trace_rec_begin(t, TRACE_MAP, mwid);
+      }
+      break;
+    case UnmapNotify:
+      trace_rec_begin(t, TRACE_UNMAP, ev->xunmap.window);
+      break;
+    case ConfigureNotify:
+      {
+        XConfigureEvent *e = &ev->xconfigure;
+        if (e->window == ps->root)
+          break;
+        trace_rec_begin(t, TRACE_CONFIGURE, e->window);
+        trace_put_u16(t, e->x);
+        trace_put_u16(t, e->y);
+        trace_put_u16(t, e->width);
+        trace_put_u16(t, e->height);
+        trace_put_u16(t, e->border_width);
+        trace_put_u32(t, e->above);
+      }
+      break;
+    case ReparentNotify:
+      {
+        XReparentEvent *e = &ev->xreparent;
+        trace_rec_begin(t, TRACE_REPARENT, e->window);
+        trace_put_u32(t, e->parent);
+        trace_put_u16(t, e->x);
+        trace_put_u16(t, e->y);
+      }
+      break;
+    case CirculateNotify:
+      trace_rec_begin(t, TRACE_CIRCULATE, ev->xcirculate.window);
+      trace_put_u8(t, ev->xcirculate.place);
+      break;
+    case PropertyNotify:
+      trace_rec_prop(ps, ev->xproperty.window, ev->xproperty.atom,
+          ev->xproperty.state);
+      break;
+    case FocusIn:
+      if (NotifyNormal == ev->xfocus.mode
+          && NotifyInferior != ev->xfocus.detail
+          && NotifyPointer != ev->xfocus.detail)
+        trace_rec_begin(t, TRACE_FOCUS, ev->xfocus.window);
+      break;
+    default:
+      if (ps->damage_event + XDamageNotify == ev->type) {
+        XDamageNotifyEvent *e = (XDamageNotifyEvent *) ev;
+        trace_rec_begin(t, TRACE_DAMAGE, e->drawable);
+        trace_put_u16(t, e->area.x);
+        trace_put_u16(t, e->area.y);
+        trace_put_u16(t, e->area.width);
+        trace_put_u16(t, e->area.height);
+      }
+      break;
+  }
+}
+///@}
+
+/** @name Replay
+ */
+///@{
+/**
+ * Get the replayed window of a recorded window, None if there's none.
+ */
+static Window
+trace_wmap_get(trace_t *t, Window old) {
+  if (old == t->old_root)
+    return DefaultRootWindow(t->dpy);
+
+  // Recently created windows are more likely to be looked up
+  for (int i = t->wmap_cnt - 1; i >= 0; --i)
+    if (old == t->wmap[i].old)
+      return t->wmap[i].new;
+
+  return None;
+}
+
+static void
+trace_wmap_set(trace_t *t, Window old, Window new, int depth) {
+  if (t->wmap_cnt == t->wmap_max) {
+    t->wmap_max = max_i(t->wmap_max * 2, 64);
+    t->wmap = allocchk(realloc(t->wmap, t->wmap_max * sizeof(trace_wmap_t)));
+  }
+  t->wmap[t->wmap_cnt++] = (trace_wmap_t) {
+    .old = old, .new = new, .depth = depth,
+  };
+}
+
+static void
+trace_wmap_remove(trace_t *t, Window old) {
+  for (int i = t->wmap_cnt - 1; i >= 0; --i)
+    if (old == t->wmap[i].old) {
+      memmove(&t->wmap[i], &t->wmap[i + 1],
+          (t->wmap_cnt - i - 1) * sizeof(trace_wmap_t));
+      --t->wmap_cnt;
+      return;
+    }
+}
+
+/**
+ * Get the depth of a replayed window, 0 for InputOnly windows.
+ */
+static int
+trace_wmap_depth(trace_t *t, Window new) {
+  for (int i = t->wmap_cnt - 1; i >= 0; --i)
+    if (new == t->wmap[i].new)
+      return t->wmap[i].depth;
+
+  return DefaultDepth(t->dpy, DefaultScreen(t->dpy));
+}
+
+/**
+ * Read an atom recorded by name.
+ */
+static bool
+trace_get_atom(trace_t *t, Atom *patom) {
+  char *name = trace_get_str(t);
+  if (!name)
+    return false;
+
+  *patom = (*name ? XInternAtom(t->dpy, name, False): None);
+  free(name);
+
+  return true;
+}
+
+/**
+ * Recreate a recorded window.
+ *
+ * Each window gets a solid background derived from its recorded ID, so
+ * replays paint the same pixels.
+ */
+static bool
+trace_play_create(session_t *ps, Window old) {
+  trace_t *t = ps->trace;
+  uint32_t old_parent = 0;
+  uint16_t x = 0, y = 0, width = 0, height = 0, border_width = 0;
+  uint8_t depth = 0, flags = 0;
+
+  if (!trace_get_u32(t, &old_parent)
+      || !trace_get_u16(t, &x) || !trace_get_u16(t, &y)
+      || !trace_get_u16(t, &width) || !trace_get_u16(t, &height)
+      || !trace_get_u16(t, &border_width)
+      || !trace_get_u8(t, &depth) || !trace_get_u8(t, &flags))
+    return false;
+
+  // A window in the snapshot may be reported created again
+  if (trace_wmap_get(t, old))
+    return true;
+
+  Window parent = trace_wmap_get(t, old_parent);
+  if (!parent)
+    parent = DefaultRootWindow(t->dpy);
+
+  XSetWindowAttributes attrs = {
+    .override_redirect = (flags & TRACE_WIN_OVERRIDE),
+    .background_pixel = (old * 2654435761UL) & 0xffffff,
+  };
+  unsigned long mask = CWOverrideRedirect;
+  Window wid = None;
+  width = max_i(width, 1);
+  height = max_i(height, 1);
+
+  if (flags & TRACE_WIN_INPUT_ONLY) {
+    wid = XCreateWindow(t->dpy, parent, (int16_t) x, (int16_t) y, width,
+        height, 0, 0, InputOnly, CopyFromParent, mask, &attrs);
+    depth = 0;
+  }
+  else if (32 == depth && t->argb_visual) {
+    attrs.background_pixel |= 0xff000000;
+    attrs.colormap = t->argb_cmap;
+    attrs.border_pixel = 0;
+    mask |= CWBackPixel | CWColormap | CWBorderPixel;
+    wid = XCreateWindow(t->dpy, parent, (int16_t) x, (int16_t) y, width,
+        height, border_width, 32, InputOutput, t->argb_visual, mask, &attrs);
+  }
+  else {
+    mask |= CWBackPixel;
+    wid = XCreateWindow(t->dpy, parent, (int16_t) x, (int16_t) y, width,
+        height, border_width, CopyFromParent, InputOutput, CopyFromParent,
+        mask, &attrs);
+    depth = trace_wmap_depth(t, parent);
+  }
+
+  trace_wmap_set(t, old, wid, depth);
+  if (flags & TRACE_WIN_MAPPED)
+    XMapWindow(t->dpy, wid);
+
+  return true;
+}
+
+/**
+ * Replay a property change or deletion.
+ */
+static bool
+trace_play_property(session_t *ps, Window wid) {
+  trace_t *t = ps->trace;
+  Atom atom = None, type = None;
+  uint8_t deleted = 0, format = 0;
+  uint32_t nitems = 0;
+
+  if (!trace_get_atom(t, &atom) || !trace_get_u8(t, &deleted))
+    return false;
+
+  if (deleted) {
+    if (wid && atom)
+      XDeleteProperty(t->dpy, wid, atom);
+    return true;
+  }
+
+  if (!trace_get_atom(t, &type) || !trace_get_u8(t, &format)
+      || !trace_get_u32(t, &nitems)
+      || (8 != format && 16 != format && 32 != format)
+      || nitems > TRACE_PROP_MAX)
+    return false;
+
+  // Xlib takes 32-bit items as longs and 16-bit ones as shorts
+  const size_t size = (32 == format ? sizeof(long):
+      (16 == format ? sizeof(short): 1));
+  unsigned char *data = allocchk(calloc(max_i(nitems, 1), size));
+  bool ret = true;
+
+  for (uint32_t i = 0; ret && i < nitems; ++i) {
+    uint8_t v8 = 0;
+    uint16_t v16 = 0;
+    uint32_t v32 = 0;
+    Atom a = None;
+    switch (format) {
+      case 8:
+        ret = trace_get_u8(t, &v8);
+        data[i] = v8;
+        break;
+      case 16:
+        ret = trace_get_u16(t, &v16);
+        ((short *) data)[i] = v16;
+        break;
+      case 32:
+        if (XA_ATOM == type) {
+          ret = trace_get_atom(t, &a);
+          ((long *) data)[i] = a;
+        }
+        else {
+          ret = trace_get_u32(t, &v32);
+          ((long *) data)[i] = (XA_WINDOW == type ? trace_wmap_get(t, v32):
+              v32);
+        }
+        break;
+    }
+  }
+
+  if (ret && wid && atom)
+    XChangeProperty(t->dpy, wid, atom, type, format, PropModeReplace, data,
+        nitems);
+  free(data);
+
+  return ret;
+}
+
+/**
+ * Replay the record whose header has been read.
+ *
+ * Records about windows that weren't recreated are skipped.
+ *
+ * @return false if the trace file is truncated
+ */
+static bool
+trace_play_record(session_t *ps) {
+  trace_t *t = ps->trace;
+  const Window wid = trace_wmap_get(t, t->next_wid);
+
+  switch (t->next_kind) {
+    case TRACE_CREATE:
+      return trace_play_create(ps, t->next_wid);
+    case TRACE_DESTROY:
+      if (wid) {
+        XDestroyWindow(t->dpy, wid);
+        trace_wmap_remove(t, t->next_wid);
+      }
+      break;
+    case TRACE_MAP:
+      if (wid)
+        XMapWindow(t->dpy, wid);
+      break;
+    case TRACE_UNMAP:
+      if (wid)
+        XUnmapWindow(t->dpy, wid);
+      break;
+    case TRACE_CONFIGURE:
+      {
+        uint16_t x = 0, y = 0, width = 0, height = 0, border_width = 0;
+        uint32_t above = 0;
+        if (!trace_get_u16(t, &x) || !trace_get_u16(t, &y)
+            || !trace_get_u16(t, &width) || !trace_get_u16(t, &height)
+            || !trace_get_u16(t, &border_width) || !trace_get_u32(t, &above))
+          return false;
+        if (!wid)
+          break;
+
+        XWindowChanges changes = {
+          .x = (int16_t) x, .y = (int16_t) y,
+          .width = max_i(width, 1), .height = max_i(height, 1),
+          .border_width = border_width,
+          .sibling = trace_wmap_get(t, above),
+        };
+        unsigned mask = CWX | CWY | CWWidth | CWHeight | CWBorderWidth;
+        // No sibling means the window is at the bottom
+        if (!above) {
+          changes.stack_mode = Below;
+          mask |= CWStackMode;
+        }
+        else if (changes.sibling) {
+          changes.stack_mode = Above;
+          mask |= CWSibling | CWStackMode;
+        }
+        XConfigureWindow(t->dpy, wid, mask, &changes);
+      }
+      break;
+    case TRACE_REPARENT:
+      {
+        uint32_t old_parent = 0;
+        uint16_t x = 0, y = 0;
+        if (!trace_get_u32(t, &old_parent)
+            || !trace_get_u16(t, &x) || !trace_get_u16(t, &y))
+          return false;
+        const Window parent = trace_wmap_get(t, old_parent);
+        if (wid && parent)
+          XReparentWindow(t->dpy, wid, parent, (int16_t) x, (int16_t) y);
+      }
+      break;
+    case TRACE_CIRCULATE:
+      {
+        uint8_t place = 0;
+        if (!trace_get_u8(t, &place))
+          return false;
+        if (wid && PlaceOnTop == place)
+          XRaiseWindow(t->dpy, wid);
+        else if (wid)
+          XLowerWindow(t->dpy, wid);
+      }
+      break;
+    case TRACE_PROPERTY:
+      return trace_play_property(ps, wid);
+    case TRACE_DAMAGE:
+      {
+        uint16_t x = 0, y = 0, width = 0, height = 0;
+        if (!trace_get_u16(t, &x) || !trace_get_u16(t, &y)
+            || !trace_get_u16(t, &width) || !trace_get_u16(t, &height))
+          return false;
+        const int depth = trace_wmap_depth(t, wid);
+        // The GC only fits windows of the root depth
+        if (!wid || depth != DefaultDepth(t->dpy, DefaultScreen(t->dpy))) {
+          if (wid && depth)
+            XClearArea(t->dpy, wid, (int16_t) x, (int16_t) y, width, height,
+                False);
+          break;
+        }
+        t->pixel = (t->pixel * 1103515245 + 12345) & 0xffffff;
+        XSetForeground(t->dpy, t->gc, t->pixel);
+        XFillRectangle(t->dpy, wid, t->gc, (int16_t) x, (int16_t) y, width,
+            height);
+      }
+      break;
+    case TRACE_FOCUS:
+      if (wid)
+        XSetInputFocus(t->dpy, wid, RevertToParent, CurrentTime);
+      break;
+    case NUM_TRACE_KINDS:
+      assert(false);
+      break;
+  }
+
+  return true;
+}
+
+/**
+ * Read the header of the next record.
+ *
+ * @return false if there are no more records
+ */
+static bool
+trace_read_next(session_t *ps) {
+  trace_t *t = ps->trace;
+  uint8_t kind = 0;
+  uint32_t delta = 0, wid = 0;
+
+  t->next_valid = false;
+  if (!trace_get_u8(t, &kind))
+    return false;
+  if (kind >= NUM_TRACE_KINDS || !trace_get_u32(t, &delta)
+      || !trace_get_u32(t, &wid)) {
+    printf_errf("(): Trace file is corrupted after %lu records.",
+        t->nrecords);
+    return false;
+  }
+
+  t->next_kind = kind;
+  t->next_wid = wid;
+  // Recorded time, in nanoseconds since recording started
+  t->last += delta * 1000UL;
+  t->next_due = (ps->o.trace_replay_speed > 0.0 ?
+      t->last / ps->o.trace_replay_speed: 0);
+  t->next_valid = true;
+
+  return true;
+}
+
+/**
+ * Timeout callback replaying due records.
+ *
+ * Both X connections are synced afterwards, so compton handles all
+ * resulting events before it paints, and replays are deterministic.
+ * At maximum speed, each record is handled and painted on its own.
+ */
+static bool
+trace_replay_timeout(session_t *ps, timeout_t *ptmout) {
+  trace_t *t = ps->trace;
+  if (t->done)
+    return true;
+
+  const uint64_t now = trace_now() - t->start;
+  while (t->next_valid && t->next_due <= now) {
+    if (!trace_play_record(ps)) {
+      printf_errf("(): Trace file is truncated after %lu records.",
+          t->nrecords);
+      t->next_valid = false;
+      break;
+    }
+    ++t->nrecords;
+    trace_read_next(ps);
+    if (!(ps->o.trace_replay_speed > 0.0))
+      break;
+  }
+
+  XSync(t->dpy, False);
+  XSync(ps->dpy, False);
+
+  // Keep firing, so the main loop returns to check whether we're done
+  if (!t->next_valid) {
+    t->done = true;
+    ptmout->interval = 0;
+  }
+  else if (t->next_due > now)
+    ptmout->interval = (t->next_due - now + 999999UL) / 1000000UL;
+  else
+    ptmout->interval = 0;
+
+  return true;
+}
+///@}
@@ -0,0 +1,218 @@
+/*
+ * Compton - a compositor for X11
+ *
+ * Based on `xcompmgr` - Copyright (c) 2003, Keith Packard
+ *
+ * Copyright (c) 2011-2013, Christopher Jeffrey
+ * See LICENSE for more information.
+ *
+ */
+
+#include "common.h"
+
+#define TRACE_MAGIC             "CMPTRACE"
+#define TRACE_VERSION           1
+/// Largest property value recorded, in bytes.
+#define TRACE_PROP_MAX          4096
+/// How deep below the root window the initial snapshot goes.
+#define TRACE_DEPTH_MAX         3
+/// Number of event types handler costs are collected for.
+#define TRACE_EV_TYPES          128
+
+/// Kinds of trace records.
+typedef enum {
+  /// A window is created, or existed when recording started.
+  TRACE_CREATE,
+  TRACE_DESTROY,
+  TRACE_MAP,
+  TRACE_UNMAP,
+  TRACE_CONFIGURE,
+  TRACE_REPARENT,
+  TRACE_CIRCULATE,
+  /// A property is changed or deleted.
+  TRACE_PROPERTY,
+  /// Contents of a window are damaged.
+  TRACE_DAMAGE,
+  /// A window gets input focus.
+  TRACE_FOCUS,
+  NUM_TRACE_KINDS,
+} trace_kind_t;
+
+/// Flags of <code>TRACE_CREATE</code> records.
+enum {
+  TRACE_WIN_OVERRIDE    = 1 << 0,
+  TRACE_WIN_INPUT_ONLY  = 1 << 1,
+  TRACE_WIN_MAPPED      = 1 << 2,
+};
+
+/// Accumulated cost of a kind of work.
+typedef struct {
+  /// Number of times the work is done.
+  unsigned long count;
+  /// Total time spent, in nanoseconds.
+  uint64_t total;
+  /// Longest time spent once, in nanoseconds.
+  uint64_t max;
+} trace_stat_t;
+
+/// Mapping from a recorded window ID to the one created on replay.
+typedef struct {
+  Window old;
+  Window new;
+  /// Depth of the replayed window, 0 for InputOnly windows.
+  int depth;
+} trace_wmap_t;
+
+/// State of an event trace being recorded or replayed.
+typedef struct _trace {
+  /// File the trace is written to or read from.
+  FILE *f;
+  /// Whether the trace is being replayed rather than recorded.
+  bool replay;
+  /// Time the last record is written or due, in nanoseconds.
+  uint64_t last;
+  /// Time handling of the current event started, in nanoseconds.
+  uint64_t ev_start;
+  /// Time the current paint started, in nanoseconds.
+  uint64_t paint_start;
+  /// Handler cost of each event type, indexed by type.
+  trace_stat_t ev_stats[TRACE_EV_TYPES];
+  /// Paint cost.
+  trace_stat_t paint_stats;
+
+  // === Replay related ===
+  /// X connection replayed windows are created on.
+  Display *dpy;
+  /// Root window of the recorded screen.
+  Window old_root;
+  /// Window ID mappings.
+  trace_wmap_t *wmap;
+  /// Number of window ID mappings.
+  int wmap_cnt;
+  /// Allocated size of <code>wmap</code>.
+  int wmap_max;
+  /// GC used to damage replayed windows.
+  GC gc;
+  /// Foreground color of the next damage.
+  unsigned long pixel;
+  /// ARGB visual for windows of depth 32, NULL if there's none.
+  Visual *argb_visual;
+  /// Colormap of <code>argb_visual</code>.
+  Colormap argb_cmap;
+  /// Timeout records are replayed from.
+  timeout_t *tmout;
+  /// Time replay started, in nanoseconds.
+  uint64_t start;
+  /// Kind of the next record, whose header has been read.
+  trace_kind_t next_kind;
+  /// Window of the next record.
+  Window next_wid;
+  /// Time the next record is due, in nanoseconds since start.
+  uint64_t next_due;
+  /// Whether the header of the next record is valid.
+  bool next_valid;
+  /// Number of records replayed.
+  unsigned long nrecords;
+  /// Whether all records have been replayed.
+  bool done;
+} trace_t;
+
+/**
+ * Get current monotonic time in nanoseconds.
+ */
+static inline uint64_t
+trace_now(void) {
+  struct timespec tp = { };
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return (uint64_t) tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+/**
+ * Add a sample to an accumulated cost.
+ */
+static inline void
+trace_stat_add(trace_stat_t *st, uint64_t ns) {
+  ++st->count;
+  st->total += ns;
+  if (ns > st->max)
+    st->max = ns;
+}
+
+static trace_t *
+trace_new(const char *path, bool replay);
+
+static void
+trace_put_u8(trace_t *t, uint8_t v);
+
+static void
+trace_put_u16(trace_t *t, uint16_t v);
+
+static void
+trace_put_u32(trace_t *t, uint32_t v);
+
+static void
+trace_put_str(trace_t *t, const char *s);
+
+static bool
+trace_get_u8(trace_t *t, uint8_t *v);
+
+static bool
+trace_get_u16(trace_t *t, uint16_t *v);
+
+static bool
+trace_get_u32(trace_t *t, uint32_t *v);
+
+static char *
+trace_get_str(trace_t *t);
+
+static void
+trace_rec_begin(trace_t *t, trace_kind_t kind, Window wid);
+
+static void
+trace_rec_create(session_t *ps, Window wid, Window parent, int x, int y,
+    int width, int height, int border_width, int depth, int flags);
+
+static void
+trace_rec_props(session_t *ps, Window wid);
+
+static void
+trace_rec_prop(session_t *ps, Window wid, Atom atom, int state);
+
+static void
+trace_rec_tree(session_t *ps, Window wid, int depth);
+
+static void
+trace_rec_event(session_t *ps, XEvent *ev);
+
+static Window
+trace_wmap_get(trace_t *t, Window old);
+
+static void
+trace_wmap_set(trace_t *t, Window old, Window new, int depth);
+
+static void
+trace_wmap_remove(trace_t *t, Window old);
+
+static int
+trace_wmap_depth(trace_t *t, Window new);
+
+static bool
+trace_get_atom(trace_t *t, Atom *patom);
+
+static bool
+trace_play_create(session_t *ps, Window old);
+
+static bool
+trace_play_property(session_t *ps, Window wid);
+
+static bool
+trace_play_record(session_t *ps);
+
+static bool
+trace_read_next(session_t *ps);
+
+static bool
+trace_replay_timeout(session_t *ps, timeout_t *ptmout);
+
+static const char *
+trace_ev_name(session_t *ps, int type);
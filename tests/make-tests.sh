@@ -7,7 +7,8 @@ BASE_DIR=$(dirname "$0")/..
 
 OPTIONS=( NO_XINERAMA NO_LIBCONFIG NO_REGEX_PCRE NO_REGEX_PCRE_JIT
   NO_VSYNC_DRM NO_VSYNC_OPENGL NO_VSYNC_OPENGL_GLSL NO_VSYNC_OPENGL_FBO
-  NO_VSYNC_OPENGL_VBO NO_DBUS NO_XSYNC NO_C2 )
+  NO_VSYNC_OPENGL_VBO ENABLE_GLX_CORE NO_DBUS NO_XSYNC NO_SHADOW_THREADS
+  NO_TRACE NO_C2 )
 
 for o in "${OPTIONS[@]}"; do
   einfo Building with $o